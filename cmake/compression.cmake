@@ -0,0 +1,35 @@
+#
+# Copyright (C) 2024 Codership Oy <info@codership.com>
+#
+
+#
+# Optional write set data compression libraries. Compressed data sets
+# are enabled in replication protocol only if both LZ4 and zstd are
+# available, see gu::Compression::supported_all().
+#
+
+set(GALERA_COMPRESSION_LIBS "")
+
+if (GALERA_WITH_LZ4)
+  check_include_file(lz4hc.h HAVE_LZ4_H)
+  find_library(HAVE_LZ4_LIB lz4)
+  if (HAVE_LZ4_H AND HAVE_LZ4_LIB)
+    add_definitions(-DGALERA_HAVE_LZ4)
+    list(APPEND GALERA_COMPRESSION_LIBS ${HAVE_LZ4_LIB})
+  else()
+    message(STATUS "LZ4 library not found, LZ4 compression not enabled")
+  endif()
+endif()
+
+if (GALERA_WITH_ZSTD)
+  check_include_file(zstd.h HAVE_ZSTD_H)
+  find_library(HAVE_ZSTD_LIB zstd)
+  if (HAVE_ZSTD_H AND HAVE_ZSTD_LIB)
+    add_definitions(-DGALERA_HAVE_ZSTD)
+    list(APPEND GALERA_COMPRESSION_LIBS ${HAVE_ZSTD_LIB})
+  else()
+    message(STATUS "zstd library not found, zstd compression not enabled")
+  endif()
+endif()
+
+message(STATUS "GALERA_COMPRESSION_LIBS: ${GALERA_COMPRESSION_LIBS}")
@@ -0,0 +1,438 @@
+//
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+//
+
+//
+// Open addressing certification index.
+//
+// Slots are organized in groups of GROUP_SIZE control bytes which are
+// probed at once (with SSE2 if available). Control byte holds 7 bits of the
+// key hash for FULL slots, EMPTY and DELETED are marked with high bit set.
+// Each slot stores the KeyPart hash inline next to the entry pointer, so that
+// a probe needs to dereference KeyEntryNG only on a full hash match.
+//
+// KeyEntryNG objects are allocated from a MemPool owned by the index.
+//
+// The index is not thread safe, it is protected by certification mutex.
+//
+// CertIndexNGShards partitions keys over several independent CertIndexNG
+// tables by key hash, so that different shards can be searched and modified
+// concurrently by different threads.
+//
+
+#ifndef GALERA_CERT_INDEX_NG_HPP
+#define GALERA_CERT_INDEX_NG_HPP
+
+#include "key_entry_ng.hpp"
+
+#include <gu_mem_pool.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <new>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace galera
+{
+    class CertIndexNG
+    {
+    public:
+
+        typedef KeyEntryNG* value_type;
+
+        static size_t const GROUP_SIZE = 16;
+
+    private:
+
+        typedef signed char ctrl_t;
+
+        static ctrl_t const EMPTY   = -128; // 0b10000000
+        static ctrl_t const DELETED = -2;   // 0b11111110
+
+        struct Slot
+        {
+            size_t      hash_;
+            KeyEntryNG* entry_;
+        };
+
+    public:
+
+        // Position of the entry in the index. Becomes invalid after any
+        // modification of the index other than erase() of this position.
+        class iterator
+        {
+        public:
+            iterator() : slot_(NULL) {}
+            KeyEntryNG* operator*()  const { return slot_->entry_; }
+            bool operator==(const iterator& o) const { return slot_ == o.slot_; }
+            bool operator!=(const iterator& o) const { return slot_ != o.slot_; }
+        private:
+            friend class CertIndexNG;
+            explicit iterator(Slot* s) : slot_(s) {}
+            Slot* slot_;
+        };
+
+        typedef iterator const_iterator;
+
+        CertIndexNG()
+            : ctrl_       (),
+              slots_      (),
+              group_mask_ (0),
+              size_       (0),
+              growth_left_(0),
+              pool_       (sizeof(KeyEntryNG), 1024, "cert_index_ng")
+        {}
+
+        ~CertIndexNG() { clear(); }
+
+        size_t size()     const { return size_; }
+        bool   empty()    const { return size_ == 0; }
+        size_t capacity() const { return ctrl_.size(); }
+
+        iterator end() const { return iterator(); }
+
+        iterator find(const KeySet::KeyPart& key) const
+        {
+            if (gu_unlikely(empty())) return end();
+
+            size_t const hash(key.hash());
+            ctrl_t const h2(H2(hash));
+
+            for (Probe p(H1(hash), group_mask_); ; p.next())
+            {
+                size_t const base(p.offset());
+                unsigned int m(match(base, h2));
+                while (m)
+                {
+                    size_t const idx(base + lowest_bit(m));
+                    Slot& s(const_cast<Slot&>(slots_[idx]));
+                    if (s.hash_ == hash && s.entry_->key().matches(key))
+                    {
+                        return iterator(&s);
+                    }
+                    m &= m - 1;
+                }
+                if (gu_likely(match_empty(base))) return end();
+            }
+        }
+
+        // Find entry matching the key, create a new one if none is found.
+        // Returns iterator and true if the entry was created.
+        std::pair<iterator, bool> insert(const KeySet::KeyPart& key)
+        {
+            iterator const found(find(key));
+            if (found != end()) return std::make_pair(found, false);
+
+            if (gu_unlikely(growth_left_ == 0)) grow();
+
+            size_t const hash(key.hash());
+            size_t const idx(find_free(hash));
+
+            if (ctrl_[idx] == EMPTY) --growth_left_;
+            ctrl_[idx] = H2(hash);
+
+            Slot& s(slots_[idx]);
+            s.hash_  = hash;
+            s.entry_ = new (pool_.acquire()) KeyEntryNG(key);
+            ++size_;
+
+            return std::make_pair(iterator(&s), true);
+        }
+
+        // Remove entry at given position and release its storage.
+        void erase(iterator it)
+        {
+            assert(it != end());
+
+            size_t const idx(it.slot_ - &slots_[0]);
+            assert(idx < slots_.size());
+            assert(ctrl_[idx] >= 0);
+
+            destroy(it.slot_->entry_);
+            it.slot_->entry_ = NULL;
+            --size_;
+
+            // If the group has an empty slot, no probe sequence could have
+            // passed through it, so the slot can be made EMPTY again.
+            size_t const base(idx & ~(GROUP_SIZE - 1));
+            if (match_empty(base))
+            {
+                ctrl_[idx] = EMPTY;
+                ++growth_left_;
+            }
+            else
+            {
+                ctrl_[idx] = DELETED;
+            }
+
+            if (gu_unlikely(capacity() > MIN_CAPACITY &&
+                            size_ < capacity() / 8))
+            {
+                rehash(capacity() / 2);
+            }
+        }
+
+        template <typename Fn>
+        void for_each(Fn fn) const
+        {
+            for (size_t i(0); i < ctrl_.size(); ++i)
+            {
+                if (ctrl_[i] >= 0) fn(slots_[i].entry_);
+            }
+        }
+
+        // Release all entries and memory.
+        void clear()
+        {
+            for (size_t i(0); i < ctrl_.size(); ++i)
+            {
+                if (ctrl_[i] >= 0) destroy(slots_[i].entry_);
+            }
+            std::vector<ctrl_t>().swap(ctrl_);
+            std::vector<Slot>().swap(slots_);
+            group_mask_  = 0;
+            size_        = 0;
+            growth_left_ = 0;
+        }
+
+    private:
+
+        CertIndexNG(const CertIndexNG&);
+        CertIndexNG& operator=(const CertIndexNG&);
+
+        static size_t const MIN_CAPACITY = GROUP_SIZE * 4;
+
+        // KeyPart hash has HEADER_BITS of upper bits cleared, so use lower
+        // 7 bits for control byte and the rest for group selection.
+        static ctrl_t H2(size_t const hash) { return ctrl_t(hash & 0x7f); }
+        static size_t H1(size_t const hash) { return hash >> 7; }
+
+        static unsigned int lowest_bit(unsigned int const m)
+        {
+            return __builtin_ctz(m);
+        }
+
+        // Triangular probing over groups, visits every group exactly once
+        // when the number of groups is a power of two.
+        class Probe
+        {
+        public:
+            Probe(size_t const h1, size_t const mask)
+                : group_(h1 & mask), mask_(mask), step_(0) {}
+            size_t offset() const { return group_ * GROUP_SIZE; }
+            void   next() { ++step_; group_ = (group_ + step_) & mask_; }
+        private:
+            size_t       group_;
+            size_t const mask_;
+            size_t       step_;
+        };
+
+#if defined(__SSE2__)
+        __m128i load(size_t const base) const
+        {
+            return _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(&ctrl_[base]));
+        }
+
+        unsigned int match(size_t const base, ctrl_t const h2) const
+        {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2),
+                                                    load(base)));
+        }
+
+        unsigned int match_empty(size_t const base) const
+        {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(EMPTY),
+                                                    load(base)));
+        }
+
+        unsigned int match_empty_or_deleted(size_t const base) const
+        {
+            // EMPTY and DELETED are the only values with high bit set
+            return _mm_movemask_epi8(load(base));
+        }
+#else
+        unsigned int match(size_t const base, ctrl_t const h2) const
+        {
+            unsigned int ret(0);
+            for (size_t i(0); i < GROUP_SIZE; ++i)
+                ret |= (unsigned int)(ctrl_[base + i] == h2) << i;
+            return ret;
+        }
+
+        unsigned int match_empty(size_t const base) const
+        {
+            return match(base, EMPTY);
+        }
+
+        unsigned int match_empty_or_deleted(size_t const base) const
+        {
+            unsigned int ret(0);
+            for (size_t i(0); i < GROUP_SIZE; ++i)
+                ret |= (unsigned int)(ctrl_[base + i] < 0) << i;
+            return ret;
+        }
+#endif /* __SSE2__ */
+
+        size_t find_free(size_t const hash) const
+        {
+            for (Probe p(H1(hash), group_mask_); ; p.next())
+            {
+                size_t const base(p.offset());
+                unsigned int const m(match_empty_or_deleted(base));
+                if (m) return base + lowest_bit(m);
+            }
+        }
+
+        void grow()
+        {
+            // Reclaim tombstones if the table is not too full, otherwise
+            // double the capacity.
+            size_t const cap(capacity());
+            rehash(cap == 0 ? MIN_CAPACITY :
+                   (size_ <= cap * 7 / 16 ? cap : cap * 2));
+        }
+
+        void rehash(size_t const new_cap)
+        {
+            assert(new_cap >= GROUP_SIZE);
+            assert((new_cap & (new_cap - 1)) == 0);
+            assert(size_ < new_cap * 7 / 8);
+
+            std::vector<ctrl_t> ctrl(new_cap, ctrl_t(EMPTY));
+            std::vector<Slot>   slots(new_cap);
+
+            ctrl.swap(ctrl_);
+            slots.swap(slots_);
+            group_mask_  = new_cap / GROUP_SIZE - 1;
+            growth_left_ = new_cap * 7 / 8 - size_;
+
+            for (size_t i(0); i < ctrl.size(); ++i)
+            {
+                if (ctrl[i] < 0) continue;
+
+                size_t const idx(find_free(slots[i].hash_));
+                ctrl_[idx]  = ctrl[i];
+                slots_[idx] = slots[i];
+            }
+        }
+
+        void destroy(KeyEntryNG* const ke)
+        {
+            ke->~KeyEntryNG();
+            pool_.recycle(ke);
+        }
+
+        std::vector<ctrl_t> ctrl_;
+        std::vector<Slot>   slots_;
+        size_t              group_mask_;
+        size_t              size_;
+        size_t              growth_left_;
+        gu::MemPoolUnsafe   pool_;
+    };
+
+    class CertIndexNGShards
+    {
+    public:
+
+        typedef CertIndexNG::value_type     value_type;
+        typedef CertIndexNG::iterator       iterator;
+        typedef CertIndexNG::const_iterator const_iterator;
+
+        static size_t const MAX_SHARDS = 64;
+
+        // Number of shards is rounded up to the power of two.
+        explicit CertIndexNGShards(size_t const n = 1)
+            : shards_(),
+              bits_  (0)
+        {
+            size_t const shards(std::min(n, size_t(MAX_SHARDS)));
+            while ((size_t(1) << bits_) < shards) ++bits_;
+            shards_.reserve(size_t(1) << bits_);
+            for (size_t i(0); i < (size_t(1) << bits_); ++i)
+            {
+                shards_.push_back(new CertIndexNG());
+            }
+        }
+
+        ~CertIndexNGShards()
+        {
+            for (size_t i(0); i < shards_.size(); ++i) delete shards_[i];
+        }
+
+        size_t shards() const { return shards_.size(); }
+
+        // Shard selection uses multiplicative hashing so that it does not
+        // correlate with the hash bits used by CertIndexNG itself.
+        size_t shard_of(const KeySet::KeyPart& key) const
+        {
+            if (bits_ == 0) return 0;
+            return (uint64_t(key.hash()) * 0x9e3779b97f4a7c15ULL)
+                >> (64 - bits_);
+        }
+
+        CertIndexNG&       shard(size_t const i)       { return *shards_[i]; }
+        const CertIndexNG& shard(size_t const i) const { return *shards_[i]; }
+
+        CertIndexNG& shard(const KeySet::KeyPart& key)
+        {
+            return *shards_[shard_of(key)];
+        }
+
+        const CertIndexNG& shard(const KeySet::KeyPart& key) const
+        {
+            return *shards_[shard_of(key)];
+        }
+
+        size_t size() const
+        {
+            size_t ret(0);
+            for (size_t i(0); i < shards_.size(); ++i) ret += shards_[i]->size();
+            return ret;
+        }
+
+        bool empty() const { return size() == 0; }
+
+        iterator end() const { return iterator(); }
+
+        iterator find(const KeySet::KeyPart& key) const
+        {
+            return shard(key).find(key);
+        }
+
+        std::pair<iterator, bool> insert(const KeySet::KeyPart& key)
+        {
+            return shard(key).insert(key);
+        }
+
+        // Key must be the one the entry at given position was found for.
+        void erase(const KeySet::KeyPart& key, iterator const it)
+        {
+            shard(key).erase(it);
+        }
+
+        template <typename Fn>
+        void for_each(Fn fn) const
+        {
+            for (size_t i(0); i < shards_.size(); ++i) shards_[i]->for_each(fn);
+        }
+
+        void clear()
+        {
+            for (size_t i(0); i < shards_.size(); ++i) shards_[i]->clear();
+        }
+
+    private:
+
+        CertIndexNGShards(const CertIndexNGShards&);
+        CertIndexNGShards& operator=(const CertIndexNGShards&);
+
+        std::vector<CertIndexNG*> shards_;
+        size_t                    bits_;
+    };
+}
+
+#endif // GALERA_CERT_INDEX_NG_HPP
@@ -0,0 +1,105 @@
+//
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+//
+
+//
+// Map of certified write sets indexed by global seqno.
+//
+// Seqnos are appended in increasing order and purged from the front, so
+// the map is kept in gu::DeqMap which makes append, lowest seqno lookup and
+// purge of the lowest seqno O(1) amortized. Seqnos which did not go through
+// certification are left as holes.
+//
+// Dummy preload events have no write set and are stored as present entries
+// with null trx handle, so that they still count as certified seqnos.
+//
+
+#ifndef GALERA_CERT_TRX_MAP_HPP
+#define GALERA_CERT_TRX_MAP_HPP
+
+#include "trx_handle.hpp"
+
+#include <gu_deqmap.hpp>
+
+#include <ostream>
+
+namespace galera
+{
+    class CertTrxMap
+    {
+    public:
+
+        CertTrxMap() : map_(0), size_(0) {}
+
+        /* number of present entries, holes are not counted */
+        size_t size()  const { return size_; }
+        bool   empty() const { return map_.empty(); }
+
+        /* seqno range of present entries, must not be called on empty map */
+        wsrep_seqno_t front_seqno() const
+        {
+            assert(!empty());
+            return map_.index_front();
+        }
+
+        wsrep_seqno_t back_seqno() const
+        {
+            assert(!empty());
+            return map_.index_back();
+        }
+
+        /* trx handle of the lowest seqno, null for dummy preload */
+        TrxHandleSlave* front() const { return map_.front().ts_.get(); }
+
+        /* @return false if seqno is already present */
+        bool insert(wsrep_seqno_t const seqno, const TrxHandleSlavePtr& ts)
+        {
+            assert(seqno >= 0);
+            if (map_.find(seqno) != map_.end()) return false;
+            map_.insert(seqno, Entry(ts));
+            ++size_;
+            return true;
+        }
+
+        /* removes the lowest seqno entry and all holes following it */
+        void pop_front()
+        {
+            assert(!empty());
+            map_.pop_front();
+            --size_;
+        }
+
+        void clear()
+        {
+            map_.clear(0);
+            size_ = 0;
+        }
+
+    private:
+
+        struct Entry
+        {
+            Entry() : ts_(), present_(false) {}
+            explicit Entry(const TrxHandleSlavePtr& ts)
+                : ts_(ts), present_(true) {}
+
+            bool operator==(const Entry& other) const
+            {
+                return present_ == other.present_ && ts_ == other.ts_;
+            }
+
+            TrxHandleSlavePtr ts_;
+            bool              present_;
+        };
+
+        friend std::ostream& operator<<(std::ostream& os, const Entry& e)
+        {
+            return os << e.ts_.get() << (e.present_ ? "" : " (hole)");
+        }
+
+        gu::DeqMap<wsrep_seqno_t, Entry> map_;
+        size_t                           size_;
+    };
+}
+
+#endif // GALERA_CERT_TRX_MAP_HPP
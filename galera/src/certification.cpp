@@ -6,9 +6,13 @@
 
 #include "gu_lock.hpp"
 #include "gu_throw.hpp"
+#include "gu_thread_keys.hpp"
 
 #include <map>
 #include <algorithm> // std::for_each
+#include <functional>
+#include <exception>
+#include <limits>
 
 using namespace galera;
 
@@ -19,19 +23,31 @@ static const bool cert_debug_on(false);
 
 #define CERT_PARAM_LOG_CONFLICTS galera::Certification::PARAM_LOG_CONFLICTS
 #define CERT_PARAM_OPTIMISTIC_PA galera::Certification::PARAM_OPTIMISTIC_PA
+#define CERT_PARAM_KEY_DEPS      galera::Certification::PARAM_KEY_DEPS
 
 static std::string const CERT_PARAM_PREFIX("cert.");
 
 std::string const CERT_PARAM_LOG_CONFLICTS(CERT_PARAM_PREFIX + "log_conflicts");
 std::string const CERT_PARAM_OPTIMISTIC_PA(CERT_PARAM_PREFIX + "optimistic_pa");
+std::string const CERT_PARAM_KEY_DEPS     (CERT_PARAM_PREFIX + "key_deps");
 
 static std::string const CERT_PARAM_MAX_LENGTH   (CERT_PARAM_PREFIX +
                                                   "max_length");
 static std::string const CERT_PARAM_LENGTH_CHECK (CERT_PARAM_PREFIX +
                                                   "length_check");
+static std::string const CERT_PARAM_SHARDS       (CERT_PARAM_PREFIX +
+                                                  "shards");
 
 static std::string const CERT_PARAM_LOG_CONFLICTS_DEFAULT("no");
 static std::string const CERT_PARAM_OPTIMISTIC_PA_DEFAULT("yes");
+static std::string const CERT_PARAM_KEY_DEPS_DEFAULT("no");
+/* Certification result does not depend on the number of shards, so unlike
+ * the constants below it may differ between the nodes. */
+static std::string const CERT_PARAM_SHARDS_DEFAULT("1");
+
+/* Write sets with fewer keys are certified serially even if the index is
+ * sharded: waking up worker threads would cost more than it saves. */
+static long const CERT_SHARDED_MIN_KEYS(256);
 
 /*** It is EXTREMELY important that these constants are the same on all nodes.
  *** Don't change them ever!!! ***/
@@ -44,6 +60,9 @@ galera::Certification::register_params(gu::Config& cnf)
     const int flags(gu::Config::Flag::type_bool);
     cnf.add(CERT_PARAM_LOG_CONFLICTS, CERT_PARAM_LOG_CONFLICTS_DEFAULT, flags);
     cnf.add(CERT_PARAM_OPTIMISTIC_PA, CERT_PARAM_OPTIMISTIC_PA_DEFAULT, flags);
+    cnf.add(CERT_PARAM_KEY_DEPS, CERT_PARAM_KEY_DEPS_DEFAULT, flags);
+    cnf.add(CERT_PARAM_SHARDS, CERT_PARAM_SHARDS_DEFAULT,
+            gu::Config::Flag::read_only | gu::Config::Flag::type_integer);
     /* The defaults below are deliberately not reflected in conf: people
      * should not know about these dangerous setting unless they read RTFM. */
     cnf.add(CERT_PARAM_MAX_LENGTH, gu::Config::Flag::hidden);
@@ -70,6 +89,155 @@ length_check(const gu::Config& conf)
         return gu::Config::from_config<int>(CERT_PARAM_LENGTH_CHECK_DEFAULT);
 }
 
+static size_t
+cert_shards(const gu::Config& conf)
+{
+    long const ret(conf.get<long>(CERT_PARAM_SHARDS));
+    if (ret < 1 || ret > long(galera::CertIndexNGShards::MAX_SHARDS))
+    {
+        gu_throw_error(EINVAL) << "Bad value for '" << CERT_PARAM_SHARDS
+                               << "': " << ret << ", must be in range [1, "
+                               << galera::CertIndexNGShards::MAX_SHARDS << ']';
+    }
+    return ret;
+}
+
+//
+// Pool of threads which execute a job for every cert index shard in
+// parallel. Shard 0 is processed by the calling thread, so there are
+// one less threads than shards.
+//
+class galera::Certification::ShardWorkers
+{
+public:
+
+    typedef std::function<void(size_t)> Job;
+
+    explicit ShardWorkers(size_t const shards)
+        :
+        mtx_       (gu::get_mutex_key(gu::GU_MUTEX_KEY_CERTIFICATION_WORKERS)),
+        cond_      (gu::get_cond_key(gu::GU_COND_KEY_CERTIFICATION_WORKERS)),
+        done_      (gu::get_cond_key(
+                        gu::GU_COND_KEY_CERTIFICATION_WORKERS_DONE)),
+        threads_   (shards - 1),
+        job_       (NULL),
+        generation_(0),
+        pending_   (0),
+        error_     (),
+        exit_      (false)
+    {
+        assert(shards > 1);
+
+        for (size_t i(0); i < threads_.size(); ++i)
+        {
+            threads_[i].pool_ = this;
+            threads_[i].idx_  = i + 1;
+            int const err(gu_thread_create(
+                              gu::get_thread_key(
+                                  gu::GU_THREAD_KEY_CERTIFICATION_WORKER),
+                              &threads_[i].thd_, thd_func, &threads_[i]));
+            if (err)
+            {
+                stop(i);
+                gu_throw_error(err) << "Failed to create certification worker";
+            }
+        }
+    }
+
+    ~ShardWorkers() { stop(threads_.size()); }
+
+    // Execute job(i) for every shard i and wait until all are done.
+    // Rethrows the first exception thrown by the job.
+    void run(const Job& job)
+    {
+        {
+            gu::Lock lock(mtx_);
+            assert(0 == pending_);
+            job_     = &job;
+            pending_ = threads_.size();
+            ++generation_;
+            cond_.broadcast();
+        }
+
+        std::exception_ptr error;
+        try { job(0); } catch (...) { error = std::current_exception(); }
+
+        gu::Lock lock(mtx_);
+        while (pending_ > 0) lock.wait(done_);
+        job_ = NULL;
+
+        if (!error) std::swap(error, error_);
+        error_ = std::exception_ptr();
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+
+    ShardWorkers(const ShardWorkers&);
+    ShardWorkers& operator=(const ShardWorkers&);
+
+    struct Thread
+    {
+        ShardWorkers* pool_;
+        size_t        idx_;
+        gu_thread_t   thd_;
+    };
+
+    static void* thd_func(void* arg)
+    {
+        Thread* const t(static_cast<Thread*>(arg));
+        t->pool_->work(t->idx_);
+        return NULL;
+    }
+
+    void work(size_t const idx)
+    {
+        unsigned long generation(0);
+
+        while (true)
+        {
+            const Job* job;
+            {
+                gu::Lock lock(mtx_);
+                while (generation == generation_ && !exit_) lock.wait(cond_);
+                if (exit_) return;
+                generation = generation_;
+                job = job_;
+            }
+
+            std::exception_ptr error;
+            try { (*job)(idx); } catch (...) { error = std::current_exception(); }
+
+            gu::Lock lock(mtx_);
+            if (error && !error_) error_ = error;
+            if (0 == --pending_) done_.signal();
+        }
+    }
+
+    void stop(size_t const started)
+    {
+        {
+            gu::Lock lock(mtx_);
+            exit_ = true;
+            cond_.broadcast();
+        }
+        for (size_t i(0); i < started; ++i)
+        {
+            gu_thread_join(threads_[i].thd_, NULL);
+        }
+    }
+
+    gu::Mutex           mtx_;
+    gu::Cond            cond_;
+    gu::Cond            done_;
+    std::vector<Thread> threads_;
+    const Job*          job_;
+    unsigned long       generation_;
+    size_t              pending_;
+    std::exception_ptr  error_;
+    bool                exit_;
+};
+
 static void
 report_stale_entry(const galera::Certification::CertIndexNG::value_type& ke,
                    const galera::KeySetIn& key_set)
@@ -95,8 +263,7 @@ check_purge_complete(const galera::Certification::CertIndexNG& cert_index,
                      const galera::TrxHandleSlave* ts,
                      const galera::KeySetIn& key_set)
 {
-    std::for_each(
-        cert_index.begin(), cert_index.end(),
+    cert_index.for_each(
         [&key_set, ts]
         (const galera::Certification::CertIndexNG::value_type& ke) {
             ke->for_each_ref([&ke, &key_set, ts](const TrxHandleSlave* ref) {
@@ -118,8 +285,7 @@ static void purge_key_set(galera::Certification::CertIndexNG& cert_index,
     for (long i(0); i < count; ++i)
     {
         const galera::KeySet::KeyPart& kp(key_set.next());
-        galera::KeyEntryNG ke(kp);
-        galera::Certification::CertIndexNG::iterator ci(cert_index.find(&ke));
+        galera::Certification::CertIndexNG::iterator ci(cert_index.find(kp));
         assert(ci != cert_index.end());
         if (ci == cert_index.end())
         {
@@ -136,25 +302,41 @@ static void purge_key_set(galera::Certification::CertIndexNG& cert_index,
             kep->unref(p, ts);
             if (kep->referenced() == false)
             {
-                cert_index.erase(ci);
-                delete kep;
+                cert_index.erase(kp, ci);
             }
         }
     }
-    if (cert_debug_on)
-    {
-        check_purge_complete(cert_index, ts, key_set);
-    }
 }
 
-void
-galera::Certification::purge_for_trx(TrxHandleSlave* trx)
+// Purge at most max_keys keys of trx from index, continuing from where
+// the previous call for this trx stopped. Purge of trx is complete when
+// purge_key_pos_ is back to 0. Returns the number of keys purged.
+long
+galera::Certification::purge_for_trx(TrxHandleSlave* trx, long const max_keys)
 {
     assert(mutex_.owned());
     assert(trx->version() >= 3 || trx->version() <= WriteSetNG::MAX_VERSION);
     const KeySetIn& keys(trx->write_set().keyset());
-    keys.rewind();
-    purge_key_set(cert_index_ng_, trx, keys, keys.count());
+    long const      count(keys.count());
+
+    // Key set iteration state is kept between calls: nothing else iterates
+    // over keys of a committed trx.
+    if (0 == purge_key_pos_) keys.rewind();
+
+    long const n(std::min(max_keys, count - purge_key_pos_));
+    purge_key_set(cert_index_ng_, trx, keys, n);
+    purge_key_pos_ += n;
+
+    if (purge_key_pos_ == count)
+    {
+        purge_key_pos_ = 0;
+        if (cert_debug_on)
+        {
+            check_purge_complete(cert_index_ng_, trx, keys);
+        }
+    }
+
+    return n;
 }
 
 /* Specifically for chain use in certify_and_depend_v3to6() */
@@ -163,9 +345,10 @@ bool
 check_against(const galera::KeyEntryNG*   const found,
               const galera::KeySet::KeyPart&    key,
               wsrep_key_type_t            const key_type,
-              galera::TrxHandleSlave*     const trx,
+              const galera::TrxHandleSlave* const trx,
               bool                        const log_conflict,
-              wsrep_seqno_t&                    depends_seqno)
+              wsrep_seqno_t&                    depends_seqno,
+              galera::KeyDeps*            const key_deps)
 {
     enum CheckType
     {
@@ -232,6 +415,16 @@ check_against(const galera::KeyEntryNG*   const found,
             /* fall through */
         case DEPENDENCY:
             depends_seqno = std::max(ref_trx->global_seqno(), depends_seqno);
+            if (key_deps)
+            {
+                // Only the latest shared reference to the key is known,
+                // the earlier ones must be covered by range.
+                if (REF_KEY_TYPE == WSREP_KEY_SHARED ||
+                    REF_KEY_TYPE == WSREP_KEY_REFERENCE)
+                    key_deps->add_range(ref_trx->global_seqno());
+                else
+                    key_deps->add(ref_trx->global_seqno());
+            }
             /* fall through */
         case NOTHING:;
         }
@@ -244,11 +437,12 @@ check_against(const galera::KeyEntryNG*   const found,
 static inline bool
 certify_and_depend_v3to6(const galera::KeyEntryNG*   const found,
                          const galera::KeySet::KeyPart&    key,
-                         galera::TrxHandleSlave*     const trx,
-                         bool                        const log_conflict)
+                         const galera::TrxHandleSlave* const trx,
+                         bool                        const log_conflict,
+                         wsrep_seqno_t&                    depends_seqno,
+                         galera::KeyDeps*            const key_deps)
 {
     bool ret(false);
-    wsrep_seqno_t depends_seqno(trx->depends_seqno());
     wsrep_key_type_t const key_type(key.wsrep_type(trx->version()));
 
     /*
@@ -265,38 +459,41 @@ certify_and_depend_v3to6(const galera::KeyEntryNG*   const found,
      *   sh | D  | D  | N  | N  |
      *   ------------------------
      *
-     * Note that depends_seqno is an in/out parameter and is updated on every
-     * step.
+     * Note that depends_seqno (and key_deps if not null) is an in/out
+     * parameter and is updated on every step.
      */
     if (check_against<WSREP_KEY_EXCLUSIVE>
-        (found, key, key_type, trx, log_conflict, depends_seqno) ||
+        (found, key, key_type, trx, log_conflict, depends_seqno,
+         key_deps) ||
         check_against<WSREP_KEY_UPDATE>
-        (found, key, key_type, trx, log_conflict, depends_seqno) ||
+        (found, key, key_type, trx, log_conflict, depends_seqno,
+         key_deps) ||
         (key_type >= WSREP_KEY_UPDATE &&
          /* exclusive and update keys must be checked against shared */
          (check_against<WSREP_KEY_REFERENCE>
-          (found, key, key_type, trx, log_conflict, depends_seqno) ||
+          (found, key, key_type, trx, log_conflict, depends_seqno,
+           key_deps) ||
           check_against<WSREP_KEY_SHARED>
-          (found, key, key_type, trx, log_conflict, depends_seqno))))
+          (found, key, key_type, trx, log_conflict, depends_seqno,
+           key_deps))))
     {
         ret = true;
     }
 
-    if (depends_seqno > trx->depends_seqno())
-        trx->set_depends_seqno(depends_seqno);
-
     return ret;
 }
 
-/* returns true on collision, false otherwise */
+/* returns true on collision, false otherwise. Does not modify the index or
+ * trx, so can be called concurrently for different shards. */
 static bool
-certify_v3to6(const galera::Certification::CertIndexNG& cert_index_ng,
+certify_v3to6(const galera::CertIndexNG&          cert_index_ng,
               const galera::KeySet::KeyPart&      key,
-              galera::TrxHandleSlave*     const   trx,
-              bool                        const   log_conflicts)
+              const galera::TrxHandleSlave* const trx,
+              bool                        const   log_conflicts,
+              wsrep_seqno_t&                      depends_seqno,
+              galera::KeyDeps*            const   key_deps)
 {
-    galera::KeyEntryNG ke(key);
-    galera::Certification::CertIndexNG::const_iterator ci(cert_index_ng.find(&ke));
+    galera::CertIndexNG::const_iterator ci(cert_index_ng.find(key));
 
     if (cert_index_ng.end() == ci)
     {
@@ -309,15 +506,29 @@ certify_v3to6(const galera::Certification::CertIndexNG& cert_index_ng,
     // Note: For we skip certification for isolated trxs, only
     // cert index and key_list is populated.
     return (!trx->is_toi() &&
-            certify_and_depend_v3to6(kep, key, trx, log_conflicts));
+            certify_and_depend_v3to6(kep, key, trx, log_conflicts,
+                                     depends_seqno, key_deps));
 }
 
 // Add key to trx references for trx that passed certification.
 //
-// @param cert_index certification index in use
+// @param cert_index certification index (shard) the key belongs to
 // @param trx        certified transaction
-// @param key_set    key_set used in certification
-// @param key_count  number of keys in key set
+// @param k          key from the key set used in certification
+static inline void do_ref_key(galera::CertIndexNG&           cert_index,
+                              galera::TrxHandleSlave*  const trx,
+                              const galera::KeySet::KeyPart& k)
+{
+    std::pair<galera::CertIndexNG::iterator, bool> const
+        ci(cert_index.insert(k));
+
+    if (ci.second)
+    {
+        cert_debug << "created new entry";
+    }
+    (*ci.first)->ref(k.wsrep_type(trx->version()), k, trx);
+}
+
 static void do_ref_keys(galera::Certification::CertIndexNG& cert_index,
                         galera::TrxHandleSlave*       const trx,
                         const galera::KeySetIn&             key_set,
@@ -326,18 +537,81 @@ static void do_ref_keys(galera::Certification::CertIndexNG& cert_index,
     for (long i(0); i < key_count; ++i)
     {
         const galera::KeySet::KeyPart& k(key_set.next());
-        galera::KeyEntryNG ke(k);
-        galera::Certification::CertIndexNG::const_iterator
-            ci(cert_index.find(&ke));
+        do_ref_key(cert_index.shard(k), trx, k);
+    }
+}
 
-        if (ci == cert_index.end())
+// Certifies the keys of trx against index shards in parallel and, if no
+// conflict was found, references the keys in the index. Returns false
+// if certification failed, in that case nothing is changed.
+bool
+galera::Certification::do_test_v3to6_sharded(TrxHandleSlave* const trx,
+                                             long            const key_count,
+                                             KeyDeps*        const key_deps)
+{
+    assert(shard_workers_);
+    assert(shard_jobs_.size() == cert_index_ng_.shards());
+
+    const KeySetIn& key_set(trx->write_set().keyset());
+
+    // KeySetIn iteration is stateful, so distribute keys here.
+    for (size_t i(0); i < shard_jobs_.size(); ++i) shard_jobs_[i].keys_.clear();
+    key_set.rewind();
+    for (long i(0); i < key_count; ++i)
+    {
+        const KeySet::KeyPart& key(key_set.next());
+        shard_jobs_[cert_index_ng_.shard_of(key)].keys_.push_back(key);
+    }
+
+    wsrep_seqno_t const initial_depends(trx->depends_seqno());
+
+    // Conflicts are not logged here: failed certification is repeated
+    // serially by the caller.
+    shard_workers_->run(
+        [this, trx, initial_depends, key_deps](size_t const s)
         {
-            galera::KeyEntryNG* const kep(new galera::KeyEntryNG(ke));
-            ci = cert_index.insert(kep).first;
-            cert_debug << "created new entry";
-        }
-        (*ci)->ref(k.wsrep_type(trx->version()), k, trx);
+            ShardJob&          job(shard_jobs_[s]);
+            const CertIndexNG& index(cert_index_ng_);
+            wsrep_seqno_t      depends_seqno(initial_depends);
+            bool               conflict(false);
+
+            job.key_deps_.reset(initial_depends);
+            KeyDeps* const deps(key_deps ? &job.key_deps_ : 0);
+
+            for (size_t i(0); !conflict && i < job.keys_.size(); ++i)
+            {
+                conflict = certify_v3to6(index.shard(s), job.keys_[i], trx,
+                                         false, depends_seqno, deps);
+            }
+
+            job.depends_seqno_ = depends_seqno;
+            job.conflict_      = conflict;
+        });
+
+    wsrep_seqno_t depends_seqno(initial_depends);
+    for (size_t i(0); i < shard_jobs_.size(); ++i)
+    {
+        if (shard_jobs_[i].conflict_) return false;
+        depends_seqno = std::max(depends_seqno, shard_jobs_[i].depends_seqno_);
+        if (key_deps) key_deps->merge(shard_jobs_[i].key_deps_);
     }
+
+    trx->set_depends_seqno(std::max(depends_seqno, last_pa_unsafe_));
+
+    // Each shard is modified by one thread only.
+    shard_workers_->run(
+        [this, trx](size_t const s)
+        {
+            ShardJob&    job(shard_jobs_[s]);
+            CertIndexNG& index(cert_index_ng_);
+
+            for (size_t i(0); i < job.keys_.size(); ++i)
+            {
+                do_ref_key(index.shard(s), trx, job.keys_[i]);
+            }
+        });
+
+    return true;
 }
 
 galera::Certification::TestResult
@@ -354,26 +628,50 @@ galera::Certification::do_test_v3to6(TrxHandleSlave* trx)
     const KeySetIn& key_set(trx->write_set().keyset());
     long const      key_count(key_set.count());
     long            processed(0);
+    wsrep_seqno_t   depends_seqno(trx->depends_seqno());
+    KeyDeps         deps;
+    KeyDeps* const  key_deps(key_deps_ ? &deps : 0);
+
+    deps.reset(depends_seqno);
 
+    if (shard_workers_ && key_count >= CERT_SHARDED_MIN_KEYS &&
+        do_test_v3to6_sharded(trx, key_count, key_deps))
+    {
+        processed = key_count;
+        goto cert_ok;
+    }
+
+    /* If sharded certification failed, repeat it serially to get the same
+     * depends_seqno and conflict logging as without sharding. */
     key_set.rewind();
+    deps.reset(depends_seqno);
 
     for (; processed < key_count; ++processed)
     {
         const KeySet::KeyPart& key(key_set.next());
 
-        if (certify_v3to6(cert_index_ng_, key, trx, log_conflicts_))
+        if (certify_v3to6(cert_index_ng_.shard(key), key, trx, log_conflicts_,
+                          depends_seqno, key_deps))
         {
-            trx->set_depends_seqno(std::max(trx->depends_seqno(), last_pa_unsafe_));
+            trx->set_depends_seqno(std::max(depends_seqno, last_pa_unsafe_));
             goto cert_fail;
         }
     }
 
-    trx->set_depends_seqno(std::max(trx->depends_seqno(), last_pa_unsafe_));
+    trx->set_depends_seqno(std::max(depends_seqno, last_pa_unsafe_));
 
     assert (key_count == processed);
     key_set.rewind();
     do_ref_keys(cert_index_ng_, trx, key_set, key_count);
 
+cert_ok:
+
+    if (key_deps)
+    {
+        key_deps->add_range(last_pa_unsafe_);
+        trx->set_key_deps(*key_deps);
+    }
+
     if (trx->pa_unsafe()) last_pa_unsafe_ = trx->global_seqno();
 
     key_count_ += key_count;
@@ -454,7 +752,9 @@ galera::Certification::do_test(const TrxHandleSlavePtr& trx)
             trx->last_seen_seqno() > trx->depends_seqno())
             trx->set_depends_seqno(trx->last_seen_seqno());
 
-        wsrep_seqno_t const ds(trx_map_.begin()->first - 1);
+        // partially purged trx can't be depended on
+        wsrep_seqno_t const ds(trx_map_.front_seqno() -
+                               (purge_key_pos_ > 0 ? 0 : 1));
         if (ds > trx->depends_seqno()) trx->set_depends_seqno(ds);
     }
 
@@ -918,7 +1218,10 @@ galera::Certification::Certification(gu::Config&     conf,
     conf_                  (conf),
     gcache_                (cache),
     trx_map_               (),
-    cert_index_ng_         (),
+    cert_index_ng_         (cert_shards(conf)),
+    shard_jobs_            (cert_index_ng_.shards()),
+    shard_workers_         (cert_index_ng_.shards() > 1 ?
+                            new ShardWorkers(cert_index_ng_.shards()) : NULL),
     nbo_map_               (),
     nbo_ctx_map_           (),
     nbo_index_             (),
@@ -935,11 +1238,17 @@ galera::Certification::Certification(gu::Config&     conf,
     last_pa_unsafe_        (-1),
     last_preordered_seqno_ (position_),
     last_preordered_id_    (0),
+    purge_seqno_           (-1),
+    purge_release_seqno_   (-1),
+    purge_released_seqno_  (-1),
+    purge_key_pos_         (0),
     stats_mutex_           (gu::get_mutex_key(gu::GU_MUTEX_KEY_CERTIFICATION_STATS)),
     n_certified_           (0),
     deps_dist_             (0),
     cert_interval_         (0),
     index_size_            (0),
+    purge_lag_             (0),
+    purge_time_            (0),
     key_count_             (0),
     byte_count_            (0),
     trx_count_             (0),
@@ -948,7 +1257,8 @@ galera::Certification::Certification(gu::Config&     conf,
     max_length_check_      (length_check(conf)),
     inconsistent_          (false),
     log_conflicts_         (conf.get<bool>(CERT_PARAM_LOG_CONFLICTS)),
-    optimistic_pa_         (conf.get<bool>(CERT_PARAM_OPTIMISTIC_PA))
+    optimistic_pa_         (conf.get<bool>(CERT_PARAM_OPTIMISTIC_PA)),
+    key_deps_              (conf.get<bool>(CERT_PARAM_KEY_DEPS))
 {}
 
 
@@ -968,8 +1278,7 @@ galera::Certification::~Certification()
 
     gu::Lock lock(mutex_);
 
-    for_each(trx_map_.begin(), trx_map_.end(), PurgeAndDiscard(*this));
-    trx_map_.clear();
+    purge_all_();
     nbo_map_.clear();
     std::for_each(nbo_index_.begin(), nbo_index_.end(),
                   [](CertIndexNBO::value_type key_entry)
@@ -990,6 +1299,8 @@ galera::Certification::~Certification()
         service_thd_->release_seqno(position_);
         service_thd_->flush(gu::UUID());
     }
+
+    delete shard_workers_;
 }
 
 
@@ -1017,7 +1328,7 @@ void galera::Certification::assign_initial_position(const gu::GTID& gtid,
     wsrep_seqno_t const seqno(gtid.seqno());
     gu::Lock lock(mutex_);
 
-    std::for_each(trx_map_.begin(), trx_map_.end(), PurgeAndDiscard(*this));
+    purge_all_();
 
     if (seqno >= position_)
     {
@@ -1031,8 +1342,6 @@ void galera::Certification::assign_initial_position(const gu::GTID& gtid,
                      << seqno;
         }
 
-        std::for_each(cert_index_ng_.begin(), cert_index_ng_.end(),
-                      gu::DeleteObject());
         cert_index_ng_.clear();
     }
 
@@ -1076,9 +1385,8 @@ galera::Certification::adjust_position(const View&         view,
 
     if (version != version_)
     {
-        std::for_each(trx_map_.begin(), trx_map_.end(), PurgeAndDiscard(*this));
-        assert(trx_map_.empty() || trx_map_.rbegin()->first + 1 == position_);
-        trx_map_.clear();
+        assert(trx_map_.empty() || trx_map_.back_seqno() + 1 == position_);
+        purge_all_();
         assert(cert_index_ng_.empty());
         if (service_thd_)
         {
@@ -1141,33 +1449,118 @@ wsrep_seqno_t galera::Certification::get_safe_to_discard_seqno_() const
 
 wsrep_seqno_t
 galera::Certification::purge_trxs_upto_(wsrep_seqno_t const seqno,
-                                        bool const          handle_gcache)
+                                        bool const          handle_gcache,
+                                        long const          max_keys)
 {
     assert (seqno > 0);
     assert(mutex_.owned());
 
-    TrxMap::iterator purge_bound(trx_map_.upper_bound(seqno));
-
     cert_debug << "purging index up to " << seqno << ", safe to discard seqno " << get_safe_to_discard_seqno_();
 
-    assert(purge_bound == trx_map_.end() ||
-           purge_bound->first <= get_safe_to_discard_seqno_() + 1);
-
-    for_each(trx_map_.begin(), purge_bound, PurgeAndDiscard(*this));
-    trx_map_.erase(trx_map_.begin(), purge_bound);
+    if (seqno > purge_seqno_) purge_seqno_ = seqno;
+    if (handle_gcache && seqno > purge_release_seqno_)
+    {
+        purge_release_seqno_ = seqno;
+    }
 
-    if (handle_gcache && service_thd_) service_thd_->release_seqno(seqno);
+    purge_step_(std::min(purge_seqno_, get_safe_to_discard_seqno_()), max_keys);
 
-    if (0 == ((trx_map_.size() + 1) % 10000))
+    if (0 == ((trx_map_.size() + 1) % 10000) && !trx_map_.empty())
     {
         log_debug << "trx map after purge: length: " << trx_map_.size()
                   << ", requested purge seqno: " << seqno
-                  << ", real purge seqno: " << trx_map_.begin()->first - 1;
+                  << ", real purge seqno: " << trx_map_.front_seqno() - 1;
     }
 
     return seqno;
 }
 
+void
+galera::Certification::purge_step_(wsrep_seqno_t const upto,
+                                   long          const max_keys)
+{
+    assert(mutex_.owned());
+
+    long long const start(gu_time_monotonic());
+    long            purged(0);
+
+    // Partially purged trx is always purged to the end: safe to discard
+    // seqno may decrease, see purge_trxs_upto().
+    while (!trx_map_.empty() &&
+           (trx_map_.front_seqno() <= upto || purge_key_pos_ > 0))
+    {
+        TrxHandleSlave* const trx(trx_map_.front());
+
+        // Dummy preload events insert only seqno.
+        //
+        // If depends seqno is not WSREP_SEQNO_UNDEFINED write set
+        // certification has passed and keys have been inserted into index
+        // and purge is needed. TOI write sets will always pass regular
+        // certification and keys will be inserted, however if they fail
+        // NBO certification depends seqno is set to WSREP_SEQNO_UNDEFINED.
+        // Therefore purge should always be done for TOI write sets.
+        if (trx && (trx->is_dummy() == false || trx->is_toi() == true))
+        {
+            if (purged >= max_keys) break;
+
+            // Trying to lock trx mutex here may cause deadlock with
+            // streaming replication. Locking can be skipped because trx
+            // is only read here and refcount uses atomics. Memory barrier
+            // is provided by certification mutex.
+            if (0 == purge_key_pos_ && !is_inconsistent())
+            {
+                assert(trx->is_committed() == true);
+                if (trx->is_committed() == false)
+                {
+                    log_warn << "trx not committed in purge and discard: "
+                             << *trx;
+                }
+            }
+
+            purged += purge_for_trx(trx, max_keys - purged);
+
+            if (purge_key_pos_ > 0) break; // trx purged partially
+        }
+
+        trx_map_.pop_front();
+    }
+
+    // everything up to this seqno is purged
+    wsrep_seqno_t const purged_seqno(
+        trx_map_.empty() ? upto : std::min(upto, trx_map_.front_seqno() - 1));
+
+    if (service_thd_ && purge_release_seqno_ > purge_released_seqno_ &&
+        purged_seqno > purge_released_seqno_)
+    {
+        purge_released_seqno_ = std::min(purge_release_seqno_, purged_seqno);
+        service_thd_->release_seqno(purge_released_seqno_);
+    }
+
+    long long const lag(std::max<long long>(0, purge_seqno_ - purged_seqno));
+    long long const end(purged > 0 ? gu_time_monotonic() : start);
+
+    gu::Lock lock(stats_mutex_);
+    purge_lag_   = lag;
+    purge_time_ += end - start;
+    index_size_  = cert_index_ng_.size();
+}
+
+// Purge all trxs regardless of the requested purge seqno.
+void
+galera::Certification::purge_all_()
+{
+    if (!trx_map_.empty())
+    {
+        purge_step_(trx_map_.back_seqno(),
+                    std::numeric_limits<long>::max());
+    }
+    assert(trx_map_.empty());
+    assert(0 == purge_key_pos_);
+    purge_seqno_          = -1;
+    purge_release_seqno_  = -1;
+    purge_released_seqno_ = -1;
+}
+
 
 galera::Certification::TestResult
 galera::Certification::append_trx(const TrxHandleSlavePtr& trx)
@@ -1191,12 +1584,13 @@ galera::Certification::append_trx(const TrxHandleSlavePtr& trx)
                       << " trx seqno " << trx->global_seqno();
         }
 
-        if (gu_unlikely((trx->last_seen_seqno() + 1) < trx_map_.begin()->first))
+        if (gu_unlikely(!trx_map_.empty() &&
+                        (trx->last_seen_seqno() + 1) < trx_map_.front_seqno()))
         {
             /* See #733 - for now it is false positive */
             cert_debug
                 << "WARNING: last_seen_seqno is below certification index: "
-                << trx_map_.begin()->first << " > " << trx->last_seen_seqno();
+                << trx_map_.front_seqno() << " > " << trx->last_seen_seqno();
         }
 
         position_ = trx->global_seqno();
@@ -1221,13 +1615,13 @@ galera::Certification::append_trx(const TrxHandleSlavePtr& trx)
                 cert_debug << "append_trx: purging index up to " << trim_seqno;
             }
 
-            purge_trxs_upto_(trim_seqno, true);
+            purge_trxs_upto_(trim_seqno, true,
+                             std::numeric_limits<long>::max());
         }
 
         retval = test(trx);
 
-        if (trx_map_.insert(
-                std::make_pair(trx->global_seqno(), trx)).second == false)
+        if (trx_map_.insert(trx->global_seqno(), trx) == false)
             gu_throw_fatal << "duplicate trx entry " << *trx;
 
         // trx with local seqno WSREP_SEQNO_UNDEFINED originates from
@@ -1262,9 +1656,8 @@ void galera::Certification::append_dummy_preload(const TrxHandleSlavePtr& trx)
     gu::Lock lock(mutex_);
     /* Dummy preloads have only meta data available, not the whole write set,
        so modifying or accessing the trx object causes problems later on.
-       Insert nullptr as a placeholder for seqno. */
-    if (not trx_map_.insert(std::make_pair(trx->global_seqno(), nullptr))
-                .second)
+       Insert null trx handle as a placeholder for seqno. */
+    if (not trx_map_.insert(trx->global_seqno(), TrxHandleSlavePtr()))
     {
         gu_throw_fatal << "duplicate trx entry in dummy preload";
     }
@@ -1296,6 +1689,26 @@ wsrep_seqno_t galera::Certification::set_trx_committed(TrxHandleSlave& trx)
             deps_set_.erase(i);
         }
 
+        // Continue pending index purge. Up to twice as many keys as trx
+        // has are purged, bounded by the size of the backlog: huge trxs are
+        // purged over several commits and the bound is raised if they
+        // keep coming.
+        wsrep_seqno_t const purge_upto(std::min(purge_seqno_,
+                                                get_safe_to_discard_seqno_()));
+        if (purge_key_pos_ > 0 ||
+            (!trx_map_.empty() && trx_map_.front_seqno() <= purge_upto))
+        {
+            long const keys(trx.is_dummy() ? 0 :
+                            trx.write_set().keyset().count());
+            long const backlog(std::max<long>(
+                                   0, purge_upto - trx_map_.front_seqno() + 1));
+            long const max_keys(PURGE_STEP_MAX_KEYS *
+                                (1 + backlog / PURGE_BACKLOG_TRXS));
+            purge_step_(purge_upto,
+                        std::min(std::max(2 * keys, long(PURGE_STEP_KEYS)),
+                                 max_keys));
+        }
+
         if (gu_unlikely(index_purge_required()))
         {
             ret = get_safe_to_discard_seqno_();
@@ -1344,6 +1757,11 @@ galera::Certification::param_set(const std::string& key,
         set_boolean_parameter(optimistic_pa_, value, CERT_PARAM_OPTIMISTIC_PA,
                               "\"optimistic\" parallel applying.");
     }
+    else if (key == Certification::PARAM_KEY_DEPS)
+    {
+        set_boolean_parameter(key_deps_, value, CERT_PARAM_KEY_DEPS,
+                              "applying on key level dependencies.");
+    }
     else
     {
         throw gu::NotFound();
@@ -9,6 +9,8 @@
 #include "nbo.hpp"
 #include "trx_handle.hpp"
 #include "key_entry_ng.hpp"
+#include "cert_index_ng.hpp"
+#include "cert_trx_map.hpp"
 #include "galera_service_thd.hpp"
 #include "galera_view.hpp"
 
@@ -22,6 +24,7 @@
 
 #include <map>
 #include <list>
+#include <vector>
 
 namespace galera
 {
@@ -31,15 +34,14 @@ namespace galera
 
         static std::string const PARAM_LOG_CONFLICTS;
         static std::string const PARAM_OPTIMISTIC_PA;
+        static std::string const PARAM_KEY_DEPS;
 
         static void register_params(gu::Config&);
 
         typedef gu::UnorderedSet<KeyEntryOS*,
                                  KeyEntryPtrHash, KeyEntryPtrEqual> CertIndex;
 
-        typedef gu::UnorderedSet<KeyEntryNG*,
-                                 KeyEntryPtrHashNG, KeyEntryPtrEqualNG>
-        CertIndexNG;
+        typedef galera::CertIndexNGShards CertIndexNG;
 
         typedef gu::UnorderedMultiset<KeyEntryNG*,
                                       KeyEntryPtrHashNG, KeyEntryPtrEqualNG>
@@ -49,7 +51,7 @@ namespace galera
 
         typedef std::multiset<wsrep_seqno_t>             DepsSet;
 
-        typedef std::map<wsrep_seqno_t, TrxHandleSlavePtr> TrxMap;
+        typedef CertTrxMap                               TrxMap;
 
     public:
 
@@ -87,7 +89,8 @@ namespace galera
             // Note: setting trx committed is not done in total order so
             // safe to discard seqno may decrease. Enable assertion above when
             // this issue is fixed.
-            return purge_trxs_upto_(std::min(seqno, stds), handle_gcache);
+            return purge_trxs_upto_(std::min(seqno, stds), handle_gcache,
+                                    PURGE_STEP_KEYS);
         }
 
         // Set trx corresponding to handle committed. Return purge seqno if
@@ -110,6 +113,17 @@ namespace galera
             index_size = index_size_;
         }
 
+        // purge_lag:     number of seqnos requested to be purged from index
+        //                but not purged yet
+        // purge_time_ns: total time spent purging index
+        void purge_stats_get(long long& purge_lag,
+                             long long& purge_time_ns) const
+        {
+            gu::Lock lock(stats_mutex_);
+            purge_lag     = purge_lag_;
+            purge_time_ns = purge_time_;
+        }
+
         void stats_reset()
         {
             gu::Lock lock(stats_mutex_);
@@ -117,13 +131,14 @@ namespace galera
             deps_dist_ = 0;
             n_certified_ = 0;
             index_size_ = 0;
+            purge_time_ = 0;
         }
 
         void param_set(const std::string& key, const std::string& value);
 
         wsrep_seqno_t lowest_trx_seqno() const
         {
-            return (trx_map_.empty() ? position_ : trx_map_.begin()->first);
+            return (trx_map_.empty() ? position_ : trx_map_.front_seqno());
         }
 
         //
@@ -150,13 +165,31 @@ namespace galera
         TestResult test(const TrxHandleSlavePtr&);
         TestResult do_test(const TrxHandleSlavePtr&);
         TestResult do_test_v3to6(TrxHandleSlave*);
+        bool       do_test_v3to6_sharded(TrxHandleSlave*, long key_count,
+                                         KeyDeps*);
         TestResult do_test_preordered(TrxHandleSlave*);
         TestResult do_test_nbo(const TrxHandleSlavePtr&);
-        void purge_for_trx(TrxHandleSlave*);
+        long purge_for_trx(TrxHandleSlave*, long max_keys);
+
+        // Index purge is done incrementally: a purge request only records
+        // the seqno to purge up to, keys are then purged in steps of at most
+        // max_keys, so that purging a large backlog does not stall the
+        // caller. The first trx in trx_map_ may be purged partially.
+        static long const PURGE_STEP_KEYS = 1024;
+        // Upper bound for keys purged on trx commit, so that committing
+        // a huge trx does not purge its whole backlog under the mutex.
+        // The bound grows by PURGE_STEP_MAX_KEYS for every
+        // PURGE_BACKLOG_TRXS trxs waiting for purge, so that purge catches
+        // up with a stream of huge trxs instead of falling behind until
+        // max_length trim purges everything at once.
+        static long const PURGE_STEP_MAX_KEYS = 8 * PURGE_STEP_KEYS;
+        static long const PURGE_BACKLOG_TRXS  = 4;
 
         // unprotected variants for internal use
         wsrep_seqno_t get_safe_to_discard_seqno_() const;
-        wsrep_seqno_t purge_trxs_upto_(wsrep_seqno_t, bool sync);
+        wsrep_seqno_t purge_trxs_upto_(wsrep_seqno_t, bool sync, long max_keys);
+        void          purge_step_(wsrep_seqno_t upto, long max_keys);
+        void          purge_all_();
 
         gu::shared_ptr<NBOCtx>::type nbo_ctx_unlocked(wsrep_seqno_t);
 
@@ -175,60 +208,17 @@ namespace galera
                      (key_count_ = 0, byte_count_ = 0, trx_count_ = 0, true));
         }
 
-        class PurgeAndDiscard
-        {
-        public:
-
-            PurgeAndDiscard(Certification& cert) : cert_(cert) { }
+        // Pool of threads to process cert index shards in parallel
+        class ShardWorkers;
 
-            void operator()(TrxMap::value_type& vt) const
-            {
-                if (not vt.second)
-                {
-                    // Dummy preload events insert only seqno
-                    return;
-                }
-                {
-                    TrxHandleSlave* trx(vt.second.get());
-                    // Trying to lock trx mutex here may cause deadlock
-                    // with streaming replication. Locking can be skipped
-                    // because trx is only read here and refcount uses atomics.
-                    // Memory barrier is provided by certification mutex.
-                    //
-                    // TrxHandleLock   lock(*trx);
-
-                    if (!cert_.is_inconsistent())
-                    {
-                        assert(trx->is_committed() == true);
-                        if (trx->is_committed() == false)
-                        {
-                            log_warn <<"trx not committed in purge and discard: "
-                                     << *trx;
-                        }
-                    }
-
-                    // If depends seqno is not WSREP_SEQNO_UNDEFINED
-                    // write set certification has passed and keys have been
-                    // inserted into index and purge is needed.
-                    // TOI write sets will always pass regular certification
-                    // and keys will be inserted, however if they fail
-                    // NBO certification depends seqno is set to
-                    // WSREP_SEQNO_UNDEFINED. Therefore purge should always
-                    // be done for TOI write sets.
-                    if (trx->is_dummy() == false || trx->is_toi() == true)
-                    {
-                        cert_.purge_for_trx(trx);
-                    }
-                }
-            }
-
-            PurgeAndDiscard(const PurgeAndDiscard& other) : cert_(other.cert_)
-            { }
-
-        private:
-
-            void operator=(const PurgeAndDiscard&);
-            Certification& cert_;
+        // Keys of the write set being certified which belong to a shard and
+        // the result of their certification
+        struct ShardJob
+        {
+            std::vector<KeySet::KeyPart> keys_;
+            wsrep_seqno_t                depends_seqno_;
+            KeyDeps                      key_deps_;
+            bool                         conflict_;
         };
 
         int           version_;
@@ -236,6 +226,8 @@ namespace galera
         gcache::GCache& gcache_;
         TrxMap        trx_map_;
         CertIndexNG   cert_index_ng_;
+        std::vector<ShardJob> shard_jobs_;
+        ShardWorkers* shard_workers_;
         NBOMap        nbo_map_;
         NBOCtxMap     nbo_ctx_map_;
         CertIndexNBO  nbo_index_;
@@ -252,11 +244,17 @@ namespace galera
         wsrep_seqno_t last_pa_unsafe_;
         wsrep_seqno_t last_preordered_seqno_;
         wsrep_trx_id_t last_preordered_id_;
+        wsrep_seqno_t purge_seqno_;         // requested purge seqno
+        wsrep_seqno_t purge_release_seqno_; // gcache release on purge
+        wsrep_seqno_t purge_released_seqno_;
+        long          purge_key_pos_; // keys of trx_map_.front() purged
         gu::Mutex     stats_mutex_;
         size_t        n_certified_;
         wsrep_seqno_t deps_dist_;
         wsrep_seqno_t cert_interval_;
         size_t        index_size_;
+        long long     purge_lag_;
+        long long     purge_time_;
 
         size_t        key_count_;
         size_t        byte_count_;
@@ -274,6 +272,7 @@ namespace galera
         bool               inconsistent_;
         bool               log_conflicts_;
         bool               optimistic_pa_;
+        bool               key_deps_; /* collect key level dependencies */
     };
 }
 
@@ -0,0 +1,195 @@
+//
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+//
+
+#include "checksum_pool.hpp"
+
+#include "gu_lock.hpp"
+#include "gu_throw.hpp"
+#include "gu_thread_keys.hpp"
+#include "gu_time.h"
+
+#include <thread>
+
+/* Process wide pool is referenced weakly here, so that it is destroyed
+ * together with the last owner. */
+static std::shared_ptr<galera::ChecksumPool>
+registry(bool const create)
+{
+    static gu::Mutex mtx(NULL);
+    static std::weak_ptr<galera::ChecksumPool> pool;
+
+    gu::Lock lock(mtx);
+
+    std::shared_ptr<galera::ChecksumPool> ret(pool.lock());
+
+    if (!ret && create)
+    {
+        size_t const max(galera::ChecksumPool::MAX_THREADS);
+        size_t const cpus(std::thread::hardware_concurrency());
+        ret.reset(new galera::ChecksumPool(cpus > 0 && cpus < max ?
+                                           cpus : max));
+        pool = ret;
+    }
+
+    return ret;
+}
+
+std::shared_ptr<galera::ChecksumPool>
+galera::ChecksumPool::get()
+{
+    return registry(true);
+}
+
+std::shared_ptr<galera::ChecksumPool>
+galera::ChecksumPool::instance()
+{
+    return registry(false);
+}
+
+galera::ChecksumPool::ChecksumPool(size_t const threads)
+    :
+    mtx_        (gu::get_mutex_key(gu::GU_MUTEX_KEY_WRITE_SET_CHECK)),
+    cond_       (gu::get_cond_key(gu::GU_COND_KEY_WRITE_SET_CHECK)),
+    done_       (gu::get_cond_key(gu::GU_COND_KEY_WRITE_SET_CHECK_DONE)),
+    queue_      (),
+    threads_    (threads),
+    submits_    (0),
+    queue_sum_  (0),
+    queue_max_  (0),
+    completed_  (0),
+    latency_sum_(0),
+    exit_       (false)
+{
+    assert(threads > 0);
+
+    for (size_t i(0); i < threads_.size(); ++i)
+    {
+        int const err(gu_thread_create(
+                          gu::get_thread_key(
+                              gu::GU_THREAD_KEY_WRITE_SET_CHECK),
+                          &threads_[i], thd_func, this));
+        if (err)
+        {
+            stop(i);
+            gu_throw_error(err) << "Failed to create checksum thread";
+        }
+    }
+}
+
+galera::ChecksumPool::~ChecksumPool()
+{
+    stop(threads_.size());
+}
+
+bool
+galera::ChecksumPool::submit(Ticket& t, const Job* const jobs, size_t const n)
+{
+    assert(0 == t.pending_);
+
+    long long const now(gu_time_monotonic());
+
+    gu::Lock lock(mtx_);
+
+    if (queue_.size() + n > MAX_QUEUE) return false;
+
+    submits_++;
+    queue_sum_ += queue_.size();
+    if (queue_max_ < static_cast<long long>(queue_.size()))
+        queue_max_ = queue_.size();
+
+    t.pending_ = n;
+    t.queued_  = now;
+
+    for (size_t i(0); i < n; ++i)
+    {
+        Task const task = { jobs[i], &t };
+        queue_.push_back(task);
+    }
+
+    if (n > 1) cond_.broadcast(); else cond_.signal();
+
+    return true;
+}
+
+void
+galera::ChecksumPool::wait(Ticket& t)
+{
+    gu::Lock lock(mtx_);
+    while (t.pending_ > 0) lock.wait(done_);
+}
+
+void
+galera::ChecksumPool::stats_get(double&    queue_avg,
+                                long long& queue_max,
+                                long long& latency_avg_ns) const
+{
+    gu::Lock lock(mtx_);
+    queue_avg      = submits_ > 0 ? double(queue_sum_) / submits_ : 0;
+    queue_max      = queue_max_;
+    latency_avg_ns = completed_ > 0 ? latency_sum_ / completed_ : 0;
+}
+
+void
+galera::ChecksumPool::stats_reset()
+{
+    gu::Lock lock(mtx_);
+    submits_     = 0;
+    queue_sum_   = 0;
+    queue_max_   = 0;
+    completed_   = 0;
+    latency_sum_ = 0;
+}
+
+void*
+galera::ChecksumPool::thd_func(void* arg)
+{
+    static_cast<ChecksumPool*>(arg)->work();
+    return NULL;
+}
+
+void
+galera::ChecksumPool::work()
+{
+    while (true)
+    {
+        Task task = { Job(), NULL };
+        {
+            gu::Lock lock(mtx_);
+            /* tasks left in the queue are completed before exit, somebody
+             * may be waiting for them */
+            while (queue_.empty() && !exit_) lock.wait(cond_);
+            if (queue_.empty()) return;
+            task = queue_.front();
+            queue_.pop_front();
+        }
+
+        task.job_();
+
+        gu::Lock lock(mtx_);
+        Ticket& t(*task.ticket_);
+        assert(t.pending_ > 0);
+
+        if (0 == --t.pending_)
+        {
+            completed_++;
+            latency_sum_ += gu_time_monotonic() - t.queued_;
+            done_.broadcast();
+        }
+    }
+}
+
+void
+galera::ChecksumPool::stop(size_t const started)
+{
+    {
+        gu::Lock lock(mtx_);
+        exit_ = true;
+        cond_.broadcast();
+    }
+
+    for (size_t i(0); i < started; ++i)
+    {
+        gu_thread_join(threads_[i], NULL);
+    }
+}
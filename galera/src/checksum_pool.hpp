@@ -0,0 +1,109 @@
+//
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+//
+
+#ifndef GALERA_CHECKSUM_POOL_HPP
+#define GALERA_CHECKSUM_POOL_HPP
+
+#include "gu_mutex.hpp"
+#include "gu_cond.hpp"
+
+#include <gu_threads.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace galera
+{
+    //
+    // Pool of threads verifying checksums of large incoming write sets. It is
+    // shared by all write sets in the process, so receive and IST paths
+    // compete for the same bounded set of threads. The pool lives as long as
+    // somebody holds a reference obtained from get(), normally the replicator.
+    //
+    class ChecksumPool
+    {
+    public:
+
+        typedef std::function<void()> Job;
+
+        // Group of jobs submitted together, e.g. for one write set.
+        class Ticket
+        {
+        public:
+
+            Ticket() : pending_(0), queued_(0) {}
+
+        private:
+
+            friend class ChecksumPool;
+
+            size_t    pending_; // jobs not finished yet
+            long long queued_;  // gu_time_monotonic() at submit
+        };
+
+        static size_t const MAX_THREADS = 4;
+        static size_t const MAX_QUEUE   = 64; // jobs
+
+        // @return the process wide pool, creating it if there is none
+        static std::shared_ptr<ChecksumPool> get();
+
+        // @return the process wide pool or empty pointer if there is none
+        static std::shared_ptr<ChecksumPool> instance();
+
+        explicit ChecksumPool(size_t threads);
+
+        ~ChecksumPool();
+
+        // Queue n jobs under ticket t. Jobs must not throw.
+        // @return false if there is no room for all of them in the queue,
+        //         nothing is queued then and the caller should run the jobs
+        //         itself
+        bool submit(Ticket& t, const Job* jobs, size_t n);
+
+        // Wait until all jobs of the ticket are done.
+        void wait(Ticket& t);
+
+        // queue_avg:      average queue length seen by submit()
+        // queue_max:      maximum queue length seen by submit()
+        // latency_avg_ns: average time from submit to completion of a ticket
+        void stats_get(double&    queue_avg,
+                       long long& queue_max,
+                       long long& latency_avg_ns) const;
+
+        void stats_reset();
+
+    private:
+
+        ChecksumPool(const ChecksumPool&);
+        ChecksumPool& operator=(const ChecksumPool&);
+
+        struct Task
+        {
+            Job     job_;
+            Ticket* ticket_;
+        };
+
+        static void* thd_func(void* arg);
+
+        void work();
+        void stop(size_t started);
+
+        gu::Mutex mutable        mtx_;
+        gu::Cond                 cond_; // workers wait for tasks
+        gu::Cond                 done_; // submitters wait for tickets
+        std::deque<Task>         queue_;
+        std::vector<gu_thread_t> threads_;
+        long long                submits_;
+        long long                queue_sum_;
+        long long                queue_max_;
+        long long                completed_;
+        long long                latency_sum_;
+        bool                     exit_;
+    };
+
+} // namespace galera
+
+#endif // GALERA_CHECKSUM_POOL_HPP
@@ -1,6 +1,190 @@
 //
-// Copyright (C) 2013 Codership Oy <info@codership.com>
+// Copyright (C) 2013-2024 Codership Oy <info@codership.com>
 //
 
 #include "data_set.hpp"
 
+#include "gu_atomic.hpp"
+#include "gu_serialize.hpp"
+#include "gu_time.h"
+
+#include <algorithm>
+
+namespace
+{
+    /* data sets compressed locally */
+    gu::Atomic<long long> out_plain_bytes;
+    gu::Atomic<long long> out_packed_bytes;
+    gu::Atomic<long long> out_time_ns;
+    /* data sets decompressed for applying */
+    gu::Atomic<long long> in_plain_bytes;
+    gu::Atomic<long long> in_packed_bytes;
+    gu::Atomic<long long> in_time_ns;
+
+    inline double
+    ratio(long long const plain, long long const packed)
+    {
+        return packed > 0 ? double(plain)/packed : 0.0;
+    }
+}
+
+void
+galera::DataSet::compression_stats_get(double&    out_ratio,
+                                       long long& out_time,
+                                       double&    in_ratio,
+                                       long long& in_time)
+{
+    out_ratio = ratio(out_plain_bytes(), out_packed_bytes());
+    out_time  = out_time_ns();
+    in_ratio  = ratio(in_plain_bytes(), in_packed_bytes());
+    in_time   = in_time_ns();
+}
+
+void
+galera::DataSet::compression_stats_reset()
+{
+    out_plain_bytes  = 0;
+    out_packed_bytes = 0;
+    out_time_ns      = 0;
+    in_plain_bytes   = 0;
+    in_packed_bytes  = 0;
+    in_time_ns       = 0;
+}
+
+size_t
+galera::DataSetOut::gather_packed(GatherVector& out)
+{
+    assert(DataSet::VER2 == version_);
+    assert(base_name_);
+
+    GatherVector plain;
+    size_t const plain_size(gu::RecordSetOut<DataSet::RecordOut>::gather
+                            (plain));
+
+    /* in case of repeated gather() */
+    delete packed_;
+    packed_ = NULL;
+    packed_ = new Packed(*base_name_, gu::RecordSet::version());
+
+    gu::byte_t hdr[DataSet::PACKED_HEADER_SIZE] = { 0, };
+    gu::Compression::Type ctype(gu::Compression::NONE);
+    size_t packed_size(0);
+
+    if (ctype_ != gu::Compression::NONE &&
+        plain_size >= DataSet::COMPRESS_MIN_SIZE)
+    {
+        long long const start(gu_time_thread_cputime());
+
+        /* compressors want contiguous input */
+        const gu::byte_t* src(static_cast<const gu::byte_t*>(plain[0].ptr));
+        std::vector<gu::byte_t> flat;
+
+        if (plain->size() > 1)
+        {
+            flat.reserve(plain_size);
+            for (size_t i(0); i < plain->size(); ++i)
+            {
+                const gu::byte_t* const ptr
+                    (static_cast<const gu::byte_t*>(plain[i].ptr));
+                flat.insert(flat.end(), ptr, ptr + plain[i].size);
+            }
+            src = flat.data();
+        }
+
+        size_t const bound(gu::Compression::bound(ctype_, plain_size));
+
+        if (bound > 0)
+        {
+            /* anything not smaller than plain_size is no gain */
+            packed_buf_.resize(std::min(bound, plain_size));
+            packed_size = gu::Compression::compress(ctype_, clevel_,
+                                                    src, plain_size,
+                                                    packed_buf_.data(),
+                                                    packed_buf_.size());
+        }
+
+        if (packed_size > 0 && packed_size < plain_size)
+        {
+            ctype = ctype_;
+        }
+
+        out_time_ns += gu_time_thread_cputime() - start;
+    }
+
+    hdr[0] = ctype;
+    gu::serialize4(uint32_t(plain_size), hdr, 4);
+    packed_->set_.append(hdr, sizeof(hdr), true, true);
+
+    if (gu::Compression::NONE != ctype)
+    {
+        packed_->set_.append(packed_buf_.data(), packed_size, false, false);
+    }
+    else
+    {
+        /* pass the wrapped set by reference */
+        packed_size = plain_size;
+
+        for (size_t i(0); i < plain->size(); ++i)
+        {
+            packed_->set_.append(plain[i].ptr, plain[i].size, false, false);
+        }
+    }
+
+    out_plain_bytes  += plain_size;
+    out_packed_bytes += packed_size;
+
+    return packed_->set_.gather(out);
+}
+
+void
+galera::DataSetIn::unpack() const
+{
+    assert(DataSet::VER2 == version_);
+    assert(plain_buf_.empty());
+
+    gu::RecordSetIn<DataSet::RecordIn>::rewind();
+    gu::Buf const packed(gu::RecordSetIn<DataSet::RecordIn>::next().buf());
+
+    if (gu_unlikely(packed.size < DataSet::PACKED_HEADER_SIZE))
+    {
+        gu_throw_error(EINVAL) << "Compressed data set too short: "
+                               << packed.size;
+    }
+
+    const gu::byte_t* const ptr(static_cast<const gu::byte_t*>(packed.ptr));
+    gu::Compression::Type const ctype(gu::Compression::type(ptr[0]));
+    uint32_t plain_size;
+    gu::unserialize4(ptr, 4, plain_size);
+
+    if (gu_unlikely(0 == plain_size))
+    {
+        gu_throw_error(EINVAL) << "Empty compressed data set";
+    }
+
+    long long const start(gu_time_thread_cputime());
+
+    plain_buf_.resize(plain_size);
+    /* record set parser expects word aligned buffer */
+    assert((uintptr_t(plain_buf_.data()) % GU_WORD_BYTES) == 0);
+
+    size_t const packed_size(packed.size - DataSet::PACKED_HEADER_SIZE);
+
+    try
+    {
+        gu::Compression::decompress(ctype,
+                                    ptr + DataSet::PACKED_HEADER_SIZE,
+                                    packed_size,
+                                    plain_buf_.data(), plain_buf_.size());
+    }
+    catch (...)
+    {
+        plain_buf_.clear();
+        throw;
+    }
+
+    in_time_ns      += gu_time_thread_cputime() - start;
+    in_plain_bytes  += plain_size;
+    in_packed_bytes += packed_size;
+
+    plain_.init(plain_buf_.data(), plain_buf_.size(), false);
+}
@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2013 Codership Oy <info@codership.com>
+// Copyright (C) 2013-2024 Codership Oy <info@codership.com>
 //
 
 
@@ -8,6 +8,9 @@
 
 #include "gu_rset.hpp"
 #include "gu_vlq.hpp"
+#include "gu_compress.hpp"
+
+#include <vector>
 
 
 namespace galera
@@ -19,10 +22,11 @@ namespace galera
         enum Version
         {
             EMPTY = 0,
-            VER1
+            VER1,
+            VER2  // VER1 set wrapped in a (possibly) compressed envelope
         };
 
-        static Version const MAX_VERSION = VER1;
+        static Version const MAX_VERSION = VER2;
 
         static Version version (unsigned int ver)
         {
@@ -64,6 +68,30 @@ namespace galera
 
         }; /* class RecordIn */
 
+        /*
+         * VER2 data set is a VER1 record set with a single record:
+         *
+         * 0:   compression type (gu::Compression::Type)
+         * 1-3: reserved, must be 0
+         * 4-7: serial size of the wrapped VER1 set
+         * 8-:  wrapped VER1 set, compressed according to type
+         *
+         * Only the outer set is checksummed, so that the checksum covers
+         * the bytes as they travel over the wire.
+         */
+        static int const PACKED_HEADER_SIZE = 8;
+
+        /* sets smaller than that are not worth compressing */
+        static size_t const COMPRESS_MIN_SIZE = 256;
+
+        /* global compression counters, for status variables */
+        static void compression_stats_get(double&    out_ratio,
+                                          long long& out_time_ns,
+                                          double&    in_ratio,
+                                          long long& in_time_ns);
+
+        static void compression_stats_reset();
+
     }; /* class DataSet */
 
 
@@ -80,14 +108,18 @@ namespace galera
 
         DataSetOut () // empty ctor for slave TrxHandle
             :
-            gu::RecordSetOut<DataSet::RecordOut>(), version_()
+            gu::RecordSetOut<DataSet::RecordOut>(), version_(),
+            base_name_(NULL), packed_(NULL), packed_buf_(),
+            ctype_(gu::Compression::NONE), clevel_(0)
         {}
 
         DataSetOut (gu::byte_t*             reserved,
                     size_t                  reserved_size,
                     const BaseName&         base_name,
                     DataSet::Version        version,
-                    gu::RecordSet::Version  rsv)
+                    gu::RecordSet::Version  rsv,
+                    gu::Compression::Type   ctype  = gu::Compression::NONE,
+                    int                     clevel = 0)
             :
             gu::RecordSetOut<DataSet::RecordOut> (
                 reserved,
@@ -96,11 +128,20 @@ namespace galera
                 check_type(version),
                 rsv
                 ),
-            version_(version)
+            version_(version),
+            base_name_(&base_name),
+            packed_(NULL),
+            packed_buf_(),
+            ctype_(ctype),
+            clevel_(clevel)
         {
             assert((uintptr_t(reserved) % GU_WORD_BYTES) == 0);
+            assert(DataSet::VER2 == version ||
+                   gu::Compression::NONE == ctype);
         }
 
+        ~DataSetOut() { delete packed_; }
+
         size_t
         append (const void* const src, size_t const size, bool const store)
         {
@@ -117,13 +158,62 @@ namespace galera
         DataSet::Version
         version () const { return count() ? version_ : DataSet::EMPTY; }
 
+        /* version the set was configured with, even if empty */
+        DataSet::Version
+        max_version () const { return version_; }
+
         typedef gu::RecordSet::GatherVector GatherVector;
 
+        /* VER2 sets are compressed here, on the originating thread */
+        size_t gather (GatherVector& out)
+        {
+            if (gu_likely(DataSet::VER2 != version_))
+            {
+                return gu::RecordSetOut<DataSet::RecordOut>::gather(out);
+            }
+
+            return gather_packed(out);
+        }
+
     private:
 
+        /* VER2 envelope, created on first gather() */
+        class Packed
+        {
+            /* distinct base name to avoid page file name clashes */
+            class Name : public BaseName
+            {
+                const BaseName& base_;
+            public:
+                Name(const BaseName& base) : base_(base) {}
+                void print(std::ostream& os) const
+                {
+                    base_.print(os); os << "_z";
+                }
+            };
+
+        public:
+
+            Packed(const BaseName& base, gu::RecordSet::Version rsv)
+                : name_(base),
+                  set_ (NULL, 0, name_, gu::RecordSet::CHECK_MMH128, rsv)
+            {}
+
+            Name                                 name_;
+            gu::RecordSetOut<DataSet::RecordOut> set_;
+        };
+
         // depending on version we may pack data differently
         DataSet::Version const version_;
 
+        const BaseName*         base_name_;
+        Packed*                 packed_;
+        std::vector<gu::byte_t> packed_buf_;
+        gu::Compression::Type   ctype_;
+        int                     clevel_;
+
+        size_t gather_packed (GatherVector& out);
+
         static gu::RecordSet::CheckType
         check_type (DataSet::Version ver)
         {
@@ -131,10 +221,15 @@ namespace galera
             {
             case DataSet::EMPTY: break; /* Can't create EMPTY DataSetOut */
             case DataSet::VER1:  return gu::RecordSet::CHECK_MMH128;
+            /* wrapped set is covered by the envelope checksum */
+            case DataSet::VER2:  return gu::RecordSet::CHECK_NONE;
             }
             throw;
         }
 
+        DataSetOut (const DataSetOut&);
+        DataSetOut& operator= (const DataSetOut&);
+
     }; /* class DataSetOut */
 
 
@@ -145,28 +240,78 @@ namespace galera
         DataSetIn (DataSet::Version ver, const gu::byte_t* buf, size_t size)
             :
             gu::RecordSetIn<DataSet::RecordIn>(buf, size, false),
-            version_(ver)
+            version_(ver),
+            plain_(),
+            plain_buf_()
         {}
 
         DataSetIn () : gu::RecordSetIn<DataSet::RecordIn>(),
-                       version_(DataSet::EMPTY)
+                       version_(DataSet::EMPTY),
+                       plain_(),
+                       plain_buf_()
         {}
 
         void init (DataSet::Version ver, const gu::byte_t* buf, size_t size)
         {
+            assert(plain_buf_.empty()); // no re-init after unpack()
             gu::RecordSetIn<DataSet::RecordIn>::init(buf, size, false);
             version_ = ver;
         }
 
+        /* Record access methods below refer to the wrapped set in VER2 and
+         * decompress it on first use. serial_size(), buf() and checksum()
+         * still refer to the envelope. */
+
+        int count () const
+        {
+            if (gu_likely(DataSet::VER2 != version_))
+            {
+                return gu::RecordSetIn<DataSet::RecordIn>::count();
+            }
+
+            return plain().count();
+        }
+
+        void rewind () const
+        {
+            if (gu_likely(DataSet::VER2 != version_))
+            {
+                gu::RecordSetIn<DataSet::RecordIn>::rewind();
+            }
+            else
+            {
+                plain().rewind();
+            }
+        }
+
         gu::Buf next () const
         {
-            return gu::RecordSetIn<DataSet::RecordIn>::next().buf();
+            if (gu_likely(DataSet::VER2 != version_))
+            {
+                return gu::RecordSetIn<DataSet::RecordIn>::next().buf();
+            }
+
+            return plain().next().buf();
         }
 
     private:
 
+        typedef gu::RecordSetIn<DataSet::RecordIn> Plain;
+
         DataSet::Version version_;
 
+        /* decompressed VER2 contents */
+        Plain mutable                   plain_;
+        std::vector<gu::byte_t> mutable plain_buf_;
+
+        const Plain& plain () const
+        {
+            if (gu_unlikely(plain_buf_.empty())) unpack();
+            return plain_;
+        }
+
+        void unpack () const;
+
     }; /* class DataSetIn */
 
 #if defined(__GNUG__)
@@ -0,0 +1,127 @@
+//
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+//
+
+//
+// Key level dependencies of a certified write set.
+//
+// depends_seqno is the highest seqno the write set conflicts with, so
+// waiting for last_left >= depends_seqno also waits for all unrelated
+// write sets below it. KeyDeps keeps the individual seqnos of the write
+// sets found in the certification index for the keys of the write set,
+// and a range below which everything must have been applied (baseline
+// dependency, shared key references of which only the latest one is known,
+// PA unsafe write sets and overflow).
+//
+
+#ifndef GALERA_KEY_DEPS_HPP
+#define GALERA_KEY_DEPS_HPP
+
+#include "wsrep_api.h"
+
+#include <algorithm>
+#include <ostream>
+
+namespace galera
+{
+    class KeyDeps
+    {
+    public:
+
+        // maximum number of individual seqnos, the rest is folded into range
+        static int const MAX = 8;
+
+        KeyDeps() : range_(WSREP_SEQNO_UNDEFINED), size_(0), valid_(false) {}
+
+        // starts collecting dependencies on top of range
+        void reset(wsrep_seqno_t const range)
+        {
+            range_ = range;
+            size_  = 0;
+            valid_ = true;
+        }
+
+        void clear() { reset(WSREP_SEQNO_UNDEFINED); valid_ = false; }
+
+        // everything up to and including s must be applied
+        void add_range(wsrep_seqno_t const s)
+        {
+            if (s <= range_) return;
+
+            range_ = s;
+
+            int n(0);
+            for (int i(0); i < size_; ++i)
+            {
+                if (seqnos_[i] > range_) seqnos_[n++] = seqnos_[i];
+            }
+            size_ = n;
+        }
+
+        // s must be applied
+        void add(wsrep_seqno_t const s)
+        {
+            if (s <= range_) return;
+
+            for (int i(0); i < size_; ++i) if (seqnos_[i] == s) return;
+
+            if (size_ < MAX)
+            {
+                seqnos_[size_++] = s;
+                return;
+            }
+
+            // fold the lowest seqno into range
+            wsrep_seqno_t* const min(std::min_element(seqnos_,
+                                                      seqnos_ + size_));
+            if (s < *min)
+            {
+                add_range(s);
+            }
+            else
+            {
+                wsrep_seqno_t const r(*min);
+                *min = s;
+                add_range(r);
+            }
+        }
+
+        void merge(const KeyDeps& other)
+        {
+            add_range(other.range_);
+            for (int i(0); i < other.size_; ++i) add(other.seqnos_[i]);
+        }
+
+        wsrep_seqno_t range() const { return range_; }
+        int           size()  const { return size_; }
+        wsrep_seqno_t operator[](int const i) const { return seqnos_[i]; }
+
+        // @return true if dependencies were collected and the highest of
+        //         them is depends_seqno, i.e. nothing was missed
+        bool complete(wsrep_seqno_t const depends_seqno) const
+        {
+            if (!valid_) return false;
+
+            wsrep_seqno_t max(range_);
+            for (int i(0); i < size_; ++i) max = std::max(max, seqnos_[i]);
+
+            return (max == depends_seqno);
+        }
+
+    private:
+
+        wsrep_seqno_t seqnos_[MAX];
+        wsrep_seqno_t range_;
+        int           size_;
+        bool          valid_;
+
+        friend std::ostream& operator<<(std::ostream& os, const KeyDeps& d)
+        {
+            os << "range: " << d.range_ << " seqnos:";
+            for (int i(0); i < d.size_; ++i) os << ' ' << d.seqnos_[i];
+            return os;
+        }
+    };
+}
+
+#endif // GALERA_KEY_DEPS_HPP
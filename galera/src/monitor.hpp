@@ -6,15 +6,39 @@
 #define GALERA_MONITOR_HPP
 
 #include "trx_handle.hpp"
+#include "key_deps.hpp"
 #include <gu_lock.hpp> // for gu::Mutex and gu::Cond
 #include <gu_limits.h>
+#include <gu_arch.h>
+#include <gu_time.h>
 #include "gu_thread_keys.hpp"
 
+#include <atomic>
+#include <limits>
 #include <memory>
 #include <vector>
 
 namespace galera
 {
+    //
+    // Monitor enforces the order in which objects enter and leave
+    // a critical section according to C::condition().
+    //
+    // When the monitor is idle (last_entered_ == last_left_ and nobody is
+    // waiting), the object with seqno last_left_ + 1 enters and leaves
+    // with a single atomic operation on fast_ without taking the mutex.
+    // Any other operation first switches the monitor to locked mode, where
+    // position is kept in last_entered_/last_left_ and process slots, and
+    // the monitor returns to fast mode when it becomes idle again.
+    //
+    // If spinning is enabled with set_spin_ns(), an object which can't
+    // enter yet spins for up to twice the average observed waiting time
+    // (but not longer than spin_ns) before going to sleep on its condition.
+    //
+    // If C has key_deps() method returning non-null KeyDeps, the object
+    // may also enter when all those dependencies have left, even if
+    // C::condition() does not hold yet.
+    //
     template <class C>
     class Monitor
     {
@@ -22,19 +46,6 @@ namespace galera
 
         struct Process
         {
-            Process()
-                : obj_(0)
-                , cond_()
-                , wait_cond_()
-                , state_(S_IDLE)
-#ifndef NDEBUG
-                , dobj_()
-#endif /* NDEBUG */
-            { }
-
-            const C* obj_;
-            gu::Cond* cond_;
-            std::shared_ptr<gu::Cond> wait_cond_;
             enum State
             {
                 S_IDLE,     // Slot is free
@@ -42,34 +53,37 @@ namespace galera
                 S_CANCELED,
                 S_APPLYING, // Applying
                 S_FINISHED  // Finished
-            } state_;
+            };
+
+            Process()
+                : obj_(0)
+                , word_(S_IDLE)
+#ifndef NDEBUG
+                , dobj_()
+#endif /* NDEBUG */
+            { }
+
+            // object occupying the slot, waits on obj_->cond()
+            C*       obj_;
+            // state in the low bits and a flag telling that there are
+            // threads in wait() for a seqno mapped to this slot
+            uint32_t word_;
 #ifndef NDEBUG
             C dobj_;
 #endif /* NDEBUG */
 
+            State state() const { return State(word_ & STATE_MASK); }
+            void  state(State const s) { word_ = (word_ & ~STATE_MASK) | s; }
 
-            std::shared_ptr<gu::Cond> wait_cond(
-                gu::Lock& lock __attribute__((unused)),
-                gu::CondKey cond_key)
+            bool waiters() const { return (word_ & WAITERS); }
+            void waiters(bool const w)
             {
-                assert(lock.owns_lock());
-                if (not wait_cond_)
-                {
-                    wait_cond_ = std::make_shared<gu::Cond>(
-                        gu::get_cond_key(cond_key));
-                }
-                return wait_cond_;
+                word_ = (w ? (word_ | WAITERS) : (word_ & ~WAITERS));
             }
 
-            void wake_up_waiters(gu::Lock& lock __attribute__((unused)))
-            {
-                assert(lock.owns_lock());
-                if (wait_cond_)
-                {
-                    wait_cond_->broadcast();
-                    wait_cond_.reset();
-                }
-            }
+            static uint32_t const STATE_MASK = 0x07;
+            static uint32_t const WAITERS    = 0x08;
+
         private:
 
             // non-copyable
@@ -77,26 +91,50 @@ namespace galera
             void operator=(const Process&);
         };
 
-        static const ssize_t process_size_ = (1ULL << 16);
-        static const size_t  process_mask_ = process_size_ - 1;
+        // initial process window size, it grows on demand up to max_size_
+        static const ssize_t INITIAL_WINDOW = (1 << 10);
+        // number of conditions shared by threads in wait(),
+        // must not be greater than process window
+        static const ssize_t WAIT_CONDS = (1 << 6);
+
     public:
 
+        static const ssize_t DEFAULT_MAX_WINDOW = (1 << 16);
+
         Monitor(enum gu::MutexKey mutex_key, enum gu::CondKey cond_key)
             :
             mutex_(gu::get_mutex_key(mutex_key)),
-            cond_key_(cond_key),
             cond_(gu::get_cond_key(cond_key)),
             uuid_(WSREP_UUID_UNDEFINED),
             last_entered_(-1),
             last_left_(-1),
             drain_seqno_(GU_LLONG_MAX),
+            process_size_(INITIAL_WINDOW),
+            process_mask_(process_size_ - 1),
+            max_size_(DEFAULT_MAX_WINDOW),
             process_(new Process[process_size_]),
+            wait_conds_(),
+            fast_(fast_idle(-1)),
+            canceled_(0),
+            sleepers_(0),
+            key_waiters_(0),
             entered_(0),
             oooe_(0),
             oool_(0),
             win_size_(0),
-            waits_(0)
-        { }
+            waits_(0),
+            spin_ns_(0),
+            hold_ns_(0),
+            spins_(0),
+            window_ns_(0)
+        {
+            for (ssize_t i(0); i < WAIT_CONDS; ++i)
+            {
+                wait_conds_.push_back(std::unique_ptr<gu::Cond>(
+                                          new gu::Cond(
+                                              gu::get_cond_key(cond_key))));
+            }
+        }
 
         ~Monitor()
         {
@@ -124,6 +162,7 @@ namespace galera
         {
             gu::Lock lock(mutex_);
 
+            fast_disable(lock);
             state_debug_print("set_initial_position", seqno);
             uuid_ = uuid;
             // When the monitor position is reset, either all the
@@ -157,50 +196,67 @@ namespace galera
 #endif
             if (seqno != -1)
             {
-                const size_t idx(indexof(seqno));
-                process_[idx].wake_up_waiters(lock);
+                wake_up_waiters(seqno);
             }
+
+            fast_enable(lock);
         }
 
         void enter(C& obj)
         {
             const wsrep_seqno_t obj_seqno(obj.seqno());
-            const size_t        idx(indexof(obj_seqno));
+
+            if (fast_enter(obj)) return;
+            if (spin(obj) && fast_enter(obj)) return;
+
             gu::Lock            lock(mutex_);
 
+            fast_disable(lock);
             state_debug_print("enter", obj);
             assert(obj_seqno > last_left_);
 
             pre_enter(obj, lock);
 
-            if (gu_likely(process_[idx].state_ != Process::S_CANCELED))
+            // slot must be looked up again after the mutex was released,
+            // since the process window may be resized meanwhile
+            if (gu_likely(slot(obj_seqno).state() != Process::S_CANCELED))
             {
-                assert(process_[idx].state_ == Process::S_IDLE);
+                assert(slot(obj_seqno).state() == Process::S_IDLE);
 
-                process_[idx].state_ = Process::S_WAITING;
-                process_[idx].obj_   = &obj;
+                set_state(slot(obj_seqno), Process::S_WAITING);
+                slot(obj_seqno).obj_ = &obj;
 #ifndef NDEBUG
-                process_[idx].dobj_.~C();
-                new (&process_[idx].dobj_) C(obj);
+                slot(obj_seqno).dobj_.~C();
+                new (&slot(obj_seqno).dobj_) C(obj);
 #endif /* NDEBUG */
 #ifdef GU_DBUG_ON
                 obj.debug_sync(mutex_);
 #endif // GU_DBUG_ON
+                long long wait_start(0);
+                bool const keyed(key_deps(obj, 0) != 0);
+                key_waiters_ += keyed;
                 while (may_enter(obj) == false &&
-                       process_[idx].state_ == Process::S_WAITING)
+                       slot(obj_seqno).state() == Process::S_WAITING)
                 {
-                    process_[idx].cond_ = obj.cond();
+                    if (0 == wait_start && spin_ns_ > 0)
+                    {
+                        wait_start = gu_time_monotonic();
+                    }
                     ++waits_;
-                    lock.wait(*process_[idx].cond_);
-                    process_[idx].cond_ = 0;
+                    sleep(lock, *obj.cond());
+                }
+                key_waiters_ -= keyed;
+                if (wait_start > 0)
+                {
+                    hold_sample(gu_time_monotonic() - wait_start);
                 }
 
-                if (process_[idx].state_ != Process::S_CANCELED)
+                if (slot(obj_seqno).state() != Process::S_CANCELED)
                 {
-                    assert(process_[idx].state_ == Process::S_WAITING ||
-                           process_[idx].state_ == Process::S_APPLYING);
+                    assert(slot(obj_seqno).state() == Process::S_WAITING ||
+                           slot(obj_seqno).state() == Process::S_APPLYING);
 
-                    process_[idx].state_ = Process::S_APPLYING;
+                    set_state(slot(obj_seqno), Process::S_APPLYING);
 
                     ++entered_;
                     oooe_     += ((last_left_ + 1) < obj_seqno);
@@ -209,8 +265,8 @@ namespace galera
                 }
             }
 
-            assert(process_[idx].state_ == Process::S_CANCELED);
-            process_[idx].state_ = Process::S_IDLE;
+            assert(slot(obj_seqno).state() == Process::S_CANCELED);
+            set_state(slot(obj_seqno), Process::S_IDLE);
 
             state_debug_print("enter canceled", obj);
             gu_throw_error(EINTR);
@@ -233,16 +289,16 @@ namespace galera
 
         void leave(const C& obj)
         {
-#ifndef NDEBUG
-            size_t   idx(indexof(obj.seqno()));
-#endif /* NDEBUG */
+            if (fast_leave(obj.seqno())) return;
+
             gu::Lock lock(mutex_);
+            fast_disable(lock);
             state_debug_print("leave", obj);
 
-            assert(process_[idx].state_ == Process::S_APPLYING ||
-                   process_[idx].state_ == Process::S_CANCELED);
+            assert(slot(obj.seqno()).state() == Process::S_APPLYING ||
+                   slot(obj.seqno()).state() == Process::S_CANCELED);
 
-            assert(process_[indexof(last_left_)].state_ == Process::S_IDLE);
+            assert(slot(last_left_).state() == Process::S_IDLE);
 
             post_leave(obj.seqno(), lock);
         }
@@ -250,14 +306,14 @@ namespace galera
         void self_cancel(C& obj)
         {
             wsrep_seqno_t const obj_seqno(obj.seqno());
-            size_t   idx(indexof(obj_seqno));
             gu::Lock lock(mutex_);
 
+            fast_disable(lock);
             state_debug_print("self_cancel", obj);
 
             assert(obj_seqno > last_left_);
 
-            while (obj_seqno - last_left_ >= process_size_)
+            while (!fits(obj_seqno, lock))
                 // TODO: exit on error
             {
                 log_warn << "Trying to self-cancel seqno out of process "
@@ -267,15 +323,17 @@ namespace galera
                          << ", process_size_: "  << process_size_
                          << ". Deadlock is very likely.";
 
-                lock.wait(cond_);
+                window_sleep(lock);
             }
 
-            assert(process_[idx].state_ == Process::S_IDLE ||
-                   process_[idx].state_ == Process::S_CANCELED);
+            Process& p(slot(obj_seqno));
+
+            assert(p.state() == Process::S_IDLE ||
+                   p.state() == Process::S_CANCELED);
 
 #ifndef NDEBUG
-            process_[idx].dobj_.~C();
-            new (&process_[idx].dobj_) C(obj);
+            p.dobj_.~C();
+            new (&p.dobj_) C(obj);
 #endif /* NDEBUG */
 
             if (obj_seqno > last_entered_) last_entered_ = obj_seqno;
@@ -286,32 +344,33 @@ namespace galera
             }
             else
             {
-                process_[idx].state_ = Process::S_FINISHED;
+                set_state(p, Process::S_FINISHED);
             }
         }
 
         bool interrupt(const C& obj)
         {
-            size_t   idx (indexof(obj.seqno()));
             gu::Lock lock(mutex_);
 
-            while (obj.seqno() - last_left_ >= process_size_)
+            fast_disable(lock);
+
+            while (!fits(obj.seqno(), lock))
                 // TODO: exit on error
             {
-                lock.wait(cond_);
+                window_sleep(lock);
             }
 
             state_debug_print("interrupt", obj);
 
-            if ((process_[idx].state_ == Process::S_IDLE &&
+            Process& p(slot(obj.seqno()));
+
+            if ((p.state() == Process::S_IDLE &&
                  obj.seqno()          >  last_left_ ) ||
-                process_[idx].state_ == Process::S_WAITING )
+                p.state() == Process::S_WAITING )
             {
-                process_[idx].state_ = Process::S_CANCELED;
-                if (process_[idx].cond_)
-                {
-                    process_[idx].cond_->signal();
-                }
+                bool const waiting(p.state() == Process::S_WAITING);
+                set_state(p, Process::S_CANCELED);
+                if (waiting) signal(p);
                 // since last_left + 1 cannot be <= S_WAITING we're not
                 // modifying a window here. No broadcasting.
                 return true;
@@ -319,7 +378,7 @@ namespace galera
             else
             {
                 log_debug << "interrupting " << obj.seqno()
-                          << " state " << process_[idx].state_
+                          << " state " << p.state()
                           << " le " << last_entered_
                           << " ll " << last_left_;
             }
@@ -330,59 +389,97 @@ namespace galera
         wsrep_seqno_t last_left() const
         {
             gu::Lock lock(mutex_);
-            return last_left_;
+            return current_last_left();
         }
 
         wsrep_seqno_t last_entered() const
         {
             gu::Lock lock(mutex_);
-            return last_entered_;
+            int64_t const f(fast_.load(std::memory_order_acquire));
+            return (f == FAST_OFF ? last_entered_ : fast_seqno(f));
         }
 
         void last_left_gtid(wsrep_gtid_t& gtid) const
         {
             gu::Lock lock(mutex_);
             gtid.uuid = uuid_;
-            gtid.seqno = last_left_;
+            gtid.seqno = current_last_left();
         }
 
-        ssize_t       size()        const { return process_size_; }
+        // current process window size
+        ssize_t size() const
+        {
+            gu::Lock lock(mutex_);
+            return process_size_;
+        }
 
         bool would_block (wsrep_seqno_t seqno) const
         {
-            return (seqno - last_left_ >= process_size_ ||
+            return (seqno - current_last_left() >=
+                    max_size_.load(std::memory_order_relaxed) ||
                     seqno > drain_seqno_);
         }
 
+        // Sets maximum process window size, rounded up to power of 2.
+        // The window grows when seqno which does not fit in it enters and
+        // shrinks when the monitor is idle or drained.
+        void set_max_window(ssize_t const max_size)
+        {
+            if (max_size <= 0)
+            {
+                gu_throw_error(EINVAL) << "Invalid monitor window size: "
+                                       << max_size;
+            }
+
+            ssize_t size(WAIT_CONDS);
+            while (size < max_size) size *= 2;
+
+            gu::Lock lock(mutex_);
+
+            fast_disable(lock);
+            max_size_.store(size, std::memory_order_relaxed);
+            shrink(lock);
+            // somebody may be waiting for the window to grow
+            cond_.broadcast();
+            fast_enable(lock);
+        }
+
         void drain(wsrep_seqno_t seqno)
         {
             gu::Lock lock(mutex_);
 
+            fast_disable(lock);
             state_debug_print("drain", seqno);
 
             while (drain_seqno_ != GU_LLONG_MAX)
             {
-                lock.wait(cond_);
+                sleep(lock, cond_);
             }
 
             drain_common(seqno, lock);
 
             // there can be some stale canceled entries
             update_last_left(lock);
+            shrink(lock);
 
             drain_seqno_ = GU_LLONG_MAX;
             cond_.broadcast();
+
+            fast_enable(lock);
         }
 
         void wait(wsrep_seqno_t seqno)
         {
             gu::Lock lock(mutex_);
+            if (current_last_left() >= seqno) return;
+
+            fast_disable(lock);
             while (last_left_ < seqno)
             {
-                size_t idx(indexof(seqno));
-                auto cond(process_[idx].wait_cond(lock, cond_key_));;
-                lock.wait(*cond);
+                slot(seqno).waiters(true);
+                sleep(lock, wait_cond(seqno));
             }
+            fast_enable(lock);
         }
 
         void wait(gu::GTID& gtid, const gu::datetime::Date& wait_until)
@@ -392,12 +489,15 @@ namespace galera
             {
                 throw gu::NotFound();
             }
+            if (current_last_left() >= gtid.seqno()) return;
+
+            fast_disable(lock);
             while (last_left_ < gtid.seqno())
             {
-                size_t idx(indexof(gtid.seqno()));
-                auto cond(process_[idx].wait_cond(lock, cond_key_));;
-                lock.wait(*cond, wait_until);
+                slot(gtid.seqno()).waiters(true);
+                sleep(lock, wait_cond(gtid.seqno()), wait_until);
             }
+            fast_enable(lock);
         }
 
         void get_stats(double* oooe, double* oool, double* win_size,
@@ -418,14 +518,305 @@ namespace galera
             *waits = waits_;
         }
 
+        // Current process window size and total time spent waiting for
+        // the window to advance when it could not grow any more.
+        void get_window_stats(ssize_t* size, long long* blocked_ns) const
+        {
+            gu::Lock lock(mutex_);
+            *size       = process_size_;
+            *blocked_ns = window_ns_;
+        }
+
+        // Number of waits resolved by spinning and number of waits
+        // which went to sleep.
+        void get_spin_stats(long long* spins, long long* parks) const
+        {
+            gu::Lock lock(mutex_);
+            *spins = spins_;
+            *parks = waits_;
+        }
+
         void flush_stats()
         {
             gu::Lock lock(mutex_);
             oooe_ = 0; oool_ = 0; win_size_ = 0; entered_ = 0; waits_ = 0;
+            spins_ = 0; window_ns_ = 0;
+        }
+
+        // Maximum time to spin before going to sleep in enter(),
+        // 0 disables spinning.
+        void set_spin_ns(long long const spin_ns)
+        {
+            spin_ns_.store(std::max(spin_ns, 0LL), std::memory_order_relaxed);
+            hold_ns_.store(spin_ns_ / 2, std::memory_order_relaxed);
         }
 
     private:
 
+        // fast_ holds 2*seqno when the monitor is idle at last_left_ seqno,
+        // 2*seqno + 1 when seqno has entered via fast path and FAST_OFF
+        // when the monitor is in locked mode.
+        static const int64_t FAST_OFF = std::numeric_limits<int64_t>::min();
+
+        static int64_t fast_idle(wsrep_seqno_t s) { return s * 2; }
+        static int64_t fast_busy(wsrep_seqno_t s) { return s * 2 + 1; }
+        static wsrep_seqno_t fast_seqno(int64_t f) { return (f - (f & 1))/2; }
+
+        bool fast_enter(C& obj)
+        {
+            wsrep_seqno_t const obj_seqno(obj.seqno());
+#ifdef GU_DBUG_ON
+            // debug sync points are in the locked path
+            return false;
+#endif /* GU_DBUG_ON */
+            int64_t expected(fast_idle(obj_seqno - 1));
+
+            if (fast_.load(std::memory_order_relaxed) == expected &&
+                obj.condition(obj_seqno - 1, obj_seqno - 1) &&
+                fast_.compare_exchange_strong(expected, fast_busy(obj_seqno),
+                                              std::memory_order_acq_rel))
+            {
+                entered_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+
+        void hold_sample(long long const ns)
+        {
+            long long const hold(hold_ns_.load(std::memory_order_relaxed));
+            hold_ns_.store(hold + (ns - hold) / 8, std::memory_order_relaxed);
+        }
+
+        // Spin until obj may enter, but not longer than twice the average
+        // waiting time. Spinning is skipped if waits are longer than
+        // spin_ns_.
+        // @return true if obj may enter
+        bool spin(const C& obj)
+        {
+            long long const max(spin_ns_.load(std::memory_order_relaxed));
+            long long const hold(hold_ns_.load(std::memory_order_relaxed));
+            long long const budget(hold < max ? std::min(2 * hold, max) : 0);
+
+            if (budget <= 0) return false;
+
+            wsrep_seqno_t const obj_seqno(obj.seqno());
+            wsrep_seqno_t ll(current_last_left());
+
+            // nothing to wait for or can't enter anyway
+            if (obj.condition(ll, ll) ||
+                obj_seqno - ll >= max_size_.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            long long const start(gu_time_monotonic());
+            long long now(start);
+            bool ready(false);
+
+            for (long i(1); !ready && now - start < budget; ++i)
+            {
+                GU_CPU_RELAX();
+                ll = current_last_left();
+                ready = obj.condition(ll, ll);
+                if (ready || 0 == (i & 63)) now = gu_time_monotonic();
+            }
+
+            if (ready)
+            {
+                spins_.fetch_add(1, std::memory_order_relaxed);
+                hold_sample(now - start);
+            }
+
+            return ready;
+        }
+
+        bool fast_leave(wsrep_seqno_t const obj_seqno)
+        {
+            int64_t expected(fast_busy(obj_seqno));
+            return fast_.compare_exchange_strong(expected,
+                                                 fast_idle(obj_seqno),
+                                                 std::memory_order_acq_rel);
+        }
+
+        // Switch to locked mode: move fast path position into
+        // last_entered_/last_left_ and process slots.
+        void fast_disable(gu::Lock& lock __attribute__((unused)))
+        {
+            assert(lock.owns_lock());
+
+            int64_t const f(fast_.exchange(FAST_OFF,
+                                           std::memory_order_acq_rel));
+            if (f == FAST_OFF) return;
+
+            wsrep_seqno_t const seqno(fast_seqno(f));
+            if (f & 1)
+            {
+                assert(slot(seqno).state() == Process::S_IDLE);
+                slot(seqno).state(Process::S_APPLYING);
+                last_entered_ = seqno;
+                last_left_    = seqno - 1;
+            }
+            else
+            {
+                last_entered_ = last_left_ = seqno;
+            }
+        }
+
+        // Switch back to fast mode if nothing can be waiting on the monitor.
+        void fast_enable(gu::Lock& lock __attribute__((unused)))
+        {
+            assert(lock.owns_lock());
+
+            if (last_entered_ == last_left_ && drain_seqno_ == GU_LLONG_MAX &&
+                canceled_ == 0 && sleepers_ == 0)
+            {
+                assert(fast_.load(std::memory_order_relaxed) == FAST_OFF);
+                fast_.store(fast_idle(last_left_), std::memory_order_release);
+            }
+        }
+
+        wsrep_seqno_t current_last_left() const
+        {
+            int64_t const f(fast_.load(std::memory_order_acquire));
+            if (f == FAST_OFF) return last_left_;
+            return fast_seqno(f) - (f & 1);
+        }
+
+        void set_state(Process& p, typename Process::State const s)
+        {
+            canceled_ += (s == Process::S_CANCELED);
+            canceled_ -= (p.state() == Process::S_CANCELED);
+            p.state(s);
+        }
+
+        static void signal(Process& p)
+        {
+            assert(p.obj_);
+            gu::Cond* const cond(p.obj_->cond());
+            if (cond) cond->signal();
+        }
+
+        gu::Cond& wait_cond(wsrep_seqno_t const seqno) const
+        {
+            return *wait_conds_[seqno & (WAIT_CONDS - 1)];
+        }
+
+        // wakes up threads in wait() for seqnos mapped to seqno slot
+        void wake_up_waiters(wsrep_seqno_t const seqno)
+        {
+            Process& p(slot(seqno));
+            if (p.waiters())
+            {
+                // WAIT_CONDS divides process window size, so all seqnos
+                // mapped to the same slot share the same wait condition
+                wait_cond(seqno).broadcast();
+                p.waiters(false);
+            }
+        }
+
+        void window_sleep(gu::Lock& lock)
+        {
+            long long const start(gu_time_monotonic());
+            sleep(lock, cond_);
+            window_ns_ += gu_time_monotonic() - start;
+        }
+
+        // @return true if seqno fits in process window, grows the window
+        //         if needed and allowed by max_size_
+        bool fits(wsrep_seqno_t const seqno, gu::Lock& lock)
+        {
+            wsrep_seqno_t const dist(seqno - last_left_);
+
+            if (gu_likely(dist < process_size_)) return true;
+            if (dist >= max_size_.load(std::memory_order_relaxed)) return false;
+
+            ssize_t size(process_size_ * 2);
+            while (size <= dist) size *= 2;
+
+            resize(size, lock);
+            return true;
+        }
+
+        // shrinks process window down to max_size_ if nothing is in it
+        void shrink(gu::Lock& lock)
+        {
+            ssize_t const max_size(max_size_.load(std::memory_order_relaxed));
+
+            if (process_size_ > max_size && last_entered_ == last_left_ &&
+                canceled_ == 0)
+            {
+                resize(max_size, lock);
+            }
+        }
+
+        // Moves slots of seqnos in (last_left_, last_left_ + process_size_]
+        // to a new process array. When shrinking, slots which don't fit
+        // in the new window must be idle and only their waiters flags are
+        // preserved.
+        void resize(ssize_t const size, gu::Lock& lock __attribute__((unused)))
+        {
+            assert(lock.owns_lock());
+            assert(size >= WAIT_CONDS && 0 == (size & (size - 1)));
+
+            Process* const     process(new Process[size]);
+            size_t const       mask(size - 1);
+            wsrep_seqno_t const ll(last_left_);
+
+            for (wsrep_seqno_t i(ll + 1); i <= ll + process_size_; ++i)
+            {
+                Process& from(slot(i));
+                Process& to(process[i & mask]);
+
+                if (i - ll < size)
+                {
+                    to.obj_  = from.obj_;
+                    to.word_ = from.word_;
+#ifndef NDEBUG
+                    to.dobj_.~C();
+                    new (&to.dobj_) C(from.dobj_);
+#endif /* NDEBUG */
+                }
+                else
+                {
+                    assert(from.state() == Process::S_IDLE);
+                    to.waiters(to.waiters() || from.waiters());
+                }
+            }
+
+            log_debug << "Monitor window resized from " << process_size_
+                      << " to " << size << " at seqno " << ll;
+
+            delete[] process_;
+            process_      = process;
+            process_size_ = size;
+            process_mask_ = mask;
+        }
+
+        // Waiting threads keep the monitor in locked mode.
+        void sleep(gu::Lock& lock, const gu::Cond& cond) const
+        {
+            ++sleepers_;
+            lock.wait(cond);
+            --sleepers_;
+        }
+
+        void sleep(gu::Lock& lock, const gu::Cond& cond,
+                   const gu::datetime::Date& wait_until) const
+        {
+            ++sleepers_;
+            try
+            {
+                lock.wait(cond, wait_until);
+            }
+            catch (...)
+            {
+                --sleepers_;
+                throw;
+            }
+            --sleepers_;
+        }
+
         template <typename T>
         void state_debug_print(const std::string& method, const T& x)
         {
@@ -441,9 +832,40 @@ namespace galera
             return (seqno & process_mask_);
         }
 
+        Process& slot(wsrep_seqno_t const seqno) const
+        {
+            return process_[indexof(seqno)];
+        }
+
+        template <typename T>
+        static auto key_deps(const T& obj, int) -> decltype(obj.key_deps())
+        {
+            return obj.key_deps();
+        }
+
+        template <typename T>
+        static const KeyDeps* key_deps(const T&, long) { return 0; }
+
+        // @return true if seqno has left the monitor, possibly out of order
+        bool left(wsrep_seqno_t const seqno) const
+        {
+            return (seqno <= last_left_ ||
+                    (seqno <= last_entered_ &&
+                     slot(seqno).state() == Process::S_FINISHED));
+        }
+
         bool may_enter(const C& obj) const
         {
-            return obj.condition(last_entered_, last_left_);
+            if (obj.condition(last_entered_, last_left_)) return true;
+
+            const KeyDeps* const deps(key_deps(obj, 0));
+            if (!deps || deps->range() > last_left_) return false;
+
+            for (int i(0); i < deps->size(); ++i)
+            {
+                if (!left((*deps)[i])) return false;
+            }
+            return true;
         }
 
         // wait until it is possible to grab slot in monitor,
@@ -454,9 +876,17 @@ namespace galera
 
             const wsrep_seqno_t obj_seqno(obj.seqno());
 
-            while (would_block (obj_seqno)) // TODO: exit on error
+            while (obj_seqno > drain_seqno_ || !fits(obj_seqno, lock))
+                // TODO: exit on error
             {
-                lock.wait(cond_);
+                if (obj_seqno > drain_seqno_)
+                {
+                    sleep(lock, cond_);
+                }
+                else
+                {
+                    window_sleep(lock);
+                }
             }
 
             if (last_entered_ < obj_seqno) last_entered_ = obj_seqno;
@@ -468,11 +898,11 @@ namespace galera
             {
                 Process& a(process_[indexof(i)]);
 
-                if (Process::S_FINISHED == a.state_)
+                if (Process::S_FINISHED == a.state())
                 {
-                    a.state_   = Process::S_IDLE;
+                    a.state(Process::S_IDLE);
                     last_left_ = i;
-                    a.wake_up_waiters(lock);
+                    wake_up_waiters(i);
                 }
                 else
                 {
@@ -487,7 +917,7 @@ namespace galera
             for (wsrep_seqno_t i = last_left_ + 1; i <= last_entered_; ++i)
             {
                 Process& a(process_[indexof(i)]);
-                if (a.state_           == Process::S_WAITING &&
+                if (a.state()          == Process::S_WAITING &&
                     may_enter(*a.obj_) == true)
                 {
                     // We need to set state to APPLYING here because if
@@ -495,24 +925,21 @@ namespace galera
                     // the race  that follows exit from this function,
                     // there will be  nobody to clean up and advance
                     // last_left_.
-                    a.state_ = Process::S_APPLYING;
-                    if (a.cond_)
-                    {
-                        a.cond_->signal();
-                    }
+                    a.state(Process::S_APPLYING);
+                    signal(a);
                 }
             }
         }
 
         void post_leave(wsrep_seqno_t const obj_seqno, gu::Lock& lock)
         {
-            const size_t idx(indexof(obj_seqno));
+            Process& p(slot(obj_seqno));
 
             if (last_left_ + 1 == obj_seqno) // we're shrinking window
             {
-                process_[idx].state_ = Process::S_IDLE;
+                set_state(p, Process::S_IDLE);
                 last_left_           = obj_seqno;
-                process_[idx].wake_up_waiters(lock);
+                wake_up_waiters(obj_seqno);
 
                 update_last_left(lock);
                 oool_ += (last_left_ > obj_seqno);
@@ -522,16 +949,18 @@ namespace galera
             }
             else
             {
-                process_[idx].state_ = Process::S_FINISHED;
+                set_state(p, Process::S_FINISHED);
+                // somebody may be waiting just for this seqno
+                if (key_waiters_ > 0) wake_up_next();
             }
 
-            process_[idx].obj_ = 0;
+            p.obj_ = 0;
 
             assert((last_left_ >= obj_seqno &&
-                    process_[idx].state_ == Process::S_IDLE) ||
-                   process_[idx].state_ == Process::S_FINISHED);
+                    p.state() == Process::S_IDLE) ||
+                   p.state() == Process::S_FINISHED);
             assert(last_left_ != last_entered_ ||
-                   process_[indexof(last_left_)].state_ == Process::S_IDLE);
+                   slot(last_left_).state() == Process::S_IDLE);
 
             if ((last_left_ >= obj_seqno) ||  // - occupied window shrinked
                 (last_left_ >= drain_seqno_)) // - this is to notify drain that
@@ -539,6 +968,8 @@ namespace galera
             {
                 cond_.broadcast();
             }
+
+            fast_enable(lock);
         }
 
         void drain_common(wsrep_seqno_t seqno, gu::Lock& lock)
@@ -556,24 +987,34 @@ namespace galera
                 {
                     const Process& a(process_[indexof(i)]);
                     log_info << "applier " << i
-                             << " in state " << a.state_;
+                             << " in state " << a.state();
                 }
 #endif
             }
 
-            while (last_left_ < drain_seqno_) lock.wait(cond_);
+            while (last_left_ < drain_seqno_) sleep(lock, cond_);
         }
 
         typename Process::State state(const C& obj) const
         {
             const wsrep_seqno_t obj_seqno(obj.seqno());
-            const size_t        idx(indexof(obj_seqno));
             gu::Lock lock(mutex_);
-            while (would_block (obj_seqno))
+            int64_t const f(fast_.load(std::memory_order_acquire));
+            if (f != FAST_OFF)
+            {
+                // in fast mode all slots except the entered one are idle
+                return ((f & 1) && fast_seqno(f) == obj_seqno ?
+                        Process::S_APPLYING : Process::S_IDLE);
+            }
+            while (obj_seqno - last_left_ >=
+                   std::max(process_size_, ssize_t(max_size_)) ||
+                   obj_seqno > drain_seqno_)
             {
-                lock.wait(cond_);
+                sleep(lock, cond_);
             }
-            return process_[idx].state_;
+            // seqnos beyond the window have not been touched yet
+            if (obj_seqno - last_left_ >= process_size_) return Process::S_IDLE;
+            return slot(obj_seqno).state();
         }
 
         Monitor(const Monitor&);
@@ -581,20 +1022,31 @@ namespace galera
 
         mutable
         gu::Mutex mutex_;
-        gu::CondKey cond_key_;
         gu::Cond  cond_;
         wsrep_uuid_t  uuid_;
         wsrep_seqno_t last_entered_;
-        wsrep_seqno_t last_left_;
+        std::atomic<wsrep_seqno_t> last_left_; // read unlocked when spinning
         wsrep_seqno_t drain_seqno_;
+        ssize_t       process_size_;
+        size_t        process_mask_;
+        std::atomic<ssize_t> max_size_;
         Process*      process_;
-        long entered_;  // entered
+        std::vector<std::unique_ptr<gu::Cond> > wait_conds_;
+        std::atomic<int64_t> fast_;
+        long          canceled_; // slots in S_CANCELED state
+        mutable long  sleepers_; // threads waiting on monitor conds
+        long          key_waiters_; // threads waiting on key dependencies
+        std::atomic<long> entered_;  // entered
         long oooe_;     // out of order entered
         long oool_;     // out of order left
         long win_size_; // window between last_left_ and last_entered_
         // Total number of waits in the monitor. Incremented before
         // entering into waiting state.
         long long waits_;
+        std::atomic<long long> spin_ns_; // max spin time before waiting
+        std::atomic<long long> hold_ns_; // average waiting time
+        std::atomic<long long> spins_;   // waits resolved by spinning
+        long long window_ns_; // time waited for process window to advance
     };
 }
 
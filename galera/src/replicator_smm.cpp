@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2010-2021 Codership Oy <info@codership.com>
+// Copyright (C) 2010-2024 Codership Oy <info@codership.com>
 //
 
 #include "galera_common.hpp"
@@ -98,7 +98,12 @@ galera::ReplicatorSMM::ReplicatorSMM(const struct wsrep_init_args* args)
                          KeySet::version(config_.get(Param::key_format)),
                          TrxHandleMaster::Defaults.record_set_ver_,
                          gu::from_string<int>(config_.get(
-                             Param::max_write_set_size))),
+                             Param::max_write_set_size)),
+                         DataSet::VER1, // until protocol is established
+                         gu::Compression::type(config_.get(
+                             Param::compression)),
+                         gu::from_string<int>(config_.get(
+                             Param::compression_level))),
     uuid_               (WSREP_UUID_UNDEFINED),
     state_uuid_         (WSREP_UUID_UNDEFINED),
     state_uuid_str_     (),
@@ -130,6 +135,7 @@ galera::ReplicatorSMM::ReplicatorSMM(const struct wsrep_init_args* args)
                          proto_max_, args->proto_ver,
                          args->node_name, args->node_incoming),
     service_thd_        (gcs_, gcache_),
+    check_pool_         (ChecksumPool::get()),
     slave_pool_         (sizeof(TrxHandleSlave), 1024, "TrxHandleSlave"),
     as_                 (new GcsActionSource(slave_pool_, gcs_, *this,gcache_)),
     ist_progress_cb_    (ProgressCallback<wsrep_seqno_t>(WSREP_MEMBER_JOINER,
@@ -199,6 +205,10 @@ galera::ReplicatorSMM::ReplicatorSMM(const struct wsrep_init_args* args)
     state_.add_transition(Transition(S_DONOR, S_JOINED));
 
     local_monitor_.set_initial_position(WSREP_UUID_UNDEFINED, 0);
+    set_monitor_spin(gu::from_string<long long>(
+                         config_.get(Param::monitor_spin_ns)));
+    set_monitor_window(gu::from_string<ssize_t>(
+                           config_.get(Param::max_monitor_window)));
 
     wsrep_uuid_t  uuid;
     wsrep_seqno_t seqno;
@@ -1888,7 +1898,7 @@ writeset_from_handle (wsrep_po_handle_t&             handle,
                 /* key format is not essential since we're not adding keys */
                 KeySet::version(trx_params.key_format_), NULL, 0, 0,
                 trx_params.record_set_ver_,
-                WriteSetNG::MAX_VERSION, DataSet::MAX_VERSION, DataSet::MAX_VERSION,
+                WriteSetNG::MAX_VERSION, DataSet::VER1, DataSet::VER1,
                 trx_params.max_write_set_size_);
 
             handle.opaque = ret;
@@ -2312,10 +2322,25 @@ void galera::ReplicatorSMM::set_initial_position(const wsrep_uuid_t&  uuid,
         commit_monitor_.set_initial_position(uuid, seqno);
 }
 
-std::tuple<int, enum gu::RecordSet::Version>
+void galera::ReplicatorSMM::set_monitor_spin(long long const spin_ns)
+{
+    local_monitor_.set_spin_ns(spin_ns);
+    apply_monitor_.set_spin_ns(spin_ns);
+    commit_monitor_.set_spin_ns(spin_ns);
+}
+
+void galera::ReplicatorSMM::set_monitor_window(ssize_t const max_size)
+{
+    local_monitor_.set_max_window(max_size);
+    apply_monitor_.set_max_window(max_size);
+    commit_monitor_.set_max_window(max_size);
+}
+
+std::tuple<int, enum gu::RecordSet::Version, enum galera::DataSet::Version>
 galera::get_trx_protocol_versions(int proto_ver)
 {
     enum gu::RecordSet::Version record_set_ver(gu::RecordSet::EMPTY);
+    enum DataSet::Version data_set_ver(DataSet::VER1);
     int trx_ver(-1);
     switch (proto_ver)
     {
@@ -2367,12 +2392,18 @@ galera::get_trx_protocol_versions(int proto_ver)
         trx_ver = 6; // zero-level key in the writeset
         record_set_ver = gu::RecordSet::VER2;
         break;
+    case 12:
+        // Protocol upgrade to enable support for compressed data sets
+        trx_ver = 6;
+        record_set_ver = gu::RecordSet::VER2;
+        data_set_ver = DataSet::VER2;
+        break;
     default:
         gu_throw_error(EPROTO)
             << "Configuration change resulted in an unsupported protocol "
             "version: " << proto_ver << ". Can't continue.";
     };
-    return std::make_tuple(trx_ver, record_set_ver);
+    return std::make_tuple(trx_ver, record_set_ver, data_set_ver);
 }
 
 void galera::ReplicatorSMM::establish_protocol_versions (int proto_ver)
@@ -2382,9 +2413,19 @@ void galera::ReplicatorSMM::establish_protocol_versions (int proto_ver)
         const auto trx_versions(get_trx_protocol_versions(proto_ver));
         trx_params_.version_ = std::get<0>(trx_versions);
         trx_params_.record_set_ver_ = std::get<1>(trx_versions);
+        trx_params_.data_set_ver_ = std::get<2>(trx_versions);
         protocol_version_ = proto_ver;
         log_info << "REPL Protocols: " << protocol_version_ << " ("
                  << trx_params_.version_ << ")";
+
+        if (trx_params_.compression_ != gu::Compression::NONE &&
+            trx_params_.data_set_ver_ < DataSet::VER2)
+        {
+            log_info << "Write set compression ("
+                     << gu::Compression::name(trx_params_.compression_)
+                     << ") is disabled until all members support protocol "
+                     << "version 12";
+        }
     }
     catch (const gu::Exception& e)
     {
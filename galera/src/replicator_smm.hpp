@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2010-2021 Codership Oy <info@codership.com>
+// Copyright (C) 2010-2024 Codership Oy <info@codership.com>
 //
 
 //! @file replicator_smm.hpp
@@ -406,6 +406,10 @@ namespace galera
             static const std::string commit_order;
             static const std::string causal_read_timeout;
             static const std::string max_write_set_size;
+            static const std::string monitor_spin_ns;
+            static const std::string max_monitor_window;
+            static const std::string compression;
+            static const std::string compression_level;
         };
 
         typedef std::pair<std::string, std::string> Default;
@@ -620,6 +624,7 @@ namespace galera
                 :
                 global_seqno_ (ts.global_seqno()),
                 depends_seqno_(ts.depends_seqno()),
+                key_deps_     (ts.key_deps()),
                 cond_(&ts.apply_order_cond_),
                 is_local_     (ts.local()),
                 is_toi_       (ts.is_toi())
@@ -638,6 +643,7 @@ namespace galera
                 :
                 global_seqno_ (gs),
                 depends_seqno_(ds),
+                key_deps_     (),
                 cond_(),
                 is_local_     (l),
                 is_toi_       (false)
@@ -657,6 +663,10 @@ namespace galera
                         last_left >= depends_seqno_);
             }
 
+            // If not null, monitor lets the object enter as soon as these
+            // particular seqnos have left, see KeyDeps.
+            const KeyDeps* key_deps() const { return key_deps_; }
+
 #ifdef GU_DBUG_ON
             void debug_sync(gu::Mutex& mutex)
             {
@@ -680,6 +690,7 @@ namespace galera
                 :
                 global_seqno_ (WSREP_SEQNO_UNDEFINED),
                 depends_seqno_(WSREP_SEQNO_UNDEFINED),
+                key_deps_     (),
                 cond_(),
                 is_local_     (false),
                 is_toi_       (false),
@@ -700,6 +711,7 @@ namespace galera
 #endif /* NDEBUG */
             const wsrep_seqno_t global_seqno_;
             const wsrep_seqno_t depends_seqno_;
+            const KeyDeps* const key_deps_;
             gu::Cond* cond_;
             const bool is_local_;
             const bool is_toi_;
@@ -835,6 +847,10 @@ namespace galera
 #endif
         };
 
+        typedef Monitor<LocalOrder>  LocalMonitor;
+        typedef Monitor<ApplyOrder>  ApplyMonitor;
+        typedef Monitor<CommitOrder> CommitMonitor;
+
     private:
 
         // state machine
@@ -877,6 +893,10 @@ namespace galera
 
         void set_initial_position(const wsrep_uuid_t&, wsrep_seqno_t);
 
+        void set_monitor_spin(long long spin_ns);
+
+        void set_monitor_window(ssize_t max_size);
+
         void establish_protocol_versions (int version);
 
         /*
@@ -975,6 +995,8 @@ namespace galera
          * | 4.x            10 | PA range/ 5 | CC events /  3 |               2 |
          * |                   | UPD keys    | idx preload    |                 |
          * |                11 | SRV keys  6 |              3 |               2 |
+         * |                12 |           6 |              3 |               2 |
+         * |                   | compressed data sets (data set version 2)      |
          * |--------------------------------------------------------------------|
          *
          * Note: str_proto_ver is decided in replicator_str.cpp based on
@@ -1044,6 +1066,7 @@ namespace galera
         ProgressCallback<gcs_seqno_t> joined_progress_cb_;
         GCS_IMPL         gcs_;
         ServiceThd       service_thd_;
+        std::shared_ptr<ChecksumPool> check_pool_; // for incoming write sets
 
         // action sources
         TrxHandleSlave::Pool slave_pool_;
@@ -1123,9 +1146,9 @@ namespace galera
         WriteSetWaiters write_set_waiters_;
 
         // concurrency control
-        Monitor<LocalOrder>  local_monitor_;
-        Monitor<ApplyOrder>  apply_monitor_;
-        Monitor<CommitOrder> commit_monitor_;
+        LocalMonitor  local_monitor_;
+        ApplyMonitor  apply_monitor_;
+        CommitMonitor commit_monitor_;
         gu::datetime::Period causal_read_timeout_;
 
         // counters
@@ -1170,9 +1193,10 @@ namespace galera
      *
      * @param proto_ver Group protocol version
      *
-     * @return Tuple consisting of trx protocol and record set versions.
+     * @return Tuple consisting of trx protocol, record set and maximum
+     *         data set versions.
      */
-    std::tuple<int, enum gu::RecordSet::Version>
+    std::tuple<int, enum gu::RecordSet::Version, enum DataSet::Version>
     get_trx_protocol_versions(int proto_ver);
 } /* namespace galera */
 
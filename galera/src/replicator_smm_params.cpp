@@ -1,4 +1,4 @@
-/* Copyright (C) 2012-2018 Codership Oy <info@codersip.com> */
+/* Copyright (C) 2012-2024 Codership Oy <info@codersip.com> */
 
 #include "replicator_smm.hpp"
 #include "gcs.hpp"
@@ -24,8 +24,18 @@ const std::string galera::ReplicatorSMM::Param::key_format =
     common_prefix + "key_format";
 const std::string galera::ReplicatorSMM::Param::max_write_set_size =
     common_prefix + "max_ws_size";
-
-int const galera::ReplicatorSMM::MAX_PROTO_VER(11);
+const std::string galera::ReplicatorSMM::Param::monitor_spin_ns =
+    common_prefix + "monitor_spin_ns";
+const std::string galera::ReplicatorSMM::Param::max_monitor_window =
+    common_prefix + "max_monitor_window";
+const std::string galera::ReplicatorSMM::Param::compression =
+    common_prefix + "compression";
+const std::string galera::ReplicatorSMM::Param::compression_level =
+    common_prefix + "compression_level";
+
+/* protocol 12 requires every node to be able to decompress every algorithm */
+int const galera::ReplicatorSMM::MAX_PROTO_VER
+(gu::Compression::supported_all() ? 12 : 11);
 
 galera::ReplicatorSMM::Defaults::Defaults() : map_()
 {
@@ -38,6 +48,11 @@ galera::ReplicatorSMM::Defaults::Defaults() : map_()
     const int max_write_set_size(galera::WriteSetNG::MAX_SIZE);
     map_.insert(Default(Param::max_write_set_size,
                         gu::to_string(max_write_set_size)));
+    map_.insert(Default(Param::monitor_spin_ns, "0"));
+    map_.insert(Default(Param::max_monitor_window, gu::to_string(
+                            ssize_t(LocalMonitor::DEFAULT_MAX_WINDOW))));
+    map_.insert(Default(Param::compression, "none"));
+    map_.insert(Default(Param::compression_level, "0"));
 }
 
 const galera::ReplicatorSMM::Defaults galera::ReplicatorSMM::defaults;
@@ -62,6 +77,10 @@ galera::ReplicatorSMM::InitConfig::InitConfig(gu::Config&       conf,
 
     conf.set_flags(Param::causal_read_timeout, gu::Config::Flag::type_duration);
     conf.set_flags(Param::max_write_set_size, gu::Config::Flag::type_integer);
+    conf.set_flags(Param::monitor_spin_ns, gu::Config::Flag::type_integer);
+    conf.set_flags(Param::max_monitor_window,
+                   gu::Config::Flag::type_integer);
+    conf.set_flags(Param::compression_level, gu::Config::Flag::type_integer);
     conf.set_flags(Param::base_dir, gu::Config::Flag::read_only);
     conf.set_flags(Param::base_port, gu::Config::Flag::read_only |
                    gu::Config::Flag::type_integer);
@@ -188,6 +207,22 @@ galera::ReplicatorSMM::set_param (const std::string& key,
     {
         trx_params_.max_write_set_size_ = gu::from_string<int>(value);
     }
+    else if (key == Param::monitor_spin_ns)
+    {
+        set_monitor_spin(gu::from_string<long long>(value));
+    }
+    else if (key == Param::max_monitor_window)
+    {
+        set_monitor_window(gu::from_string<ssize_t>(value));
+    }
+    else if (key == Param::compression)
+    {
+        trx_params_.compression_ = gu::Compression::type(value);
+    }
+    else if (key == Param::compression_level)
+    {
+        trx_params_.compression_level_ = gu::from_string<int>(value);
+    }
     else
     {
         log_warn << "parameter '" << key << "' not found";
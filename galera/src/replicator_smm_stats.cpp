@@ -1,4 +1,4 @@
-/* Copyright (C) 2010-2020 Codership Oy <info@codersip.com> */
+/* Copyright (C) 2010-2024 Codership Oy <info@codersip.com> */
 
 #include "replicator_smm.hpp"
 
@@ -89,6 +89,9 @@ typedef enum status_vars
     STATS_LOCAL_RECV_QUEUE_MIN,
     STATS_LOCAL_RECV_QUEUE_AVG,
     STATS_LOCAL_CACHED_DOWNTO,
+    STATS_LOCAL_CACHED_RECLAIM_BYTES,
+    STATS_LOCAL_CACHED_RECLAIM_PAGES,
+    STATS_LOCAL_CACHED_RECLAIM_LAG_NS,
     STATS_FC_PAUSED_NS,
     STATS_FC_PAUSED_AVG,
     STATS_FC_SSENT,
@@ -101,14 +104,27 @@ typedef enum status_vars
     STATS_APPLY_OOOL,
     STATS_APPLY_WINDOW,
     STATS_APPLY_WAITS,
+    STATS_APPLY_SPINS,
     STATS_COMMIT_OOOE,
     STATS_COMMIT_OOOL,
     STATS_COMMIT_WINDOW,
+    STATS_COMMIT_WAITS,
+    STATS_COMMIT_SPINS,
+    STATS_MONITOR_WINDOW_BLOCKED_NS,
     STATS_LOCAL_STATE,
     STATS_LOCAL_STATE_COMMENT,
     STATS_CERT_INDEX_SIZE,
     STATS_CAUSAL_READS,
     STATS_CERT_INTERVAL,
+    STATS_CERT_PURGE_LAG,
+    STATS_CERT_PURGE_TIME_NS,
+    STATS_CHECKSUM_QUEUE_AVG,
+    STATS_CHECKSUM_QUEUE_MAX,
+    STATS_CHECKSUM_LATENCY_NS,
+    STATS_REPL_COMPRESS_RATIO,
+    STATS_REPL_COMPRESS_TIME_NS,
+    STATS_RECV_COMPRESS_RATIO,
+    STATS_RECV_DECOMPRESS_TIME_NS,
     STATS_OPEN_TRX,
     STATS_OPEN_CONN,
     STATS_INCOMING_LIST,
@@ -140,6 +156,9 @@ static const struct wsrep_stats_var wsrep_stats[STATS_MAX + 1] =
     { "local_recv_queue_min",     WSREP_VAR_INT64,  { 0 }  },
     { "local_recv_queue_avg",     WSREP_VAR_DOUBLE, { 0 }  },
     { "local_cached_downto",      WSREP_VAR_INT64,  { 0 }  },
+    { "local_cached_reclaim_bytes", WSREP_VAR_INT64, { 0 }  },
+    { "local_cached_reclaim_pages", WSREP_VAR_INT64, { 0 }  },
+    { "local_cached_reclaim_lag_ns", WSREP_VAR_INT64, { 0 } },
     { "flow_control_paused_ns",   WSREP_VAR_INT64,  { 0 }  },
     { "flow_control_paused",      WSREP_VAR_DOUBLE, { 0 }  },
     { "flow_control_sent",        WSREP_VAR_INT64,  { 0 }  },
@@ -152,14 +171,27 @@ static const struct wsrep_stats_var wsrep_stats[STATS_MAX + 1] =
     { "apply_oool",               WSREP_VAR_DOUBLE, { 0 }  },
     { "apply_window",             WSREP_VAR_DOUBLE, { 0 }  },
     { "apply_waits",              WSREP_VAR_INT64,  { 0 }  },
+    { "apply_spins",              WSREP_VAR_INT64,  { 0 }  },
     { "commit_oooe",              WSREP_VAR_DOUBLE, { 0 }  },
     { "commit_oool",              WSREP_VAR_DOUBLE, { 0 }  },
     { "commit_window",            WSREP_VAR_DOUBLE, { 0 }  },
+    { "commit_waits",             WSREP_VAR_INT64,  { 0 }  },
+    { "commit_spins",             WSREP_VAR_INT64,  { 0 }  },
+    { "monitor_window_blocked_ns", WSREP_VAR_INT64, { 0 }  },
     { "local_state",              WSREP_VAR_INT64,  { 0 }  },
     { "local_state_comment",      WSREP_VAR_STRING, { 0 }  },
     { "cert_index_size",          WSREP_VAR_INT64,  { 0 }  },
     { "causal_reads",             WSREP_VAR_INT64,  { 0 }  },
     { "cert_interval",            WSREP_VAR_DOUBLE, { 0 }  },
+    { "cert_purge_lag",           WSREP_VAR_INT64,  { 0 }  },
+    { "cert_purge_time_ns",       WSREP_VAR_INT64,  { 0 }  },
+    { "checksum_queue_avg",       WSREP_VAR_DOUBLE, { 0 }  },
+    { "checksum_queue_max",       WSREP_VAR_INT64,  { 0 }  },
+    { "checksum_latency_ns",      WSREP_VAR_INT64,  { 0 }  },
+    { "repl_data_compress_ratio", WSREP_VAR_DOUBLE, { 0 }  },
+    { "repl_data_compress_time_ns", WSREP_VAR_INT64, { 0 } },
+    { "received_data_compress_ratio", WSREP_VAR_DOUBLE, { 0 } },
+    { "received_data_decompress_time_ns", WSREP_VAR_INT64, { 0 } },
     { "open_transactions",        WSREP_VAR_INT64,  { 0 }  },
     { "open_connections",         WSREP_VAR_INT64,  { 0 }  },
     { "incoming_addresses",       WSREP_VAR_STRING, { 0 }  },
@@ -216,6 +248,13 @@ galera::ReplicatorSMM::stats_get() const
     sv[STATS_LOCAL_RECV_QUEUE_MIN].value._int64  = stats.recv_q_len_min;
     sv[STATS_LOCAL_RECV_QUEUE_AVG].value._double = stats.recv_q_len_avg;
     sv[STATS_LOCAL_CACHED_DOWNTO ].value._int64  = gcache_.seqno_min();
+    {
+        long long bytes, pages, lag;
+        gcache_.reclaim_stats(bytes, pages, lag);
+        sv[STATS_LOCAL_CACHED_RECLAIM_BYTES ].value._int64 = bytes;
+        sv[STATS_LOCAL_CACHED_RECLAIM_PAGES ].value._int64 = pages;
+        sv[STATS_LOCAL_CACHED_RECLAIM_LAG_NS].value._int64 = lag;
+    }
     sv[STATS_FC_PAUSED_NS        ].value._int64  = stats.fc_paused_ns;
     sv[STATS_FC_PAUSED_AVG       ].value._double = stats.fc_paused_avg;
     sv[STATS_FC_SSENT            ].value._int64  = stats.fc_ssent;
@@ -235,6 +274,34 @@ galera::ReplicatorSMM::stats_get() const
     sv[STATS_CERT_INTERVAL       ].value._double = avg_cert_interval;
     sv[STATS_CERT_INDEX_SIZE     ].value._int64  = index_size;
 
+    long long purge_lag(0);
+    long long purge_time(0);
+    cert_.purge_stats_get(purge_lag, purge_time);
+
+    sv[STATS_CERT_PURGE_LAG      ].value._int64  = purge_lag;
+    sv[STATS_CERT_PURGE_TIME_NS  ].value._int64  = purge_time;
+
+    double    check_queue_avg;
+    long long check_queue_max;
+    long long check_latency;
+    check_pool_->stats_get(check_queue_avg, check_queue_max, check_latency);
+
+    sv[STATS_CHECKSUM_QUEUE_AVG  ].value._double = check_queue_avg;
+    sv[STATS_CHECKSUM_QUEUE_MAX  ].value._int64  = check_queue_max;
+    sv[STATS_CHECKSUM_LATENCY_NS ].value._int64  = check_latency;
+
+    double    repl_ratio;
+    long long repl_time;
+    double    recv_ratio;
+    long long recv_time;
+    DataSet::compression_stats_get(repl_ratio, repl_time,
+                                   recv_ratio, recv_time);
+
+    sv[STATS_REPL_COMPRESS_RATIO    ].value._double = repl_ratio;
+    sv[STATS_REPL_COMPRESS_TIME_NS  ].value._int64  = repl_time;
+    sv[STATS_RECV_COMPRESS_RATIO    ].value._double = recv_ratio;
+    sv[STATS_RECV_DECOMPRESS_TIME_NS].value._int64  = recv_time;
+
     double oooe;
     double oool;
     double win;
@@ -245,12 +312,33 @@ galera::ReplicatorSMM::stats_get() const
     sv[STATS_APPLY_OOOL          ].value._double = oool;
     sv[STATS_APPLY_WINDOW        ].value._double = win;
     sv[STATS_APPLY_WAITS         ].value._int64 = waits;
+
+    long long spins;
+    apply_monitor_.get_spin_stats(&spins, &waits);
+
+    sv[STATS_APPLY_SPINS         ].value._int64 = spins;
     commit_monitor_.get_stats(&oooe, &oool, &win, &waits);
 
     sv[STATS_COMMIT_OOOE         ].value._double = oooe;
     sv[STATS_COMMIT_OOOL         ].value._double = oool;
     sv[STATS_COMMIT_WINDOW       ].value._double = win;
 
+    commit_monitor_.get_spin_stats(&spins, &waits);
+
+    sv[STATS_COMMIT_WAITS        ].value._int64 = waits;
+    sv[STATS_COMMIT_SPINS        ].value._int64 = spins;
+
+    ssize_t   window;
+    long long blocked, blocked_total(0);
+    local_monitor_.get_window_stats(&window, &blocked);
+    blocked_total += blocked;
+    apply_monitor_.get_window_stats(&window, &blocked);
+    blocked_total += blocked;
+    commit_monitor_.get_window_stats(&window, &blocked);
+    blocked_total += blocked;
+
+    sv[STATS_MONITOR_WINDOW_BLOCKED_NS].value._int64 = blocked_total;
+
     if (st_.corrupt())
     {
         sv[STATS_LOCAL_STATE        ].value._int64  = WSREP_MEMBER_ERROR;
@@ -372,6 +460,10 @@ galera::ReplicatorSMM::stats_reset()
     commit_monitor_.flush_stats();
 
     cert_.stats_reset();
+
+    check_pool_->stats_reset();
+
+    DataSet::compression_stats_reset();
 }
 
 void
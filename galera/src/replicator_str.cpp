@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2010-2020 Codership Oy <info@codership.com>
+// Copyright (C) 2010-2024 Codership Oy <info@codership.com>
 //
 
 #include "replicator_smm.hpp"
@@ -32,6 +32,7 @@ static int get_str_proto_ver(int const group_proto_ver)
         return 2;
     case 10:
     case 11:
+    case 12:
         // 4.x
         // CC events in IST, certification index preload
         return 3;
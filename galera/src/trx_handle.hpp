@@ -8,6 +8,7 @@
 
 #include "fsm.hpp"
 #include "key_data.hpp" // for append_key()
+#include "key_deps.hpp"
 #include "key_entry_os.hpp"
 #include "write_set_ng.hpp"
 
@@ -593,6 +594,16 @@ namespace galera
             depends_seqno_ = seqno_lt;
         }
 
+        void set_key_deps(const KeyDeps& deps) { key_deps_ = deps; }
+
+        // @return key level dependencies if they were collected during
+        //         certification and are consistent with depends_seqno,
+        //         null otherwise
+        const KeyDeps* key_deps() const
+        {
+            return (key_deps_.complete(depends_seqno_) ? &key_deps_ : 0);
+        }
+
         void set_global_seqno(wsrep_seqno_t s) // for monitor cancellation
         {
             global_seqno_ = s;
@@ -711,6 +722,7 @@ namespace galera
             last_seen_seqno_   (WSREP_SEQNO_UNDEFINED),
             depends_seqno_     (WSREP_SEQNO_UNDEFINED),
             ends_nbo_          (WSREP_SEQNO_UNDEFINED),
+            key_deps_          (),
             mem_pool_          (mp),
             write_set_         (),
             buf_               (buf),
@@ -740,6 +752,7 @@ namespace galera
         wsrep_seqno_t          last_seen_seqno_;
         wsrep_seqno_t          depends_seqno_;
         wsrep_seqno_t          ends_nbo_;
+        KeyDeps                key_deps_;
         gu::MemPool<true>&     mem_pool_;
         WriteSetIn             write_set_;
         void* const            buf_;
@@ -810,23 +823,34 @@ namespace galera
             KeySet::Version        key_format_;
             gu::RecordSet::Version record_set_ver_;
             int                    max_write_set_size_;
+            DataSet::Version       data_set_ver_;
+            gu::Compression::Type  compression_;
+            int                    compression_level_;
 
             Params (const std::string& wdir,
                     int                ver,
                     KeySet::Version    kformat,
                     gu::RecordSet::Version rsv = gu::RecordSet::VER2,
-                    int                max_write_set_size = WriteSetNG::MAX_SIZE)
+                    int                max_write_set_size = WriteSetNG::MAX_SIZE,
+                    DataSet::Version   dver = DataSet::VER1,
+                    gu::Compression::Type ctype = gu::Compression::NONE,
+                    int                clevel = 0)
                 :
                 working_dir_       (wdir),
                 version_           (ver),
                 key_format_        (kformat),
                 record_set_ver_    (rsv),
-                max_write_set_size_(max_write_set_size)
+                max_write_set_size_(max_write_set_size),
+                data_set_ver_      (dver),
+                compression_       (ctype),
+                compression_level_ (clevel)
             {}
 
             Params () :
                 working_dir_(), version_(), key_format_(),
-                record_set_ver_(), max_write_set_size_()
+                record_set_ver_(), max_write_set_size_(),
+                data_set_ver_(DataSet::VER1),
+                compression_(gu::Compression::NONE), compression_level_()
             {}
         };
 
@@ -1055,6 +1079,12 @@ namespace galera
             assert(params_.version_ >= 0 &&
                    params_.version_ <= WriteSetNG::MAX_VERSION);
 
+            /* compressed data sets are used only if negotiated and wanted */
+            bool const compress(params_.data_set_ver_ >= DataSet::VER2 &&
+                                params_.compression_ != gu::Compression::NONE);
+            DataSet::Version const dver(compress ? DataSet::VER2 :
+                                        DataSet::VER1);
+
             new (wso) WriteSetOut (params_.working_dir_,
                                    trx_id(), params_.key_format_,
                                    store,
@@ -1062,9 +1092,12 @@ namespace galera
                                    0,
                                    params_.record_set_ver_,
                                    WriteSetNG::Version(params_.version_),
-                                   DataSet::MAX_VERSION,
-                                   DataSet::MAX_VERSION,
-                                   params_.max_write_set_size_);
+                                   dver,
+                                   dver,
+                                   params_.max_write_set_size_,
+                                   compress ? params_.compression_ :
+                                   gu::Compression::NONE,
+                                   params_.compression_level_);
 
             wso_ = true;
         }
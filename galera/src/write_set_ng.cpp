@@ -202,7 +202,7 @@ const char WriteSetOut::annt_suffix[] = "_annt";
 void
 WriteSetIn::init (ssize_t const st)
 {
-    assert(false == check_thr_);
+    assert(false == check_async_);
 
     const gu::byte_t* const pptr (header_.payload());
     ssize_t           const psize(size_ - header_.size());
@@ -213,44 +213,87 @@ WriteSetIn::init (ssize_t const st)
 
     if (kver != KeySet::EMPTY) gu_trace(keys_.init (kver, pptr, psize));
 
-    assert (false == check_);
-    assert (false == check_thr_);
+    assert (false == check_keys_);
+    assert (false == check_data_);
+    assert (false == check_async_);
 
     if (gu_likely(st > 0)) /* checksum enforced */
     {
         if (size_ >= st)
         {
-            /* buffer too big, start checksumming in background */
-            int const err(gu_thread_create (
-                              gu::get_thread_key(
-                                  gu::GU_THREAD_KEY_WRITE_SET_CHECK),
-                              &check_thr_id_,
-                              checksum_thread, this));
-
-            if (gu_likely(0 == err))
-            {
-                check_thr_ = true;
-                return;
-            }
+            /* buffer too big, checksum in background, the result will be
+             * checked in verify_checksum() */
+            check_async_ = true;
 
-            log_warn << "Starting checksum thread failed: " << err
-                     << '(' << ::strerror(err) << ')';
+            if (checksum_submit()) return;
 
-            /* fall through to checksum in foreground */
+            /* no checksum pool or it is full, checksum in foreground */
         }
 
         checksum();
-        gu_trace(checksum_fin());
+        if (!check_async_) gu_trace(checksum_fin());
     }
     else /* checksum skipped, pretend it's alright */
     {
-        check_ = true;
+        check_keys_ = true;
+        check_data_ = true;
     }
 }
 
 
-void
-WriteSetIn::checksum()
+bool
+WriteSetIn::checksum_submit()
+{
+    std::shared_ptr<ChecksumPool> const pool(ChecksumPool::instance());
+
+    if (!pool) return false;
+
+    /* key and data sets are checksummed separately, so can be in parallel */
+    ChecksumPool::Job jobs[2];
+    size_t n(0);
+
+    if (keys_.size() > 0)
+    {
+        jobs[n++] = [this]() { check_keys_ = checksum_keys(); };
+    }
+    else
+    {
+        check_keys_ = true;
+    }
+
+    jobs[n++] = [this]() { check_data_ = checksum_data(); };
+
+    if (!pool->submit(check_ticket_, jobs, n)) return false;
+
+    check_pool_ = pool;
+
+    return true;
+}
+
+
+bool
+WriteSetIn::checksum_keys()
+{
+    try
+    {
+        if (keys_.size() > 0) gu_trace(keys_.checksum());
+        return true;
+    }
+    catch (std::exception& e)
+    {
+        log_error << e.what();
+    }
+    catch (...)
+    {
+        log_error << "Non-standard exception in WriteSet::checksum()";
+    }
+
+    return false;
+}
+
+
+bool
+WriteSetIn::checksum_data()
 {
     const gu::byte_t* pptr (header_.payload());
     ssize_t           psize(size_ - header_.size());
@@ -261,7 +304,6 @@ WriteSetIn::checksum()
     {
         if (keys_.size() > 0)
         {
-            gu_trace(keys_.checksum());
             size_t const tmpsize(keys_.serial_size());
             psize -= tmpsize;
             pptr  += tmpsize;
@@ -306,7 +348,7 @@ WriteSetIn::checksum()
         assert (psize >= 0);
         assert (size_t(psize) < gcache::MemOps::ALIGNMENT);
 #endif
-        check_ = true;
+        return true;
     }
     catch (std::exception& e)
     {
@@ -316,6 +358,8 @@ WriteSetIn::checksum()
     {
         log_error << "Non-standard exception in WriteSet::checksum()";
     }
+
+    return false;
 }
 
 
@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2013-2017 Codership Oy <info@codership.com>
+// Copyright (C) 2013-2024 Codership Oy <info@codership.com>
 //
 
 /*
@@ -17,6 +17,7 @@
 #include "wsrep_api.h"
 #include "key_set.hpp"
 #include "data_set.hpp"
+#include "checksum_pool.hpp"
 
 #include "gu_serialize.hpp"
 #include "gu_vector.hpp"
@@ -506,9 +507,11 @@ namespace galera
                      uint16_t                flags    = 0,
                      gu::RecordSet::Version  rsv      = gu::RecordSet::VER2,
                      WriteSetNG::Version     ver      = WriteSetNG::MAX_VERSION,
-                     DataSet::Version        dver     = DataSet::MAX_VERSION,
-                     DataSet::Version        uver     = DataSet::MAX_VERSION,
-                     size_t                  max_size = WriteSetNG::MAX_SIZE)
+                     DataSet::Version        dver     = DataSet::VER1,
+                     DataSet::Version        uver     = DataSet::VER1,
+                     size_t                  max_size = WriteSetNG::MAX_SIZE,
+                     gu::Compression::Type   ctype    = gu::Compression::NONE,
+                     int                     clevel   = 0)
             :
             header_(ver),
             base_name_(dir_name, id),
@@ -519,10 +522,12 @@ namespace galera
                     kbn_, kver, rsv, ver),
             /* 5/8 of reserved goes to data set  */
             dbn_   (base_name_),
-            data_  (reserved + reserved_size, reserved_size*5, dbn_, dver, rsv),
+            data_  (reserved + reserved_size, reserved_size*5, dbn_, dver, rsv,
+                    ctype, clevel),
             /* 2/8 of reserved goes to unordered set  */
             ubn_   (base_name_),
-            unrd_  (reserved + reserved_size*6, reserved_size*2, ubn_, uver,rsv),
+            unrd_  (reserved + reserved_size*6, reserved_size*2, ubn_, uver,rsv,
+                    ctype, clevel),
             /* annotation set is not allocated unless requested */
             abn_   (base_name_),
             annt_  (NULL),
@@ -554,7 +559,9 @@ namespace galera
         {
             if (NULL == annt_)
             {
-                annt_ = new DataSetOut(NULL, 0, abn_, DataSet::MAX_VERSION,
+                /* header has a single version field for all data sets,
+                 * annotations are never worth compressing though */
+                annt_ = new DataSetOut(NULL, 0, abn_, data_.max_version(),
                                        // use the same version as the dataset
                                        data_.gu::RecordSet::version());
                 left_ -= annt_->size();
@@ -717,9 +724,11 @@ namespace galera
               data_  (),
               unrd_  (),
               annt_  (NULL),
-              check_thr_id_(),
-              check_thr_(false),
-              check_ (false)
+              check_pool_  (),
+              check_ticket_(),
+              check_async_ (false),
+              check_keys_  (false),
+              check_data_  (false)
         {
             gu_trace(init(st));
         }
@@ -731,15 +740,18 @@ namespace galera
               data_  (),
               unrd_  (),
               annt_  (NULL),
-              check_thr_id_(),
-              check_thr_(false),
-              check_ (false)
+              check_pool_  (),
+              check_ticket_(),
+              check_async_ (false),
+              check_keys_  (false),
+              check_data_  (false)
         {}
 
         void read_header (const gu::Buf& buf)
         {
             assert (0 == size_);
-            assert (false == check_);
+            assert (false == check_keys_);
+            assert (false == check_data_);
 
             header_.read_buf (buf);
             size_ = buf.size;
@@ -748,7 +760,7 @@ namespace galera
         /*
          * WriteSetIn(buf) == WriteSetIn() + read_buf(buf)
          *
-         * @param st threshold at which launch dedicated thread for checksumming
+         * @param st threshold at which checksumming is done in background
          *           0 - no checksumming
          */
         void read_buf (const gu::Buf& buf, ssize_t const st = SIZE_THRESHOLD)
@@ -768,11 +780,8 @@ namespace galera
 
         ~WriteSetIn ()
         {
-            if (gu_unlikely(check_thr_))
-            {
-                /* checksum was performed in a parallel thread */
-                gu_thread_join (check_thr_id_, NULL);
-            }
+            /* checksum jobs may still be referencing this object */
+            checksum_wait();
 
             delete annt_;
         }
@@ -811,11 +820,11 @@ namespace galera
          * and before it is finalized. */
         void verify_checksum() const /* throws */
         {
-            if (gu_unlikely(check_thr_))
+            if (gu_unlikely(check_async_))
             {
-                /* checksum was performed in a parallel thread */
-                gu_thread_join (check_thr_id_, NULL);
-                check_thr_ = false;
+                /* checksum was performed in background */
+                checksum_wait();
+                check_async_ = false;
                 gu_trace(checksum_fin());
             }
         }
@@ -854,27 +863,43 @@ namespace galera
         DataSetIn          data_;
         DataSetIn          unrd_;
         DataSetIn*         annt_;
-        gu_thread_t        check_thr_id_;
-        bool mutable       check_thr_;
-        bool               check_;
+        /* set while checksum jobs are queued in the pool */
+        std::shared_ptr<ChecksumPool> mutable check_pool_;
+        ChecksumPool::Ticket mutable check_ticket_;
+        bool mutable       check_async_;
+        bool               check_keys_;
+        bool               check_data_;
 
         static size_t const SIZE_THRESHOLD = 1 << 22; /* 4Mb */
 
-        void checksum (); /* checksums writeset, stores result in check_ */
+        /* checksums writeset, stores results in check_keys_ and check_data_*/
+        void checksum ()
+        {
+            check_keys_ = checksum_keys();
+            check_data_ = checksum_data();
+        }
+
+        bool checksum_keys ();
+        bool checksum_data (); /* also initializes data, unrd and annt sets */
 
-        void checksum_fin() const
+        /* @return true if checksum jobs were queued in the pool */
+        bool checksum_submit ();
+
+        void checksum_wait () const
         {
-            if (gu_unlikely(!check_))
+            if (check_pool_)
             {
-                gu_throw_error(EINVAL) << "Writeset checksum failed";
+                check_pool_->wait(check_ticket_);
+                check_pool_.reset();
             }
         }
 
-        static void* checksum_thread (void* arg)
+        void checksum_fin() const
         {
-            WriteSetIn* ws(reinterpret_cast<WriteSetIn*>(arg));
-            ws->checksum();
-            return NULL;
+            if (gu_unlikely(!(check_keys_ && check_data_)))
+            {
+                gu_throw_error(EINVAL) << "Writeset checksum failed";
+            }
         }
 
         /* late initialization after default constructor */
@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to measure parallel applying with and without key level
+ * dependencies (cert.key_deps). A synthetic workload is certified and then
+ * replayed through ReplicatorSMM::apply_trx() by a pool of applier threads.
+ * Dummy applier callback sleeps for 0 to 2*apply_us to emulate applying and
+ * then commits via commit_order_enter_remote()/commit_order_leave(), both
+ * with default (NO_OOOC) and out of order (OOOC) repl.commit_order.
+ *
+ * Each write set updates KEYS rows. A row is picked from hot_rows hot rows
+ * with hot_pct probability and from a big table otherwise, so that most
+ * write sets depend on some recent write set while being unrelated to
+ * those in between.
+ *
+ * Usage: apply_replay_bench [total [threads [apply_us [hot_pct [hot_rows]]]]]
+ */
+
+#include "../src/replicator_smm.hpp"
+#include "../src/certification.hpp"
+#include "../src/saved_state.hpp"
+
+#include <gu_threads.h>
+
+#include <sys/time.h>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+using galera::TrxHandle;
+using galera::TrxHandleSlave;
+using galera::TrxHandleSlavePtr;
+
+static int      const VERSION (5);
+static int      const KEYS    (2);
+static uint64_t const ROWS    (1 << 20);
+
+static wsrep_uuid_t const SOURCE = { { 1, } };
+static wsrep_uuid_t const STATE  = { { 2, } };
+
+// repl.commit_order values
+static int const OOOC   (1);
+static int const NO_OOOC(3);
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+static void log_cb(wsrep_log_level_t const level, const char* const msg)
+{
+    if (level <= WSREP_LOG_WARN) std::cerr << msg << '\n';
+}
+
+struct Applier
+{
+    galera::ReplicatorSMM*          repl;
+    std::vector<TrxHandleSlavePtr>* trxs;
+    std::atomic<size_t>*            next;
+    long                            apply_us;
+};
+
+extern "C" wsrep_cb_status_t
+apply_cb(void* const ctx, const wsrep_ws_handle_t* const wh, uint32_t,
+         const wsrep_buf_t*, const wsrep_trx_meta_t*, wsrep_bool_t*)
+{
+    Applier* const a(static_cast<Applier*>(ctx));
+    TrxHandleSlave* const ts(static_cast<TrxHandleSlave*>(wh->opaque));
+
+    // pseudo random applying time, the same for the same seqno in all runs
+    uint64_t const r((uint64_t(ts->global_seqno()) * 2654435761ULL) >> 8);
+    if (a->apply_us > 0) usleep(a->apply_us * (r % 2001) / 1000);
+
+    a->repl->commit_order_enter_remote(*ts);
+    a->repl->commit_order_leave(*ts, NULL);
+
+    return WSREP_CB_SUCCESS;
+}
+
+extern "C" void* applier_thread(void* arg)
+{
+    Applier* const a(static_cast<Applier*>(arg));
+
+    for (size_t i(a->next->fetch_add(1)); i < a->trxs->size();
+         i = a->next->fetch_add(1))
+    {
+        a->repl->apply_trx(a, *(*a->trxs)[i]);
+    }
+
+    return NULL;
+}
+
+/* Write sets certified by a standalone Certification object,
+ * buffers are allocated in a dedicated GCache. */
+class Workload
+{
+public:
+
+    Workload(const std::string& dir, const std::vector<uint64_t>& rows,
+             bool const key_deps)
+        : conf_      ()
+        , init_      (conf_, NULL, dir.c_str())
+        , pcb_       (WSREP_MEMBER_UNDEFINED, WSREP_MEMBER_UNDEFINED)
+        , gcache_    (init_gcache(conf_, dir, &pcb_))
+        , cert_      (new galera::Certification(conf_, *gcache_, 0))
+        , mp_        (sizeof(galera::TrxHandleMaster)
+                      + sizeof(galera::WriteSetOut), 16, "bench_mp")
+        , sp_        (sizeof(TrxHandleSlave), 1024, "bench_sp")
+        , trxs_      ()
+        , deps_dist_ (0)
+    {
+        conf_.set(galera::Certification::PARAM_KEY_DEPS,
+                  key_deps ? "yes" : "no");
+        cert_->param_set(galera::Certification::PARAM_KEY_DEPS,
+                         key_deps ? "yes" : "no");
+
+        cert_->assign_initial_position(gu::GTID(gu::UUID(), 0), VERSION);
+
+        galera::TrxHandleMaster::Params const trx_params(
+            "", VERSION, galera::KeySet::MAX_VERSION);
+
+        unsigned int seed(1);
+        size_t const total(rows.size() / KEYS);
+
+        for (size_t i(0); i < total; ++i)
+        {
+            wsrep_seqno_t const seqno(i + 1);
+
+            galera::TrxHandleMasterPtr trx(
+                galera::TrxHandleMaster::New(mp_, trx_params, SOURCE, 1,
+                                             seqno),
+                galera::TrxHandleMasterDeleter());
+            trx->set_flags(TrxHandle::F_BEGIN | TrxHandle::F_COMMIT);
+
+            for (int k(0); k < KEYS; ++k)
+            {
+                wsrep_buf_t const key[2] =
+                    { { "t", 1 }, { &rows[i * KEYS + k], sizeof(uint64_t) } };
+                trx->append_key(galera::KeyData(VERSION, key, 2,
+                                                WSREP_KEY_EXCLUSIVE, true));
+            }
+            trx->append_data(&rows[i * KEYS], KEYS * sizeof(uint64_t),
+                             WSREP_DATA_ORDERED, true);
+
+            galera::WriteSetNG::GatherVector out;
+            size_t const size(trx->write_set_out().gather(trx->source_id(),
+                                                          trx->conn_id(),
+                                                          trx->trx_id(),
+                                                          out));
+            // certification interval of up to 16 write sets
+            wsrep_seqno_t const last_seen(
+                std::max<wsrep_seqno_t>(0, seqno - 1 - rand_r(&seed) % 16));
+            trx->finalize(last_seen);
+
+            void* ptx;
+            void* const buf(gcache_->malloc(size, ptx));
+            if (out.serialize(ptx, size) != size) abort();
+            gcache_->drop_plaintext(buf);
+
+            // local seqno -1 like in IST, so that replicator's certification
+            // object does not track it
+            gcs_action const act = { seqno, WSREP_SEQNO_UNDEFINED, buf,
+                                     static_cast<int32_t>(size),
+                                     GCS_ACT_WRITESET };
+            TrxHandleSlavePtr ts(TrxHandleSlave::New(false, sp_),
+                                 galera::TrxHandleSlaveDeleter());
+            if (ts->unserialize<true>(*gcache_, act) != size) abort();
+
+            ts->set_state(TrxHandle::S_CERTIFYING);
+            if (cert_->append_trx(ts) != galera::Certification::TEST_OK)
+                abort();
+
+            gcache_->seqno_assign(buf, seqno, GCS_ACT_WRITESET, false);
+
+            deps_dist_ += seqno - ts->depends_seqno();
+            trxs_.push_back(ts);
+        }
+    }
+
+    ~Workload()
+    {
+        wsrep_seqno_t const last(trxs_.size());
+        trxs_.clear();
+        delete cert_;
+        gcache_->seqno_release(last);
+        delete gcache_;
+    }
+
+    std::vector<TrxHandleSlavePtr>& trxs() { return trxs_; }
+
+    double deps_dist() const { return double(deps_dist_) / trxs_.size(); }
+
+private:
+
+    static gcache::GCache* init_gcache(gu::Config& conf,
+                                       const std::string& dir,
+                                       galera::ProgressCallback<int64_t>* pcb)
+    {
+        conf.set("gcache.name", "bench.cache");
+        conf.set("gcache.size", "64M");
+        return new gcache::GCache(pcb, conf, dir, NULL, NULL);
+    }
+
+    gu::Config                          conf_;
+    galera::ReplicatorSMM::InitConfig   init_;
+    galera::ProgressCallback<int64_t>   pcb_;
+    gcache::GCache*                     gcache_;
+    galera::Certification*              cert_;
+    galera::TrxHandleMaster::Pool       mp_;
+    TrxHandleSlave::Pool                sp_;
+    std::vector<TrxHandleSlavePtr>      trxs_;
+    long long                           deps_dist_;
+
+    Workload(const Workload&);
+    void operator=(const Workload&);
+};
+
+static double stat(const struct wsrep_stats_var* const stats,
+                   const char* const name)
+{
+    for (const struct wsrep_stats_var* s(stats); s->name; ++s)
+    {
+        if (0 == strcmp(s->name, name) && WSREP_VAR_DOUBLE == s->type)
+            return s->value._double;
+    }
+    abort();
+}
+
+static void run(const std::string& dir, const std::vector<uint64_t>& rows,
+                int const threads, long const apply_us,
+                int const commit_order,
+                bool const key_deps)
+{
+    Workload wl(dir, rows, key_deps);
+
+    {
+        // replicator monitors start from seqno 0 of this history
+        galera::SavedState st(dir + "/grastate.dat");
+        st.set(STATE, 0, true);
+    }
+
+    wsrep_init_args args;
+    memset(&args, 0, sizeof(args));
+    args.data_dir  = dir.c_str();
+    std::string const options(
+        "gcache.size=1M; gcache.page_size=1M; repl.commit_order=" +
+        gu::to_string(commit_order));
+    args.options   = options.c_str();
+    args.proto_ver = 1;
+    args.logger_cb = log_cb;
+    args.apply_cb  = apply_cb;
+
+    galera::ReplicatorSMM repl(&args);
+
+    std::atomic<size_t>      next(0);
+    std::vector<Applier>     appliers(threads);
+    std::vector<gu_thread_t> thds(threads);
+    struct timeval tv_begin, tv_end;
+
+    gettimeofday(&tv_begin, NULL);
+    for (int i(0); i < threads; ++i)
+    {
+        Applier const a = { &repl, &wl.trxs(), &next, apply_us };
+        appliers[i] = a;
+        if (gu_thread_create(NULL, &thds[i], applier_thread, &appliers[i]))
+            abort();
+    }
+    for (int i(0); i < threads; ++i) gu_thread_join(thds[i], NULL);
+    gettimeofday(&tv_end, NULL);
+
+    const struct wsrep_stats_var* const stats(repl.stats_get());
+
+    std::cout << std::setw(10)
+              << (commit_order == OOOC ? "OOOC" : "NO_OOOC")
+              << std::setw(10) << (key_deps ? "key" : "seqno")
+              << std::setw(12) << wl.deps_dist()
+              << std::setw(12) << rows.size() / KEYS /
+                                  time_diff(tv_end, tv_begin)
+              << std::setw(12) << stat(stats, "apply_oooe")
+              << std::setw(12) << stat(stats, "apply_window")
+              << std::setw(12) << stat(stats, "commit_window")
+              << '\n';
+
+    repl.stats_free(const_cast<struct wsrep_stats_var*>(stats));
+}
+
+int main(int argc, char* argv[])
+{
+    long const total   (argc > 1 ? atol(argv[1]) : 10000);
+    int  const threads (argc > 2 ? atoi(argv[2]) : 16);
+    long const apply_us(argc > 3 ? atol(argv[3]) : 200);
+    int  const hot_pct (argc > 4 ? atoi(argv[4]) : 20);
+    long const hot_rows(argc > 5 ? atol(argv[5]) : 16);
+
+    if (total <= 0 || threads <= 0 || apply_us < 0 ||
+        hot_pct < 0 || hot_pct > 100 || hot_rows <= 0)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [total [threads [apply_us [hot_pct [hot_rows]]]]]\n";
+        return 1;
+    }
+
+    char dir[] = "/tmp/apply_replay_bench.XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        std::cerr << "Failed to create " << dir << ": " << strerror(errno)
+                  << '\n';
+        return 1;
+    }
+
+    std::vector<uint64_t> rows(total * KEYS);
+    unsigned int seed(hot_pct);
+    for (size_t i(0); i < rows.size(); ++i)
+    {
+        bool const hot(rand_r(&seed) % 100 < hot_pct);
+        uint64_t const r((uint64_t(rand_r(&seed)) << 16) ^ rand_r(&seed));
+        rows[i] = (hot ? r % hot_rows : hot_rows + r % ROWS);
+    }
+
+    std::cout << std::setprecision(4)
+              << "trxs: " << total << ", threads: " << threads
+              << ", apply_us: " << apply_us << ", hot: " << hot_pct
+              << "% of " << hot_rows << " rows\n"
+              << std::setw(10) << "commit"
+              << std::setw(10) << "deps"
+              << std::setw(12) << "deps_dist"
+              << std::setw(12) << "trxs/s"
+              << std::setw(12) << "apply_oooe"
+              << std::setw(12) << "apply_win"
+              << std::setw(12) << "commit_win" << '\n';
+
+    run(dir, rows, threads, apply_us, NO_OOOC, false);
+    run(dir, rows, threads, apply_us, NO_OOOC, true);
+    run(dir, rows, threads, apply_us, OOOC,    false);
+    run(dir, rows, threads, apply_us, OOOC,    true);
+
+    const char* const files[] = { "grastate.dat", "galera.cache",
+                                  "bench.cache" };
+    for (size_t i(0); i < sizeof(files)/sizeof(files[0]); ++i)
+    {
+        ::unlink((std::string(dir) + '/' + files[i]).c_str());
+    }
+    ::rmdir(dir);
+
+    return 0;
+}
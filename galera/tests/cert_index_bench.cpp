@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to benchmark insert/probe/erase operations of CertIndexNG
+ * and comparing those to node based gu::UnorderedSet<KeyEntryNG*> which
+ * was used as a certification index before.
+ *
+ * Usage: cert_index_bench [max_power [min_power]]
+ */
+
+#include "../src/cert_index_ng.hpp"
+
+#include <gu_unordered.hpp>
+
+#include <sys/time.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <stdint.h>
+
+using galera::KeySet;
+using galera::KeyEntryNG;
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+typedef gu::UnorderedSet<KeyEntryNG*,
+                         galera::KeyEntryPtrHashNG,
+                         galera::KeyEntryPtrEqualNG> NodeIndex;
+
+/* Adapter for the old index to present the same interface as CertIndexNG */
+class NodeIndexAdapter
+{
+public:
+    NodeIndexAdapter() : index_() {}
+    ~NodeIndexAdapter()
+    {
+        for (NodeIndex::iterator i(index_.begin()); i != index_.end(); ++i)
+            delete *i;
+    }
+
+    bool find(const KeySet::KeyPart& key) const
+    {
+        KeyEntryNG ke(key);
+        return index_.find(&ke) != index_.end();
+    }
+
+    void insert(const KeySet::KeyPart& key)
+    {
+        KeyEntryNG ke(key);
+        if (index_.find(&ke) == index_.end())
+            index_.insert(new KeyEntryNG(ke));
+    }
+
+    void erase(const KeySet::KeyPart& key)
+    {
+        KeyEntryNG ke(key);
+        NodeIndex::iterator const i(index_.find(&ke));
+        KeyEntryNG* const kep(*i);
+        index_.erase(i);
+        delete kep;
+    }
+
+    size_t size() const { return index_.size(); }
+
+private:
+    NodeIndex index_;
+};
+
+class FlatIndexAdapter
+{
+public:
+    FlatIndexAdapter() : index_() {}
+
+    bool find(const KeySet::KeyPart& key) const
+    {
+        return index_.find(key) != index_.end();
+    }
+
+    void insert(const KeySet::KeyPart& key) { index_.insert(key); }
+    void erase (const KeySet::KeyPart& key) { index_.erase(index_.find(key)); }
+    size_t size() const { return index_.size(); }
+
+private:
+    galera::CertIndexNG index_;
+};
+
+/* Serialized FLAT16 key parts */
+class KeyParts
+{
+public:
+    KeyParts(size_t const n, unsigned int seed) : buf_(n * 2)
+    {
+        for (size_t i(0); i < buf_.size(); ++i)
+        {
+            buf_[i] = (uint64_t(rand_r(&seed)) << 32) ^ rand_r(&seed);
+            if (0 == i % 2)
+            {
+                gu::byte_t* const b(reinterpret_cast<gu::byte_t*>(&buf_[i]));
+                b[0] = (b[0] & ~0x1f) | (KeySet::FLAT16 << 2);
+            }
+        }
+    }
+
+    size_t size() const { return buf_.size() / 2; }
+
+    KeySet::KeyPart operator[](size_t const i) const
+    {
+        return KeySet::KeyPart(
+            reinterpret_cast<const gu::byte_t*>(&buf_[i * 2]), 16);
+    }
+
+private:
+    std::vector<uint64_t> buf_;
+};
+
+struct Result
+{
+    double insert; // ops/s
+    double hit;    // probes/s
+    double miss;   // probes/s
+    double erase;  // ops/s
+};
+
+template <typename Index>
+static Result run(const KeyParts& keys, const KeyParts& other, int const loops)
+{
+    Result res;
+    struct timeval tv_begin, tv_end;
+    size_t const n(keys.size());
+    size_t found(0);
+
+    Index index;
+
+    gettimeofday(&tv_begin, NULL);
+    for (size_t i(0); i < n; ++i) index.insert(keys[i]);
+    gettimeofday(&tv_end, NULL);
+    res.insert = n / time_diff(tv_end, tv_begin);
+
+    if (index.size() != n) abort();
+
+    gettimeofday(&tv_begin, NULL);
+    for (int l(0); l < loops; ++l)
+        for (size_t i(0); i < n; ++i) found += index.find(keys[i]);
+    gettimeofday(&tv_end, NULL);
+    res.hit = n * loops / time_diff(tv_end, tv_begin);
+
+    gettimeofday(&tv_begin, NULL);
+    for (int l(0); l < loops; ++l)
+        for (size_t i(0); i < n; ++i) found += index.find(other[i]);
+    gettimeofday(&tv_end, NULL);
+    res.miss = n * loops / time_diff(tv_end, tv_begin);
+
+    if (found != n * loops) abort();
+
+    gettimeofday(&tv_begin, NULL);
+    for (size_t i(0); i < n; ++i) index.erase(keys[i]);
+    gettimeofday(&tv_end, NULL);
+    res.erase = n / time_diff(tv_end, tv_begin);
+
+    if (index.size() != 0) abort();
+
+    return res;
+}
+
+static void print(const char* const name, const Result& r)
+{
+    std::cout << std::setw(14) << name
+              << std::setw(14) << r.insert
+              << std::setw(14) << r.hit
+              << std::setw(14) << r.miss
+              << std::setw(14) << r.erase << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    int const max_power(argc > 1 ? atoi(argv[1]) : 22);
+    int const min_power(argc > 2 ? atoi(argv[2]) : 10);
+
+    std::cout << std::setprecision(4);
+
+    for (int power(min_power); power <= max_power; power += 2)
+    {
+        size_t const n(size_t(1) << power);
+        int    const loops(std::max(1, (1 << 24) >> power));
+        KeyParts const keys(n, power);
+        KeyParts const other(n, power + 1000);
+
+        std::cout << "keys: " << n << '\n'
+                  << std::setw(14) << "index"
+                  << std::setw(14) << "insert/s"
+                  << std::setw(14) << "hit probes/s"
+                  << std::setw(14) << "miss probes/s"
+                  << std::setw(14) << "erase/s" << '\n';
+
+        print("UnorderedSet", run<NodeIndexAdapter>(keys, other, loops));
+        print("CertIndexNG",  run<FlatIndexAdapter>(keys, other, loops));
+    }
+
+    return 0;
+}
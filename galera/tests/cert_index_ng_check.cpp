@@ -0,0 +1,154 @@
+//
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+//
+
+#include "../src/cert_index_ng.hpp"
+
+#include <check.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace galera;
+
+namespace
+{
+    // Serialized FLAT16 key parts generated from a seed.
+    class KeyParts
+    {
+    public:
+        KeyParts(size_t const n, unsigned int seed) : buf_(n * 2)
+        {
+            for (size_t i(0); i < buf_.size(); i += 2)
+            {
+                buf_[i]     = (uint64_t(rand_r(&seed)) << 32) ^ rand_r(&seed);
+                buf_[i + 1] = (uint64_t(rand_r(&seed)) << 32) ^ rand_r(&seed);
+                set_header(i);
+            }
+        }
+
+        size_t size() const { return buf_.size() / 2; }
+
+        KeySet::KeyPart operator[](size_t const i) const
+        {
+            return KeySet::KeyPart(
+                reinterpret_cast<const gu::byte_t*>(&buf_[i * 2]), 16);
+        }
+
+        // make key i share the first word (and so the hash) with key j
+        void alias_hash(size_t const i, size_t const j)
+        {
+            buf_[i * 2] = buf_[j * 2];
+        }
+
+    private:
+        void set_header(size_t const i)
+        {
+            gu::byte_t* const b(reinterpret_cast<gu::byte_t*>(&buf_[i]));
+            b[0] = (b[0] & ~0x1f) | (KeySet::FLAT16 << 2);
+        }
+
+        std::vector<uint64_t> buf_;
+    };
+}
+
+START_TEST(cert_index_ng_insert_find_erase)
+{
+    size_t const n(1 << 16);
+    KeyParts const keys(n, 1);
+    KeyParts const other(n, 2);
+
+    CertIndexNG index;
+    ck_assert(index.empty());
+    ck_assert(index.find(keys[0]) == index.end());
+
+    for (size_t i(0); i < n; ++i)
+    {
+        std::pair<CertIndexNG::iterator, bool> const r(index.insert(keys[i]));
+        ck_assert(r.second);
+        ck_assert((*r.first)->key().matches(keys[i]));
+    }
+    ck_assert_int_eq(index.size(), n);
+    ck_assert(index.capacity() * 7 / 8 >= n);
+
+    for (size_t i(0); i < n; ++i)
+    {
+        CertIndexNG::iterator const it(index.find(keys[i]));
+        ck_assert_msg(it != index.end(), "key %zu not found", i);
+        ck_assert(index.insert(keys[i]).second == false);
+        ck_assert(index.find(other[i]) == index.end());
+    }
+    ck_assert_int_eq(index.size(), n);
+
+    for (size_t i(0); i < n; i += 2) index.erase(index.find(keys[i]));
+    ck_assert_int_eq(index.size(), n / 2);
+
+    for (size_t i(0); i < n; ++i)
+    {
+        ck_assert_msg((index.find(keys[i]) == index.end()) == (i % 2 == 0),
+                      "wrong find() result for key %zu", i);
+    }
+
+    size_t const cap(index.capacity());
+    for (size_t i(1); i < n; i += 2) index.erase(index.find(keys[i]));
+    ck_assert(index.empty());
+    ck_assert(index.capacity() < cap);
+
+    // tombstones must not break probing after reinsertion
+    for (size_t i(0); i < n; ++i) ck_assert(index.insert(keys[i]).second);
+    ck_assert_int_eq(index.size(), n);
+    for (size_t i(0); i < n; ++i) ck_assert(index.find(keys[i]) != index.end());
+
+    size_t count(0);
+    index.for_each([&count](const KeyEntryNG*) { ++count; });
+    ck_assert_int_eq(count, n);
+
+    index.clear();
+    ck_assert(index.empty());
+    ck_assert_int_eq(index.capacity(), 0);
+}
+END_TEST
+
+START_TEST(cert_index_ng_hash_collision)
+{
+    size_t const n(1024);
+    KeyParts keys(n, 3);
+
+    // all keys share the same hash but differ in the second word
+    for (size_t i(1); i < n; ++i) keys.alias_hash(i, 0);
+
+    CertIndexNG index;
+    for (size_t i(0); i < n; ++i) ck_assert(index.insert(keys[i]).second);
+    ck_assert_int_eq(index.size(), n);
+
+    for (size_t i(0); i < n; ++i)
+    {
+        CertIndexNG::iterator const it(index.find(keys[i]));
+        ck_assert(it != index.end());
+        ck_assert((*it)->key().ptr() == keys[i].ptr());
+    }
+
+    for (size_t i(0); i < n; ++i)
+    {
+        index.erase(index.find(keys[i]));
+        for (size_t j(i + 1); j < n; j += 97)
+        {
+            ck_assert(index.find(keys[j]) != index.end());
+        }
+    }
+    ck_assert(index.empty());
+}
+END_TEST
+
+Suite* cert_index_ng_suite()
+{
+    TCase* t = tcase_create ("cert_index_ng");
+    tcase_add_test (t, cert_index_ng_insert_find_erase);
+    tcase_add_test (t, cert_index_ng_hash_collision);
+    tcase_set_timeout(t, 60);
+
+    Suite* s = suite_create ("CertIndexNG");
+    suite_add_tcase (s, t);
+
+    return s;
+}
@@ -14,6 +14,8 @@
 
 #include <check.h>
 
+#include <memory>
+
 namespace
 {
     struct WSInfo
@@ -49,6 +51,7 @@ void run_wsinfo(const WSInfo* const wsi, size_t const nws, int const version,
 
     {   // At least with GCC 5.4.0-6ubuntu1~16.04.10 another scope is needed
         // to guarantee cert object destruction before env destruction.
+        env.conf().set(galera::Certification::PARAM_KEY_DEPS, "yes");
         galera::Certification cert(env.conf(), env.gcache(), 0);
 
         cert.assign_initial_position(gu::GTID(), version);
@@ -133,6 +136,11 @@ void run_wsinfo(const WSInfo* const wsi, size_t const nws, int const version,
                           ", version: %d",
                           i, ts->global_seqno(), ts->depends_seqno(),
                           wsi[i].expected_depends_seqno, version);
+            // key level dependencies must account for depends_seqno
+            ck_assert_msg(result != galera::Certification::TEST_OK ||
+                          ts->key_deps(),
+                          "wsi: %zu g: %" PRId64 " no key deps, version: %d",
+                          i, ts->global_seqno(), version);
             cert.set_trx_committed(*ts);
             mark_point();
 
@@ -1535,6 +1543,274 @@ START_TEST(cert_certify_no_match)
 }
 END_TEST
 
+namespace
+{
+    class CertRunner
+    {
+    public:
+        CertRunner(const std::string& name, int const shards,
+                   bool const auto_purge = true)
+            : env_(name, false),
+              mp_(sizeof(galera::TrxHandleMaster) + sizeof(galera::WriteSetOut),
+                  16, "certification_mp"),
+              sp_(sizeof(galera::TrxHandleSlave), 16, "certification_sp"),
+              cert_(),
+              last_seqno_(0),
+              auto_purge_(auto_purge)
+        {
+            env_.conf().set("cert.shards", gu::to_string(shards));
+            cert_.reset(new galera::Certification(env_.conf(), env_.gcache(),
+                                                  0));
+            cert_->assign_initial_position(gu::GTID(), version_);
+        }
+
+        ~CertRunner()
+        {
+            cert_.reset();
+            if (last_seqno_ > 0) env_.gcache().seqno_release(last_seqno_);
+        }
+
+        struct Key
+        {
+            std::string      table;
+            std::string      row;
+            wsrep_key_type_t type;
+        };
+
+        galera::TrxHandleSlavePtr
+        append(const wsrep_uuid_t& node, wsrep_seqno_t const seqno,
+               wsrep_seqno_t const last_seen, int const flags,
+               const std::vector<Key>& keys)
+        {
+            galera::TrxHandleMasterPtr txm(galera::TrxHandleMaster::New(
+                                               mp_,
+                                               galera::TrxHandleMaster::Params(
+                                                   "", version_,
+                                                   galera::KeySet::MAX_VERSION),
+                                               node, 1, seqno),
+                                           galera::TrxHandleMasterDeleter());
+            txm->set_flags(flags);
+            for (size_t i(0); i < keys.size(); ++i)
+            {
+                TestKey tkey(version_, keys[i].type, true,
+                             keys[i].table.c_str(), keys[i].row.c_str());
+                txm->append_key(tkey());
+            }
+
+            galera::WriteSetNG::GatherVector out;
+            size_t const size(txm->write_set_out().gather(
+                                  txm->source_id(), txm->conn_id(),
+                                  txm->trx_id(), out));
+            txm->finalize(last_seen);
+
+            void* ptx;
+            void* const buf(env_.gcache().malloc(size, ptx));
+            ck_assert(out.serialize(ptx, size) == size);
+            env_.gcache().drop_plaintext(buf);
+
+            gcs_action act = { seqno, seqno, buf, static_cast<int32_t>(size),
+                               GCS_ACT_WRITESET };
+            galera::TrxHandleSlavePtr ts(galera::TrxHandleSlave::New(false,
+                                                                     sp_),
+                                         galera::TrxHandleSlaveDeleter());
+            ck_assert(ts->unserialize<true>(env_.gcache(), act) == size);
+
+            result_ = cert_->append_trx(ts);
+
+            wsrep_seqno_t const purge(cert_->set_trx_committed(*ts));
+            env_.gcache().seqno_assign(buf, seqno, GCS_ACT_WRITESET, false);
+            last_seqno_ = seqno;
+            if (auto_purge_ && purge >= 0) cert_->purge_trxs_upto(purge, false);
+
+            return ts;
+        }
+
+        void purge(wsrep_seqno_t const seqno)
+        {
+            cert_->purge_trxs_upto(seqno, false);
+        }
+
+        long long purge_lag() const
+        {
+            long long lag, time;
+            cert_->purge_stats_get(lag, time);
+            return lag;
+        }
+
+        CertResult result() const { return result_; }
+
+        size_t index_size() const
+        {
+            double avg_cert_interval, avg_deps_dist;
+            size_t index_size;
+            cert_->stats_get(avg_cert_interval, avg_deps_dist, index_size);
+            return index_size;
+        }
+
+    private:
+        static int const version_ = galera::WriteSetNG::MAX_VERSION;
+
+        TestEnv                               env_;
+        galera::TrxHandleMaster::Pool         mp_;
+        galera::TrxHandleSlave::Pool          sp_;
+        std::unique_ptr<galera::Certification> cert_;
+        wsrep_seqno_t                         last_seqno_;
+        bool const                            auto_purge_;
+        CertResult                            result_;
+    };
+}
+
+/*
+ * Sharded certification must produce exactly the same results as serial.
+ */
+
+START_TEST(cert_certify_sharded_deterministic)
+{
+    CertRunner serial ("cert_shards_1", 1);
+    CertRunner sharded("cert_shards_4", 4);
+
+    wsrep_uuid_t const nodes[3] = { {{1, }}, {{2, }}, {{3, }} };
+    unsigned int  seed(42);
+    wsrep_seqno_t last_seen(0);
+    size_t        failed(0);
+
+    for (wsrep_seqno_t seqno(1); seqno <= 300; ++seqno)
+    {
+        bool const writer(rand_r(&seed) % 2);
+        size_t const n_keys(rand_r(&seed) % 8 ? 256 + rand_r(&seed) % 256
+                                              : 1 + rand_r(&seed) % 16);
+        std::vector<CertRunner::Key> keys(n_keys);
+        for (size_t i(0); i < n_keys; ++i)
+        {
+            keys[i].table = gu::to_string(rand_r(&seed) % 4);
+            keys[i].row   = gu::to_string(rand_r(&seed) % (1 << 15));
+            keys[i].type  = writer ?
+                (rand_r(&seed) % 2 ? WSREP_KEY_UPDATE : WSREP_KEY_EXCLUSIVE) :
+                (rand_r(&seed) % 2 ? WSREP_KEY_SHARED : WSREP_KEY_REFERENCE);
+        }
+
+        wsrep_uuid_t const& node(nodes[rand_r(&seed) % 3]);
+        // last seen seqno must not go backwards for index purge to work
+        last_seen = std::max<wsrep_seqno_t>(last_seen,
+                                            seqno - 1 - rand_r(&seed) % 8);
+        int const flags(galera::TrxHandle::F_BEGIN |
+                        galera::TrxHandle::F_COMMIT |
+                        (rand_r(&seed) % 16 ? 0 :
+                         galera::TrxHandle::F_PA_UNSAFE));
+
+        galera::TrxHandleSlavePtr const ts1(
+            serial.append(node, seqno, last_seen, flags, keys));
+        galera::TrxHandleSlavePtr const ts2(
+            sharded.append(node, seqno, last_seen, flags, keys));
+
+        ck_assert_msg(serial.result() == sharded.result(),
+                      "g: %" PRId64 " serial res: %d sharded res: %d",
+                      seqno, serial.result(), sharded.result());
+        ck_assert_msg(ts1->depends_seqno() == ts2->depends_seqno(),
+                      "g: %" PRId64 " serial ld: %" PRId64
+                      " sharded ld: %" PRId64,
+                      seqno, ts1->depends_seqno(), ts2->depends_seqno());
+        ck_assert_int_eq(serial.index_size(), sharded.index_size());
+
+        failed += (serial.result() == CertResult::TEST_FAILED);
+    }
+
+    // make sure both outcomes were exercised
+    ck_assert(failed > 0);
+    ck_assert(failed < 300);
+}
+END_TEST
+
+/*
+ * Index purge must proceed in bounded steps.
+ */
+START_TEST(cert_purge_incremental)
+{
+    CertRunner runner("cert_purge", 1, false);
+
+    wsrep_uuid_t const node = {{1, }};
+    size_t const       n_keys(3000);
+    wsrep_seqno_t const n_trx(8);
+
+    for (wsrep_seqno_t seqno(1); seqno <= n_trx; ++seqno)
+    {
+        std::vector<CertRunner::Key> keys(n_keys);
+        for (size_t i(0); i < n_keys; ++i)
+        {
+            keys[i].table = "t";
+            keys[i].row   = gu::to_string(seqno * n_keys + i);
+            keys[i].type  = WSREP_KEY_EXCLUSIVE;
+        }
+        runner.append(node, seqno, seqno - 1,
+                      galera::TrxHandle::F_BEGIN | galera::TrxHandle::F_COMMIT,
+                      keys);
+        ck_assert(runner.result() == CertResult::TEST_OK);
+    }
+
+    size_t const index_size(runner.index_size());
+    ck_assert(index_size > n_trx * n_keys);
+
+    runner.purge(n_trx);
+    ck_assert(runner.purge_lag() > 0);
+    ck_assert(runner.index_size() < index_size);
+    ck_assert_msg(index_size - runner.index_size() <= 1024,
+                  "purged %zu keys in one step",
+                  index_size - runner.index_size());
+
+    int steps(1);
+    while (runner.purge_lag() > 0)
+    {
+        runner.purge(n_trx);
+        ++steps;
+        ck_assert(steps < 1000);
+    }
+    ck_assert(steps > 1);
+
+    // last trx is not safe to discard yet
+    ck_assert(runner.index_size() > n_keys);
+    ck_assert(runner.index_size() < 2 * n_keys);
+}
+END_TEST
+
+/*
+ * Purge on commit must keep up with a stream of trxs larger than
+ * the purge step bound.
+ */
+START_TEST(cert_purge_huge_trxs)
+{
+    CertRunner runner("cert_purge_huge", 1, false);
+
+    wsrep_uuid_t const node = {{1, }};
+    size_t const       n_keys(20000);
+    wsrep_seqno_t const n_trx(40);
+    long long          max_lag(0);
+
+    for (wsrep_seqno_t seqno(1); seqno <= n_trx; ++seqno)
+    {
+        std::vector<CertRunner::Key> keys(n_keys);
+        for (size_t i(0); i < n_keys; ++i)
+        {
+            keys[i].table = "t";
+            keys[i].row   = gu::to_string(seqno * n_keys + i);
+            keys[i].type  = WSREP_KEY_EXCLUSIVE;
+        }
+        runner.append(node, seqno, seqno - 1,
+                      galera::TrxHandle::F_BEGIN | galera::TrxHandle::F_COMMIT,
+                      keys);
+        ck_assert(runner.result() == CertResult::TEST_OK);
+
+        if (seqno > 1)
+        {
+            runner.purge(seqno - 1);
+            max_lag = std::max(max_lag, runner.purge_lag());
+        }
+    }
+
+    // without raising the bound the lag would grow past n_trx / 2
+    ck_assert_msg(max_lag < 16, "purge lag %lld", max_lag);
+}
+END_TEST
+
 
 Suite* certification_suite()
 {
@@ -1627,5 +1903,16 @@ Suite* certification_suite()
 
     suite_add_tcase(s, t);
 
+    t = tcase_create("certification_shards");
+    tcase_add_test(t, cert_certify_sharded_deterministic);
+    tcase_set_timeout(t, 120);
+    suite_add_tcase(s, t);
+
+    t = tcase_create("certification_purge");
+    tcase_add_test(t, cert_purge_incremental);
+    tcase_add_test(t, cert_purge_huge_trxs);
+    tcase_set_timeout(t, 120);
+    suite_add_tcase(s, t);
+
     return s;
 }
@@ -1,4 +1,4 @@
-/* Copyright (C) 2013-2023 Codership Oy <info@codership.com>
+/* Copyright (C) 2013-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -12,6 +12,8 @@
 
 #include <check.h>
 
+#include <sstream>
+
 using namespace galera;
 
 class TestBaseName : public gu::Allocator::BaseName
@@ -256,6 +258,104 @@ START_TEST (ver2)
 }
 END_TEST
 
+static void test_packed(gu::Compression::Type const ctype)
+{
+    /* repetitive records so that compression has something to chew on */
+    std::vector<TestRecord*> records;
+    for (int i(0); i < 64; ++i)
+    {
+        std::ostringstream os;
+        os << "row " << i << ": the quick brown fox jumps over the lazy dog";
+        records.push_back(new TestRecord(256 + i, os.str().c_str()));
+    }
+
+    union { gu::byte_t buf[1024]; gu_word_t align; } reserved;
+    TestBaseName str("data_set_packed_test");
+    DataSetOut dset_out(reserved.buf, sizeof(reserved.buf), str, DataSet::VER2,
+                        gu::RecordSet::VER2, ctype, 0);
+
+    size_t plain_size(0);
+    for (size_t i(0); i < records.size(); ++i)
+    {
+        plain_size += records[i]->serial_size();
+        dset_out.append(records[i]->buf(), records[i]->serial_size(),
+                        i % 2);
+    }
+
+    ck_assert(1 == dset_out.count());
+    ck_assert(DataSet::VER2 == dset_out.version());
+
+    DataSetOut::GatherVector out_bufs;
+    size_t const out_size(dset_out.gather(out_bufs));
+    ck_assert(0 == out_size % gu::RecordSet::VER2_ALIGNMENT);
+
+    if (gu::Compression::NONE != ctype)
+    {
+        ck_assert_msg(out_size < plain_size / 2,
+                      "%s: out size %zu, plain size %zu",
+                      gu::Compression::name(ctype), out_size, plain_size);
+    }
+    else
+    {
+        ck_assert(out_size > plain_size);
+    }
+
+    std::vector<gu::byte_t> in_buf;
+    in_buf.reserve(out_size);
+    for (size_t i(0); i < out_bufs->size(); ++i)
+    {
+        const gu::byte_t* ptr
+            (reinterpret_cast<const gu::byte_t*>(out_bufs[i].ptr));
+        in_buf.insert (in_buf.end(), ptr, ptr + out_bufs[i].size);
+    }
+    ck_assert(in_buf.size() == out_size);
+
+    galera::DataSetIn dset_in;
+    dset_in.init(DataSet::VER2, in_buf.data(), in_buf.size());
+
+    ck_assert(size_t(dset_in.serial_size()) == out_size);
+    try { dset_in.checksum(); }
+    catch(gu::Exception& e) { ck_abort_msg("%s", e.what()); }
+
+    ck_assert(1 == dset_in.count());
+    gu::Buf const data(dset_in.next());
+    ck_assert_msg(size_t(data.size) == plain_size,
+                  "expected %zu bytes, got %zd", plain_size, data.size);
+
+    /* records are concatenated in a single data set record */
+    const gu::byte_t* ptr(static_cast<const gu::byte_t*>(data.ptr));
+    for (size_t i(0); i < records.size(); ++i)
+    {
+        TestRecord const rin(ptr, data.size);
+        ck_assert_msg(rin == *records[i],
+                      "Record %zu failed: expected %s, found %s",
+                      i, records[i]->c_str(), rin.c_str());
+        ptr += rin.serial_size();
+    }
+
+    /* corrupted payload must be caught by the envelope checksum */
+    in_buf[in_buf.size() / 2] ^= 0xff;
+    galera::DataSetIn dset_bad(DataSet::VER2, in_buf.data(), in_buf.size());
+    try
+    {
+        dset_bad.checksum();
+        ck_abort_msg("corrupted data set passed checksum");
+    }
+    catch (gu::Exception& e) {}
+
+    for (size_t i(0); i < records.size(); ++i) delete records[i];
+}
+
+START_TEST (packed)
+{
+    for (int t(gu::Compression::NONE); t <= gu::Compression::MAX_TYPE; ++t)
+    {
+        gu::Compression::Type const ctype(static_cast<gu::Compression::Type>(t));
+        if (gu::Compression::supported(ctype)) test_packed(ctype);
+    }
+}
+END_TEST
+
 Suite* data_set_suite ()
 {
     TCase* t = tcase_create ("DataSet");
@@ -263,6 +363,7 @@ Suite* data_set_suite ()
     tcase_add_test (t, ver1);
 #endif
     tcase_add_test (t, ver2);
+    tcase_add_test (t, packed);
     tcase_set_timeout(t, 60);
 
     Suite* s = suite_create ("DataSet");
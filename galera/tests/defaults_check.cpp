@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2018-2023 Codership Oy <info@codership.com>
+// Copyright (C) 2018-2024 Codership Oy <info@codership.com>
 //
 
 #include <wsrep_api.h>
@@ -30,12 +30,15 @@ static const char* Defaults[] =
 {
     "base_dir",                    ".",
     "base_port",                   "4567",
+    "cert.key_deps",               "no",
     "cert.log_conflicts",          "no",
     "cert.optimistic_pa",          "yes",
+    "cert.shards",                 "1",
     "debug",                       "no",
 #ifdef GU_DBUG_ON
     "dbug",                        "",
 #endif
+    "evs.adaptive_window",         "false",
     "evs.auto_evict",              "0",
     "evs.causal_keepalive_period", "PT1S",
     "evs.debug_log_mask",          "0x1",
@@ -59,14 +62,21 @@ static const char* Defaults[] =
     "gcache.debug",                "0",
 #endif
     "gcache.dir",                  ".",
+    "gcache.huge_pages",           "no",
     "gcache.keep_pages_size",      "0",
     "gcache.keep_plaintext_size",  "128M", /* defaults to gcache.page_size */
     "gcache.mem_size",             "0",
     "gcache.name",                 "galera.cache",
+    "gcache.numa_node",            "-1",
     "gcache.page_size",            "128M",
+    "gcache.populate",             "no",
     "gcache.recover",              "yes",
+    "gcache.recover_threads",      "4",
     "gcache.size",                 "128M",
     "gcomm.thread_prio",           "",
+    "gcs.batch_bytes",             "32768",
+    "gcs.batch_latency",           "100",
+    "gcs.batch_size",              "1",
     "gcs.fc_debug",                "0",
     "gcs.fc_factor",               "1.0",
     "gcs.fc_limit",                "16",
@@ -83,6 +93,7 @@ static const char* Defaults[] =
     "gcs.sync_donor",              "no",
     "gmcast.listen_addr",          "tcp://0.0.0.0:4567",
     "gmcast.mcast_addr",           "",
+    "gmcast.mcast_mtu",            "1500",
     "gmcast.mcast_ttl",            "1",
     "gmcast.peer_timeout",         "PT3S",
     "gmcast.segment",              "0",
@@ -103,9 +114,17 @@ static const char* Defaults[] =
     "protonet.version",            "0",
     "repl.causal_read_timeout",    "PT30S",
     "repl.commit_order",           "3",
+    "repl.compression",            "none",
+    "repl.compression_level",      "0",
     "repl.key_format",             "FLAT8",
+    "repl.max_monitor_window",     "65536",
     "repl.max_ws_size",            "2147483647",
+    "repl.monitor_spin_ns",        "0",
+#if defined(GALERA_HAVE_LZ4) && defined(GALERA_HAVE_ZSTD)
+    "repl.proto_max",              "12",
+#else
     "repl.proto_max",              "11",
+#endif
 #ifdef GU_DBUG_ON
     "signal",                      "",
 #endif
@@ -16,6 +16,8 @@ extern Suite* data_set_suite();
 extern Suite* key_set_suite();
 extern Suite* write_set_ng_suite();
 extern Suite* certification_suite();
+extern Suite* cert_index_ng_suite();
+extern Suite* monitor_suite();
 //extern Suite* write_set_suite();
 extern Suite* trx_handle_suite();
 extern Suite* service_thd_suite();
@@ -30,6 +32,8 @@ static suite_creator_t suites[] =
     key_set_suite,
     write_set_ng_suite,
     certification_suite,
+    cert_index_ng_suite,
+    monitor_suite,
     trx_handle_suite,
     service_thd_suite,
     ist_suite,
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to benchmark Monitor enter()/leave() throughput with 1 to 64
+ * threads. Seqnos are distributed over threads round robin, ordered objects
+ * enter strictly in seqno order (like local and commit monitors), unordered
+ * ones as soon as they get a slot (like apply monitor without dependencies).
+ *
+ * Usage: monitor_bench [total [max_threads [spin_ns]]]
+ */
+
+#include "../src/monitor.hpp"
+
+#include <gu_threads.h>
+
+#include <sys/time.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+class BenchOrder
+{
+public:
+    BenchOrder(wsrep_seqno_t const seqno, bool const ordered, gu::Cond* cond)
+        : seqno_(seqno), ordered_(ordered), cond_(cond)
+    { }
+
+    BenchOrder() : seqno_(WSREP_SEQNO_UNDEFINED), ordered_(), cond_() { }
+
+    wsrep_seqno_t seqno() const { return seqno_; }
+
+    gu::Cond* cond() { return cond_; }
+
+    bool condition(wsrep_seqno_t last_entered,
+                   wsrep_seqno_t last_left) const
+    {
+        return (!ordered_ || last_left + 1 == seqno_);
+    }
+
+#ifdef GU_DBUG_ON
+    void debug_sync(gu::Mutex&) { }
+#endif // GU_DBUG_ON
+
+private:
+    wsrep_seqno_t seqno_;
+    bool          ordered_;
+    gu::Cond*     cond_;
+};
+
+typedef galera::Monitor<BenchOrder> BenchMonitor;
+
+struct ThreadArg
+{
+    BenchMonitor* mon;
+    int           thread;
+    int           threads;
+    long          total;
+    bool          ordered;
+};
+
+extern "C" void* bench_thread(void* arg)
+{
+    ThreadArg* const ta(static_cast<ThreadArg*>(arg));
+    gu::Cond cond(gu::get_cond_key(gu::GU_COND_KEY_LOCAL_MONITOR));
+
+    for (wsrep_seqno_t s(ta->thread + 1); s <= ta->total; s += ta->threads)
+    {
+        BenchOrder o(s, ta->ordered, &cond);
+        ta->mon->enter(o);
+        ta->mon->leave(o);
+    }
+
+    return NULL;
+}
+
+static void run(int const threads, long const total, bool const ordered,
+                long long const spin_ns)
+{
+    BenchMonitor mon(gu::GU_MUTEX_KEY_LOCAL_MONITOR,
+                     gu::GU_COND_KEY_LOCAL_MONITOR);
+    mon.set_initial_position(WSREP_UUID_UNDEFINED, 0);
+    mon.set_spin_ns(spin_ns);
+
+    std::vector<ThreadArg>   args(threads);
+    std::vector<gu_thread_t> thds(threads);
+    struct timeval tv_begin, tv_end;
+
+    gettimeofday(&tv_begin, NULL);
+    for (int i(0); i < threads; ++i)
+    {
+        ThreadArg const ta = { &mon, i, threads, total, ordered };
+        args[i] = ta;
+        if (gu_thread_create(NULL, &thds[i], bench_thread, &args[i])) abort();
+    }
+    for (int i(0); i < threads; ++i) gu_thread_join(thds[i], NULL);
+    gettimeofday(&tv_end, NULL);
+
+    if (mon.last_left() != total) abort();
+
+    double oooe, oool, win;
+    long long waits, spins;
+    mon.get_stats(&oooe, &oool, &win, &waits);
+    mon.get_spin_stats(&spins, &waits);
+
+    std::cout << std::setw(10) << threads
+              << std::setw(12) << (ordered ? "ordered" : "unordered")
+              << std::setw(14) << total / time_diff(tv_end, tv_begin)
+              << std::setw(14) << double(waits) / total
+              << std::setw(14) << double(spins) / total
+              << std::setw(14) << oooe << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    long const total      (argc > 1 ? atol(argv[1]) : 1000000);
+    int  const max_threads(argc > 2 ? atoi(argv[2]) : 64);
+    long long const spin_ns(argc > 3 ? atoll(argv[3]) : 0);
+
+    if (total <= 0 || max_threads <= 0 || spin_ns < 0)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [total [max_threads [spin_ns]]]\n";
+        return 1;
+    }
+
+    std::cout << std::setprecision(4)
+              << std::setw(10) << "threads"
+              << std::setw(12) << "order"
+              << std::setw(14) << "enter+leave/s"
+              << std::setw(14) << "waits/op"
+              << std::setw(14) << "spins/op"
+              << std::setw(14) << "oooe" << '\n';
+
+    for (int threads(1); threads <= max_threads; threads *= 2)
+    {
+        run(threads, total, true,  spin_ns);
+        run(threads, total, false, spin_ns);
+    }
+
+    return 0;
+}
@@ -0,0 +1,513 @@
+//
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+//
+
+#include "../src/monitor.hpp"
+
+#include <gu_threads.h>
+
+#include <check.h>
+
+#include <vector>
+#include <unistd.h> // usleep()
+
+using namespace galera;
+
+namespace
+{
+    // Monitor order object: ordered objects enter strictly in seqno order,
+    // unordered ones may enter as soon as they get a slot.
+    class TestOrder
+    {
+    public:
+        explicit TestOrder(wsrep_seqno_t const seqno = WSREP_SEQNO_UNDEFINED,
+                           bool          const ordered = true)
+            : seqno_(seqno)
+            , ordered_(ordered)
+            , cond_(std::make_shared<gu::Cond>(
+                        gu::get_cond_key(gu::GU_COND_KEY_LOCAL_MONITOR)))
+        { }
+
+        wsrep_seqno_t seqno() const { return seqno_; }
+
+        gu::Cond* cond() { return cond_.get(); }
+
+        bool condition(wsrep_seqno_t last_entered,
+                       wsrep_seqno_t last_left) const
+        {
+            return (!ordered_ || last_left + 1 == seqno_);
+        }
+
+#ifdef GU_DBUG_ON
+        void debug_sync(gu::Mutex&) { }
+#endif // GU_DBUG_ON
+
+    private:
+        wsrep_seqno_t             seqno_;
+        bool                      ordered_;
+        std::shared_ptr<gu::Cond> cond_;
+    };
+
+    typedef Monitor<TestOrder> TestMonitor;
+
+    // Order object with seqno dependency like ApplyOrder and optional key
+    // level dependencies.
+    class KeyOrder
+    {
+    public:
+        KeyOrder(wsrep_seqno_t const seqno, wsrep_seqno_t const depends,
+                 const KeyDeps* const deps)
+            : seqno_(seqno)
+            , depends_(depends)
+            , deps_(deps)
+            , cond_(std::make_shared<gu::Cond>(
+                        gu::get_cond_key(gu::GU_COND_KEY_APPLY_MONITOR)))
+        { }
+
+        KeyOrder() : seqno_(WSREP_SEQNO_UNDEFINED), depends_(), deps_(),
+                     cond_() { }
+
+        wsrep_seqno_t seqno() const { return seqno_; }
+
+        gu::Cond* cond() { return cond_.get(); }
+
+        bool condition(wsrep_seqno_t last_entered,
+                       wsrep_seqno_t last_left) const
+        {
+            return (last_left >= depends_);
+        }
+
+        const KeyDeps* key_deps() const { return deps_; }
+
+#ifdef GU_DBUG_ON
+        void debug_sync(gu::Mutex&) { }
+#endif // GU_DBUG_ON
+
+    private:
+        wsrep_seqno_t             seqno_;
+        wsrep_seqno_t             depends_;
+        const KeyDeps*            deps_;
+        std::shared_ptr<gu::Cond> cond_;
+    };
+
+    typedef Monitor<KeyOrder> KeyMonitor;
+
+    struct KeyEnter
+    {
+        KeyMonitor* mon_;
+        KeyOrder*   obj_;
+    };
+
+    extern "C" void* key_enter_thread(void* arg)
+    {
+        KeyEnter* const ke(static_cast<KeyEnter*>(arg));
+        ke->mon_->enter(*ke->obj_);
+        return NULL;
+    }
+
+    TestMonitor* new_monitor()
+    {
+        TestMonitor* const mon(new TestMonitor(gu::GU_MUTEX_KEY_LOCAL_MONITOR,
+                                               gu::GU_COND_KEY_LOCAL_MONITOR));
+        mon->set_initial_position(WSREP_UUID_UNDEFINED, 0);
+        return mon;
+    }
+
+    struct EnterLeave
+    {
+        TestMonitor*  mon_;
+        wsrep_seqno_t seqno_;
+        wsrep_seqno_t wait_; // wait for this seqno instead of entering
+        bool          unordered_;
+    };
+
+    extern "C" void* enter_leave_thread(void* arg)
+    {
+        EnterLeave* const el(static_cast<EnterLeave*>(arg));
+
+        if (el->wait_ > 0)
+        {
+            el->mon_->wait(el->wait_);
+        }
+        else
+        {
+            TestOrder o(el->seqno_, !el->unordered_);
+            el->mon_->enter(o);
+            el->mon_->leave(o);
+        }
+
+        return NULL;
+    }
+
+    struct InOrder
+    {
+        TestMonitor*   mon_;
+        int            thread_;
+        int            threads_;
+        wsrep_seqno_t  total_;
+        wsrep_seqno_t* last_; // written only inside the monitor
+        bool           ok_;
+    };
+
+    extern "C" void* in_order_thread(void* arg)
+    {
+        InOrder* const io(static_cast<InOrder*>(arg));
+
+        for (wsrep_seqno_t s(io->thread_ + 1); s <= io->total_;
+             s += io->threads_)
+        {
+            TestOrder o(s);
+            io->mon_->enter(o);
+            io->ok_ = io->ok_ && (*io->last_ + 1 == s);
+            *io->last_ = s;
+            io->mon_->leave(o);
+        }
+
+        return NULL;
+    }
+}
+
+START_TEST(monitor_in_order)
+{
+    std::unique_ptr<TestMonitor> mon(new_monitor());
+
+    for (wsrep_seqno_t s(1); s <= 1000; ++s)
+    {
+        TestOrder o(s);
+        ck_assert(!mon->would_block(s));
+        mon->enter(o);
+        ck_assert(mon->entered(o));
+        ck_assert_int_eq(mon->last_entered(), s);
+        ck_assert_int_eq(mon->last_left(), s - 1);
+        mon->leave(o);
+        ck_assert(!mon->entered(o));
+        ck_assert_int_eq(mon->last_left(), s);
+    }
+
+    double oooe, oool, win;
+    long long waits;
+    mon->get_stats(&oooe, &oool, &win, &waits);
+    ck_assert(oooe == 0.0);
+    ck_assert(oool == 0.0);
+    ck_assert_int_eq(waits, 0);
+
+    mon->drain(1000);
+    ck_assert_int_eq(mon->last_left(), 1000);
+}
+END_TEST
+
+START_TEST(monitor_fast_and_locked)
+{
+    std::unique_ptr<TestMonitor> mon(new_monitor());
+
+    // 2 has to wait for 1 which has entered via fast path
+    TestOrder o1(1);
+    mon->enter(o1);
+
+    EnterLeave el2 = { mon.get(), 2, 0, false };
+    gu_thread_t t2;
+    ck_assert(0 == gu_thread_create(NULL, &t2, enter_leave_thread, &el2));
+
+    // wait() for 3 keeps monitor in locked mode until 3 leaves
+    EnterLeave el3 = { mon.get(), 0, 3, false };
+    gu_thread_t t3;
+    ck_assert(0 == gu_thread_create(NULL, &t3, enter_leave_thread, &el3));
+
+    while (mon->last_entered() < 2) usleep(1000);
+
+    mon->leave(o1);
+    gu_thread_join(t2, NULL);
+    ck_assert_int_eq(mon->last_left(), 2);
+
+    TestOrder o3(3);
+    mon->enter(o3);
+    mon->leave(o3);
+    gu_thread_join(t3, NULL);
+    ck_assert_int_eq(mon->last_left(), 3);
+
+    // interrupted seqno must be canceled even after fast path entries
+    TestOrder o6(6);
+    ck_assert(mon->interrupt(o6));
+    ck_assert(mon->canceled(o6));
+
+    for (wsrep_seqno_t s(4); s <= 5; ++s)
+    {
+        TestOrder o(s);
+        mon->enter(o);
+        mon->leave(o);
+    }
+
+    try
+    {
+        mon->enter(o6);
+        ck_abort_msg("canceled seqno entered monitor");
+    }
+    catch (gu::Exception& e)
+    {
+        ck_assert_int_eq(e.get_errno(), EINTR);
+    }
+    mon->self_cancel(o6);
+    ck_assert_int_eq(mon->last_left(), 6);
+
+    // unordered objects entering out of order
+    TestOrder o8(8, false);
+    mon->enter(o8);
+    TestOrder o7(7, false);
+    mon->enter(o7);
+    mon->leave(o8);
+    ck_assert_int_eq(mon->last_left(), 6);
+    mon->leave(o7);
+    ck_assert_int_eq(mon->last_left(), 8);
+
+    TestOrder o9(9);
+    mon->enter(o9);
+    ck_assert(mon->entered(o9));
+    mon->leave(o9);
+    ck_assert_int_eq(mon->last_left(), 9);
+}
+END_TEST
+
+static void in_order_mt(long long const spin_ns)
+{
+    std::unique_ptr<TestMonitor> mon(new_monitor());
+    mon->set_spin_ns(spin_ns);
+
+    int const n_threads(8);
+    wsrep_seqno_t const total(50000);
+    wsrep_seqno_t last(0);
+
+    std::vector<InOrder>     args(n_threads);
+    std::vector<gu_thread_t> threads(n_threads);
+
+    for (int i(0); i < n_threads; ++i)
+    {
+        InOrder const io = { mon.get(), i, n_threads, total, &last, true };
+        args[i] = io;
+        ck_assert(0 == gu_thread_create(NULL, &threads[i], in_order_thread,
+                                        &args[i]));
+    }
+
+    for (int i(0); i < n_threads; ++i)
+    {
+        gu_thread_join(threads[i], NULL);
+        ck_assert_msg(args[i].ok_, "thread %d entered out of order", i);
+    }
+
+    ck_assert_int_eq(last, total);
+    ck_assert_int_eq(mon->last_left(), total);
+    ck_assert_int_eq(mon->last_entered(), total);
+
+    long long spins, parks;
+    mon->get_spin_stats(&spins, &parks);
+    if (0 == spin_ns) ck_assert_int_eq(spins, 0);
+    ck_assert(spins + parks <= total);
+}
+
+START_TEST(monitor_in_order_mt)
+{
+    in_order_mt(0);
+}
+END_TEST
+
+START_TEST(monitor_in_order_mt_spin)
+{
+    in_order_mt(100000);
+}
+END_TEST
+
+START_TEST(monitor_window)
+{
+    std::unique_ptr<TestMonitor> mon(new_monitor());
+
+    ssize_t const max_window(2048);
+    mon->set_max_window(max_window - 1); // rounded up to power of 2
+    ck_assert(mon->size() < max_window);
+
+    // thread in wait() must be woken up after window resize
+    EnterLeave el_wait = { mon.get(), 0, 300, false };
+    gu_thread_t t_wait;
+    ck_assert(0 == gu_thread_create(NULL, &t_wait, enter_leave_thread,
+                                    &el_wait));
+    usleep(10000);
+
+    // window grows to fit unordered objects which have entered
+    wsrep_seqno_t const n(1500);
+    std::vector<std::shared_ptr<TestOrder> > objs;
+    for (wsrep_seqno_t s(1); s <= n; ++s)
+    {
+        objs.push_back(std::make_shared<TestOrder>(s, false));
+        mon->enter(*objs.back());
+    }
+    ck_assert_int_eq(mon->size(), max_window);
+    ck_assert_int_eq(mon->last_entered(), n);
+    ck_assert(mon->entered(*objs[0]));
+    ck_assert(mon->entered(*objs[n - 1]));
+
+    for (wsrep_seqno_t s(n); s >= 1; --s) mon->leave(*objs[s - 1]);
+    gu_thread_join(t_wait, NULL);
+    ck_assert_int_eq(mon->last_left(), n);
+
+    // window can't grow any more, far seqno has to wait for n + 1 to leave
+    TestOrder o(n + 1, false);
+    mon->enter(o);
+
+    wsrep_seqno_t const far(n + max_window);
+    ck_assert(mon->would_block(far));
+    EnterLeave el_far = { mon.get(), far, 0, true };
+    gu_thread_t t_far;
+    ck_assert(0 == gu_thread_create(NULL, &t_far, enter_leave_thread,
+                                    &el_far));
+    usleep(10000);
+    ck_assert_int_eq(mon->last_entered(), n + 1);
+
+    mon->leave(o);
+    gu_thread_join(t_far, NULL);
+    ck_assert_int_eq(mon->last_entered(), far);
+    ck_assert_int_eq(mon->last_left(), n + 1);
+
+    ssize_t   size;
+    long long blocked_ns;
+    mon->get_window_stats(&size, &blocked_ns);
+    ck_assert_int_eq(size, max_window);
+    ck_assert(blocked_ns > 0);
+
+    for (wsrep_seqno_t s(n + 2); s < far; ++s)
+    {
+        TestOrder so(s);
+        mon->self_cancel(so);
+    }
+    ck_assert_int_eq(mon->last_left(), far);
+
+    // idle monitor shrinks immediately
+    mon->set_max_window(64);
+    ck_assert_int_eq(mon->size(), 64);
+
+    TestOrder o_next(far + 1);
+    mon->enter(o_next);
+    mon->leave(o_next);
+    ck_assert_int_eq(mon->last_left(), far + 1);
+}
+END_TEST
+
+START_TEST(monitor_key_deps)
+{
+    KeyMonitor mon(gu::GU_MUTEX_KEY_APPLY_MONITOR,
+                   gu::GU_COND_KEY_APPLY_MONITOR);
+    mon.set_initial_position(WSREP_UUID_UNDEFINED, 0);
+
+    KeyOrder o1(1, 0, 0);
+    KeyOrder o2(2, 0, 0);
+    mon.enter(o1);
+    mon.enter(o2);
+
+    // 3 depends on 2 by seqno, but only on 1 by keys
+    KeyDeps d3;
+    d3.reset(0);
+    d3.add(1);
+    ck_assert(d3.complete(1));
+    ck_assert(!d3.complete(2));
+
+    // 4 depends on 3 by seqno, but only on 2 by keys
+    KeyDeps d4;
+    d4.reset(0);
+    d4.add(2);
+
+    KeyOrder o3(3, 2, &d3);
+    KeyOrder o4(4, 3, &d4);
+    KeyEnter ke3 = { &mon, &o3 };
+    KeyEnter ke4 = { &mon, &o4 };
+    gu_thread_t t3, t4;
+    ck_assert(0 == gu_thread_create(NULL, &t3, key_enter_thread, &ke3));
+    ck_assert(0 == gu_thread_create(NULL, &t4, key_enter_thread, &ke4));
+    usleep(10000);
+    ck_assert(!mon.entered(o3));
+    ck_assert(!mon.entered(o4));
+
+    // out of order leave must wake up 4
+    mon.leave(o2);
+    gu_thread_join(t4, NULL);
+    ck_assert(mon.entered(o4));
+    ck_assert(!mon.entered(o3));
+    ck_assert_int_eq(mon.last_left(), 0);
+
+    mon.leave(o1);
+    gu_thread_join(t3, NULL);
+    ck_assert(mon.entered(o3));
+    ck_assert_int_eq(mon.last_left(), 2);
+
+    mon.leave(o4);
+    mon.leave(o3);
+    ck_assert_int_eq(mon.last_left(), 4);
+
+    // range must have been left entirely
+    KeyOrder o5(5, 0, 0);
+    KeyOrder o6(6, 0, 0);
+    mon.enter(o5);
+    mon.enter(o6);
+    KeyDeps d7;
+    d7.reset(5);
+    d7.add(6);
+    KeyOrder o7(7, 6, &d7);
+    KeyEnter ke7 = { &mon, &o7 };
+    gu_thread_t t7;
+    ck_assert(0 == gu_thread_create(NULL, &t7, key_enter_thread, &ke7));
+    mon.leave(o6);
+    usleep(10000);
+    ck_assert(!mon.entered(o7));
+    mon.leave(o5);
+    gu_thread_join(t7, NULL);
+    mon.leave(o7);
+    ck_assert_int_eq(mon.last_left(), 7);
+}
+END_TEST
+
+START_TEST(key_deps_overflow)
+{
+    KeyDeps d;
+    ck_assert(!d.complete(WSREP_SEQNO_UNDEFINED));
+
+    d.reset(10);
+    d.add(5); // below range
+    ck_assert_int_eq(d.size(), 0);
+
+    for (wsrep_seqno_t s(11); s < 11 + KeyDeps::MAX; ++s) d.add(s);
+    d.add(11); // duplicate
+    ck_assert_int_eq(d.size(), KeyDeps::MAX);
+    ck_assert_int_eq(d.range(), 10);
+
+    // lowest seqno is folded into range
+    d.add(100);
+    ck_assert_int_eq(d.size(), KeyDeps::MAX);
+    ck_assert_int_eq(d.range(), 11);
+    ck_assert(d.complete(100));
+
+    d.add_range(15);
+    ck_assert_int_eq(d.size(), KeyDeps::MAX - 4);
+    for (int i(0); i < d.size(); ++i) ck_assert(d[i] > 15);
+
+    KeyDeps o;
+    o.reset(20);
+    o.add(200);
+    d.merge(o);
+    ck_assert_int_eq(d.range(), 20);
+    ck_assert(d.complete(200));
+}
+END_TEST
+
+Suite* monitor_suite()
+{
+    TCase* t = tcase_create ("monitor");
+    tcase_add_test (t, monitor_in_order);
+    tcase_add_test (t, monitor_fast_and_locked);
+    tcase_add_test (t, monitor_in_order_mt);
+    tcase_add_test (t, monitor_in_order_mt_spin);
+    tcase_add_test (t, monitor_window);
+    tcase_add_test (t, monitor_key_deps);
+    tcase_add_test (t, key_deps_overflow);
+    tcase_set_timeout(t, 60);
+
+    Suite* s = suite_create ("Monitor");
+    suite_add_tcase (s, t);
+
+    return s;
+}
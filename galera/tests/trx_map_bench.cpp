@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to benchmark certification trx map: append of increasing seqnos,
+ * lowest seqno lookup and purge from the front with a sliding window of
+ * certified trxs, comparing CertTrxMap to std::map which was used before.
+ *
+ * Usage: trx_map_bench [window [total [purge_interval]]]
+ */
+
+#include "../src/cert_trx_map.hpp"
+
+#include <sys/time.h>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <cstdlib>
+
+using galera::TrxHandleSlave;
+using galera::TrxHandleSlavePtr;
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+/* Adapter for std::map to present the same interface as CertTrxMap */
+class StdMapAdapter
+{
+public:
+    StdMapAdapter() : map_() {}
+
+    size_t size()  const { return map_.size(); }
+    bool   empty() const { return map_.empty(); }
+    wsrep_seqno_t front_seqno() const { return map_.begin()->first; }
+
+    bool insert(wsrep_seqno_t const seqno, const TrxHandleSlavePtr& ts)
+    {
+        return map_.insert(std::make_pair(seqno, ts)).second;
+    }
+
+    void purge_upto(wsrep_seqno_t const seqno)
+    {
+        map_.erase(map_.begin(), map_.upper_bound(seqno));
+    }
+
+private:
+    std::map<wsrep_seqno_t, TrxHandleSlavePtr> map_;
+};
+
+class DeqMapAdapter
+{
+public:
+    DeqMapAdapter() : map_() {}
+
+    size_t size()  const { return map_.size(); }
+    bool   empty() const { return map_.empty(); }
+    wsrep_seqno_t front_seqno() const { return map_.front_seqno(); }
+
+    bool insert(wsrep_seqno_t const seqno, const TrxHandleSlavePtr& ts)
+    {
+        return map_.insert(seqno, ts);
+    }
+
+    void purge_upto(wsrep_seqno_t const seqno)
+    {
+        while (!map_.empty() && map_.front_seqno() <= seqno) map_.pop_front();
+    }
+
+private:
+    galera::CertTrxMap map_;
+};
+
+/* Appends total seqnos (every 16th is skipped to leave a hole) keeping at
+ * most window trxs in the map, purges every purge_interval seqnos.
+ * @return trxs/s */
+template <typename Map>
+static double run(const TrxHandleSlavePtr& ts,
+                  long const window, long const total,
+                  long const purge_interval)
+{
+    struct timeval tv_begin, tv_end;
+    long long check(0);
+
+    Map map;
+
+    gettimeofday(&tv_begin, NULL);
+    for (wsrep_seqno_t seqno(1); seqno <= total; ++seqno)
+    {
+        if (0 == seqno % 16) continue;
+
+        if (!map.insert(seqno, ts)) abort();
+        check += map.front_seqno();
+
+        if (0 == seqno % purge_interval) map.purge_upto(seqno - window);
+    }
+    map.purge_upto(total);
+    gettimeofday(&tv_end, NULL);
+
+    if (!map.empty() || check <= 0) abort();
+
+    return total / time_diff(tv_end, tv_begin);
+}
+
+int main(int argc, char* argv[])
+{
+    long const window(argc > 1 ? atol(argv[1]) : 100000);
+    long const total (argc > 2 ? atol(argv[2]) : 50 * window);
+    long const purge_interval(argc > 3 ? atol(argv[3]) : 1);
+
+    if (window <= 0 || total <= 0 || purge_interval <= 0)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [window [total [purge_interval]]]\n";
+        return 1;
+    }
+
+    TrxHandleSlave::Pool sp(sizeof(TrxHandleSlave), 16, "trx_map_bench");
+    TrxHandleSlavePtr const ts(TrxHandleSlave::New(false, sp),
+                               galera::TrxHandleSlaveDeleter());
+
+    std::cout << std::setprecision(4)
+              << "window: " << window << ", trxs: " << total
+              << ", purge interval: " << purge_interval << '\n'
+              << std::setw(14) << "map"
+              << std::setw(14) << "trxs/s" << '\n'
+              << std::setw(14) << "std::map"
+              << std::setw(14)
+              << run<StdMapAdapter>(ts, window, total, purge_interval) << '\n'
+              << std::setw(14) << "CertTrxMap"
+              << std::setw(14)
+              << run<DeqMapAdapter>(ts, window, total, purge_interval) << '\n';
+
+    return 0;
+}
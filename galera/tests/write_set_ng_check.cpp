@@ -298,6 +298,27 @@ START_TEST (ver3_basic_rsv2_wsv4)
 }
 END_TEST
 
+/* same as above, but background checksums go to the pool */
+START_TEST (ver3_basic_checksum_pool)
+{
+    std::shared_ptr<ChecksumPool> const pool(ChecksumPool::get());
+    ck_assert(ChecksumPool::instance() == pool);
+
+    ver3_basic(gu::RecordSet::VER2, WriteSetNG::VER4);
+
+    double    queue_avg;
+    long long queue_max;
+    long long latency;
+    pool->stats_get(queue_avg, queue_max, latency);
+    ck_assert(latency > 0);
+    ck_assert(queue_max <= long(ChecksumPool::MAX_QUEUE));
+
+    pool->stats_reset();
+    pool->stats_get(queue_avg, queue_max, latency);
+    ck_assert(0 == latency);
+}
+END_TEST
+
 static void ver3_annotation(gu::RecordSet::Version const rsv)
 {
     int const alignment(rsv >= gu::RecordSet::VER2 ? GU_MIN_ALIGNMENT : 1);
@@ -403,6 +424,7 @@ Suite* write_set_ng_suite ()
 #endif
     tcase_add_test (t, ver3_basic_rsv2_wsv3);
     tcase_add_test (t, ver3_basic_rsv2_wsv4);
+    tcase_add_test (t, ver3_basic_checksum_pool);
     tcase_set_timeout(t, 60);
     suite_add_tcase (s, t);
 
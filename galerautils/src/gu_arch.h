@@ -66,6 +66,15 @@ typedef uint64_t gu_word_t;
 
 #define GU_WORD_BYTES sizeof(gu_word_t)
 
+/* CPU hint to be used in busy wait loops */
+#if defined(__x86_64__) || defined(__i386__)
+# define GU_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+# define GU_CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else
+# define GU_CPU_RELAX() do {} while (0)
+#endif
+
 #include <assert.h>
 #ifdef __cpluplus // to avoid "old-style cast" in C++ make it temp instantiation
 #define GU_ASSERT_ALIGNMENT(x)                              \
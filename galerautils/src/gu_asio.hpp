@@ -26,6 +26,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace gu
 {
@@ -564,6 +565,17 @@ namespace gu
          */
         virtual void write(const std::array<AsioConstBuffer, 2>& bufs) = 0;
 
+        /**
+         * Write several datagrams at once. Each datagram consists of
+         * two buffers like in write() above. Where supported, datagrams
+         * are passed to the kernel in batches with sendmmsg().
+         *
+         * @throw gu::Exception If an error occurs, see write() above.
+         *        Datagrams preceding the failed one have been sent.
+         */
+        virtual void write(
+            const std::vector<std::array<AsioConstBuffer, 2> >& bufs) = 0;
+
         /**
          * Send a datagram to destination given by target. Sending a
          * message is best effort only, the message may be dropped
@@ -582,6 +594,24 @@ namespace gu
         virtual void async_read(const AsioMutableBuffer&,
                                 const std::shared_ptr<AsioDatagramSocketHandler>& handler) = 0;
 
+        /**
+         * Read datagrams which have already been received, without
+         * blocking. Where supported, datagrams are read in a single
+         * system call with recvmmsg(). Must not be called while
+         * asynchronous read is pending.
+         *
+         * @param bufs Buffers to read into, one datagram per buffer.
+         * @param lens Lengths of datagrams read, resized to bufs.size().
+         *             Datagram which did not fit into its buffer and was
+         *             truncated is reported with length of buffer size + 1.
+         *
+         * @return Number of datagrams read, zero if none was available.
+         *
+         * @throw gu::Exception If an error occurs.
+         */
+        virtual size_t read(const std::vector<AsioMutableBuffer>& bufs,
+                            std::vector<size_t>& lens) = 0;
+
         /**
          * Return address containing the local endpoint where the socket
          * was bound to.
@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2020 Codership Oy <info@codership.com>
+// Copyright (C) 2020-2024 Codership Oy <info@codership.com>
 //
 
 #define GU_ASIO_IMPL
@@ -19,6 +19,15 @@
 
 #include <boost/bind.hpp>
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// Max number of datagrams passed to kernel in one system call
+static const size_t max_batch = 64;
+
 static asio::ip::udp::resolver::iterator resolve_udp(
     asio::io_service& io_service,
     const gu::URI& uri)
@@ -205,6 +214,114 @@ catch (const asio::system_error& e)
         << "Failed to write UDP socket: " << e.what();
 }
 
+#if defined(__linux__)
+void gu::AsioUdpSocket::write(
+    const std::vector<std::array<AsioConstBuffer, 2> >& buffers)
+{
+    struct mmsghdr msgs[max_batch];
+    struct iovec   iov[2 * max_batch];
+    int const      fd(native_socket_handle(socket_));
+
+    size_t sent(0);
+    while (sent < buffers.size())
+    {
+        unsigned int const n(std::min(buffers.size() - sent, max_batch));
+        for (unsigned int i(0); i < n; ++i)
+        {
+            const std::array<AsioConstBuffer, 2>& b(buffers[sent + i]);
+            iov[2*i].iov_base     = const_cast<void*>(b[0].data());
+            iov[2*i].iov_len      = b[0].size();
+            iov[2*i + 1].iov_base = const_cast<void*>(b[1].data());
+            iov[2*i + 1].iov_len  = b[1].size();
+            struct msghdr& hdr(msgs[i].msg_hdr);
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name    = local_endpoint_.data();
+            hdr.msg_namelen = local_endpoint_.size();
+            hdr.msg_iov     = &iov[2*i];
+            hdr.msg_iovlen  = 2;
+        }
+        int const ret(::sendmmsg(fd, msgs, n, 0));
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            gu_throw_error(errno) << "Failed to write UDP socket";
+        }
+        sent += ret;
+    }
+}
+
+size_t gu::AsioUdpSocket::read(const std::vector<AsioMutableBuffer>& buffers,
+                               std::vector<size_t>& lens)
+{
+    struct mmsghdr msgs[max_batch];
+    struct iovec   iov[max_batch];
+    unsigned int const n(std::min(buffers.size(), max_batch));
+    int const      fd(native_socket_handle(socket_));
+
+    for (unsigned int i(0); i < n; ++i)
+    {
+        iov[i].iov_base = buffers[i].data();
+        iov[i].iov_len  = buffers[i].size();
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int ret;
+    while ((ret = ::recvmmsg(fd, msgs, n, MSG_DONTWAIT, 0)) < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        if (errno != EINTR)
+        {
+            gu_throw_error(errno) << "Failed to read UDP socket";
+        }
+    }
+
+    lens.resize(buffers.size());
+    for (int i(0); i < ret; ++i)
+    {
+        lens[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ?
+            buffers[i].size() + 1 : msgs[i].msg_len;
+    }
+    return ret;
+}
+#else
+void gu::AsioUdpSocket::write(
+    const std::vector<std::array<AsioConstBuffer, 2> >& buffers)
+{
+    for (size_t i(0); i < buffers.size(); ++i) write(buffers[i]);
+}
+
+size_t gu::AsioUdpSocket::read(const std::vector<AsioMutableBuffer>& buffers,
+                               std::vector<size_t>& lens)
+{
+    int const fd(native_socket_handle(socket_));
+    size_t n(0);
+
+    lens.resize(buffers.size());
+    while (n < buffers.size())
+    {
+        struct iovec  iov;
+        struct msghdr hdr;
+        iov.iov_base = buffers[n].data();
+        iov.iov_len  = buffers[n].size();
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov    = &iov;
+        hdr.msg_iovlen = 1;
+        ssize_t const ret(::recvmsg(fd, &hdr, MSG_DONTWAIT));
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            gu_throw_error(errno) << "Failed to read UDP socket";
+        }
+        lens[n] = (hdr.msg_flags & MSG_TRUNC) ? buffers[n].size() + 1 : ret;
+        ++n;
+    }
+    return n;
+}
+#endif /* __linux__ */
+
 void gu::AsioUdpSocket::send_to(
     const std::array<AsioConstBuffer, 2>& buffers,
     const AsioIpAddress& target_host,
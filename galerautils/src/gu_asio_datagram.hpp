@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2020 Codership Oy <info@codership.com>
+// Copyright (C) 2020-2024 Codership Oy <info@codership.com>
 //
 
 /** @file gu_asio_datagram.hpp
@@ -46,6 +46,10 @@ namespace gu
         virtual void write(const std::array<AsioConstBuffer, 2>& buffers)
             GALERA_OVERRIDE;
 
+        virtual void write(
+            const std::vector<std::array<AsioConstBuffer, 2> >& buffers)
+            GALERA_OVERRIDE;
+
         virtual void send_to(const std::array<AsioConstBuffer, 2>& buffers,
                              const AsioIpAddress& target_host,
                              unsigned short target_port) GALERA_OVERRIDE;
@@ -55,6 +59,9 @@ namespace gu
             const std::shared_ptr<AsioDatagramSocketHandler>& handler)
             GALERA_OVERRIDE;
 
+        virtual size_t read(const std::vector<AsioMutableBuffer>& buffers,
+                            std::vector<size_t>& lens) GALERA_OVERRIDE;
+
         virtual std::string local_addr() const GALERA_OVERRIDE;
 
         // Async handlers
@@ -1,6 +1,237 @@
 //
-// Copyright (C) 2010 Codership Oy <info@codership.com>
+// Copyright (C) 2010-2024 Codership Oy <info@codership.com>
 //
 
 #include "gu_buffer.hpp"
 
+#include "gu_lock.hpp"
+#include "gu_macros.hpp"
+#include "gu_thread_keys.hpp"
+
+namespace
+{
+    size_t const N_CLASSES = 11; // 64 .. 64K
+
+    /* Free blocks are linked through their first word */
+    struct FreeBlock
+    {
+        FreeBlock* next_;
+    };
+
+    inline size_t
+    size_class(size_t const size)
+    {
+        size_t c(0);
+        for (size_t s(gu::BufferPool::MIN_SIZE); s < size; s <<= 1) ++c;
+        return c;
+    }
+
+    inline size_t
+    class_size(size_t const c)
+    {
+        return (gu::BufferPool::MIN_SIZE << c);
+    }
+
+    /* Limit on the number of blocks of a class held by a thread cache,
+     * at most 32K of memory per class. */
+    inline size_t
+    cache_max(size_t const c)
+    {
+        size_t const ret((32 << 10) / class_size(c));
+        return (ret > 4 ? ret : 4);
+    }
+
+    std::atomic<long long> heap_allocs_(0);
+    std::atomic<long long> heap_frees_(0);
+
+    inline void*
+    heap_alloc(size_t const size)
+    {
+        heap_allocs_.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    inline void
+    heap_free(void* const ptr)
+    {
+        heap_frees_.fetch_add(1, std::memory_order_relaxed);
+        ::operator delete(ptr);
+    }
+
+    struct FreeList
+    {
+        FreeBlock* head_;
+        size_t     count_;
+
+        void push(void* const ptr)
+        {
+            FreeBlock* const b(static_cast<FreeBlock*>(ptr));
+            b->next_ = head_;
+            head_ = b;
+            ++count_;
+        }
+
+        void* pop()
+        {
+            assert(head_);
+            FreeBlock* const b(head_);
+            head_ = b->next_;
+            --count_;
+            return b;
+        }
+    };
+
+    /* Shared store of free blocks for thread caches to spill to and
+     * refill from. Holds up to 4 thread caches worth of blocks per class. */
+    class Depot
+    {
+    public:
+
+        Depot() : mtx_(gu::get_mutex_key(gu::GU_MUTEX_KEY_MEMPOOL)), lists_()
+        {}
+
+        /* moves up to n blocks of class c to list */
+        void get(size_t const c, FreeList& list, size_t n)
+        {
+            gu::Lock lock(mtx_);
+            while (n-- > 0 && lists_[c].count_ > 0) list.push(lists_[c].pop());
+        }
+
+        /* moves n blocks of class c from list, frees what does not fit */
+        void put(size_t const c, FreeList& list, size_t n)
+        {
+            FreeList excess = { 0, 0 };
+            {
+                gu::Lock lock(mtx_);
+                while (n-- > 0)
+                {
+                    if (lists_[c].count_ < 4 * cache_max(c))
+                        lists_[c].push(list.pop());
+                    else
+                        excess.push(list.pop());
+                }
+            }
+            while (excess.count_ > 0) heap_free(excess.pop());
+        }
+
+        size_t count(size_t const c) const
+        {
+            gu::Lock lock(mtx_);
+            return lists_[c].count_;
+        }
+
+    private:
+
+        gu::Mutex mtx_;
+        FreeList  lists_[N_CLASSES];
+    };
+
+    /* Never destroyed: buffers may be released by static destructors. */
+    Depot&
+    depot()
+    {
+        static Depot* const d(new Depot);
+        return *d;
+    }
+
+    /* Trivially destructible, so that it remains usable for buffers released
+     * by other thread_local destructors after it has been flushed. */
+    struct ThreadCache
+    {
+        FreeList lists_[N_CLASSES];
+        bool     registered_;
+        bool     closed_;
+    };
+
+    thread_local ThreadCache cache_;
+
+    /* Returns cached blocks to depot on thread exit */
+    struct ThreadCacheFlush
+    {
+        ~ThreadCacheFlush()
+        {
+            cache_.closed_ = true;
+            for (size_t c(0); c < N_CLASSES; ++c)
+            {
+                depot().put(c, cache_.lists_[c], cache_.lists_[c].count_);
+            }
+        }
+    };
+
+    inline void
+    register_thread()
+    {
+        static thread_local ThreadCacheFlush flush;
+        (void)flush;
+        cache_.registered_ = true;
+    }
+}
+
+void*
+gu::BufferPool::allocate(size_t const size)
+{
+    if (gu_unlikely(size > MAX_SIZE)) return heap_alloc(size);
+
+    size_t const c(size_class(size));
+    FreeList& list(cache_.lists_[c]);
+
+    if (gu_unlikely(0 == list.count_))
+    {
+        if (gu_unlikely(!cache_.registered_)) register_thread();
+
+        depot().get(c, list, cache_max(c) / 2);
+
+        if (0 == list.count_) return heap_alloc(class_size(c));
+    }
+
+    return list.pop();
+}
+
+void
+gu::BufferPool::deallocate(void* const ptr, size_t const size)
+{
+    if (gu_unlikely(size > MAX_SIZE)) { heap_free(ptr); return; }
+
+    size_t const c(size_class(size));
+    FreeList& list(cache_.lists_[c]);
+
+    list.push(ptr);
+
+    if (gu_unlikely(cache_.closed_))
+    {
+        depot().put(c, list, list.count_);
+        return;
+    }
+
+    if (gu_unlikely(!cache_.registered_)) register_thread();
+
+    if (gu_unlikely(list.count_ > cache_max(c)))
+    {
+        depot().put(c, list, list.count_ / 2);
+    }
+}
+
+long long
+gu::BufferPool::heap_allocs()
+{
+    return heap_allocs_.load(std::memory_order_relaxed);
+}
+
+long long
+gu::BufferPool::heap_frees()
+{
+    return heap_frees_.load(std::memory_order_relaxed);
+}
+
+void
+gu::BufferPool::print(std::ostream& os)
+{
+    os << "BufferPool: heap allocs: " << heap_allocs()
+       << ", heap frees: " << heap_frees()
+       << ", in depot:";
+
+    for (size_t c(0); c < N_CLASSES; ++c)
+    {
+        os << ' ' << depot().count(c);
+    }
+}
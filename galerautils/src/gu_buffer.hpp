@@ -1,9 +1,10 @@
 /*
- * Copyright (C) 2009-2017 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 /*!
- * Byte buffer class. This is thin wrapper to std::vector
+ * Byte buffer class. This is thin wrapper to std::vector with pooled
+ * storage, and an intrusively refcounted handle to it.
  */
 
 #ifndef GU_BUFFER_HPP
@@ -12,11 +13,77 @@
 #include "gu_types.hpp" // for gu::byte_t
 
 #include "gu_shared_ptr.hpp"
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <new>
+#include <ostream>
+#include <utility>
 #include <vector>
 
 namespace gu
 {
+    /*
+     * Size-classed pool of raw memory blocks for buffers. Sizes are rounded
+     * up to a power of two between MIN_SIZE and MAX_SIZE, anything larger
+     * goes directly to operator new.
+     *
+     * Every thread keeps a small cache of free blocks per size class, so
+     * that allocation and release normally take no locks. Caches that grow
+     * too large (e.g. in a thread which only releases buffers allocated
+     * by another one) spill half of the blocks to a shared depot, and empty
+     * caches are refilled from there before resorting to operator new.
+     */
+    class BufferPool
+    {
+    public:
+
+        static size_t const MIN_SIZE = 64;
+        static size_t const MAX_SIZE = 64 << 10;
+
+        static void* allocate  (size_t size);
+        static void  deallocate(void* ptr, size_t size);
+
+        /* Number of blocks allocated from and returned to the heap since
+         * the start of the process. */
+        static long long heap_allocs();
+        static long long heap_frees();
+
+        static void print(std::ostream& os);
+
+    private:
+
+        BufferPool();
+    };
+
+    /* Standard allocator on top of BufferPool */
+    template <typename T>
+    class BufferAllocator
+    {
+    public:
+
+        typedef T value_type;
+
+        BufferAllocator() { }
+        template <typename U>
+        BufferAllocator(const BufferAllocator<U>&) { }
+
+        T* allocate(size_t n)
+        {
+            return static_cast<T*>(BufferPool::allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t n)
+        {
+            BufferPool::deallocate(p, n * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator==(const BufferAllocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const BufferAllocator<U>&) const { return false; }
+    };
+
     /*
      * Utility class for data buffers with vector like interface.
      *
@@ -27,7 +94,7 @@ namespace gu
     class Buffer
     {
     public:
-        typedef std::vector<byte_t> buffer_type;
+        typedef std::vector<byte_t, BufferAllocator<byte_t> > buffer_type;
         typedef buffer_type::iterator iterator;
         typedef buffer_type::const_iterator const_iterator;
         typedef buffer_type::difference_type difference_type;
@@ -72,9 +139,106 @@ namespace gu
             return (buf_ == other.buf_);
         }
     private:
-        std::vector<byte_t> buf_;
+        buffer_type buf_;
+    };
+
+    /*
+     * Shared pointer to Buffer. The reference counter is kept together with
+     * the Buffer object in a single block allocated from BufferPool, so
+     * creating a shared buffer takes one pool allocation for the object
+     * and one for its contents instead of three heap allocations.
+     *
+     * Use make_shared_buffer() to create one.
+     */
+    class SharedBuffer
+    {
+        struct Block
+        {
+            std::atomic<long> refs_;
+            Buffer            buf_;
+
+            template <class... Args>
+            explicit Block(Args&&... args)
+                : refs_(1), buf_(std::forward<Args>(args)...) { }
+        };
+
+    public:
+
+        SharedBuffer() : block_(0) { }
+
+        SharedBuffer(const SharedBuffer& other) : block_(other.block_)
+        {
+            if (block_) block_->refs_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        SharedBuffer(SharedBuffer&& other) : block_(other.block_)
+        {
+            other.block_ = 0;
+        }
+
+        ~SharedBuffer() { release(); }
+
+        SharedBuffer& operator=(SharedBuffer other)
+        {
+            swap(other);
+            return *this;
+        }
+
+        void swap(SharedBuffer& other) { std::swap(block_, other.block_); }
+
+        Buffer* get()        const { return block_ ? &block_->buf_ : 0; }
+        Buffer& operator*()  const { assert(block_); return block_->buf_; }
+        Buffer* operator->() const { assert(block_); return &block_->buf_; }
+
+        explicit operator bool() const { return block_ != 0; }
+
+        /* true if this is the only reference to the buffer */
+        bool unique() const
+        {
+            return (block_ &&
+                    block_->refs_.load(std::memory_order_acquire) == 1);
+        }
+
+        template <class... Args>
+        friend SharedBuffer make_shared_buffer(Args&&... args);
+
+    private:
+
+        explicit SharedBuffer(Block* block) : block_(block) { }
+
+        void release()
+        {
+            if (block_ &&
+                block_->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                block_->~Block();
+                BufferPool::deallocate(block_, sizeof(Block));
+            }
+            block_ = 0;
+        }
+
+        Block* block_;
     };
-    typedef gu::shared_ptr<Buffer>::type SharedBuffer;
+
+    inline void swap(SharedBuffer& lhs, SharedBuffer& rhs) { lhs.swap(rhs); }
+
+    /* Allocates Buffer constructed from args */
+    template <class... Args>
+    SharedBuffer make_shared_buffer(Args&&... args)
+    {
+        void* const ptr(BufferPool::allocate(sizeof(SharedBuffer::Block)));
+
+        try
+        {
+            return SharedBuffer(new (ptr) SharedBuffer::Block
+                                (std::forward<Args>(args)...));
+        }
+        catch (...)
+        {
+            BufferPool::deallocate(ptr, sizeof(SharedBuffer::Block));
+            throw;
+        }
+    }
 }
 
 #endif // GU_BUFFER_HPP
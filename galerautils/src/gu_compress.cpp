@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+#include "gu_compress.hpp"
+#include "gu_throw.hpp"
+#include "gu_macros.h"
+
+#ifdef GALERA_HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#ifdef GALERA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cstring>
+#include <strings.h> // strcasecmp()
+
+bool
+gu::Compression::supported(Type const type)
+{
+    switch (type)
+    {
+    case NONE:
+        return true;
+    case LZ4:
+#ifdef GALERA_HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case ZSTD:
+#ifdef GALERA_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+bool
+gu::Compression::supported_all()
+{
+    return supported(LZ4) && supported(ZSTD);
+}
+
+gu::Compression::Type
+gu::Compression::type(int const type)
+{
+    switch (type)
+    {
+    case NONE: return NONE;
+    case LZ4:  return LZ4;
+    case ZSTD: return ZSTD;
+    }
+
+    gu_throw_error(EINVAL) << "Unrecognized compression type: " << type;
+}
+
+gu::Compression::Type
+gu::Compression::type(const std::string& name)
+{
+    for (int t(NONE); t <= MAX_TYPE; ++t)
+    {
+        Type const ret(static_cast<Type>(t));
+
+        if (0 == strcasecmp(name.c_str(), Compression::name(ret)))
+        {
+            if (!supported(ret))
+            {
+                gu_throw_error(EINVAL) << "Compression algorithm '" << name
+                                       << "' is not supported by this build";
+            }
+
+            return ret;
+        }
+    }
+
+    gu_throw_error(EINVAL) << "Unrecognized compression algorithm: '"
+                           << name << "'. Expected one of none, lz4, zstd";
+}
+
+const char*
+gu::Compression::name(Type const type)
+{
+    switch (type)
+    {
+    case NONE: return "none";
+    case LZ4:  return "lz4";
+    case ZSTD: return "zstd";
+    }
+
+    return "unknown";
+}
+
+static GU_NORETURN void
+throw_not_supported(gu::Compression::Type const type)
+{
+    gu_throw_error(ENOTSUP) << "Compression algorithm '"
+                            << gu::Compression::name(type)
+                            << "' is not supported by this build";
+}
+
+#ifdef GALERA_HAVE_ZSTD
+namespace
+{
+    /* zstd contexts are expensive to create, keep one per thread */
+    class ZstdContext
+    {
+    public:
+        ZstdContext() : cctx_(NULL), dctx_(NULL) {}
+        ~ZstdContext()
+        {
+            ZSTD_freeCCtx(cctx_);
+            ZSTD_freeDCtx(dctx_);
+        }
+
+        ZSTD_CCtx* cctx()
+        {
+            if (gu_unlikely(NULL == cctx_))
+            {
+                cctx_ = ZSTD_createCCtx();
+                if (NULL == cctx_) gu_throw_error(ENOMEM);
+            }
+            return cctx_;
+        }
+
+        ZSTD_DCtx* dctx()
+        {
+            if (gu_unlikely(NULL == dctx_))
+            {
+                dctx_ = ZSTD_createDCtx();
+                if (NULL == dctx_) gu_throw_error(ENOMEM);
+            }
+            return dctx_;
+        }
+
+    private:
+        ZSTD_CCtx* cctx_;
+        ZSTD_DCtx* dctx_;
+
+        ZstdContext(const ZstdContext&);
+        ZstdContext& operator=(const ZstdContext&);
+    };
+
+    thread_local ZstdContext zstd_ctx;
+}
+#endif /* GALERA_HAVE_ZSTD */
+
+size_t
+gu::Compression::bound(Type const type, size_t const src_size)
+{
+    switch (type)
+    {
+    case NONE:
+        return src_size;
+    case LZ4:
+#ifdef GALERA_HAVE_LZ4
+        if (src_size > size_t(LZ4_MAX_INPUT_SIZE)) return 0;
+        return LZ4_compressBound(int(src_size));
+#else
+        break;
+#endif
+    case ZSTD:
+#ifdef GALERA_HAVE_ZSTD
+        return ZSTD_compressBound(src_size);
+#else
+        break;
+#endif
+    }
+
+    throw_not_supported(type);
+}
+
+size_t
+gu::Compression::compress(Type        const type,
+                          int         const level,
+                          const void* const src,
+                          size_t      const src_size,
+                          void*       const dst,
+                          size_t      const dst_size)
+{
+    switch (type)
+    {
+    case NONE:
+        if (src_size > dst_size) return 0;
+        ::memcpy(dst, src, src_size);
+        return src_size;
+    case LZ4:
+    {
+#ifdef GALERA_HAVE_LZ4
+        if (src_size > size_t(LZ4_MAX_INPUT_SIZE)) return 0;
+
+        int const dst_cap(dst_size > size_t(LZ4_MAX_INPUT_SIZE) ?
+                          LZ4_compressBound(LZ4_MAX_INPUT_SIZE) :
+                          int(dst_size));
+        int ret;
+
+        if (level > 0)
+        {
+            ret = LZ4_compress_HC(static_cast<const char*>(src),
+                                  static_cast<char*>(dst),
+                                  int(src_size), dst_cap, level);
+        }
+        else
+        {
+            ret = LZ4_compress_fast(static_cast<const char*>(src),
+                                    static_cast<char*>(dst),
+                                    int(src_size), dst_cap, 1 - level);
+        }
+
+        return ret > 0 ? size_t(ret) : 0;
+#else
+        break;
+#endif
+    }
+    case ZSTD:
+    {
+#ifdef GALERA_HAVE_ZSTD
+        size_t const ret(ZSTD_compressCCtx(zstd_ctx.cctx(), dst, dst_size,
+                                           src, src_size, level));
+        return ZSTD_isError(ret) ? 0 : ret;
+#else
+        break;
+#endif
+    }
+    }
+
+    throw_not_supported(type);
+}
+
+void
+gu::Compression::decompress(Type        const type,
+                            const void* const src,
+                            size_t      const src_size,
+                            void*       const dst,
+                            size_t      const dst_size)
+{
+    switch (type)
+    {
+    case NONE:
+        if (gu_unlikely(src_size != dst_size)) break;
+        ::memcpy(dst, src, src_size);
+        return;
+    case LZ4:
+    {
+#ifdef GALERA_HAVE_LZ4
+        if (gu_unlikely(src_size > size_t(LZ4_MAX_INPUT_SIZE) ||
+                        dst_size > size_t(LZ4_MAX_INPUT_SIZE))) break;
+
+        int const ret(LZ4_decompress_safe(static_cast<const char*>(src),
+                                          static_cast<char*>(dst),
+                                          int(src_size), int(dst_size)));
+        if (gu_likely(ret >= 0 && size_t(ret) == dst_size)) return;
+        break;
+#else
+        throw_not_supported(type);
+#endif
+    }
+    case ZSTD:
+    {
+#ifdef GALERA_HAVE_ZSTD
+        size_t const ret(ZSTD_decompressDCtx(zstd_ctx.dctx(), dst, dst_size,
+                                             src, src_size));
+        if (gu_likely(!ZSTD_isError(ret) && ret == dst_size)) return;
+        break;
+#else
+        throw_not_supported(type);
+#endif
+    }
+    default:
+        gu_throw_error(EINVAL) << "Unrecognized compression type: " << type;
+    }
+
+    gu_throw_error(EINVAL) << "Failed to decompress " << src_size
+                           << " bytes of " << name(type) << " data into "
+                           << dst_size << " bytes";
+}
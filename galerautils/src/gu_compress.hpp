@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/*!
+ * @file Thin wrapper around optional LZ4 and zstd block compression.
+ *
+ * Algorithm support is decided at build time (GALERA_HAVE_LZ4 and
+ * GALERA_HAVE_ZSTD). Type values are a part of the wire format and must
+ * never be changed.
+ */
+
+#ifndef _gu_compress_hpp_
+#define _gu_compress_hpp_
+
+#include <string>
+#include <cstddef>
+
+namespace gu
+{
+    class Compression
+    {
+    public:
+
+        enum Type
+        {
+            NONE = 0,
+            LZ4  = 1,
+            ZSTD = 2
+        };
+
+        static Type const MAX_TYPE = ZSTD;
+
+        /*! @return true if the algorithm was compiled in */
+        static bool supported(Type type);
+
+        /*! @return true if every known algorithm was compiled in */
+        static bool supported_all();
+
+        /*! @throws EINVAL if type is not a known algorithm */
+        static Type type(int type);
+
+        /*! Parses "none", "lz4" or "zstd" (case insensitive)
+         *  @throws EINVAL if the name is unknown or the algorithm
+         *          is not supported by this build */
+        static Type type(const std::string& name);
+
+        static const char* name(Type type);
+
+        /*! @return maximum compressed size for src_size bytes of input */
+        static size_t bound(Type type, size_t src_size);
+
+        /*!
+         * Compresses src into dst.
+         *
+         * Level 0 selects the algorithm default, higher values trade speed
+         * for ratio, negative values trade ratio for speed. For LZ4 positive
+         * levels select LZ4HC.
+         *
+         * @return compressed size or 0 if the result does not fit into
+         *         dst_size bytes
+         * @throws ENOTSUP if the algorithm is not supported
+         */
+        static size_t compress(Type        type,
+                               int         level,
+                               const void* src,
+                               size_t      src_size,
+                               void*       dst,
+                               size_t      dst_size);
+
+        /*!
+         * Decompresses exactly dst_size bytes from src into dst.
+         *
+         * @throws EINVAL if the input is corrupt or its decompressed size
+         *         is not dst_size, ENOTSUP if the algorithm is not supported
+         */
+        static void decompress(Type        type,
+                               const void* src,
+                               size_t      src_size,
+                               void*       dst,
+                               size_t      dst_size);
+    };
+}
+
+#endif // _gu_compress_hpp_
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * Queue (FIFO) class implementation
  *
@@ -58,6 +58,7 @@ struct gu_fifo
     gu_cond_t    get_cond;
     gu_cond_t    put_cond;
 
+    void* spare_row; /* last released row, saves malloc()/free() under lock */
     void* rows[];
 };
 
@@ -343,13 +344,23 @@ void* gu_fifo_get_head (gu_fifo_t* q, int* err)
 static inline
 void fifo_advance_head (gu_fifo_t* q)
 {
-    if (FIFO_COL(q, q->head) == q->col_mask) {
+    /* If the queue is full and wrapped around, tail may be already filling
+     * this row again. If tail is only at the start of the row, it has not
+     * written there yet and the row is released as usual. */
+    if (FIFO_COL(q, q->head) == q->col_mask &&
+        (FIFO_ROW(q, q->head) != FIFO_ROW(q, q->tail) ||
+         FIFO_COL(q, q->tail) == 0)) {
         /* removing last unit from the row */
         ulong row = FIFO_ROW (q, q->head);
         assert (q->rows[row] != NULL);
-        gu_free (q->rows[row]);
+        if (NULL == q->spare_row) {
+            q->spare_row = q->rows[row];
+        }
+        else {
+            gu_free (q->rows[row]);
+            q->alloc -= q->row_size;
+        }
         q->rows[row] = NULL;
-        q->alloc -= q->row_size;
     }
 
     q->head = FIFO_INC(q, q->head);
@@ -382,6 +393,11 @@ void* gu_fifo_get_tail (gu_fifo_t* q)
         assert (q->used < q->length);
 
         // check if row is allocated and allocate if not.
+        if (NULL == q->rows[row] && NULL != q->spare_row) {
+            q->rows[row] = q->spare_row;
+            q->spare_row = NULL;
+        }
+
         if (NULL == q->rows[row] &&
             NULL == (q->alloc += q->row_size,
                      q->rows[row] = gu_malloc(q->row_size))) {
@@ -514,6 +530,11 @@ void gu_fifo_destroy   (gu_fifo_t *queue)
 
     while (gu_mutex_destroy (&queue->lock)) continue;
 
+    if (queue->spare_row) {
+        gu_free (queue->spare_row);
+        queue->alloc -= queue->row_size;
+    }
+
     /* only one row might be left */
     {
         ulong row = FIFO_ROW(queue, queue->tail);
@@ -15,6 +15,15 @@
 #include <cerrno>
 #include <sys/mman.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(SYS_get_mempolicy) && defined(SYS_set_mempolicy)
+#include <linux/mempolicy.h>
+#define GU_MMAP_NUMA 1
+#endif
+#endif
+
 #if defined(__FreeBSD__) && defined(MAP_NORESERVE)
 /* FreeBSD has never implemented this flags and will deprecate it. */
 #undef MAP_NORESERVE
@@ -29,7 +38,87 @@ extern "C" { static const void* const GU_MAP_FAILED = MAP_FAILED; }
 
 namespace gu
 {
-    MMap::MMap (const FileDescriptor& fd, bool const sequential)
+    /* Kernel ignores mbind() on shared mappings: pages are allocated
+     * according to the policy of the thread that faults them in. So to place
+     * a mapping on a given node we make it the preferred node of the calling
+     * thread while pre-faulting. The previous policy is restored on scope
+     * exit. */
+    class NumaPreferred
+    {
+    public:
+
+        NumaPreferred(int const node, const std::string& name)
+            : mode_(0), mask_(), set_(false)
+        {
+            if (node < 0) return;
+#if defined(GU_MMAP_NUMA)
+            if (node >= MAX_NODES)
+            {
+                log_warn << "NUMA node " << node << " for " << name
+                         << " is out of range, ignoring";
+                return;
+            }
+
+            unsigned long mask[MAX_NODES / BITS] = { 0, };
+            mask[node / BITS] = 1UL << (node % BITS);
+
+            if (::syscall(SYS_get_mempolicy, &mode_, mask_, MAX_NODES,
+                          NULL, 0) ||
+                ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+                          MAX_NODES))
+            {
+                int const err(errno);
+                log_warn << "Failed to set preferred NUMA node " << node
+                         << " for " << name << ": " << err << " ("
+                         << strerror(err) << ")";
+                return;
+            }
+
+            set_ = true;
+#else
+            log_warn << "NUMA node binding is not supported on this "
+                     << "platform, ignoring it for " << name;
+#endif
+        }
+
+        ~NumaPreferred()
+        {
+#if defined(GU_MMAP_NUMA)
+            if (set_ &&
+                ::syscall(SYS_set_mempolicy, mode_, mask_, MAX_NODES))
+            {
+                int const err(errno);
+                log_warn << "Failed to restore NUMA policy: " << err << " ("
+                         << strerror(err) << ")";
+            }
+#endif
+        }
+
+    private:
+
+        static int const BITS      = sizeof(unsigned long) * 8;
+        static int const MAX_NODES = 1024;
+
+        int           mode_;
+        unsigned long mask_[MAX_NODES / BITS];
+        bool          set_;
+    };
+
+    static void
+    populate (void* const ptr, size_t const size)
+    {
+#if defined(MADV_POPULATE_WRITE)
+        if (0 == ::madvise(ptr, size, MADV_POPULATE_WRITE)) return;
+        /* kernels before 5.14 don't have it, touch the pages instead */
+#endif
+        volatile uint8_t* const p(static_cast<volatile uint8_t*>(ptr));
+        size_t const page(GU_PAGE_SIZE);
+
+        for (size_t off(0); off < size; off += page) p[off] = p[off];
+    }
+
+    MMap::MMap (const FileDescriptor& fd, bool const sequential,
+                const Options& opts)
         :
         size   (fd.size()),
         ptr    (mmap (NULL, size, PROT_READ|PROT_WRITE,
@@ -66,6 +155,32 @@ namespace gu
                      << ": " << err << " (" << strerror(err) << ")";
         }
 
+        if (opts.huge_pages)
+        {
+#if defined(MADV_HUGEPAGE)
+            /* must precede faulting the pages in */
+            if (::madvise (ptr, size, MADV_HUGEPAGE))
+            {
+                int const err(errno);
+                log_warn << "Failed to set MADV_HUGEPAGE on " << fd.name()
+                         << ": " << err << " (" << strerror(err) << ")";
+            }
+#else
+            log_warn << "Huge pages are not supported on this platform, "
+                     << "ignoring it for " << fd.name();
+#endif
+        }
+
+        /* NUMA placement is only effective when done by pre-faulting */
+        if (opts.populate || opts.numa_node >= 0)
+        {
+            log_info << "Pre-faulting " << size << " bytes of " << fd.name()
+                     << ", NUMA node: " << opts.numa_node;
+
+            NumaPreferred const numa(opts.numa_node, fd.name());
+            populate(ptr, size);
+        }
+
         log_debug << "Memory mapped: " << ptr << " (" << size << " bytes)";
     }
 
@@ -17,10 +17,21 @@ class MMap
 
 public:
 
+    /*! Optional tuning of the mapping, all off by default */
+    struct Options
+    {
+        Options() : huge_pages(false), populate(false), numa_node(-1) {}
+
+        bool huge_pages; // advise kernel to back mapping with huge pages
+        bool populate;   // pre-fault the whole mapping on creation
+        int  numa_node;  // preferred NUMA node for the pages, -1 - any
+    };
+
     size_t const size;
     void*  const ptr;
 
-    MMap (const FileDescriptor& fd, bool sequential = false);
+    MMap (const FileDescriptor& fd, bool sequential = false,
+          const Options& opts = Options());
 
     ~MMap ();
 
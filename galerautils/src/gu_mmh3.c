@@ -1,4 +1,4 @@
-// Copyright (C) 2012-2020 Codership Oy <info@codership.com>
+// Copyright (C) 2012-2024 Codership Oy <info@codership.com>
 
 /**
  * @file MurmurHash3 implementation
@@ -307,43 +307,87 @@ gu_mmh128_init(gu_mmh128_ctx_t* const mmh)
     _mmh128_init_seed (mmh, GU_MMH128_SEED1, GU_MMH128_SEED2);
 }
 
+/*! Copies less than 16 bytes without calling memcpy(): parts appended to
+ *  the stream are often only a few dozen bytes long, so a library call for
+ *  every tail copy costs more than hashing the blocks. */
+static GU_FORCE_INLINE void
+_mmh3_copy_short (void* const dst, const void* const src, size_t const len)
+{
+    uint8_t*       const d = (uint8_t*)dst;
+    const uint8_t* const s = (const uint8_t*)src;
+
+    if (len >= 8) /* two possibly overlapping 8-byte words */
+    {
+        uint64_t a, b;
+        memcpy (&a, s, 8);
+        memcpy (&b, s + len - 8, 8);
+        memcpy (d, &a, 8);
+        memcpy (d + len - 8, &b, 8);
+    }
+    else if (len >= 4)
+    {
+        uint32_t a, b;
+        memcpy (&a, s, 4);
+        memcpy (&b, s + len - 4, 4);
+        memcpy (d, &a, 4);
+        memcpy (d + len - 4, &b, 4);
+    }
+    else if (len > 0)
+    {
+        d[0]       = s[0];
+        d[len / 2] = s[len / 2];
+        d[len - 1] = s[len - 1];
+    }
+}
+
 /*! Apeend message part to hash context */
 void
 gu_mmh128_append (gu_mmh128_ctx_t* const mmh,
                   const void*      part,
                   size_t           len)
 {
-    size_t tail_len = mmh->length & 15;
+    size_t const tail_len = mmh->length & 15;
 
     mmh->length += len;
 
-    if (tail_len) /* there's something in the tail */// do we need this if()?
+    if (tail_len) /* there's something in the tail */
     {
         size_t const to_fill  = 16 - tail_len;
         void*  const tail_end = (uint8_t*)mmh->tail + tail_len;
 
-        if (len >= to_fill) /* we can fill a full block */
-        {
-            memcpy (tail_end, part, to_fill);
-            _mmh3_128_block (gu_le64(mmh->tail[0]), gu_le64(mmh->tail[1]),
-                             &mmh->hash[0], &mmh->hash[1]);
-            part = ((char*)part) + to_fill;
-            len -= to_fill;
-        }
-        else
+        if (len < to_fill) /* can't fill a full block, just accumulate */
         {
-            memcpy (tail_end, part, len);
+            _mmh3_copy_short (tail_end, part, len);
             return;
         }
+
+        _mmh3_copy_short (tail_end, part, to_fill);
+        part = ((const char*)part) + to_fill;
+        len -= to_fill;
+    }
+
+    /* Hash state is kept in locals for the duration of the loop: as the
+     * message could alias the context as far as the compiler is concerned,
+     * working on mmh->hash directly would store and reload it every block. */
+    uint64_t h1 = mmh->hash[0];
+    uint64_t h2 = mmh->hash[1];
+
+    if (tail_len)
+    {
+        _mmh3_128_block (gu_le64(mmh->tail[0]), gu_le64(mmh->tail[1]),
+                         &h1, &h2);
     }
 
     size_t const nblocks = (len >> 4) << 1; /* using 64-bit half-blocks */
     const uint64_t* const blocks = (const uint64_t*)(part);
 
-    _mmh3_128_blocks (blocks, nblocks, &mmh->hash[0], &mmh->hash[1]);
+    _mmh3_128_blocks (blocks, nblocks, &h1, &h2);
+
+    mmh->hash[0] = h1;
+    mmh->hash[1] = h2;
 
     /* save possible trailing bytes to tail */
-    memcpy (mmh->tail, blocks + nblocks, len & 15);
+    _mmh3_copy_short (mmh->tail, blocks + nblocks, len & 15);
 }
 
 /*! Get the accumulated message hash (does not change the context) */
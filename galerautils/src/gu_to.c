@@ -21,6 +21,8 @@
 #include "gu_assert.h"
 #include "gu_mem.h"
 #include "gu_threads.h"
+#include "gu_arch.h"
+#include "gu_time.h"
 #include "gu_to.h"
 
 #define TO_USE_SIGNAL 1
@@ -52,8 +54,55 @@ struct gu_to
     size_t               qmask;
     to_waiter_t*         queue;
     gu_mutex_t           lock;
+    long long            spin_ns; /* max time to spin before sleeping */
+    long long            hold_ns; /* average observed waiting time */
+    long long            spins;   /* waits resolved by spinning */
+    long long            parks;   /* waits which went to sleep */
 };
 
+/** Updates average waiting time with a new sample */
+static inline void
+to_hold_sample (gu_to_t* to, long long ns)
+{
+    to->hold_ns += (ns - to->hold_ns) / 8;
+}
+
+/**
+ * Spins with TO lock released while previous seqno is held, but not longer
+ * than twice the average waiting time and spin_ns. Spinning is skipped if
+ * waits are longer than spin_ns.
+ *
+ * TO lock may be released and relocked, so the caller must recheck the state.
+ */
+static void
+to_spin (gu_to_t* to, gu_seqno_t seqno)
+{
+    long long const hold2  = 2 * to->hold_ns;
+    long long const budget = to->hold_ns < to->spin_ns ?
+        (hold2 < to->spin_ns ? hold2 : to->spin_ns) : 0;
+    long long start, now;
+    bool ready = false;
+    long i;
+
+    if (budget <= 0) return;
+
+    gu_mutex_unlock (&to->lock);
+
+    start = now = gu_time_monotonic();
+    for (i = 1; !ready && now - start < budget; i++) {
+        GU_CPU_RELAX();
+        ready = (to->seqno >= seqno);
+        if (ready || 0 == (i & 63)) now = gu_time_monotonic();
+    }
+
+    gu_mutex_lock (&to->lock);
+
+    if (ready) {
+        to->spins++;
+        to_hold_sample (to, now - start);
+    }
+}
+
 /** Returns pointer to the waiter with the given seqno */
 static inline to_waiter_t*
 to_get_waiter (gu_to_t* to, gu_seqno_t seqno)
@@ -156,6 +205,7 @@ long gu_to_grab (gu_to_t* to, gu_seqno_t seqno)
 {
     long err;
     to_waiter_t *w;
+    bool spun = false;
 
     assert (seqno >= 0);
 
@@ -164,6 +214,7 @@ long gu_to_grab (gu_to_t* to, gu_seqno_t seqno)
         abort();
     }
 
+retry:
     if (seqno < to->seqno) {
         gu_mutex_unlock(&to->lock);
         return -ECANCELED;
@@ -190,8 +241,18 @@ long gu_to_grab (gu_to_t* to, gu_seqno_t seqno)
             gu_error("Trying to grab outdated seqno");
             err = -ECANCELED;
         } else { /* seqno > to->seqno, wait for my turn */
+            long long start;
+
+            if (!spun && to->spin_ns > 0) {
+                spun = true;
+                to_spin (to, seqno);
+                goto retry; /* state may have changed while spinning */
+            }
+
+            start = to->spin_ns > 0 ? gu_time_monotonic() : 0;
             w->state = WAIT;
             to->used++;
+            to->parks++;
 #ifdef TO_USE_SIGNAL
             gu_cond_wait(&w->cond, &to->lock);
 #else
@@ -202,6 +263,9 @@ long gu_to_grab (gu_to_t* to, gu_seqno_t seqno)
             pthread_mutex_unlock (&w->mtx);
 #endif
             to->used--;
+            if (to->spin_ns > 0) {
+                to_hold_sample (to, gu_time_monotonic() - start);
+            }
             switch (w->state) { 
             case WAIT:// should be most probable
                 assert (seqno == to->seqno);
@@ -313,6 +377,22 @@ gu_seqno_t gu_to_seqno (gu_to_t* to)
     return to->seqno - 1;
 }
 
+void gu_to_set_spin (gu_to_t* to, long long spin_ns)
+{
+    gu_mutex_lock (&to->lock);
+    to->spin_ns = spin_ns > 0 ? spin_ns : 0;
+    to->hold_ns = to->spin_ns / 2;
+    gu_mutex_unlock (&to->lock);
+}
+
+void gu_to_spin_stats (gu_to_t* to, long long* spins, long long* parks)
+{
+    gu_mutex_lock (&to->lock);
+    *spins = to->spins;
+    *parks = to->parks;
+    gu_mutex_unlock (&to->lock);
+}
+
 long gu_to_cancel (gu_to_t *to, gu_seqno_t seqno)
 {
     long         err;
@@ -85,6 +85,20 @@ extern long gu_to_release (gu_to_t* to, gu_seqno_t seqno);
  */
 extern gu_seqno_t gu_to_seqno (gu_to_t* to);
 
+/*! @brief Sets maximum time gu_to_grab() spins before going to sleep.
+ * Actual spin time adapts to observed waiting times.
+ *
+ * @param to A pointer to TO object.
+ * @param spin_ns Maximum spin time in nanoseconds, 0 disables spinning.
+ */
+extern void gu_to_set_spin (gu_to_t* to, long long spin_ns);
+
+/*! @brief Returns the number of waits in gu_to_grab() which were resolved
+ * by spinning and the number of waits which went to sleep.
+ */
+extern void gu_to_spin_stats (gu_to_t* to, long long* spins,
+                              long long* parks);
+
 /*! @brief cancels a TO monitor waiter making it return immediately
  * It is assumed that the caller is currenly holding the TO.
  * The to-be-cancelled waiter can be some later transaction but also
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * Micro benchmark for write set data compression: compression ratio vs.
+ * compression and decompression throughput of every supported algorithm
+ * at several levels, on synthetic row-based replication events and on
+ * JSON documents.
+ *
+ * Usage: compress_bench [buffer size]
+ * (by default buffers of 1K, 16K and 1M are used)
+ */
+
+#include "../src/gu_compress.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <chrono>
+
+using gu::Compression;
+
+/* Something resembling binlog row events: fixed size integer columns with
+ * slowly changing values and short strings from a small dictionary. */
+static std::string
+make_rows(size_t const size)
+{
+    static const char* const words[] =
+        { "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf" };
+    static size_t const n_words(sizeof(words)/sizeof(words[0]));
+
+    std::string ret;
+    ret.reserve(size);
+
+    unsigned long long seed(0x5eed);
+
+    for (unsigned int id(0); ret.size() < size; ++id)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        unsigned char row[32];
+        ::memcpy(row, &id, sizeof(id));
+        ::memset(row + 4, 0, sizeof(row) - 4);
+        row[8]  = static_cast<unsigned char>(seed >> 56);
+        row[9]  = static_cast<unsigned char>(seed >> 48);
+        row[16] = static_cast<unsigned char>(id % 100);
+
+        ret.append(reinterpret_cast<const char*>(row), sizeof(row));
+        ret.append(words[(seed >> 33) % n_words]);
+        ret.append(words[id % n_words]);
+    }
+
+    ret.resize(size);
+    return ret;
+}
+
+static std::string
+make_json(size_t const size)
+{
+    std::ostringstream os;
+
+    for (int i(0); os.tellp() < std::streampos(size); ++i)
+    {
+        os << "{\"id\":" << i << ",\"name\":\"user" << i % 1000
+           << "\",\"email\":\"user" << i % 1000 << "@example.com\""
+           << ",\"active\":" << (i % 3 ? "true" : "false")
+           << ",\"score\":" << (i * 7919) % 10007 << "}\n";
+    }
+
+    std::string ret(os.str());
+    ret.resize(size);
+    return ret;
+}
+
+static void
+one_algorithm(const std::string& src, Compression::Type const type,
+              int const level)
+{
+    size_t const size(src.size());
+    std::vector<char> packed(Compression::bound(type, size));
+    std::vector<char> plain(size);
+
+    /* run over at least 64M of input to get stable numbers */
+    size_t const reps(std::max<size_t>(1, (64 << 20) / size));
+
+    size_t packed_size(0);
+
+    auto const c_start(std::chrono::steady_clock::now());
+    for (size_t r(0); r < reps; ++r)
+    {
+        packed_size = Compression::compress(type, level, src.data(), size,
+                                            packed.data(), packed.size());
+    }
+    auto const c_stop(std::chrono::steady_clock::now());
+
+    if (0 == packed_size) throw std::runtime_error("Compression failed");
+
+    auto const d_start(std::chrono::steady_clock::now());
+    for (size_t r(0); r < reps; ++r)
+    {
+        Compression::decompress(type, packed.data(), packed_size,
+                                plain.data(), plain.size());
+    }
+    auto const d_stop(std::chrono::steady_clock::now());
+
+    if (::memcmp(plain.data(), src.data(), size))
+        throw std::runtime_error("Decompressed data differs");
+
+    double const c_sec(std::chrono::duration<double>(c_stop-c_start).count());
+    double const d_sec(std::chrono::duration<double>(d_stop-d_start).count());
+    double const total(double(size) * reps);
+
+    std::cout << std::left << std::setw(5) << Compression::name(type)
+              << std::right << std::setw(4) << level << '\t'
+              << size << '\t' << packed_size << '\t'
+              << std::fixed << std::setprecision(2)
+              << double(size) / packed_size << '\t'
+              << std::setprecision(3)
+              << total / c_sec / 1.0e9 << '\t'
+              << total / d_sec / 1.0e9 << '\n';
+}
+
+static void
+one_input(const char* const name, const std::string& src)
+{
+    static int const levels[] = { -1, 0, 1, 3, 9 };
+
+    std::cout << "\nInput: " << name
+              << "\nAlg/level:\tBytes:\tPacked:\tRatio:\tC GB/s:\tD GB/s:\n";
+
+    for (int t(Compression::NONE); t <= Compression::MAX_TYPE; ++t)
+    {
+        Compression::Type const type(static_cast<Compression::Type>(t));
+
+        if (!Compression::supported(type)) continue;
+
+        for (size_t l(0); l < sizeof(levels)/sizeof(levels[0]); ++l)
+        {
+            if (Compression::NONE == type && levels[l] != 0) continue;
+
+            one_algorithm(src, type, levels[l]);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    long const size(argc > 1 ? atol(argv[1]) : 0);
+
+    if (size < 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [buffer size]\n";
+        return 1;
+    }
+
+    static size_t const sizes[] = { 1 << 10, 1 << 14, 1 << 20 };
+
+    for (size_t s(0); s < sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        size_t const len(size > 0 ? size : sizes[s]);
+
+        one_input("rows", make_rows(len));
+        one_input("json", make_json(len));
+
+        if (size > 0) break;
+    }
+
+    return 0;
+}
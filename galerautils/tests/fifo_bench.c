@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ *
+ * Micro benchmark for gu_fifo used as GCS slave queue: one producer thread
+ * (GCS receiving thread) and a varying number of consumer threads (appliers)
+ * passing small items through the queue.
+ *
+ * Usage: fifo_bench [items [max consumers]]
+ * (by default 4M items and 1 to 64 consumers)
+ */
+
+#include "../src/galerautils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct
+{
+    gu_fifo_t* q;
+    long       items;
+    long       got;
+    long long  sum;
+} bench_ctx_t;
+
+static void*
+producer (void* arg)
+{
+    bench_ctx_t* const ctx = arg;
+    long i;
+
+    for (i = 0; i < ctx->items; i++)
+    {
+        long* const item = gu_fifo_get_tail (ctx->q);
+        if (NULL == item) abort();
+        *item = i;
+        gu_fifo_push_tail (ctx->q);
+    }
+
+    gu_fifo_close (ctx->q);
+
+    return NULL;
+}
+
+static void*
+consumer (void* arg)
+{
+    bench_ctx_t* const ctx = arg;
+    long      got = 0;
+    long long sum = 0;
+    long*     item;
+    int       err;
+
+    while (NULL != (item = gu_fifo_get_head (ctx->q, &err)))
+    {
+        sum += *item;
+        got++;
+        gu_fifo_pop_head (ctx->q);
+    }
+
+    if (-ENODATA != err) abort();
+
+    ctx->got = got;
+    ctx->sum = sum;
+
+    return NULL;
+}
+
+static double
+now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+static void
+one_run (long const items, int const n_consumers)
+{
+    gu_fifo_t* const q = gu_fifo_create (1 << 16, sizeof(long));
+    bench_ctx_t  prod  = { q, items, 0, 0 };
+    bench_ctx_t  cons[n_consumers];
+    gu_thread_t  cons_thd[n_consumers];
+    gu_thread_t  prod_thd;
+    long         got = 0;
+    long long    sum = 0;
+    int          i;
+
+    if (NULL == q) abort();
+
+    double const start = now();
+
+    for (i = 0; i < n_consumers; i++)
+    {
+        cons[i] = prod;
+        gu_thread_create (NULL, &cons_thd[i], consumer, &cons[i]);
+    }
+
+    gu_thread_create (NULL, &prod_thd, producer, &prod);
+    gu_thread_join (prod_thd, NULL);
+
+    for (i = 0; i < n_consumers; i++)
+    {
+        gu_thread_join (cons_thd[i], NULL);
+        got += cons[i].got;
+        sum += cons[i].sum;
+    }
+
+    double const stop = now();
+
+    if (got != items || sum != (long long)items * (items - 1) / 2)
+    {
+        fprintf (stderr, "Lost items: got %ld of %ld\n", got, items);
+        abort();
+    }
+
+    gu_fifo_destroy (q);
+
+    printf ("%d\t%.3f\n", n_consumers, items / (stop - start) / 1.0e6);
+}
+
+int main (int argc, char* argv[])
+{
+    long const items   = argc > 1 ? atol(argv[1]) : (4L << 20);
+    int  const max_cns = argc > 2 ? atoi(argv[2]) : 64;
+    int  n;
+
+    if (items <= 0 || max_cns <= 0)
+    {
+        fprintf (stderr, "Usage: %s [items [max consumers]]\n", argv[0]);
+        return 1;
+    }
+
+    printf ("Consumers:\tMops/s:\n");
+
+    for (n = 1; n <= max_cns; n *= 2) one_run (items, n);
+
+    return 0;
+}
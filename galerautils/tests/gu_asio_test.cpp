@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2019-2023 Codership Oy <info@codership.com>
+ * Copyright (C) 2019-2024 Codership Oy <info@codership.com>
  */
 
 
@@ -2380,6 +2380,48 @@ START_TEST(test_datagram_write_multicast)
 }
 END_TEST
 
+START_TEST(test_datagram_write_read_batch)
+{
+    gu::AsioIoService io_service;
+    gu::URI uri("udp://127.0.0.1:0");
+    auto socket(io_service.make_datagram_socket(uri));
+    socket->connect(uri);
+
+    // Unicast socket writes to its own address
+    const char* hdrs[3] = { "hdr0", "hdr1", "hdr2" };
+    const char* data = "data";
+    std::vector<std::array<gu::AsioConstBuffer, 2> > cbs(3);
+    for (size_t i(0); i < cbs.size(); ++i)
+    {
+        cbs[i][0] = gu::AsioConstBuffer(hdrs[i], strlen(hdrs[i]));
+        cbs[i][1] = gu::AsioConstBuffer(data, i);
+    }
+    socket->write(cbs);
+
+    char read_bufs[4][16];
+    std::vector<gu::AsioMutableBuffer> mbs;
+    for (size_t i(0); i < 4; ++i)
+    {
+        mbs.push_back(gu::AsioMutableBuffer(read_bufs[i],
+                                            sizeof(read_bufs[i])));
+    }
+    std::vector<size_t> lens;
+    // Loopback datagrams are queued to the receiving socket by the
+    // time write() returns.
+    size_t const n(socket->read(mbs, lens));
+    ck_assert_int_eq(n, 3);
+    for (size_t i(0); i < n; ++i)
+    {
+        ck_assert_int_eq(lens[i], strlen(hdrs[i]) + i);
+        ck_assert(memcmp(read_bufs[i], hdrs[i], strlen(hdrs[i])) == 0);
+        ck_assert(memcmp(read_bufs[i] + strlen(hdrs[i]), data, i) == 0);
+    }
+
+    // Nothing more to read
+    ck_assert_int_eq(socket->read(mbs, lens), 0);
+}
+END_TEST
+
 //
 // Steady timer
 //
@@ -2760,6 +2802,10 @@ Suite* gu_asio_suite()
     tcase_add_test(tc, test_datagram_send_to_and_async_read);
     suite_add_tcase(s, tc);
 
+    tc = tcase_create("test_datagram_write_read_batch");
+    tcase_add_test(tc, test_datagram_write_read_batch);
+    suite_add_tcase(s, tc);
+
     }
 #if defined(GALERA_ASIO_TEST_MULTICAST)
     tc = tcase_create("test_datagram_connect_multicast");
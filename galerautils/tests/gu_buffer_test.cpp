@@ -0,0 +1,129 @@
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+
+#include "gu_buffer.hpp"
+#include "gu_logger.hpp"
+#include "gu_threads.h"
+
+#include "gu_buffer_test.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+START_TEST (pool_recycle)
+{
+    void* const buf0(gu::BufferPool::allocate(100));
+    ck_assert(NULL != buf0);
+    ::memset(buf0, 0xab, 100);
+
+    void* const buf1(gu::BufferPool::allocate(128));
+    ck_assert(NULL != buf1);
+    ck_assert(buf0 != buf1);
+
+    /* 100 and 128 bytes are in the same size class */
+    gu::BufferPool::deallocate(buf0, 100);
+    void* const buf2(gu::BufferPool::allocate(120));
+    ck_assert(buf0 == buf2);
+
+    /* blocks above MAX_SIZE bypass the pool */
+    long long const allocs(gu::BufferPool::heap_allocs());
+    void* const big(gu::BufferPool::allocate(gu::BufferPool::MAX_SIZE + 1));
+    ck_assert(gu::BufferPool::heap_allocs() == allocs + 1);
+    gu::BufferPool::deallocate(big, gu::BufferPool::MAX_SIZE + 1);
+
+    gu::BufferPool::deallocate(buf1, 128);
+    gu::BufferPool::deallocate(buf2, 120);
+
+    /* steady state allocation does not touch heap */
+    long long const before(gu::BufferPool::heap_allocs());
+    for (int i(0); i < 1000; ++i)
+    {
+        gu::Buffer b(200);
+        b.resize(1000);
+    }
+    ck_assert(gu::BufferPool::heap_allocs() - before <= 2);
+}
+END_TEST
+
+START_TEST (shared_buffer)
+{
+    static const gu::byte_t data[] = { 1, 2, 3, 4, 5 };
+
+    gu::SharedBuffer sb0;
+    ck_assert(!sb0);
+    ck_assert(NULL == sb0.get());
+
+    gu::SharedBuffer sb1(gu::make_shared_buffer(data, data + sizeof(data)));
+    ck_assert(sb1);
+    ck_assert(sb1.unique());
+    ck_assert(sb1->size() == sizeof(data));
+    ck_assert(0 == ::memcmp(sb1->data(), data, sizeof(data)));
+
+    sb0 = sb1;
+    ck_assert(!sb1.unique());
+    ck_assert(sb0.get() == sb1.get());
+
+    gu::SharedBuffer sb2(std::move(sb1));
+    ck_assert(!sb1);
+    ck_assert(sb2.get() == sb0.get());
+
+    sb0 = gu::SharedBuffer();
+    ck_assert(sb2.unique());
+
+    gu::Buffer b(data, data + 2);
+    gu::SharedBuffer sb3(gu::make_shared_buffer(std::move(b)));
+    ck_assert(sb3->size() == 2);
+    ck_assert((*sb3)[1] == 2);
+
+    swap(sb2, sb3);
+    ck_assert(sb2->size() == 2);
+    ck_assert(sb3->size() == sizeof(data));
+}
+END_TEST
+
+/* buffers allocated in one thread and released in another */
+static void* release_thread(void* arg)
+{
+    std::vector<gu::SharedBuffer>* const bufs
+        (static_cast<std::vector<gu::SharedBuffer>*>(arg));
+    bufs->clear();
+    return NULL;
+}
+
+START_TEST (cross_thread)
+{
+    for (int round(0); round < 10; ++round)
+    {
+        std::vector<gu::SharedBuffer> bufs;
+
+        for (size_t i(0); i < 1000; ++i)
+        {
+            bufs.push_back(gu::make_shared_buffer(64 + i * 8));
+            (*bufs.back())[0] = gu::byte_t(i);
+        }
+
+        gu_thread_t thd;
+        ck_assert(0 == gu_thread_create(NULL, &thd, release_thread, &bufs));
+        gu_thread_join(thd, NULL);
+
+        ck_assert(bufs.empty());
+    }
+
+    std::ostringstream os;
+    gu::BufferPool::print(os);
+    log_info << os.str();
+}
+END_TEST
+
+Suite *gu_buffer_suite(void)
+{
+    Suite *s = suite_create("gu::Buffer");
+    TCase *tc = tcase_create("gu_buffer");
+
+    suite_add_tcase (s, tc);
+    tcase_add_test(tc, pool_recycle);
+    tcase_add_test(tc, shared_buffer);
+    tcase_add_test(tc, cross_thread);
+
+    return s;
+}
@@ -0,0 +1,209 @@
+// Copyright (C) 2024 Codership Oy <info@codership.com>
+
+#include "../src/gu_compress.hpp"
+#include "../src/gu_exception.hpp"
+
+#include "gu_compress_test.hpp"
+
+#include <vector>
+#include <sstream>
+#include <cstring>
+
+using gu::Compression;
+
+static std::vector<unsigned char>
+sample(size_t const size)
+{
+    std::ostringstream os;
+    for (int i(0); os.tellp() < std::streampos(size); ++i)
+    {
+        os << "INSERT INTO t1 VALUES (" << i << ", 'row " << i % 17 << "');";
+    }
+
+    std::string const str(os.str());
+    return std::vector<unsigned char>(str.begin(), str.begin() + size);
+}
+
+static void
+round_trip(Compression::Type const type, int const level, size_t const size)
+{
+    std::vector<unsigned char> const src(sample(size));
+    std::vector<unsigned char> packed(Compression::bound(type, size));
+
+    size_t const packed_size(Compression::compress(type, level,
+                                                   src.data(), src.size(),
+                                                   packed.data(),
+                                                   packed.size()));
+    ck_assert_msg(packed_size > 0, "%s/%d: compression of %zu bytes failed",
+                  Compression::name(type), level, size);
+
+    if (Compression::NONE != type && size >= 1024)
+    {
+        ck_assert_msg(packed_size < size / 2, "%s/%d: %zu -> %zu",
+                      Compression::name(type), level, size, packed_size);
+    }
+
+    std::vector<unsigned char> plain(size);
+    Compression::decompress(type, packed.data(), packed_size,
+                            plain.data(), plain.size());
+    ck_assert(0 == ::memcmp(plain.data(), src.data(), size));
+
+    /* wrong expected size must be detected */
+    try
+    {
+        Compression::decompress(type, packed.data(), packed_size,
+                                plain.data(), plain.size() - 1);
+        ck_abort_msg("%s: size mismatch not detected",
+                     Compression::name(type));
+    }
+    catch (gu::Exception& e)
+    {
+        ck_assert(EINVAL == e.get_errno());
+    }
+}
+
+START_TEST(round_trips)
+{
+    static int const levels[] = { -1, 0, 1, 3, 9 };
+    static size_t const sizes[] = { 1, 100, 4096, 1 << 20 };
+
+    for (int t(Compression::NONE); t <= Compression::MAX_TYPE; ++t)
+    {
+        Compression::Type const type(static_cast<Compression::Type>(t));
+
+        if (!Compression::supported(type)) continue;
+
+        for (size_t l(0); l < sizeof(levels)/sizeof(levels[0]); ++l)
+        {
+            for (size_t s(0); s < sizeof(sizes)/sizeof(sizes[0]); ++s)
+            {
+                round_trip(type, levels[l], sizes[s]);
+            }
+        }
+    }
+}
+END_TEST
+
+START_TEST(small_output)
+{
+    std::vector<unsigned char> const src(sample(4096));
+    std::vector<unsigned char> dst(16);
+
+    for (int t(Compression::NONE); t <= Compression::MAX_TYPE; ++t)
+    {
+        Compression::Type const type(static_cast<Compression::Type>(t));
+
+        if (!Compression::supported(type)) continue;
+
+        ck_assert(0 == Compression::compress(type, 0, src.data(), src.size(),
+                                             dst.data(), dst.size()));
+    }
+}
+END_TEST
+
+START_TEST(corrupt_input)
+{
+    std::vector<unsigned char> const src(sample(4096));
+
+    for (int t(Compression::LZ4); t <= Compression::MAX_TYPE; ++t)
+    {
+        Compression::Type const type(static_cast<Compression::Type>(t));
+
+        if (!Compression::supported(type)) continue;
+
+        std::vector<unsigned char> packed(Compression::bound(type,src.size()));
+        size_t const packed_size(Compression::compress(type, 0,
+                                                       src.data(), src.size(),
+                                                       packed.data(),
+                                                       packed.size()));
+        ck_assert(packed_size > 0);
+
+        /* truncated input */
+        std::vector<unsigned char> plain(src.size());
+        try
+        {
+            Compression::decompress(type, packed.data(), packed_size / 2,
+                                    plain.data(), plain.size());
+            ck_abort_msg("%s: truncated input not detected",
+                         Compression::name(type));
+        }
+        catch (gu::Exception& e)
+        {
+            ck_assert(EINVAL == e.get_errno());
+        }
+    }
+}
+END_TEST
+
+START_TEST(names)
+{
+    ck_assert(Compression::NONE == Compression::type(std::string("none")));
+    ck_assert(Compression::NONE == Compression::type(std::string("NONE")));
+    ck_assert(Compression::NONE == Compression::type(0));
+
+    for (int t(Compression::NONE); t <= Compression::MAX_TYPE; ++t)
+    {
+        Compression::Type const type(static_cast<Compression::Type>(t));
+        std::string const name(Compression::name(type));
+
+        if (Compression::supported(type))
+        {
+            ck_assert(type == Compression::type(name));
+        }
+        else
+        {
+            try
+            {
+                Compression::type(name);
+                ck_abort_msg("unsupported '%s' accepted", name.c_str());
+            }
+            catch (gu::Exception& e) {}
+        }
+    }
+
+    try
+    {
+        Compression::type(std::string("gzip"));
+        ck_abort_msg("unknown algorithm accepted");
+    }
+    catch (gu::Exception& e)
+    {
+        ck_assert(EINVAL == e.get_errno());
+    }
+
+    try
+    {
+        Compression::type(Compression::MAX_TYPE + 1);
+        ck_abort_msg("unknown type accepted");
+    }
+    catch (gu::Exception& e)
+    {
+        ck_assert(EINVAL == e.get_errno());
+    }
+}
+END_TEST
+
+Suite* gu_compress_suite()
+{
+    Suite* s = suite_create("gu::Compression");
+    TCase* tc;
+
+    tc = tcase_create("round_trips");
+    tcase_add_test(tc, round_trips);
+    tcase_set_timeout(tc, 60);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("small_output");
+    tcase_add_test(tc, small_output);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("corrupt_input");
+    tcase_add_test(tc, corrupt_input);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("names");
+    tcase_add_test(tc, names);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2007-2020 Codership Oy <info@codership.com>
+// Copyright (C) 2007-2024 Codership Oy <info@codership.com>
 
 // $Id$
 
@@ -235,6 +235,119 @@ START_TEST(gu_fifo_cancel_test)
 }
 END_TEST
 
+#define MT_ITEMS     200000L
+#define MT_CONSUMERS 4
+
+struct mt_ctx
+{
+    gu_fifo_t* q;
+    long       got;
+    long       sum;
+};
+
+static void*
+mt_consumer (void* arg)
+{
+    struct mt_ctx* ctx = arg;
+    long*          item;
+    long           prev = -1;
+    int            err;
+
+    while ((item = gu_fifo_get_head (ctx->q, &err))) {
+        /* items must come out in order */
+        ck_assert_msg(*item > prev, "got %ld after %ld", *item, prev);
+        prev = *item;
+        ctx->got++;
+        ctx->sum += *item;
+        gu_fifo_pop_head (ctx->q);
+    }
+
+    ck_assert(-ENODATA == err);
+
+    return NULL;
+}
+
+/* several consumers on a short queue: the queue is constantly full and
+ * wraps around, rows get released and reused while the tail is chasing
+ * the head */
+START_TEST(gu_fifo_mt_test)
+{
+    gu_fifo_t* q = gu_fifo_create (1, sizeof(long)); // shortest possible
+    ck_assert(q != NULL);
+
+    struct mt_ctx ctx[MT_CONSUMERS];
+    gu_thread_t   thd[MT_CONSUMERS];
+    long i;
+
+    for (i = 0; i < MT_CONSUMERS; i++) {
+        ctx[i].q   = q;
+        ctx[i].got = 0;
+        ctx[i].sum = 0;
+        gu_thread_create (NULL, &thd[i], mt_consumer, &ctx[i]);
+    }
+
+    for (i = 0; i < MT_ITEMS; i++) {
+        long* item = gu_fifo_get_tail (q);
+        ck_assert_msg(item != NULL, "could not get item %ld", i);
+        *item = i;
+        gu_fifo_push_tail (q);
+    }
+
+    gu_fifo_close (q);
+
+    long got = 0;
+    long sum = 0;
+
+    for (i = 0; i < MT_CONSUMERS; i++) {
+        gu_thread_join (thd[i], NULL);
+        got += ctx[i].got;
+        sum += ctx[i].sum;
+    }
+
+    ck_assert_msg(got == MT_ITEMS, "got %ld items, expected %ld",
+                  got, MT_ITEMS);
+    ck_assert(sum == MT_ITEMS * (MT_ITEMS - 1) / 2);
+
+    gu_fifo_destroy (q);
+}
+END_TEST
+
+/* queue drained right after the head leaves a row which the tail has just
+ * reached: the row must not be kept, destroy expects no row allocated
+ * for the tail */
+START_TEST(gu_fifo_drain_test)
+{
+    gu_fifo_t* q = gu_fifo_create (2048, sizeof(long));
+    ck_assert(q != NULL);
+
+    long const rounds[] = { 1023, 1025 };
+    long r, i;
+    int  err;
+
+    for (r = 0; r < 2; r++) {
+        for (i = 0; i < rounds[r]; i++) {
+            long* item = gu_fifo_get_tail (q);
+            ck_assert_msg(item != NULL, "could not get item %ld", i);
+            *item = i;
+            gu_fifo_push_tail (q);
+        }
+
+        for (i = 0; i < rounds[r]; i++) {
+            long* item = gu_fifo_get_head (q, &err);
+            ck_assert_msg(item != NULL, "could not get item %ld: %d", i, err);
+            ck_assert(*item == i);
+            gu_fifo_pop_head (q);
+        }
+
+        ck_assert(gu_fifo_length(q) == 0);
+    }
+
+    gu_fifo_close (q);
+    mark_point();
+    gu_fifo_destroy (q);
+}
+END_TEST
+
 Suite *gu_fifo_suite(void)
 {
     Suite *s  = suite_create("Galera FIFO functions");
@@ -243,6 +356,8 @@ Suite *gu_fifo_suite(void)
     suite_add_tcase (s, tc);
     tcase_add_test  (tc, gu_fifo_test);
     tcase_add_test  (tc, gu_fifo_cancel_test);
+    tcase_add_test  (tc, gu_fifo_mt_test);
+    tcase_add_test  (tc, gu_fifo_drain_test);
     tcase_set_timeout(tc, 60);
 
     return s;
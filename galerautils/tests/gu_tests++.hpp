@@ -1,4 +1,4 @@
-// Copyright (C) 2009-2014 Codership Oy <info@codership.com>
+// Copyright (C) 2009-2024 Codership Oy <info@codership.com>
 
 // $Id$
 
@@ -16,6 +16,7 @@
 #include "gu_vlq_test.hpp"
 #include "gu_digest_test.hpp"
 #include "gu_mem_pool_test.hpp"
+#include "gu_buffer_test.hpp"
 #include "gu_alloc_test.hpp"
 #include "gu_rset_test.hpp"
 #include "gu_string_utils_test.hpp"
@@ -30,6 +31,7 @@
 #include "gu_asio_test.hpp"
 #include "gu_deqmap_test.hpp"
 #include "gu_utils_test++.hpp"
+#include "gu_compress_test.hpp"
 
 typedef Suite *(*suite_creator_t)(void);
 
@@ -41,6 +43,7 @@ static suite_creator_t suites[] =
     gu_vlq_suite,
     gu_digest_suite,
     gu_mem_pool_suite,
+    gu_buffer_suite,
     gu_alloc_suite,
     gu_rset_suite,
     gu_string_utils_suite,
@@ -55,6 +58,7 @@ static suite_creator_t suites[] =
     gu_asio_suite,
     gu_deqmap_suite,
     gu_utils_cpp_suite,
+    gu_compress_suite,
     0
 };
 
@@ -69,6 +69,7 @@ cancel_offset (ulong rnd)
 static gu_to_t*   to          = NULL;
 static ulong      thread_max  = 16;    // default number of threads
 static gu_seqno_t seqno_max   = 1<<20; // default number of seqnos to check
+static long long  spin_ns     = 0;     // max spin time before sleeping
 
 /* mutex to synchronize threads start */
 static gu_mutex_t start  = GU_MUTEX_INITIALIZER;
@@ -167,11 +168,12 @@ int main (int argc, char* argv[])
     ulong to_len = cancel(0xffffffff) * cancel_offset(0xffffffff);
 
     errno = 0;
-    if (argc > 1) seqno_max  = (1 << atol(argv[0]));
-    if (argc > 2) thread_max = (1 << atol(argv[1]));
+    if (argc > 1) seqno_max  = (1 << atol(argv[1]));
+    if (argc > 2) thread_max = (1 << atol(argv[2]));
+    if (argc > 3) spin_ns    = atoll(argv[3]);
     if (errno) {
-        fprintf (stderr, "Usage: %s [seqno [threads]]\nBoth seqno and threads"
-                 "are exponents of 2^n.\n", argv[0]);
+        fprintf (stderr, "Usage: %s [seqno [threads [spin_ns]]]\nBoth seqno "
+                 "and threads are exponents of 2^n.\n", argv[0]);
         exit(errno);
     }
     printf ("Starting with %lu threads and %llu maximum seqno.\n",
@@ -183,6 +185,7 @@ int main (int argc, char* argv[])
     to = gu_to_create (to_len, 0);
     if (to != NULL) {
         printf ("Created TO monitor of length %lu\n", to_len);
+        gu_to_set_spin (to, spin_ns);
     }
     else {
         exit (-ENOMEM);
@@ -240,6 +243,12 @@ int main (int argc, char* argv[])
                 thread[0].stat_grabs,   thread[0].stat_fails,
                 thread[0].stat_self, thread[0].stat_cancels
             );
+        {
+            long long spins, parks;
+            gu_to_spin_stats (to, &spins, &parks);
+            printf ("Spins:          %9lld\n"
+                    "Parks:          %9lld\n", spins, parks);
+        }
         if (seqno_max !=
             (thread[0].stat_grabs+thread[0].stat_fails+thread[0].stat_self)) {
             fprintf (stderr, "Error: total number of grabbed, failed and "
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * Micro benchmark for hash functions used in record set checksums and
+ * gu::FastHash: MMH3 (in one go and by parts, the way RecordSetOut appends
+ * records), Spooky and gu_fast_hash128(). CRC32C is included for reference.
+ *
+ * Usage: hash_bench [part size]
+ * (by default parts of 33 and 250 bytes are used for MMH3 streaming)
+ */
+
+#include "../src/gu_crc32c.h"
+#include "../src/gu_hash.h"
+#include "../src/gu_digest.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <stdexcept>
+#include <chrono>
+
+static std::vector<unsigned char> data(1<<21 /* 2M */);
+
+// Initialize data
+static class Setup
+{
+public:
+    Setup()
+    {
+        for (size_t i(0); i < data.size(); ++i)
+        {
+            data[i] = static_cast<unsigned char>(i);
+        }
+    }
+}
+    setup;
+
+static const size_t align_loop(sizeof(uint64_t));
+
+enum Alg
+{
+    CRC32C,
+    MMH128,
+    MMH128_PARTS,
+    SPOOKY128,
+    FAST128
+};
+
+static const char* const alg_names[] =
+{
+    "CRC32C     ",
+    "MMH128     ",
+    "MMH128 part",
+    "Spooky128  ",
+    "FastHash128"
+};
+
+static uint64_t
+hash_once(Alg const alg, const unsigned char* const buf, size_t const len,
+          size_t const part)
+{
+    uint64_t res[2] = { 0, 0 };
+
+    switch (alg)
+    {
+    case CRC32C:
+        res[0] = gu_crc32c(buf, len);
+        break;
+    case MMH128:
+        gu_mmh128(buf, len, res);
+        break;
+    case MMH128_PARTS:
+    {
+        gu::MMH3 h;
+        size_t off(0);
+        for (; off + part < len; off += part) h.append(buf + off, part);
+        h.append(buf + off, len - off);
+        res[0] = h.gather8();
+        break;
+    }
+    case SPOOKY128:
+        gu_spooky128(buf, len, res);
+        break;
+    case FAST128:
+        gu_fast_hash128(buf, len, res);
+        break;
+    }
+
+    return res[0];
+}
+
+static uint64_t
+run_bench(Alg const alg, size_t const len, size_t const reps,
+          size_t const part)
+{
+    if ((data.size() - len) < align_loop)
+        throw std::out_of_range("Too long message");
+
+    uint64_t ret(0);
+
+    for (size_t r(0); r < reps; ++r)
+        for (size_t i(0); i < align_loop; ++i)
+        {
+            // roll data window over the buffer to give equal chance to
+            // different alignments
+            ret += hash_once(alg, &data[i], len, part);
+        }
+
+    return ret;
+}
+
+static void
+one_length(size_t const len, size_t const reps, size_t const part)
+{
+    std::cout << "\nImpl:      \tBytes:\tGB/s:\tResult:\n";
+
+    for (int a(CRC32C); a <= FAST128; ++a)
+    {
+        Alg const alg(static_cast<Alg>(a));
+
+        (void)hash_once(alg, &data[0], len, part); // warm up
+
+        auto const start(std::chrono::steady_clock::now());
+        uint64_t const result(run_bench(alg, len, reps, part));
+        auto const stop(std::chrono::steady_clock::now());
+        double const sec(std::chrono::duration<double>(stop - start).count());
+
+        std::cout << alg_names[a] << '\t' << len << '\t'
+                  << std::fixed << std::setprecision(3)
+                  << double(len) * reps * align_loop / sec / 1.0e9 << '\t'
+                  << std::hex << result << std::dec << '\n';
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    long const part(argc > 1 ? atol(argv[1]) : 0);
+
+    if (part < 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [part size]\n";
+        return 1;
+    }
+
+    gu_crc32c_configure();
+
+    static size_t const parts[] = { 33, 250 };
+
+    for (size_t p(0); p < sizeof(parts)/sizeof(parts[0]); ++p)
+    {
+        size_t const ps(part > 0 ? part : parts[p]);
+
+        std::cout << "\nMMH128 part size: " << ps << '\n';
+
+        one_length(11,     1<<22 /* 4M   */, ps);
+        one_length(64,     1<<20 /* 1M   */, ps);
+        one_length(512,    1<<17 /* 128K */, ps);
+        one_length(16384,  1<<12 /* 4K   */, ps);
+        one_length(1<<20,  64,               ps);
+
+        if (part > 0) break;
+    }
+
+    return 0;
+}
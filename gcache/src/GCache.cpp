@@ -16,6 +16,10 @@ namespace gcache
     void
     GCache::reset()
     {
+        CacheLock lock(*this);
+
+        reclaim_pending = 0;
+
         mem.reset();
         rb.reset();
         ps.reset();
@@ -62,11 +66,18 @@ namespace gcache
         config    (cfg),
         params    (config, data_dir),
         mtx       (gu::get_mutex_key(gu::GU_MUTEX_KEY_GCACHE)),
+        free_queue(),
+        reclaim_cond(gu::get_cond_key(gu::GU_COND_KEY_GCACHE)),
+        reclaim_thr(),
+        reclaim_pending(0),
+        reclaim_since(0),
+        reclaim_stop(false),
         seqno2ptr (SEQNO_NONE),
         gid       (),
         mem       (params.mem_size(), seqno2ptr, params.debug()),
         rb        (pcb, params.rb_name(), params.rb_size(), seqno2ptr, gid,
-                   params.debug(), recover_rb(encrypt_cb, params.recover())),
+                   params.debug(), recover_rb(encrypt_cb, params.recover()),
+                   params.recover_threads(), params.mmap_opts()),
         ps        (params.dir_name(),
                    encrypt_cb,
                    app_ctx,
@@ -75,7 +86,8 @@ namespace gcache
                    params.keep_plaintext_size(),
                    params.debug(),
                    /* keep last page if PS is the only storage */
-                   !((params.mem_size() + params.rb_size()) > 0)),
+                   !((params.mem_size() + params.rb_size()) > 0),
+                   params.mmap_opts()),
         mallocs   (0),
         reallocs  (0),
         frees     (0),
@@ -88,11 +100,26 @@ namespace gcache
 #ifndef NDEBUG
         ,buf_tracker()
 #endif
-    {}
+    {
+        int const err(gu_thread_create(
+                          gu::get_thread_key(gu::GU_THREAD_KEY_GCACHE_RECLAIM),
+                          &reclaim_thr, reclaim_thread, this));
+        if (0 != err)
+        {
+            gu_throw_error(err) << "Failed to create gcache reclaim thread";
+        }
+    }
 
     GCache::~GCache ()
     {
-        gu::Lock lock(mtx);
+        {
+            gu::Lock lock(mtx);
+            reclaim_stop = true;
+            reclaim_cond.signal();
+        }
+        gu_thread_join(reclaim_thr, NULL);
+
+        CacheLock lock(*this);
         log_debug << "\n" << "GCache mallocs : " << mallocs
                   << "\n" << "GCache reallocs: " << reallocs
                   << "\n" << "GCache frees   : " << frees;
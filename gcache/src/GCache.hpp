@@ -6,6 +6,7 @@
 #define __GCACHE_H__
 
 #include "gcache_seqno.hpp"
+#include "gcache_free_queue.hpp"
 #include "gcache_mem_store.hpp"
 #include "gcache_rb_store.hpp"
 #include "gcache_page_store.hpp"
@@ -239,6 +240,15 @@ namespace gcache
         /* prints out buffer metadata */
         std::string meta(const void* ptr);
 
+        /*!
+         * Background reclaim statistics:
+         * bytes - amount of released buffers requested to be discarded,
+         * pages - number of deleted pages which files are yet to be removed,
+         * lag   - how long (ns) the oldest of these requests has been pending.
+         */
+        void reclaim_stats(long long& bytes, long long& pages, long long& lag)
+            const;
+
         static size_t const PREAMBLE_LEN;
 
     private:
@@ -247,6 +257,34 @@ namespace gcache
 
         void free_common (BufferHeader*, const void*);
 
+        /* completes frees queued by free(), must be called under mtx */
+        void free_queued ();
+
+        /* Page store cleanup requested by malloc() is done by reclaim
+         * thread. If it falls behind by more than this, malloc() resorts
+         * to discarding buffers by itself. */
+        static size_t const RECLAIM_PENDING_MAX = 1 << 26;
+
+        /* requests reclaim thread to discard size bytes of released buffers,
+         * must be called under mtx */
+        void reclaim_request (size_t size);
+
+        /* reclaim thread main loop */
+        void reclaim ();
+        static void* reclaim_thread (void* arg);
+
+        /* locks mtx and brings the stores up to date with queued frees */
+        class CacheLock
+        {
+        public:
+            explicit CacheLock(GCache& gc) : lock_(gc.mtx)
+            {
+                gc.free_queued();
+            }
+        private:
+            gu::Lock lock_;
+        };
+
         gu::Config&     config;
 
         class Params
@@ -267,6 +305,8 @@ namespace gcache
             size_t keep_plaintext_size() const { return keep_plaintext_size_;}
             int    debug()               const { return debug_;           }
             bool   recover()             const { return recover_;         }
+            int    recover_threads()     const { return recover_threads_; }
+            const gu::MMap::Options& mmap_opts() const { return mmap_opts_; }
 
             void mem_size        (size_t s) { mem_size_        = s; }
             void page_size       (size_t s) { page_size_       = s; }
@@ -287,10 +327,18 @@ namespace gcache
             size_t            keep_plaintext_size_;
             int               debug_;
             bool        const recover_;
+            int         const recover_threads_;
+            gu::MMap::Options const mmap_opts_;
         }
             params;
 
         gu::Mutex       mtx;
+        FreeQueue       free_queue; // buffers freed without taking mtx
+        gu::Cond        reclaim_cond;
+        gu_thread_t     reclaim_thr;
+        size_t          reclaim_pending; // bytes to discard in background
+        long long       reclaim_since;   // when reclaim_pending became > 0
+        bool            reclaim_stop;
 
         seqno2ptr_t     seqno2ptr;
         gu::UUID        gid;
@@ -4,6 +4,8 @@
 
 #include "GCache.hpp"
 
+#include <gu_time.h>
+
 #include <cassert>
 
 namespace gcache
@@ -146,6 +148,81 @@ namespace gcache
         return discard<>(cond);
     }
 
+    void
+    GCache::reclaim_request (size_t const size)
+    {
+        assert(mtx.locked() && mtx.owned());
+
+        if (gu_unlikely(reclaim_pending > RECLAIM_PENDING_MAX))
+        {
+            /* backpressure: reclaim thread does not keep up */
+            discard_size(size);
+            return;
+        }
+
+        if (0 == reclaim_pending) reclaim_since = gu_time_monotonic();
+        reclaim_pending += size;
+        reclaim_cond.signal();
+    }
+
+    void
+    GCache::reclaim ()
+    {
+        /* discard in batches to let malloc() in between */
+        static size_t const batch(1 << 20);
+
+        for (;;)
+        {
+            gu::Lock lock(mtx);
+
+            while (0 == reclaim_pending && !reclaim_stop)
+            {
+                lock.wait(reclaim_cond);
+            }
+
+            if (reclaim_stop) return;
+
+            free_queued();
+
+            size_t const size(std::min(reclaim_pending, batch));
+
+            if (discard_size(size) && reclaim_pending > size &&
+                ps.page_cleanup_needed())
+            {
+                reclaim_pending -= size;
+            }
+            else
+            {
+                /* done, or there is nothing released to discard at the
+                 * moment - next malloc() will renew the request */
+                reclaim_pending = 0;
+            }
+        }
+    }
+
+    void*
+    GCache::reclaim_thread (void* arg)
+    {
+        static_cast<GCache*>(arg)->reclaim();
+        return NULL;
+    }
+
+    void
+    GCache::reclaim_stats (long long& bytes, long long& pages, long long& lag)
+        const
+    {
+        {
+            gu::Lock lock(mtx);
+            bytes = reclaim_pending;
+            lag   = reclaim_pending > 0 ?
+                gu_time_monotonic() - reclaim_since : 0;
+        }
+
+        pages = ps.reclaim_queue();
+        long long const pages_lag(ps.reclaim_lag());
+        if (pages_lag > lag) lag = pages_lag;
+    }
+
     void
     GCache::discard_tail (seqno_t const seqno)
     {
@@ -173,12 +250,12 @@ namespace gcache
         {
             size_type const size(BH_size(s));
 
-            gu::Lock lock(mtx);
+            CacheLock lock(*this);
 
             bool const page_cleanup(ps.page_cleanup_needed());
             /* try to discard twice as much as being allocated in order to
              * eventually delete some pages */
-            if (page_cleanup) discard_size(2*size);
+            if (page_cleanup) reclaim_request(2*size);
 
             mallocs++;
 
@@ -250,12 +327,31 @@ namespace gcache
         rb.assert_size_free();
     }
 
+    void
+    GCache::free_queued ()
+    {
+        assert(mtx.locked() && mtx.owned());
+
+        const void* ptr;
+
+        while (NULL != (ptr = free_queue.pop()))
+        {
+            free_common(get_BH(ptr), ptr);
+        }
+    }
+
     void
     GCache::free (void* ptr)
     {
         if (gu_likely(0 != ptr))
         {
-            gu::Lock lock(mtx);
+            /* The buffer will be released by the next mtx holder. All methods
+             * that depend on released state take CacheLock, so there is no
+             * visible difference for the caller, other than free() not
+             * having to wait for the mutex. Debug logging wants it inline. */
+            if (gu_likely(0 == params.debug() && free_queue.push(ptr))) return;
+
+            CacheLock lock(*this);
             BufferHeader* const bh(get_BH(ptr));
 #ifndef NDEBUG
             assert(bh->store == BUFFER_IN_PAGE || !encrypt_cache);
@@ -326,7 +422,7 @@ namespace gcache
         if (!encrypt_cache)
         {
             /* with non-encrypted cache we may try in-store realloc() */
-            gu::Lock lock(mtx);
+            CacheLock lock(*this);
             new_ptr = store->realloc(ptr, size);
             ptx = new_ptr;
         }
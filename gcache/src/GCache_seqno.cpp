@@ -19,7 +19,7 @@ namespace gcache
     void
     GCache::seqno_reset (const gu::GTID& gtid)
     {
-        gu::Lock lock(mtx);
+        CacheLock lock(*this);
 
         assert(seqno2ptr.empty() || seqno_max == seqno2ptr.index_back());
 
@@ -183,7 +183,7 @@ namespace gcache
 
         while(loop)
         {
-            gu::Lock lock(mtx);
+            CacheLock lock(*this);
 
             if (seqno < seqno_released || seqno >= seqno_locked)
             {
@@ -320,7 +320,7 @@ namespace gcache
     const void* GCache::seqno_get_ptr (seqno_t const seqno_g,
                                        ssize_t&      size)
     {
-        gu::Lock lock(mtx);
+        CacheLock lock(*this);
 
         const void* const ptr(seqno2ptr.at(seqno_g));
         assert (ptr);
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/*! @file bounded lock-free queue of buffers freed without holding cache
+ *        mutex */
+
+#ifndef __GCACHE_FREE_QUEUE__
+#define __GCACHE_FREE_QUEUE__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace gcache
+{
+    /*!
+     * GCache::free() pushes buffers here instead of taking GCache mutex.
+     * Any number of threads may push concurrently, but only the current
+     * holder of GCache mutex pops, so there is at most one consumer at a time.
+     * This is a bounded queue with per-cell sequence numbers (D. Vyukov),
+     * push() fails when it is full and the caller must then free the buffer
+     * under the mutex.
+     */
+    class FreeQueue
+    {
+    public:
+
+        static size_t const SIZE = 1024; // must be a power of 2
+
+        FreeQueue() : cells_(), pad0_(), tail_(0), pad1_(), head_(0)
+        {
+            for (size_t i(0); i < SIZE; ++i)
+            {
+                cells_[i].seq_.store(i, std::memory_order_relaxed);
+                cells_[i].ptr_ = NULL;
+            }
+        }
+
+        /*! @return false if the queue is full */
+        bool push(const void* const ptr)
+        {
+            size_t pos(tail_.load(std::memory_order_relaxed));
+
+            for (;;)
+            {
+                Cell& c(cells_[pos & (SIZE - 1)]);
+                size_t const seq(c.seq_.load(std::memory_order_acquire));
+                intptr_t const dif(intptr_t(seq) - intptr_t(pos));
+
+                if (0 == dif)
+                {
+                    if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                    std::memory_order_relaxed))
+                    {
+                        c.ptr_ = ptr;
+                        c.seq_.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /*! Must be called only under GCache mutex.
+         *  @return NULL if there is nothing (yet) published in the queue */
+        const void* pop()
+        {
+            Cell& c(cells_[head_ & (SIZE - 1)]);
+
+            if (c.seq_.load(std::memory_order_acquire) != head_ + 1)
+                return NULL;
+
+            const void* const ret(c.ptr_);
+            c.seq_.store(head_ + SIZE, std::memory_order_release);
+            ++head_;
+
+            return ret;
+        }
+
+    private:
+
+        struct Cell
+        {
+            std::atomic<size_t> seq_;
+            const void*         ptr_;
+        };
+
+        Cell                cells_[SIZE];
+        // keep producers and the consumer on separate cache lines
+        char                pad0_[64];
+        std::atomic<size_t> tail_;
+        char                pad1_[64];
+        size_t              head_;
+
+        FreeQueue(const FreeQueue&);
+        FreeQueue& operator=(const FreeQueue&);
+    };
+}
+
+#endif /* __GCACHE_FREE_QUEUE__ */
@@ -100,10 +100,11 @@ gcache::Page::Page (void*              ps,
                     const EncKey&      key,
                     const Nonce&       nonce,
                     size_t size,
-                    int dbg)
+                    int dbg,
+                    const gu::MMap::Options& mmap_opts)
     :
     fd_   (name, aligned_size(size), true, false),
-    mmap_ (fd_),
+    mmap_ (fd_, false, mmap_opts),
     key_  (key),
     nonce_(nonce),
     ps_   (ps),
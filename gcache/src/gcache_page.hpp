@@ -57,7 +57,8 @@ namespace gcache
               const EncKey&      key,
               const Nonce&       nonce,
               size_t             size,
-              int                dbg);
+              int                dbg,
+              const gu::MMap::Options& mmap_opts = gu::MMap::Options());
 
         ~Page () {}
 
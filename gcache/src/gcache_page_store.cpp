@@ -10,10 +10,12 @@
 
 #include <gu_logger.hpp>
 #include <gu_throw.hpp>
+#include <gu_thread_keys.hpp>
+
+#include <gu_time.h>
 
 #include <cstdio>
 #include <cstring>
-#include <pthread.h>
 
 #include <iomanip>
 
@@ -47,33 +49,20 @@ make_page_name (const std::string& base_name, size_t count)
     return os.str();
 }
 
-static void*
-remove_file (void* __restrict__ arg)
+static void
+remove_file (const std::string& file_name)
 {
-    char* const file_name (static_cast<char*>(arg));
-
-    if (NULL != file_name)
+    if (remove (file_name.c_str()))
     {
-        if (remove (file_name))
-        {
-            int err = errno;
-
-            log_error << "Failed to remove page file '" << file_name << "': "
-                      << err << " (" << strerror(err) << ")";
-        }
-        else
-        {
-            log_info << "Deleted page " << file_name;
-        }
+        int err = errno;
 
-        free (file_name);
+        log_error << "Failed to remove page file '" << file_name << "': "
+                  << err << " (" << strerror(err) << ")";
     }
     else
     {
-        log_error << "Null file name in " << __FUNCTION__;
+        log_info << "Deleted page " << file_name;
     }
-
-    pthread_exit(NULL);
 }
 
 bool
@@ -85,31 +74,81 @@ gcache::PageStore::delete_page ()
 
     pages_.pop_front();
 
-    char* const file_name(strdup(page->name().c_str()));
-
     total_size_ -= page->size();
 
     if (current_ == page) current_ = 0;
 
-    delete page;
+    Reclaim const r = { page, gu_time_monotonic() };
 
-#ifdef GCACHE_DETACH_THREAD
-    pthread_t delete_thr_;
-#else
-    if (delete_thr_ != pthread_t(-1)) pthread_join (delete_thr_, NULL);
-#endif /* GCACHE_DETACH_THERAD */
+    gu::Lock lock(reclaim_mtx_);
 
-    int err = pthread_create (&delete_thr_, &delete_page_attr_, remove_file,
-                              file_name);
-    if (0 != err)
+    while (reclaim_queue_.size() >= RECLAIM_QUEUE_MAX)
     {
-        delete_thr_ = pthread_t(-1);
-        gu_throw_error(err) << "Failed to create page file deletion thread";
+        lock.wait(reclaim_cond_);
     }
 
+    reclaim_queue_.push_back(r);
+    reclaim_cond_.broadcast();
+
     return true;
 }
 
+void
+gcache::PageStore::reclaim ()
+{
+    for (;;)
+    {
+        Reclaim r;
+        {
+            gu::Lock lock(reclaim_mtx_);
+
+            while (reclaim_queue_.empty() && !reclaim_stop_)
+            {
+                lock.wait(reclaim_cond_);
+            }
+
+            /* stop only when all queued pages are deleted */
+            if (reclaim_queue_.empty()) return;
+
+            /* leave it in the queue until it is gone to account for lag */
+            r = reclaim_queue_.front();
+        }
+
+        std::string const file_name(r.page_->name());
+
+        delete r.page_; /* unmaps and closes the file */
+
+        remove_file(file_name);
+
+        gu::Lock lock(reclaim_mtx_);
+
+        reclaim_queue_.pop_front();
+        reclaim_cond_.broadcast();
+    }
+}
+
+void*
+gcache::PageStore::reclaim_thread (void* arg)
+{
+    static_cast<PageStore*>(arg)->reclaim();
+    return NULL;
+}
+
+size_t
+gcache::PageStore::reclaim_queue () const
+{
+    gu::Lock lock(reclaim_mtx_);
+    return reclaim_queue_.size();
+}
+
+long long
+gcache::PageStore::reclaim_lag () const
+{
+    gu::Lock lock(reclaim_mtx_);
+    return reclaim_queue_.empty() ?
+        0 : gu_time_monotonic() - reclaim_queue_.front().queued_;
+}
+
 /* Deleting pages only from the beginning kinda means that some free pages
  * can be locked in the middle for a while. Leaving it like that for simplicity
  * for now. */
@@ -149,7 +188,8 @@ gcache::PageStore::new_page (size_type const size, const Page::EncKey& new_key)
                               new_key,
                               nonce_,
                               page_size_ > min_size ? page_size_ : min_size,
-                              debug_));
+                              debug_,
+                              mmap_opts_));
 
     pages_.push_back (page);
     total_size_ += page->size();
@@ -202,7 +242,8 @@ gcache::PageStore::PageStore (const std::string&       dir_name,
                               size_t             const page_size,
                               size_t             const keep_plaintext_size,
                               int                const dbg,
-                              bool               const keep_page)
+                              bool               const keep_page,
+                              const gu::MMap::Options& mmap_opts)
     :
     base_name_ (make_base_name(dir_name)),
     encrypt_cb_(encrypt_cb),
@@ -216,39 +257,33 @@ gcache::PageStore::PageStore (const std::string&       dir_name,
     pages_     (),
     current_   (0),
     total_size_(0),
+    plain_     (),
+    plain_free_(),
     enc2plain_ (),
     plaintext_size_(0),
-    delete_page_attr_(),
-#ifndef GCACHE_DETACH_THREAD
-    delete_thr_(pthread_t(-1)),
-#endif /* GCACHE_DETACH_THREAD */
+    reclaim_mtx_  (gu::get_mutex_key(gu::GU_MUTEX_KEY_GCACHE_PAGE_RECLAIM)),
+    reclaim_cond_ (gu::get_cond_key(gu::GU_COND_KEY_GCACHE_PAGE_RECLAIM)),
+    reclaim_queue_(),
+    reclaim_thr_  (),
+    reclaim_stop_ (false),
+    mmap_opts_ (mmap_opts),
     debug_     (dbg & DEBUG),
     keep_page_ (keep_page)
 {
-    int err = pthread_attr_init (&delete_page_attr_);
-
+    int const err(gu_thread_create(
+                      gu::get_thread_key(gu::GU_THREAD_KEY_GCACHE_RECLAIM),
+                      &reclaim_thr_, reclaim_thread, this));
     if (0 != err)
     {
-        gu_throw_error(err) << "Failed to initialize page file deletion "
-                            << "thread attributes";
+        gu_throw_error(err) << "Failed to create page reclaim thread";
     }
-
-#ifdef GCACHE_DETACH_THREAD
-    err = pthread_attr_setdetachstate (&delete_page_attr_,
-                                       PTHREAD_CREATE_DETACHED);
-    if (0 != err)
-    {
-        pthread_attr_destroy (&delete_page_attr_);
-        gu_throw_error(err) << "Failed to set DETACHED attribute to "
-                            << "page file deletion thread";
-    }
-#endif /* GCACHE_DETACH_THREAD */
 }
 
 void
 gcache::PageStore::Plain::print(std::ostream& os) const
 {
     os << "Page: "      << page_
+       << ", ptr: "     << ptr_
        << ", ptx: "     << static_cast<void*>(ptx_)
        << ", BH: "      << &bh_
        << ", alloc'd: " << alloc_size_
@@ -264,11 +299,12 @@ gcache::PageStore::~PageStore ()
     {
         int unflushed(0);
         int unfreed(0);
-        for (PlainMap::iterator i(enc2plain_.begin()); i != enc2plain_.end();
+        for (std::deque<Plain>::iterator i(plain_.begin()); i != plain_.end();
              ++i)
         {
-            unflushed += i->second.changed_;
-            unfreed   += i->second.ptx_ != NULL;
+            if (NULL == i->ptr_) continue;
+            unflushed += i->changed_;
+            unfreed   += i->ptx_ != NULL;
         }
 
         if (unflushed > 0)
@@ -277,10 +313,10 @@ gcache::PageStore::~PageStore ()
                       << enc2plain_.size();
             if (debug_)
             {
-                for (PlainMap::iterator i(enc2plain_.begin());
-                     i != enc2plain_.end(); ++i)
+                for (std::deque<Plain>::iterator i(plain_.begin());
+                     i != plain_.end(); ++i)
                 {
-                    if (i->second.changed_) { log_error << i->second; }
+                    if (i->ptr_ && i->changed_) { log_error << *i; }
                 }
             }
         }
@@ -291,10 +327,10 @@ gcache::PageStore::~PageStore ()
                       << enc2plain_.size();
             if (debug_)
             {
-                for (PlainMap::iterator i(enc2plain_.begin());
-                     i != enc2plain_.end(); ++i)
+                for (std::deque<Plain>::iterator i(plain_.begin());
+                     i != plain_.end(); ++i)
                 {
-                    if (i->second.ptx_ != NULL) { log_error << i->second; }
+                    if (i->ptr_ && i->ptx_ != NULL) { log_error << *i; }
                 }
             }
         }
@@ -302,17 +338,14 @@ gcache::PageStore::~PageStore ()
         assert(!(unflushed || unfreed));
     }
 
-    try
-    {
-        while (pages_.size() && delete_page()) {};
-#ifndef GCACHE_DETACH_THREAD
-        if (delete_thr_ != pthread_t(-1)) pthread_join (delete_thr_, NULL);
-#endif /* GCACHE_DETACH_THREAD */
-    }
-    catch (gu::Exception& e)
+    while (pages_.size() && delete_page()) {};
+
     {
-        log_error << e.what() << " in ~PageStore()"; // abort() ?
+        gu::Lock lock(reclaim_mtx_);
+        reclaim_stop_ = true;
+        reclaim_cond_.broadcast();
     }
+    gu_thread_join(reclaim_thr_, NULL);
 
     if (page_cleanup_needed())
     {
@@ -338,8 +371,6 @@ gcache::PageStore::~PageStore ()
         delete *i;
     }
     pages_.clear();
-
-    pthread_attr_destroy (&delete_page_attr_);
 }
 
 inline void*
@@ -403,6 +434,7 @@ gcache::PageStore::malloc (size_type const size, void*& ptx)
         {
             assert(alloc_size > 0);
             Plain plain = {
+                ret,         // ptr_
                 current_,    // page_
                 bh,          // ptx_
                 *bh,         // bh_
@@ -412,8 +444,23 @@ gcache::PageStore::malloc (size_type const size, void*& ptx)
                 false        // freed_
             };
 
-            if (gu_unlikely(!enc2plain_.insert(PlainMapEntry(ret,plain)).second))
+            uint32_t slot;
+            if (plain_free_.empty())
             {
+                slot = uint32_t(plain_.size());
+                plain_.push_back(plain);
+            }
+            else
+            {
+                slot = plain_free_.back();
+                plain_free_.pop_back();
+                plain_[slot] = plain;
+            }
+
+            if (gu_unlikely(!enc2plain_.insert(ret, slot)))
+            {
+                plain_[slot].ptr_ = NULL;
+                plain_free_.push_back(slot);
                 delete bh;
                 gu_throw_fatal << "Failed to insert plaintext ctx. Map size: "
                                << enc2plain_.size();
@@ -463,18 +510,19 @@ gcache::PageStore::realloc (void* ptr, size_type const size)
     return NULL; // fallback to malloc()/memcpy()/free()
 }
 
-gcache::PageStore::PlainMap::iterator
+gcache::PageStore::Plain&
 gcache::PageStore::find_plaintext(const void* const ptr)
 {
     assert(encrypt_cb_); // must be called only if encryption callback is set
 
-    PlainMap::iterator i(enc2plain_.find(ptr));
-    if (enc2plain_.end() == i)
+    const uint32_t* const slot(enc2plain_.find(ptr));
+    if (NULL == slot)
     {
         assert(0); // this sohuld not happen unless ptr was discarded
         gu_throw_fatal << "Internal program error: plaintext context not found.";
     }
-    return i;
+    assert(plain_[*slot].ptr_ == ptr);
+    return plain_[*slot];
 }
 
 void*
@@ -482,10 +530,7 @@ gcache::PageStore::get_plaintext(const void* ptr, bool const writable)
 {
     assert(encrypt_cb_); // must be called only if encryption callback is set
 
-    PlainMap::iterator const i(find_plaintext(ptr));
-    assert(i->first == ptr);
-
-    Plain& p(i->second);
+    Plain& p(find_plaintext(ptr));
     assert(p.page_);
     assert(!writable || !p.freed_); // should not change freed buffer
 
@@ -516,13 +561,11 @@ gcache::PageStore::get_plaintext(const void* ptr, bool const writable)
 }
 
 void
-gcache::PageStore::drop_plaintext(PlainMap::iterator const i,
+gcache::PageStore::drop_plaintext(Plain&             p,
                                   const void*        const ptr,
                                   bool               const free)
 {
-    assert(i->first == ptr);
-
-    Plain& p(i->second);
+    assert(p.ptr_ == ptr);
     assert(p.page_);
 
     if (p.ref_count_ > 0)
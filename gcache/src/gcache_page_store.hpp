@@ -10,12 +10,15 @@
 #include "gcache_memops.hpp"
 #include "gcache_page.hpp"
 #include "gcache_seqno.hpp"
+#include "gcache_ptr_index.hpp"
 
 #include <gu_macros.hpp> // GU_COMPILE_ASSERT
+#include <gu_lock.hpp>
+#include <gu_threads.h>
 
 #include <string>
 #include <deque>
-#include <map>
+#include <vector>
 #include <type_traits> // std::is_standard_layout
 #include <cstddef> // offsetof
 
@@ -34,7 +37,8 @@ namespace gcache
                    size_t             page_size,
                    size_t             plaintext_size,
                    int                dbg,
-                   bool               keep_page);
+                   bool               keep_page,
+                   const gu::MMap::Options& mmap_opts = gu::MMap::Options());
 
         ~PageStore ();
 
@@ -64,7 +68,7 @@ namespace gcache
         BufferHeader* get_BH(const void* const ptr, bool change = false)
         {
             assert(encrypt_cb_);
-            Plain& p(find_plaintext(ptr)->second);
+            Plain& p(find_plaintext(ptr));
             p.changed_ = p.changed_ || change;
             return &(p.bh_);
         }
@@ -95,6 +99,12 @@ namespace gcache
 
         void  set_debug(int dbg);
 
+        /* number of deleted pages waiting for reclaim thread */
+        size_t    reclaim_queue() const;
+
+        /* how long (ns) the oldest page has been waiting for reclaim thread */
+        long long reclaim_lag()   const;
+
         /* for unit tests */
         size_t count()       const { return count_;        }
         size_t total_pages() const { return pages_.size(); }
@@ -102,13 +112,14 @@ namespace gcache
 
         void meta(const void* const ptr, std::ostream& os)
         {
-            os << find_plaintext(ptr)->second;
+            os << find_plaintext(ptr);
         }
 
     private:
 
         struct Plain
         {
+            const void*   ptr_;        /* ciphertext, NULL if slot is free */
             Page*         page_;       /* page containing ciphertext */
             BufferHeader* ptx_;        /* corresponding plaintext buffer */
             BufferHeader  bh_;         /* plaintex copy of buffer header */
@@ -124,8 +135,6 @@ namespace gcache
             { p.print(os); return os; }
         };
 
-        typedef std::pair<const void*, Plain> PlainMapEntry;
-
         std::string const base_name_; /* /.../.../gcache.page. */
         wsrep_encrypt_cb_t const encrypt_cb_;
         void* const       app_ctx_;   /* context for encryption callback */
@@ -139,13 +148,28 @@ namespace gcache
         PageQueue         pages_;
         Page*             current_;
         size_t            total_size_;
-        typedef std::map<const void*, Plain> PlainMap;
-        PlainMap          enc2plain_;
+        /* Plain records live in stable slots, ciphertext pointers are mapped
+         * to slot numbers, free slots are reused */
+        std::deque<Plain> plain_;
+        std::vector<uint32_t> plain_free_;
+        PtrIndex          enc2plain_;
         size_t            plaintext_size_; /* how much plaintext allocated */
-        pthread_attr_t    delete_page_attr_;
-#ifndef GCACHE_DETACH_THREAD
-        pthread_t         delete_thr_;
-#endif /* GCACHE_DETACH_THREAD */
+        /* Deleted pages are unmapped and their files removed by reclaim
+         * thread. Queue length is bounded, delete_page() blocks when it is
+         * full, so that page files can't accumulate on disk unnoticed. */
+        static size_t const RECLAIM_QUEUE_MAX = 8;
+        struct Reclaim
+        {
+            Page*         page_;
+            long long     queued_;    /* gu_time_monotonic() when queued */
+        };
+        typedef std::deque<Reclaim> ReclaimQueue;
+        gu::Mutex         reclaim_mtx_;
+        gu::Cond          reclaim_cond_;
+        ReclaimQueue      reclaim_queue_;
+        gu_thread_t       reclaim_thr_;
+        bool              reclaim_stop_;
+        gu::MMap::Options const mmap_opts_; /* for new pages */
         int               debug_;
         bool        const keep_page_; /* whether to keep the last page */
 
@@ -154,26 +178,38 @@ namespace gcache
         // returns true if a page could be deleted
         bool delete_page ();
 
+        // reclaim thread main loop
+        void reclaim     ();
+        static void* reclaim_thread (void* arg);
+
         // cleans up extra pages.
         void cleanup     ();
 
         void* malloc_new (size_type size);
 
-        PlainMap::iterator find_plaintext(const void* ptr);
+        Plain& find_plaintext(const void* ptr);
 
         /* shared functionality for public drop_palintext() and free() */
-        void drop_plaintext(PlainMap::iterator i, const void* ptr, bool free);
+        void drop_plaintext(Plain& p, const void* ptr, bool free);
 
-        void discard_plaintext(PlainMap::iterator i)
+        void discard_plaintext(Plain& p)
         {
-#ifndef NDEBUG
-            Plain& p(i->second);
             assert(p.freed_);
             assert(0     == p.ref_count_);
             assert(false == p.changed_);
             assert(NULL  == p.ptx_);
-#endif
-            enc2plain_.erase(i);
+
+            uint32_t slot;
+            if (gu_likely(enc2plain_.erase(p.ptr_, slot)))
+            {
+                assert(&plain_[slot] == &p);
+                p.ptr_ = NULL;
+                plain_free_.push_back(slot);
+            }
+            else
+            {
+                assert(0);
+            }
         }
 
         template <bool Discard> void
@@ -195,9 +231,9 @@ namespace gcache
 
                 if (encrypt_cb_)
                 {
-                    PlainMap::iterator const i(find_plaintext(ptr));
-                    drop_plaintext(i, ptr, true);
-                    if (dis) discard_plaintext(i);
+                    Plain& p(find_plaintext(ptr));
+                    drop_plaintext(p, ptr, true);
+                    if (dis) discard_plaintext(p);
                 }
             }
 
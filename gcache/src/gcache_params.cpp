@@ -24,6 +24,14 @@ static const std::string GCACHE_DEFAULT_DEBUG     ("0");
 #endif
 static const std::string GCACHE_PARAMS_RECOVER    ("gcache.recover");
 static const std::string GCACHE_DEFAULT_RECOVER   ("yes");
+static const std::string GCACHE_PARAMS_RECOVER_THREADS ("gcache.recover_threads");
+static const std::string GCACHE_DEFAULT_RECOVER_THREADS("4");
+static const std::string GCACHE_PARAMS_HUGE_PAGES ("gcache.huge_pages");
+static const std::string GCACHE_DEFAULT_HUGE_PAGES("no");
+static const std::string GCACHE_PARAMS_POPULATE   ("gcache.populate");
+static const std::string GCACHE_DEFAULT_POPULATE  ("no");
+static const std::string GCACHE_PARAMS_NUMA_NODE  ("gcache.numa_node");
+static const std::string GCACHE_DEFAULT_NUMA_NODE ("-1");
 
 const std::string&
 gcache::GCache::PARAMS_DIR                 (GCACHE_PARAMS_DIR);
@@ -50,6 +58,14 @@ gcache::GCache::Params::register_params(gu::Config& cfg)
 #endif
     cfg.add(GCACHE_PARAMS_RECOVER, GCACHE_DEFAULT_RECOVER,
             gu::Config::Flag::read_only | gu::Config::Flag::type_bool);
+    cfg.add(GCACHE_PARAMS_RECOVER_THREADS, GCACHE_DEFAULT_RECOVER_THREADS,
+            gu::Config::Flag::read_only | gu::Config::Flag::type_integer);
+    cfg.add(GCACHE_PARAMS_HUGE_PAGES, GCACHE_DEFAULT_HUGE_PAGES,
+            gu::Config::Flag::read_only | gu::Config::Flag::type_bool);
+    cfg.add(GCACHE_PARAMS_POPULATE, GCACHE_DEFAULT_POPULATE,
+            gu::Config::Flag::read_only | gu::Config::Flag::type_bool);
+    cfg.add(GCACHE_PARAMS_NUMA_NODE, GCACHE_DEFAULT_NUMA_NODE,
+            gu::Config::Flag::read_only | gu::Config::Flag::type_integer);
 }
 
 static const std::string
@@ -76,6 +92,25 @@ name_value (gu::Config& cfg, const std::string& data_dir)
     return rb_name;
 }
 
+static gu::MMap::Options
+mmap_options (gu::Config& cfg)
+{
+    gu::MMap::Options opts;
+
+    opts.huge_pages = cfg.get<bool>(GCACHE_PARAMS_HUGE_PAGES);
+    opts.populate   = cfg.get<bool>(GCACHE_PARAMS_POPULATE);
+    opts.numa_node  = cfg.get<int>(GCACHE_PARAMS_NUMA_NODE);
+
+    if (opts.numa_node < -1)
+    {
+        gu_throw_error(EINVAL) << "'" << GCACHE_PARAMS_NUMA_NODE
+                               << "' must be a node number or -1: "
+                               << opts.numa_node;
+    }
+
+    return opts;
+}
+
 gcache::GCache::Params::Params (gu::Config& cfg, const std::string& data_dir)
     :
     rb_name_  (name_value (cfg, data_dir)),
@@ -90,8 +125,16 @@ gcache::GCache::Params::Params (gu::Config& cfg, const std::string& data_dir)
 #else
     debug_    (0),
 #endif
-    recover_  (cfg.get<bool>(GCACHE_PARAMS_RECOVER))
+    recover_  (cfg.get<bool>(GCACHE_PARAMS_RECOVER)),
+    recover_threads_(cfg.get<int>(GCACHE_PARAMS_RECOVER_THREADS)),
+    mmap_opts_(mmap_options(cfg))
 {
+    if (recover_threads_ < 0)
+    {
+        gu_throw_error(EINVAL) << "'" << GCACHE_PARAMS_RECOVER_THREADS
+                               << "' can't be negative: " << recover_threads_;
+    }
+
     try
     {
         keep_plaintext_size_ = cfg.get<size_t>
@@ -174,7 +217,15 @@ gcache::GCache::param_set (const std::string& key, const std::string& val)
         params.keep_plaintext_size(tmp_size);
         ps.set_keep_plaintext_size(params.keep_plaintext_size());
     }
-    else if (key == GCACHE_PARAMS_RECOVER)
+    else if (key == GCACHE_PARAMS_HUGE_PAGES ||
+             key == GCACHE_PARAMS_POPULATE   ||
+             key == GCACHE_PARAMS_NUMA_NODE)
+    {
+        gu_throw_error(EPERM) << "Can't change memory mapping options in "
+            "runtime.";
+    }
+    else if (key == GCACHE_PARAMS_RECOVER ||
+             key == GCACHE_PARAMS_RECOVER_THREADS)
     {
         gu_throw_error(EINVAL) << "'" << key
                                << "' has a meaning only on startup.";
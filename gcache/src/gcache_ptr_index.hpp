@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/*! @file hash table mapping buffer pointers to integer indices */
+
+#ifndef __GCACHE_PTR_INDEX__
+#define __GCACHE_PTR_INDEX__
+
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace gcache
+{
+    /*!
+     * Open addressing hash table with linear probing and backward shift
+     * deletion, so that neither insertion nor removal allocates memory except
+     * when the table grows. Keys are buffer pointers, which are at least
+     * 16-byte aligned and never NULL.
+     */
+    class PtrIndex
+    {
+    public:
+
+        PtrIndex() : cells_(MIN_SIZE), size_(0) {}
+
+        size_t size() const { return size_; }
+
+        /*! @return false if the key is already there */
+        bool insert(const void* const key, uint32_t const val)
+        {
+            assert(key);
+
+            if ((size_ + 1) * 4 > cells_.size() * 3) grow();
+
+            size_t i(slot(key));
+
+            for (; cells_[i].key_; i = (i + 1) & mask())
+            {
+                if (cells_[i].key_ == key) return false;
+            }
+
+            cells_[i].key_ = key;
+            cells_[i].val_ = val;
+            ++size_;
+
+            return true;
+        }
+
+        /*! @return pointer to the value or NULL if the key is not there */
+        const uint32_t* find(const void* const key) const
+        {
+            for (size_t i(slot(key)); cells_[i].key_; i = (i + 1) & mask())
+            {
+                if (cells_[i].key_ == key) return &cells_[i].val_;
+            }
+
+            return NULL;
+        }
+
+        /*! @return false if the key is not there, otherwise its value in val */
+        bool erase(const void* const key, uint32_t& val)
+        {
+            size_t i(slot(key));
+
+            for (; cells_[i].key_ != key; i = (i + 1) & mask())
+            {
+                if (!cells_[i].key_) return false;
+            }
+
+            val = cells_[i].val_;
+
+            /* shift back the following cells which would not be found
+             * otherwise */
+            for (size_t j(i);;)
+            {
+                j = (j + 1) & mask();
+
+                if (!cells_[j].key_) break;
+
+                size_t const k(slot(cells_[j].key_));
+
+                if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+
+                cells_[i] = cells_[j];
+                i = j;
+            }
+
+            cells_[i].key_ = NULL;
+            --size_;
+
+            return true;
+        }
+
+    private:
+
+        static size_t const MIN_SIZE = 1024; // must be a power of 2
+
+        struct Cell
+        {
+            Cell() : key_(NULL), val_(0) {}
+            const void* key_;
+            uint32_t    val_;
+        };
+
+        std::vector<Cell> cells_;
+        size_t            size_;
+
+        size_t mask() const { return cells_.size() - 1; }
+
+        size_t slot(const void* const key) const
+        {
+            uint64_t const h((uint64_t(uintptr_t(key)) >> 4) *
+                             0x9e3779b97f4a7c15ULL);
+            return size_t(h ^ (h >> 32)) & mask();
+        }
+
+        void grow()
+        {
+            std::vector<Cell> old(cells_.size() * 2);
+            old.swap(cells_);
+
+            for (size_t i(0); i < old.size(); ++i)
+            {
+                if (old[i].key_)
+                {
+                    size_t j(slot(old[i].key_));
+                    while (cells_[j].key_) j = (j + 1) & mask();
+                    cells_[j] = old[i];
+                }
+            }
+        }
+    };
+}
+
+#endif /* __GCACHE_PTR_INDEX__ */
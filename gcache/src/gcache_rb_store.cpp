@@ -12,9 +12,16 @@
 #include <gu_progress.hpp>
 #include <gu_hexdump.hpp>
 #include <gu_hash.h>
+#include <gu_lock.hpp>
+#include <gu_limits.h>
+#include <gu_thread_keys.hpp>
+
+#include <sys/mman.h>
 
 #include <cassert>
+#include <cstring>
 #include <iostream> // std::cerr
+#include <vector>
 
 namespace gcache
 {
@@ -26,6 +33,7 @@ namespace gcache
     void
     RingBuffer::reset()
     {
+        ckpt_ = NULL; // will be set again by the first allocation
         write_preamble(false);
 
         for (seqno2ptr_iter_t i = seqno2ptr_.begin(); i != seqno2ptr_.end(); ++i)
@@ -57,17 +65,20 @@ namespace gcache
                             seqno2ptr_t&       seqno2ptr,
                             gu::UUID&          gid,
                             int const          dbg,
-                            bool const         recover)
+                            bool const         recover,
+                            int const          recover_threads,
+                            const gu::MMap::Options& mmap_opts)
     :
         pcb_       (pcb),
         fd_        (name, check_size(size)),
-        mmap_      (fd_),
+        mmap_      (fd_, false, mmap_opts),
         preamble_  (static_cast<char*>(mmap_.ptr)),
         header_    (reinterpret_cast<int64_t*>(preamble_ + PREAMBLE_LEN)),
         start_     (reinterpret_cast<uint8_t*>(header_   + HEADER_LEN)),
         end_       (reinterpret_cast<uint8_t*>(preamble_ + mmap_.size)),
         first_     (start_),
         next_      (first_),
+        ckpt_      (NULL),
         seqno2ptr_ (seqno2ptr),
         gid_       (gid),
         size_cache_(end_ - start_ - sizeof(BufferHeader)),
@@ -77,6 +88,7 @@ namespace gcache
 //        mallocs_   (0),
 //        reallocs_  (0),
         debug_     (dbg & DEBUG),
+        recover_threads_(recover_threads),
         open_      (true)
     {
         assert((uintptr_t(start_) % MemOps::ALIGNMENT) == 0);
@@ -255,6 +267,7 @@ namespace gcache
 
     found_space:
         assert((uintptr_t(ret) % MemOps::ALIGNMENT) == 0);
+        checkpoint(ret, ret + size_next);
         size_used_ += alloc_size;
         assert (size_used_ <= size_cache_);
         assert (size_free_ >= alloc_size);
@@ -536,6 +549,9 @@ namespace gcache
 
         if (next_ > first_ && first_ > start_) BH_clear(BH_cast(start_));
         /* this is needed to avoid rescanning from start_ on recovery */
+
+        ckpt_ = first_;
+        write_preamble(false);
     }
 
     void
@@ -585,6 +601,11 @@ namespace gcache
                 os << PR_KEY_SEQNO_MAX << ' ' << SEQNO_ILL << '\n';
             }
         }
+        else if (ckpt_)
+        {
+            /* lets recovery skip searching for the first segment after crash */
+            os << PR_KEY_OFFSET << ' ' << ckpt_ - preamble << '\n';
+        }
 
         os << PR_KEY_SYNCED << ' ' << synced << '\n';
         os << '\n';
@@ -599,6 +620,41 @@ namespace gcache
         mmap_.sync(preamble_, copy_len);
     }
 
+    void
+    RingBuffer::checkpoint(const uint8_t* const alloc_begin,
+                           const uint8_t* const alloc_end)
+    {
+        /* ckpt_ is valid as long as the header chain starting from it is
+         * intact, so it must be dropped before the allocation overwrites it.
+         * A new one is set only when there is enough free space ahead of
+         * next_, so that preamble is synced at most twice per
+         * size_cache_/CKPT_GAP bytes allocated, even when the cache is full. */
+        static size_t const CKPT_GAP(8);
+
+        if (ckpt_)
+        {
+            /* ckpt_ == first_ only if the cache is empty and the new buffer
+             * header will be written right at it */
+            if (ckpt_ >= alloc_begin && ckpt_ < alloc_end && ckpt_ != first_)
+            {
+                ckpt_ = NULL;
+                write_preamble(false);
+            }
+        }
+        else
+        {
+            size_t const gap(alloc_end <= first_ ?
+                             size_t(first_ - alloc_end) :
+                             size_t(end_ - alloc_end) + (first_ - start_));
+
+            if (gap >= size_cache_ / CKPT_GAP)
+            {
+                ckpt_ = first_;
+                write_preamble(false);
+            }
+        }
+    }
+
     void
     RingBuffer::open_preamble(bool const do_recover)
     {
@@ -681,6 +737,7 @@ namespace gcache
             }
         }
 
+        ckpt_ = first_;
         write_preamble(false);
     }
 
@@ -709,6 +766,166 @@ namespace gcache
         ProgressCallback* pcb_;
     };
 
+    /* Reads ring buffer file ahead of the recovery scan in several threads,
+     * so that the scan, which has to follow the chain of buffer headers in one
+     * thread, mostly finds the pages already in memory instead of faulting
+     * them in one by one. The area is split into chunks in the order of the
+     * scan: from the given position to the end and then from the start. */
+    class ScanPrefetch
+    {
+    public:
+
+        ScanPrefetch(uint8_t* const start, uint8_t* const end,
+                     uint8_t* const from,  int threads)
+            :
+            mtx_    (gu::get_mutex_key(gu::GU_MUTEX_KEY_GCACHE)),
+            cond_   (gu::get_cond_key(gu::GU_COND_KEY_GCACHE)),
+            thds_   (),
+            start_  (start),
+            size_   (end - start),
+            from_   (from - start),
+            chunks_ ((size_ + CHUNK - 1) / CHUNK),
+            next_   (0),
+            scanned_(0),
+            done_   (0),
+            notify_ (CHUNK),
+            stop_   (false),
+            sink_   (0)
+        {
+            /* with one chunk there is nothing to read ahead of the scan */
+            if (chunks_ < 2) threads = 0;
+            if (size_t(threads) > chunks_) threads = chunks_;
+
+            thds_.reserve(threads);
+
+            for (int i(0); i < threads; ++i)
+            {
+                gu_thread_t thd;
+                int const err(gu_thread_create(
+                                  gu::get_thread_key(
+                                      gu::GU_THREAD_KEY_GCACHE_RECOVER),
+                                  &thd, run, this));
+                if (err)
+                {
+                    log_warn << "Failed to start GCache recovery thread: "
+                             << err << " (" << ::strerror(err) << ')';
+                    break;
+                }
+                thds_.push_back(thd);
+            }
+        }
+
+        ~ScanPrefetch()
+        {
+            {
+                gu::Lock lock(mtx_);
+                stop_ = true;
+                cond_.broadcast();
+            }
+
+            for (size_t i(0); i < thds_.size(); ++i)
+            {
+                gu_thread_join(thds_[i], NULL);
+            }
+        }
+
+        /* called by the scan for every byte range it has passed */
+        void advance(size_t const amount)
+        {
+            done_ += amount;
+
+            if (gu_unlikely(done_ >= notify_ && !thds_.empty()))
+            {
+                notify_ = (done_ / CHUNK + 1) * CHUNK;
+
+                gu::Lock lock(mtx_);
+                scanned_ = done_ / CHUNK;
+                cond_.broadcast();
+            }
+        }
+
+        size_t threads() const { return thds_.size(); }
+
+    private:
+
+        static size_t const CHUNK  = 1 << 26; // 64M
+        static size_t const WINDOW = 16;      // max chunks ahead of the scan
+
+        gu::Mutex                mtx_;
+        gu::Cond                 cond_;
+        std::vector<gu_thread_t> thds_;
+        uint8_t*           const start_;
+        size_t             const size_;
+        size_t             const from_;
+        size_t             const chunks_;
+        size_t                   next_;    // next chunk to read, under mtx_
+        size_t                   scanned_; // chunks passed by scan, under mtx_
+        size_t                   done_;    // bytes passed by scan
+        size_t                   notify_;  // when to update scanned_
+        bool                     stop_;
+        mutable volatile uint8_t sink_;    // to keep page reads
+
+        /* touch every page in the chunk, wrapping over the end of the area */
+        void read_chunk(size_t const chunk) const
+        {
+            size_t const page(GU_PAGE_SIZE);
+            size_t const begin(chunk * CHUNK);
+            size_t const end(begin + CHUNK < size_ ? begin + CHUNK : size_);
+
+            for (size_t off(begin); off < end;)
+            {
+                size_t const pos((from_ + off) % size_);
+                size_t const len(end - off < size_ - pos ?
+                                 end - off : size_ - pos);
+                uint8_t* const ptr(start_ + pos);
+                uint8_t* const ptr_aligned(reinterpret_cast<uint8_t*>(
+                                               uintptr_t(ptr) & ~(page - 1)));
+
+                /* hint the kernel to start asynchronous read of the whole
+                 * range, then wait for it page by page */
+                ::madvise(ptr_aligned, ptr + len - ptr_aligned,MADV_WILLNEED);
+
+                uint8_t sum(0);
+                for (size_t i(0); i < len; i += page) sum += ptr[i];
+                sink_ = sum;
+
+                off += len;
+            }
+        }
+
+        void read_ahead()
+        {
+            for (;;)
+            {
+                size_t chunk;
+                {
+                    gu::Lock lock(mtx_);
+
+                    while (!stop_ && next_ < chunks_ &&
+                           next_ >= scanned_ + WINDOW)
+                    {
+                        lock.wait(cond_);
+                    }
+
+                    if (stop_ || next_ >= chunks_) return;
+
+                    chunk = next_++;
+                }
+
+                read_chunk(chunk);
+            }
+        }
+
+        static void* run(void* arg)
+        {
+            static_cast<ScanPrefetch*>(arg)->read_ahead();
+            return NULL;
+        }
+
+        ScanPrefetch(const ScanPrefetch&);
+        ScanPrefetch& operator=(const ScanPrefetch&);
+    };
+
     seqno_t
     RingBuffer::scan(off_t const offset, int const scan_step)
     {
@@ -739,6 +956,13 @@ namespace gcache
                                          "GCache::RingBuffer initial scan",
                                          " bytes", end_ - start_, 1<<22/*4Mb*/);
 
+        ScanPrefetch prefetch(start_, end_, segment_start, recover_threads_);
+        if (prefetch.threads() > 0)
+        {
+            log_info << "GCache::RingBuffer initial scan: reading ahead in "
+                     << prefetch.threads() << " threads";
+        }
+
         while (segment_scans < 2)
         {
             segment_scans++;
@@ -755,6 +979,7 @@ namespace gcache
 #define GCACHE_SCAN_ADVANCE(amount)             \
             ptr += amount;                      \
             progress.update(amount);            \
+            prefetch.advance(amount);           \
             bh = BH_cast(ptr);                  \
             bh_offset = BH_offset(bh);
 
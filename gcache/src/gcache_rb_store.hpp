@@ -29,7 +29,9 @@ namespace gcache
                     seqno2ptr_t&       seqno2ptr,
                     gu::UUID&          gid,
                     int                dbg,
-                    bool               recover);
+                    bool               recover,
+                    int                recover_threads,
+                    const gu::MMap::Options& mmap_opts = gu::MMap::Options());
 
         ~RingBuffer ();
 
@@ -169,6 +171,7 @@ namespace gcache
         uint8_t*     const end_;      // first byte after cache area
         uint8_t*           first_;    // pointer to the first (oldest) buffer
         uint8_t*           next_;     // pointer to the next free space
+        uint8_t*           ckpt_;     // recovery checkpoint (or NULL)
 
         seqno2ptr_t&       seqno2ptr_;
         gu::UUID&          gid_;
@@ -179,6 +182,7 @@ namespace gcache
         size_t             size_trail_;
 
         int                debug_;
+        int          const recover_threads_;
 
         bool               open_;
 
@@ -195,6 +199,8 @@ namespace gcache
         static std::string const PR_KEY_SYNCED;
 
         void          write_preamble(bool synced);
+        void          checkpoint(const uint8_t* alloc_begin,
+                                 const uint8_t* alloc_end);
         void          open_preamble(bool recover);
         void          close_preamble();
 
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to compare throughput of encrypted and plaintext page store.
+ * Each writeset is allocated, written, assigned a seqno, freed (which
+ * flushes plaintext to page in encrypted case) and then read back once by
+ * seqno, like IST sender would do, before it is released. Encryption is done
+ * by gcache_test_encrypt_cb().
+ *
+ * Usage: gcache_enc_bench [total [size]]
+ * (by default runs with 128, 1K and 16K writesets)
+ */
+
+#include "GCache.hpp"
+#include "gcache_test_encryption.hpp"
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+
+#define BENCH_CACHE "gcache_enc_bench.cache"
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+static void run(long const total, int const size, bool const enc)
+{
+    gu::Config conf;
+    gcache::GCache::register_params(conf);
+    conf.parse("gcache.name = " BENCH_CACHE "; gcache.size = 0; "
+               "gcache.page_size = 64M; gcache.keep_pages_size = 256M");
+
+    ::unlink(BENCH_CACHE); // start with clean history
+
+    gcache::GCache gc(NULL, conf, "",
+                      enc ? gcache_test_encrypt_cb : NULL, NULL);
+
+    static const char key[] = "0123456789abcdef";
+    wsrep_enc_key_t const enc_key = { key, sizeof(key) - 1 };
+    if (enc) gc.set_enc_key(enc_key);
+
+    long const batch(256);
+    struct timeval tv_begin, tv_end;
+
+    gettimeofday(&tv_begin, NULL);
+
+    for (gcache::seqno_t g(1); g + batch - 1 <= total;)
+    {
+        for (long b(0); b < batch; ++b, ++g)
+        {
+            void* ptx;
+            void* const ptr(gc.malloc(size, ptx));
+            if (!ptr) abort();
+            ::memset(ptx, int(g), size);
+            gc.seqno_assign(ptr, g, 0, false);
+            gc.free(ptr);
+        }
+
+        gc.seqno_lock(g - batch);
+
+        for (gcache::seqno_t s(g - batch); s < g; ++s)
+        {
+            ssize_t len;
+            const void* const ptr(gc.seqno_get_ptr(s, len));
+            const void* const ptx(gc.get_ro_plaintext(ptr));
+            if (static_cast<const char*>(ptx)[0] != char(s)) abort();
+            gc.drop_plaintext(ptr);
+            gc.free(const_cast<void*>(ptr));
+        }
+
+        gc.seqno_unlock();
+
+        gc.seqno_release(g - 1);
+    }
+
+    gettimeofday(&tv_end, NULL);
+
+    double const sec(time_diff(tv_end, tv_begin));
+    long   const ops(total / batch * batch);
+
+    std::cout << std::setw(10) << (enc ? "encrypted" : "plain")
+              << std::setw(10) << size
+              << std::setw(14) << ops / sec
+              << std::setw(12) << double(ops) * size / sec / (1 << 20)
+              << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    long const total(argc > 1 ? atol(argv[1]) : 200000);
+    int  const size (argc > 2 ? atoi(argv[2]) : 0);
+
+    if (total <= 0 || size < 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [total [size]]\n";
+        return 1;
+    }
+
+    std::cout << std::setprecision(4)
+              << std::setw(10) << "store"
+              << std::setw(10) << "size"
+              << std::setw(14) << "writesets/s"
+              << std::setw(12) << "MB/s" << '\n';
+
+    static int const sizes[] = { 128, 1024, 16384 };
+
+    for (size_t i(0); i < sizeof(sizes)/sizeof(sizes[0]); ++i)
+    {
+        int const s(size > 0 ? size : sizes[i]);
+        run(total, s, false);
+        run(total, s, true);
+        if (size > 0) break;
+    }
+
+    ::unlink(BENCH_CACHE);
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+#include "GCache.hpp"
+#include "gcache_bh.hpp"
+#include "gcache_free_queue_test.hpp"
+
+#include <gu_threads.h>
+
+#include <sched.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace gcache;
+
+static const char* const CACHE_NAME = "free_queue_test.cache";
+
+START_TEST(queue_full)
+{
+    FreeQueue q;
+
+    ck_assert(NULL == q.pop());
+
+    for (size_t i(1); i <= FreeQueue::SIZE; ++i)
+    {
+        ck_assert(q.push(reinterpret_cast<const void*>(i)));
+    }
+    ck_assert(!q.push(reinterpret_cast<const void*>(FreeQueue::SIZE + 1)));
+
+    ck_assert(reinterpret_cast<const void*>(1) == q.pop());
+    ck_assert(q.push(reinterpret_cast<const void*>(FreeQueue::SIZE + 1)));
+    ck_assert(!q.push(reinterpret_cast<const void*>(FreeQueue::SIZE + 2)));
+
+    for (size_t i(2); i <= FreeQueue::SIZE + 1; ++i)
+    {
+        ck_assert(reinterpret_cast<const void*>(i) == q.pop());
+    }
+    ck_assert(NULL == q.pop());
+}
+END_TEST
+
+static size_t const PRODUCERS = 4;
+static size_t const PUSHES    = 100000;
+
+struct ProducerArg
+{
+    FreeQueue* q;
+    size_t     id;
+    size_t     full; // number of times the queue was found full
+};
+
+extern "C" void* producer_thread(void* arg)
+{
+    ProducerArg* const pa(static_cast<ProducerArg*>(arg));
+
+    for (size_t i(0); i < PUSHES; ++i)
+    {
+        /* 0 is not a valid pointer to push */
+        uintptr_t const val(pa->id * PUSHES + i + 1);
+        while (!pa->q->push(reinterpret_cast<const void*>(val)))
+        {
+            ++pa->full;
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/* Concurrent producers and a single consumer: every pushed value must be
+ * popped exactly once and in push order of each producer. */
+START_TEST(queue_concurrent)
+{
+    FreeQueue q;
+
+    std::vector<ProducerArg> args(PRODUCERS);
+    std::vector<gu_thread_t> thds(PRODUCERS);
+
+    for (size_t i(0); i < PRODUCERS; ++i)
+    {
+        ProducerArg const pa = { &q, i, 0 };
+        args[i] = pa;
+        ck_assert(0 == gu_thread_create(NULL, &thds[i], producer_thread,
+                                        &args[i]));
+    }
+
+    std::vector<size_t> next(PRODUCERS, 0);
+    for (size_t popped(0); popped < PRODUCERS * PUSHES; )
+    {
+        const void* const ptr(q.pop());
+        if (NULL == ptr) { sched_yield(); continue; }
+
+        uintptr_t const val(reinterpret_cast<uintptr_t>(ptr) - 1);
+        size_t const    id(val / PUSHES);
+        ck_assert(id < PRODUCERS);
+        ck_assert_msg(val % PUSHES == next[id], "producer %zu: expected %zu, "
+                      "got %zu", id, next[id], size_t(val % PUSHES));
+        ++next[id];
+        ++popped;
+    }
+
+    for (size_t i(0); i < PRODUCERS; ++i) gu_thread_join(thds[i], NULL);
+
+    ck_assert(NULL == q.pop());
+}
+END_TEST
+
+/* 1M ring buffer, everything that does not fit goes to 1M pages */
+static void cache_conf(gu::Config& conf)
+{
+    GCache::register_params(conf);
+    conf.parse(std::string("gcache.name = ") + CACHE_NAME +
+               "; gcache.size = 1M; gcache.page_size = 1M; "
+               "gcache.keep_pages_size = 0");
+}
+
+static size_t const BUF_SIZE = 400;
+static size_t const BUFS     = 2048; // fills most of the ring buffer
+
+static void fill(GCache& gc, std::vector<void*>& bufs)
+{
+    bufs.resize(BUFS);
+    for (size_t i(0); i < BUFS; ++i)
+    {
+        void* ptx;
+        bufs[i] = gc.malloc(BUF_SIZE, ptx);
+        ck_assert(NULL != bufs[i]);
+        ck_assert_msg(BUFFER_IN_RB == ptr2BH(bufs[i])->store,
+                      "buffer %zu is not in ring buffer", i);
+    }
+}
+
+/* half of the ring buffer can be allocated only if freed buffers were
+ * returned to it */
+static void check_rb_free(GCache& gc)
+{
+    void* ptx;
+    void* const ptr(gc.malloc(400 << 10, ptx));
+    ck_assert(NULL != ptr);
+    ck_assert_msg(BUFFER_IN_RB == ptr2BH(ptr)->store,
+                  "ring buffer space was not freed");
+    gc.free(ptr);
+}
+
+struct FreeArg
+{
+    GCache* gc;
+    void**  bufs;
+    size_t  n;
+};
+
+extern "C" void* free_thread(void* arg)
+{
+    FreeArg* const fa(static_cast<FreeArg*>(arg));
+    for (size_t i(0); i < fa->n; ++i) fa->gc->free(fa->bufs[i]);
+    return NULL;
+}
+
+/* More concurrent frees than fit into the queue: the ones that don't fit
+ * take the mutex and drain the queue. The rest is drained before malloc()
+ * looks for space. */
+START_TEST(cache_concurrent_free)
+{
+    ::unlink(CACHE_NAME);
+    {
+        gu::Config conf;
+        cache_conf(conf);
+        GCache gc(NULL, conf, "");
+
+        std::vector<void*> bufs;
+        fill(gc, bufs);
+        ck_assert(BUFS > FreeQueue::SIZE);
+
+        size_t const threads(4);
+        std::vector<FreeArg>     args(threads);
+        std::vector<gu_thread_t> thds(threads);
+        for (size_t i(0); i < threads; ++i)
+        {
+            FreeArg const fa = { &gc, &bufs[i * BUFS/threads], BUFS/threads };
+            args[i] = fa;
+            ck_assert(0 == gu_thread_create(NULL, &thds[i], free_thread,
+                                            &args[i]));
+        }
+        for (size_t i(0); i < threads; ++i) gu_thread_join(thds[i], NULL);
+
+        check_rb_free(gc);
+    }
+    ::unlink(CACHE_NAME);
+}
+END_TEST
+
+/* Buffers freed by the caller are queued, seqno_release() must complete
+ * those frees before it releases the rest in seqno order. */
+START_TEST(cache_seqno_release)
+{
+    ::unlink(CACHE_NAME);
+    {
+        gu::Config conf;
+        cache_conf(conf);
+        GCache gc(NULL, conf, "");
+        gc.seqno_reset(gu::GTID(gu::UUID(NULL, 0), SEQNO_NONE));
+
+        std::vector<void*> bufs;
+        fill(gc, bufs);
+        for (size_t i(0); i < BUFS; ++i)
+        {
+            gc.seqno_assign(bufs[i], i + 1, 0, false);
+        }
+
+        /* fits into the queue */
+        size_t const freed(FreeQueue::SIZE / 2);
+        for (size_t i(0); i < freed; ++i) gc.free(bufs[i]);
+
+        gc.seqno_release(BUFS);
+
+        for (size_t i(0); i < BUFS; ++i)
+        {
+            ck_assert_msg(BH_is_released(ptr2BH(bufs[i])),
+                          "seqno %zu not released", i + 1);
+        }
+
+        check_rb_free(gc);
+    }
+    ::unlink(CACHE_NAME);
+}
+END_TEST
+
+/* reset() must not leave queued frees to be applied to reset stores */
+START_TEST(cache_reset)
+{
+    ::unlink(CACHE_NAME);
+    {
+        gu::Config conf;
+        cache_conf(conf);
+        GCache gc(NULL, conf, "");
+
+        std::vector<void*> bufs;
+        fill(gc, bufs);
+        for (size_t i(0); i < FreeQueue::SIZE / 2; ++i) gc.free(bufs[i]);
+
+        gc.reset();
+
+        fill(gc, bufs);
+        for (size_t i(0); i < BUFS; ++i) gc.free(bufs[i]);
+        check_rb_free(gc);
+    }
+    ::unlink(CACHE_NAME);
+}
+END_TEST
+
+Suite* gcache_free_queue_suite()
+{
+    Suite* ts = suite_create("gcache::FreeQueue");
+    TCase* tc = tcase_create("queue");
+
+    tcase_set_timeout(tc, 60);
+    tcase_add_test(tc, queue_full);
+    tcase_add_test(tc, queue_concurrent);
+    suite_add_tcase(ts, tc);
+
+    tc = tcase_create("cache");
+
+    tcase_set_timeout(tc, 60);
+    tcase_add_test(tc, cache_concurrent_free);
+    tcase_add_test(tc, cache_seqno_release);
+    tcase_add_test(tc, cache_reset);
+    suite_add_tcase(ts, tc);
+
+    return ts;
+}
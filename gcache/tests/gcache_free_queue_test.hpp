@@ -0,0 +1,13 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+#ifndef __gcache_free_queue_test_hpp__
+#define __gcache_free_queue_test_hpp__
+
+extern "C" {
+#include <check.h>
+}
+
+extern Suite* gcache_free_queue_suite();
+
+#endif // __gcache_free_queue_test_hpp__
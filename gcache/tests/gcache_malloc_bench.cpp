@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to benchmark GCache malloc()/free() throughput with 1 to 64
+ * threads. Each thread allocates a batch of buffers of pseudo-random size,
+ * touches them and frees them, either itself or, in "handoff" mode, in the
+ * next thread, like GCS receive thread allocates and appliers free.
+ *
+ * Usage: gcache_malloc_bench [total [max_threads [batch]]]
+ */
+
+#include "GCache.hpp"
+
+#include <gu_threads.h>
+
+#include <sys/time.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#define BENCH_CACHE "gcache_malloc_bench.cache"
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+struct ThreadArg
+{
+    gcache::GCache*     gc;
+    std::vector<void*>* mine;  // buffers allocated by this thread
+    std::vector<void*>* other; // buffers to free, may be mine
+    gu_barrier_t*       barrier;
+    long                ops;
+    int                 batch;
+    unsigned int        seed;
+};
+
+extern "C" void* bench_thread(void* arg)
+{
+    ThreadArg* const ta(static_cast<ThreadArg*>(arg));
+
+    for (long i(0); i < ta->ops; i += ta->batch)
+    {
+        for (int b(0); b < ta->batch; ++b)
+        {
+            void* ptx;
+            int const size(64 + rand_r(&ta->seed) % 4032);
+            void* const ptr(ta->gc->malloc(size, ptx));
+            if (!ptr) abort();
+            ::memset(ptx, b, size);
+            (*ta->mine)[b] = ptr;
+        }
+
+        /* in handoff mode wait until the neighbour has filled its batch */
+        gu_barrier_wait(ta->barrier);
+
+        for (int b(0); b < ta->batch; ++b) ta->gc->free((*ta->other)[b]);
+
+        gu_barrier_wait(ta->barrier);
+    }
+
+    return NULL;
+}
+
+static void run(gu::Config& conf, int const threads, long const total,
+                int const batch, bool const handoff)
+{
+    gcache::GCache gc(NULL, conf, "");
+
+    std::vector<std::vector<void*> > bufs(threads,
+                                          std::vector<void*>(batch));
+    std::vector<ThreadArg>   args(threads);
+    std::vector<gu_thread_t> thds(threads);
+    gu_barrier_t             barrier;
+    struct timeval           tv_begin, tv_end;
+
+    gu_barrier_init(&barrier, NULL, threads);
+
+    gettimeofday(&tv_begin, NULL);
+    for (int i(0); i < threads; ++i)
+    {
+        ThreadArg const ta = { &gc, &bufs[i],
+                               &bufs[handoff ? (i + 1) % threads : i],
+                               &barrier, total / threads, batch,
+                               static_cast<unsigned int>(i + 1) };
+        args[i] = ta;
+        if (gu_thread_create(NULL, &thds[i], bench_thread, &args[i])) abort();
+    }
+    for (int i(0); i < threads; ++i) gu_thread_join(thds[i], NULL);
+    gettimeofday(&tv_end, NULL);
+
+    gu_barrier_destroy(&barrier);
+
+    std::cout << std::setw(10) << threads
+              << std::setw(10) << (handoff ? "handoff" : "local")
+              << std::setw(16)
+              << total / threads * threads / time_diff(tv_end, tv_begin)
+              << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    long const total      (argc > 1 ? atol(argv[1]) : 2000000);
+    int  const max_threads(argc > 2 ? atoi(argv[2]) : 64);
+    int  const batch      (argc > 3 ? atoi(argv[3]) : 16);
+
+    if (total <= 0 || max_threads <= 0 || batch <= 0)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [total [max_threads [batch]]]\n";
+        return 1;
+    }
+
+    gu::Config conf;
+    gcache::GCache::register_params(conf);
+    conf.parse("gcache.name = " BENCH_CACHE "; gcache.size = 128M");
+
+    std::cout << std::setprecision(4)
+              << std::setw(10) << "threads"
+              << std::setw(10) << "free"
+              << std::setw(16) << "malloc+free/s" << '\n';
+
+    for (int threads(1); threads <= max_threads; threads *= 2)
+    {
+        run(conf, threads, total, batch, false);
+        run(conf, threads, total, batch, true);
+    }
+
+    ::unlink(BENCH_CACHE);
+
+    return 0;
+}
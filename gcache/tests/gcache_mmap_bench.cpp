@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to compare ring buffer memory mapping options. For each
+ * combination of gcache.huge_pages and gcache.populate (and gcache.numa_node
+ * if given) a new ring buffer is created and then twice its size worth of
+ * writesets is written into it and read back, like appliers would do.
+ * Page faults and time are reported separately for opening and for the
+ * workload.
+ *
+ * Usage: gcache_mmap_bench [size [writeset [numa_node]]]
+ */
+
+#include "GCache.hpp"
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+#define BENCH_CACHE "gcache_mmap_bench.cache"
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+static volatile unsigned long bench_sink; // keeps read back from being elided
+
+static long faults()
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru)) abort();
+    return ru.ru_minflt + ru.ru_majflt;
+}
+
+static void run(const std::string& size, int const ws, bool const huge,
+                bool const populate, int const numa)
+{
+    gu::Config conf;
+    gcache::GCache::register_params(conf);
+
+    std::ostringstream opts;
+    opts << "gcache.name = " BENCH_CACHE "; gcache.size = " << size
+         << "; gcache.huge_pages = " << (huge ? "yes" : "no")
+         << "; gcache.populate = " << (populate ? "yes" : "no")
+         << "; gcache.numa_node = " << numa;
+    conf.parse(opts.str());
+
+    ::unlink(BENCH_CACHE);
+
+    struct timeval tv_begin, tv_open, tv_end;
+    long const flt_begin(faults());
+    gettimeofday(&tv_begin, NULL);
+
+    gcache::GCache gc(NULL, conf, "");
+
+    gettimeofday(&tv_open, NULL);
+    long const flt_open(faults());
+
+    long const total(2 * conf.get<long>("gcache.size") / ws);
+    unsigned long sum(0);
+
+    for (long i(0); i < total; ++i)
+    {
+        void* ptx;
+        void* const ptr(gc.malloc(ws, ptx));
+        if (!ptr) abort();
+        ::memset(ptx, int(i), ws);
+
+        const unsigned long* const p(static_cast<const unsigned long*>(ptx));
+        for (size_t j(0); j < ws / sizeof(*p); ++j) sum += p[j];
+
+        gc.free(ptr);
+    }
+
+    gettimeofday(&tv_end, NULL);
+    long const flt_end(faults());
+    bench_sink = sum;
+
+    double const sec(time_diff(tv_end, tv_open));
+
+    std::cout << std::setw(6)  << (huge ? "yes" : "no")
+              << std::setw(10) << (populate ? "yes" : "no")
+              << std::setw(6)  << numa
+              << std::setw(10) << time_diff(tv_open, tv_begin)
+              << std::setw(12) << flt_open - flt_begin
+              << std::setw(12) << flt_end - flt_open
+              << std::setw(12) << double(total) * ws / sec / (1 << 20)
+              << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    std::string const size(argc > 1 ? argv[1] : "1G");
+    int const ws  (argc > 2 ? atoi(argv[2]) : 4096);
+    int const numa(argc > 3 ? atoi(argv[3]) : -1);
+
+    if (ws <= 0 || ws % sizeof(unsigned long) || numa < -1)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [size [writeset [numa_node]]]\n";
+        return 1;
+    }
+
+    std::cout << std::setprecision(4)
+              << std::setw(6)  << "huge"
+              << std::setw(10) << "populate"
+              << std::setw(6)  << "numa"
+              << std::setw(10) << "open, s"
+              << std::setw(12) << "open flt"
+              << std::setw(12) << "run flt"
+              << std::setw(12) << "MB/s" << '\n';
+
+    for (int i(0); i < 4; ++i)
+    {
+        run(size, ws, i & 1, i & 2, -1);
+    }
+
+    if (numa >= 0)
+    {
+        run(size, ws, false, false, numa);
+        run(size, ws, true,  false, numa);
+    }
+
+    ::unlink(BENCH_CACHE);
+
+    return 0;
+}
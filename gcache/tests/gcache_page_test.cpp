@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2010-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2010-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -11,6 +11,11 @@
 
 #include <gu_digest.hpp>
 
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+
 using namespace gcache;
 
 /* helper to switch between encryption and non-encryption modes */
@@ -437,6 +442,195 @@ START_TEST(test4) // check that pages linger correctly and get deleted as they
 }
 END_TEST
 
+static void
+t5(wsrep_encrypt_cb_t cb, void* app_ctx, const gcache::Page::EncKey& key)
+{
+    bool const enc(NULL != cb);
+    log_test(5, enc);
+
+    const char* const dir_name = "";
+    ssize_t const page_size = 1024;
+    ssize_t const alloc_size = page_size - gcache::Page::meta_size(BH_size(0));
+    int     const pages = 32; // more than reclaim queue can hold
+
+    gcache::PageStore ps(dir_name, cb, app_ctx, 0, page_size, page_size,
+                         0, false);
+    ps.set_enc_key(key);
+
+    get_BH BH(ps, enc);
+
+    for (int i(0); i < pages; ++i)
+    {
+        void* ptx;
+        void* ptr(ps.malloc(alloc_size, ptx));
+        ck_assert(NULL != ptr);
+        ps_free(ps, BH(ptr), ptr);
+        /* page is gone from the store at once, file - in background */
+        ck_assert_msg(ps.total_pages() == 0,
+                      "Expected total_pages() = 0, got %zu", ps.total_pages());
+    }
+
+    for (int i(0); i < 1000 && ps.reclaim_queue() > 0; ++i) usleep(10000);
+
+    ck_assert_msg(ps.reclaim_queue() == 0,
+                  "Expected reclaim_queue() = 0, got %zu", ps.reclaim_queue());
+    ck_assert(ps.reclaim_lag() == 0);
+
+    for (size_t i(0); i < ps.count(); ++i)
+    {
+        std::ostringstream os;
+        os << "gcache.page." << std::setfill('0') << std::setw(6) << i;
+        ck_assert_msg(::access(os.str().c_str(), F_OK) != 0,
+                      "Page file %s was not removed", os.str().c_str());
+    }
+}
+
+START_TEST(test5) // check that page files get removed by reclaim thread
+{
+    t5(NULL, NULL, Key);
+    t5(gcache_test_encrypt_cb, NULL, Key);
+}
+END_TEST
+
+/* Slot of the key in PtrIndex table of given size, must match
+ * PtrIndex::slot() for the test to hit the intended collisions. */
+static size_t ptr_index_slot(const void* const key, size_t const size)
+{
+    uint64_t const h((uint64_t(uintptr_t(key)) >> 4) *
+                     0x9e3779b97f4a7c15ULL);
+    return size_t(h ^ (h >> 32)) & (size - 1);
+}
+
+typedef std::map<const void*, uint32_t> PtrMap;
+
+static void ptr_index_check(const PtrIndex& idx, const PtrMap& ref,
+                            const std::vector<const void*>& erased)
+{
+    ck_assert_int_eq(idx.size(), ref.size());
+
+    for (PtrMap::const_iterator i(ref.begin()); i != ref.end(); ++i)
+    {
+        const uint32_t* const val(idx.find(i->first));
+        ck_assert_msg(NULL != val, "key %p not found", i->first);
+        ck_assert_int_eq(*val, i->second);
+    }
+
+    for (size_t i(0); i < erased.size(); ++i)
+    {
+        if (ref.find(erased[i]) == ref.end())
+        {
+            ck_assert(NULL == idx.find(erased[i]));
+        }
+    }
+}
+
+static void ptr_index_erase(PtrIndex& idx, PtrMap& ref,
+                            std::vector<const void*>& erased,
+                            const void* const key)
+{
+    uint32_t val;
+    ck_assert(idx.erase(key, val));
+    ck_assert_int_eq(val, ref[key]);
+    ref.erase(key);
+    erased.push_back(key);
+    ck_assert(!idx.erase(key, val));
+    ptr_index_check(idx, ref, erased);
+}
+
+/* keys colliding at the end of the table wrap around to its beginning and
+ * mix with keys hashed there, erase must shift them back correctly */
+START_TEST(ptr_index_wrap)
+{
+    size_t const size(1024); // initial table size
+
+    std::vector<const void*> tail, head;
+    for (uintptr_t p(0x10000); tail.size() < 24 || head.size() < 8; p += 16)
+    {
+        const void* const key(reinterpret_cast<const void*>(p));
+        size_t const s(ptr_index_slot(key, size));
+        if (s >= size - 3 && tail.size() < 24) tail.push_back(key);
+        else if (s < 2 && head.size() < 8) head.push_back(key);
+    }
+
+    PtrIndex idx;
+    PtrMap   ref;
+    std::vector<const void*> erased;
+    uint32_t val(0);
+
+    /* interleave so that head keys are displaced by the wrapped cluster */
+    for (size_t i(0); i < tail.size(); ++i)
+    {
+        ck_assert(idx.insert(tail[i], ++val));
+        ref[tail[i]] = val;
+        if (i % 3 == 0 && i / 3 < head.size())
+        {
+            ck_assert(idx.insert(head[i / 3], ++val));
+            ref[head[i / 3]] = val;
+        }
+    }
+    ck_assert(!idx.insert(tail[0], 0));
+    ptr_index_check(idx, ref, erased);
+
+    /* erase from the middle, the start and the wrapped part of the cluster */
+    for (size_t i(0); i < tail.size(); i += 4)
+    {
+        ptr_index_erase(idx, ref, erased, tail[i]);
+    }
+    for (size_t i(0); i < head.size(); i += 2)
+    {
+        ptr_index_erase(idx, ref, erased, head[i]);
+    }
+
+    /* reinsert into freed cells */
+    for (size_t i(0); i < erased.size(); ++i)
+    {
+        ck_assert(idx.insert(erased[i], ++val));
+        ref[erased[i]] = val;
+    }
+    ptr_index_check(idx, ref, erased);
+
+    while (!ref.empty())
+    {
+        ptr_index_erase(idx, ref, erased, ref.rbegin()->first);
+    }
+}
+END_TEST
+
+/* table grows past the initial size and stays consistent under erase */
+START_TEST(ptr_index_grow)
+{
+    PtrIndex idx;
+    PtrMap   ref;
+    std::vector<const void*> erased;
+
+    unsigned int seed(1);
+    while (ref.size() < 5000)
+    {
+        const void* const key(reinterpret_cast<const void*>(
+                                  uintptr_t(rand_r(&seed) % (1 << 20)) << 4));
+        if (0 == key) continue;
+        bool const     fresh(ref.find(key) == ref.end());
+        uint32_t const val(ref.size());
+        ck_assert(idx.insert(key, val) == fresh);
+        if (fresh) ref[key] = val;
+    }
+    ptr_index_check(idx, ref, erased);
+
+    for (size_t n(0); n < 2500; ++n)
+    {
+        PtrMap::iterator i(ref.begin());
+        std::advance(i, rand_r(&seed) % ref.size());
+        uint32_t val;
+        ck_assert(idx.erase(i->first, val));
+        ck_assert_int_eq(val, i->second);
+        erased.push_back(i->first);
+        ref.erase(i);
+        if (n % 100 == 0) ptr_index_check(idx, ref, erased);
+    }
+    ptr_index_check(idx, ref, erased);
+}
+END_TEST
+
 Suite* gcache_page_suite()
 {
     Suite* s = suite_create("gcache::PageStore");
@@ -447,6 +641,12 @@ Suite* gcache_page_suite()
     tcase_add_test(tc, test2);
     tcase_add_test(tc, test3);
     tcase_add_test(tc, test4);
+    tcase_add_test(tc, test5);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("ptr_index");
+    tcase_add_test(tc, ptr_index_wrap);
+    tcase_add_test(tc, ptr_index_grow);
     suite_add_tcase(s, tc);
 
     return s;
@@ -13,6 +13,8 @@
 #include <gu_logger.hpp>
 #include <gu_throw.hpp>
 
+#include <fstream>
+
 using namespace gcache;
 
 static gu::UUID    const GID(NULL, 0);
@@ -33,7 +35,7 @@ START_TEST(test1)
 
     seqno2ptr_t s2p(SEQNO_NONE);
     gu::UUID   gid(GID);
-    RingBuffer rb(NULL, RB_NAME, rb_size, s2p, gid, 0, false);
+    RingBuffer rb(NULL, RB_NAME, rb_size, s2p, gid, 0, false, 0);
 
     ck_assert_msg(rb.size() == rb_size,
                   "Expected %zd, got %zd", rb_size, rb.size());
@@ -157,7 +159,7 @@ START_TEST(recovery)
 
         rb_ctx(size_t s, bool recover = true) :
             size(s), s2p(SEQNO_NONE), gid(GID),
-            rb(NULL, RB_NAME, size, s2p, gid, 0, recover)
+            rb(NULL, RB_NAME, size, s2p, gid, 0, recover, 0)
         {}
 
         void seqno_assign (seqno2ptr_t& s2p, void* const ptr,
@@ -505,6 +507,79 @@ START_TEST(recovery)
 }
 END_TEST
 
+/* returns preamble of the ring buffer file as it would be seen after crash */
+static std::string rb_preamble()
+{
+    std::ifstream f(RB_NAME.c_str());
+    std::string ret;
+    std::getline(f, ret, '\0');
+    return ret;
+}
+
+START_TEST(recovery_checkpoint)
+{
+    ::unlink(RB_NAME.c_str());
+
+    size_type const buf_size(ALLOC_SIZE(8));
+    size_t    const rb_size(buf_size * 16);
+
+    seqno2ptr_t s2p(SEQNO_NONE);
+    gu::UUID    gid(GID);
+    RingBuffer  rb(NULL, RB_NAME, rb_size, s2p, gid, 0, false, 0);
+
+    /* allocates a buffer, assigns it seqno and releases it */
+    struct
+    {
+        void operator()(RingBuffer& rb, seqno2ptr_t& s2p, seqno_t const g,
+                        size_type const size)
+        {
+            void* const ptr(rb.malloc(size));
+            ck_assert(NULL != ptr);
+            s2p.insert(g, ptr);
+            ptr2BH(ptr)->seqno_g = g;
+            BH_release(ptr2BH(ptr));
+            rb.free(ptr2BH(ptr));
+        }
+    } add;
+
+    seqno_t g(1);
+    for (; g <= 5; ++g) add(rb, s2p, g, buf_size);
+
+    /* the cache was not closed, but the preamble must point at the first
+     * buffer already */
+    std::string pr(rb_preamble());
+    ck_assert_msg(pr.find("synced: 0") != std::string::npos, "%s",pr.c_str());
+    ck_assert_msg(pr.find("offset: ") != std::string::npos, "%s", pr.c_str());
+
+    {
+        seqno2ptr_t s2p_rec(SEQNO_NONE);
+        gu::UUID    gid_rec;
+        RingBuffer  rb_rec(NULL, RB_NAME, rb_size, s2p_rec, gid_rec, 0, true,
+                           0);
+        ck_assert(gid_rec == GID);
+        ck_assert_int_eq(s2p_rec.index_front(), 1);
+        ck_assert_int_eq(s2p_rec.index_back(), g - 1);
+    }
+
+    /* after rollover the checkpoint is overwritten and must be gone */
+    for (; g <= 40; ++g) add(rb, s2p, g, buf_size);
+
+    pr = rb_preamble();
+    ck_assert_msg(pr.find("offset: ") == std::string::npos, "%s", pr.c_str());
+
+    {
+        seqno2ptr_t s2p_rec(SEQNO_NONE);
+        gu::UUID    gid_rec;
+        RingBuffer  rb_rec(NULL, RB_NAME, rb_size, s2p_rec, gid_rec, 0, true,
+                           0);
+        ck_assert(!s2p_rec.empty());
+        ck_assert_int_eq(s2p_rec.index_back(), g - 1);
+        ck_assert(s2p_rec.index_front() > 1);
+    }
+
+    ::unlink(RB_NAME.c_str());
+}
+END_TEST
 
 Suite* gcache_rb_suite()
 {
@@ -519,6 +594,7 @@ Suite* gcache_rb_suite()
 
     tcase_set_timeout(tc, 60);
     tcase_add_test(tc, recovery);
+    tcase_add_test(tc, recovery_checkpoint);
     suite_add_tcase(ts, tc);
 
     return ts;
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * This is to benchmark ring buffer recovery after crash. A child process
+ * fills 90% of the ring buffer with ordered writesets and exits without
+ * closing it. Then the buffer is recovered with cold page cache, once with
+ * the preamble as it was left by the crash (first segment offset known from
+ * the checkpoint) and once with the offset removed (first segment has to be
+ * searched for), each without and with the read ahead threads.
+ *
+ * Usage: gcache_recover_bench [size [threads]]
+ */
+
+#include "gcache_rb_store.hpp"
+#include "gcache_bh.hpp"
+
+#include <gu_config.hpp>
+
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+
+#define BENCH_CACHE "gcache_recover_bench.cache"
+
+using namespace gcache;
+
+static size_t const PREAMBLE_LEN(1024); // see RingBuffer
+
+static double time_diff(const struct timeval& l,
+                        const struct timeval& r)
+{
+    double const left(double(l.tv_usec)*1.0e-06 + l.tv_sec);
+    double const right(double(r.tv_usec)*1.0e-06 + r.tv_sec);
+    return left - right;
+}
+
+static void fill(size_t const size)
+{
+    seqno2ptr_t s2p(SEQNO_NONE);
+    gu::UUID    gid(NULL, 0);
+    RingBuffer* const rb(new RingBuffer(NULL, BENCH_CACHE, size, s2p, gid,
+                                        0, false, 0));
+    unsigned int seed(1);
+    size_t filled(0);
+
+    for (seqno_t g(1); filled < size / 10 * 9; ++g)
+    {
+        size_t const alloc(BH_size(512 + rand_r(&seed) % 7680));
+        void* const ptr(rb->malloc(alloc));
+        if (!ptr) abort();
+        ::memset(ptr, int(g), alloc - sizeof(BufferHeader));
+        s2p.insert(g, ptr);
+        ptr2BH(ptr)->seqno_g = g;
+        BH_release(ptr2BH(ptr));
+        rb->free(ptr2BH(ptr));
+        filled += RingBuffer::aligned_size(alloc);
+    }
+
+    std::cout << "Filled " << filled << " bytes with " << s2p.size()
+              << " writesets" << std::endl;
+
+    /* crash: leave the cache open */
+    _exit(0);
+}
+
+static std::string read_preamble()
+{
+    char buf[PREAMBLE_LEN] = { 0, };
+    int const fd(::open(BENCH_CACHE, O_RDONLY));
+    if (fd < 0 || ::pread(fd, buf, sizeof(buf) - 1, 0) < 0) abort();
+    ::close(fd);
+    return buf;
+}
+
+/* writes the preamble back and drops the file from page cache */
+static void prepare(const std::string& preamble)
+{
+    char buf[PREAMBLE_LEN] = { 0, };
+    ::memcpy(buf, preamble.data(), preamble.length());
+
+    int const fd(::open(BENCH_CACHE, O_RDWR));
+    if (fd < 0 || ::pwrite(fd, buf, sizeof(buf), 0) != sizeof(buf)) abort();
+    if (::fdatasync(fd) ||
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED)) abort();
+    ::close(fd);
+}
+
+static void run(size_t const size, const std::string& preamble,
+                const char* const mode, int const threads)
+{
+    prepare(preamble);
+
+    seqno2ptr_t    s2p(SEQNO_NONE);
+    gu::UUID       gid;
+    struct timeval tv_begin, tv_end;
+
+    gettimeofday(&tv_begin, NULL);
+    {
+        RingBuffer rb(NULL, BENCH_CACHE, size, s2p, gid, 0, true, threads);
+        gettimeofday(&tv_end, NULL);
+    }
+
+    std::cout << std::setw(12) << mode
+              << std::setw(10) << threads
+              << std::setw(12) << time_diff(tv_end, tv_begin)
+              << std::setw(12) << s2p.size() << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t const size(gu::Config::from_config<size_t>(argc > 1 ? argv[1] :
+                                                      "8G"));
+    int    const threads(argc > 2 ? atoi(argv[2]) : 4);
+
+    if (size < (1 << 20) || threads <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [size [threads]]\n";
+        return 1;
+    }
+
+    ::unlink(BENCH_CACHE);
+
+    pid_t const pid(fork());
+    if (0 == pid) fill(size);
+
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status))
+    {
+        std::cerr << "Failed to fill the cache\n";
+        return 1;
+    }
+
+    /* preamble as left by the crash and the same without the checkpoint */
+    std::string const ckpt(read_preamble());
+    std::string       search(ckpt);
+    size_t const off(search.find("offset:"));
+    if (off != std::string::npos)
+    {
+        search.erase(off, search.find('\n', off) - off + 1);
+    }
+    else
+    {
+        std::cerr << "No checkpoint in preamble:\n" << ckpt;
+    }
+
+    std::cout << std::setprecision(4)
+              << std::setw(12) << "preamble"
+              << std::setw(10) << "threads"
+              << std::setw(12) << "seconds"
+              << std::setw(12) << "seqnos" << '\n';
+
+    run(size, ckpt,   "checkpoint", 0);
+    run(size, ckpt,   "checkpoint", threads);
+    run(size, search, "search",     0);
+    run(size, search, "search",     threads);
+
+    ::unlink(BENCH_CACHE);
+
+    return 0;
+}
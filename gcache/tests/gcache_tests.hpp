@@ -1,4 +1,4 @@
-// Copyright (C) 2010-2019 Codership Oy <info@codership.com>
+// Copyright (C) 2010-2024 Codership Oy <info@codership.com>
 
 // $Id$
 
@@ -9,6 +9,7 @@
 #define __gcache_tests_hpp__
 
 #include "gcache_enc_test.hpp"
+#include "gcache_free_queue_test.hpp"
 #include "gcache_mem_test.hpp"
 #include "gcache_rb_test.hpp"
 #include "gcache_page_test.hpp"
@@ -25,6 +26,7 @@ static suite_creator_t suites[] =
     gcache_mem_suite,
     gcache_rb_suite,
     gcache_page_suite,
+    gcache_free_queue_suite,
     0
 };
 
@@ -514,10 +514,9 @@ void gcomm::AsioTcpSocket::read_handler(gu::AsioSocket& socket,
         if (recv_offset_ >= hdr.len() + NetHeader::serial_size_)
         {
             Datagram dg(
-                gu::SharedBuffer(
-                    new gu::Buffer(&recv_buf_[0] + NetHeader::serial_size_,
-                                   &recv_buf_[0] + NetHeader::serial_size_
-                                   + hdr.len())));
+                gu::make_shared_buffer(&recv_buf_[0] + NetHeader::serial_size_,
+                                       &recv_buf_[0] + NetHeader::serial_size_
+                                       + hdr.len()));
             if (net_.checksum_ != NetHeader::CS_NONE)
             {
 #ifdef TEST_NET_CHECKSUM_ERROR
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2010-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2010-2024 Codership Oy <info@codership.com>
  */
 
 #include "asio_udp.hpp"
@@ -11,14 +11,86 @@
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+    // Max size of valid datagram: unfragmented message of mtu() bytes
+    const size_t max_recv_dgram = (1 << 15) + gcomm::NetHeader::serial_size_;
+    // Receive slot has room for one extra byte, datagram filling the whole
+    // slot was truncated and is dropped
+    const size_t recv_slot_size = max_recv_dgram + 1;
+    // Number of datagrams read with single system call
+    const size_t recv_batch = 16;
+    // Max number of batches read before yielding to other event handlers
+    const size_t max_recv_batches = 4;
+    // IPv4 and UDP header sizes
+    const size_t ip_udp_hdr_size = 20 + 8;
+    // Min IPv4 MTU all hosts must accept
+    const size_t min_mtu = 576;
+    // Fragment header following NetHeader in fragmented messages:
+    //
+    // |           source(128)         |
+    // |            seq(32)            |
+    // |           offset(32)          |
+    //
+    // Source is UUID of the sending node, seq the message from source
+    // and offset the position of fragment data in message.
+    const size_t frag_hdr_size = sizeof(gu_uuid_t) + 8;
+    const size_t frag_prefix_size = gcomm::NetHeader::serial_size_
+        + frag_hdr_size;
+    // Max number of partially received messages. If exceeded, the one
+    // which has not progressed for the longest time is discarded.
+    const size_t max_reassembly = 256;
+
+    // Source UUID given in socket options, random UUID if not set
+    gcomm::UUID source_from_string(const std::string& str)
+    {
+        if (str.empty()) return gcomm::UUID(0, 0);
+
+        gcomm::UUID ret;
+        std::istringstream is(str);
+        is >> ret;
+        return ret;
+    }
+}
+
 gcomm::AsioUdpSocket::AsioUdpSocket(AsioProtonet& net, const gu::URI& uri)
     :
     Socket(uri),
     net_(net),
     state_(S_CLOSED),
     socket_(net_.io_service_.make_datagram_socket(uri)),
-    recv_buf_((1 << 15) + NetHeader::serial_size_)
-{ }
+    max_dgram_(gu::from_string<size_t>(
+                   uri.get_option(Socket::OptMcastMTU, "1500"))
+               - ip_udp_hdr_size),
+    source_(source_from_string(uri.get_option(Socket::OptSourceId, ""))),
+    frag_seq_(0),
+    frag_hdrs_(),
+    send_bufs_(),
+    reassembly_(),
+    recv_ring_(recv_batch * recv_slot_size),
+    recv_bufs_(),
+    recv_lens_(recv_batch)
+{
+    if (max_dgram_ + ip_udp_hdr_size < min_mtu || max_dgram_ > max_recv_dgram)
+    {
+        gu_throw_error(EINVAL) << "Invalid " << Socket::OptMcastMTU << ": "
+                               << max_dgram_ + ip_udp_hdr_size
+                               << ", allowed range [" << min_mtu << ", "
+                               << max_recv_dgram + ip_udp_hdr_size << "]";
+    }
+
+    // The first ring slot is reserved for asynchronous read
+    for (size_t i(1); i < recv_batch; ++i)
+    {
+        recv_bufs_.push_back(gu::AsioMutableBuffer(
+                                 &recv_ring_[i * recv_slot_size],
+                                 recv_slot_size));
+    }
+}
 
 
 gcomm::AsioUdpSocket::~AsioUdpSocket()
@@ -27,6 +99,20 @@ gcomm::AsioUdpSocket::~AsioUdpSocket()
 }
 
 
+void gcomm::AsioUdpSocket::set_option(const std::string& key,
+                                      const std::string& val)
+{
+    if (key == Socket::OptForgetSource)
+    {
+        Critical<AsioProtonet> crit(net_);
+        UUID source;
+        std::istringstream is(val);
+        is >> source;
+        reassembly_.erase(source);
+    }
+}
+
+
 void gcomm::AsioUdpSocket::connect(const gu::URI& uri)
 {
     gcomm_assert(state() == S_CLOSED);
@@ -53,6 +139,11 @@ int gcomm::AsioUdpSocket::send(int /* segment */, const Datagram& dg)
         hdr.set_crc32(crc32(net_.checksum_, dg), net_.checksum_);
     }
 
+    if (NetHeader::serial_size_ + dg.len() > max_dgram_)
+    {
+        return send_fragments(hdr, dg);
+    }
+
     // Make copy of datagram to be able to adjust the header
     Datagram priv_dg(dg);
     priv_dg.set_header_offset(priv_dg.header_offset() -
@@ -63,9 +154,9 @@ int gcomm::AsioUdpSocket::send(int /* segment */, const Datagram& dg)
               priv_dg.header_offset());
 
     std::array<gu::AsioConstBuffer, 2> cbs;
-    cbs[0] = gu::AsioConstBuffer(dg.header()
-                                 + dg.header_offset(),
-                                 dg.header_len());
+    cbs[0] = gu::AsioConstBuffer(priv_dg.header()
+                                 + priv_dg.header_offset(),
+                                 priv_dg.header_len());
     cbs[1] = gu::AsioConstBuffer(dg.payload().data(),
                                  dg.payload().size());
 
@@ -81,6 +172,221 @@ int gcomm::AsioUdpSocket::send(int /* segment */, const Datagram& dg)
     return 0;
 }
 
+//
+// Message which does not fit into single datagram is split into
+// fragments of max_dgram_ bytes. Each fragment starts with NetHeader
+// of the whole message and fragment header. Datagram header is
+// copied after the headers of the first fragment, payload is sent from
+// where it is. All the fragments are passed to the socket at once.
+//
+int gcomm::AsioUdpSocket::send_fragments(const NetHeader& msg_hdr,
+                                         const Datagram& dg)
+{
+    size_t const hdr_len(dg.header_len());
+    size_t const frag_len(max_dgram_ - frag_prefix_size);
+    size_t const n_frags((dg.len() + frag_len - 1)/frag_len);
+    gcomm_assert(hdr_len < frag_len);
+
+    NetHeader hdr(msg_hdr);
+    hdr.set_fragment();
+    ++frag_seq_;
+
+    frag_hdrs_.resize(n_frags * frag_prefix_size + hdr_len);
+    send_bufs_.resize(n_frags);
+
+    gu::byte_t* const hbuf(&frag_hdrs_[0]);
+    size_t const      hbuf_len(frag_hdrs_.size());
+    size_t            hoff(0);
+    size_t            offset(0);
+
+    for (size_t i(0); i < n_frags; ++i)
+    {
+        size_t const prefix(hoff);
+        hoff = serialize(hdr, hbuf, hbuf_len, hoff);
+        hoff = source_.serialize(hbuf, hbuf_len, hoff);
+        hoff = gu::serialize4(frag_seq_, hbuf, hbuf_len, hoff);
+        hoff = gu::serialize4(static_cast<uint32_t>(offset),
+                              hbuf, hbuf_len, hoff);
+
+        size_t const len(std::min(frag_len, dg.len() - offset));
+        size_t       data_offset(offset - hdr_len);
+        size_t       data_len(len);
+        if (0 == i)
+        {
+            memcpy(hbuf + hoff, dg.header() + dg.header_offset(), hdr_len);
+            hoff += hdr_len;
+            data_offset = 0;
+            data_len -= hdr_len;
+        }
+
+        send_bufs_[i][0] = gu::AsioConstBuffer(hbuf + prefix, hoff - prefix);
+        send_bufs_[i][1] = gu::AsioConstBuffer(
+            dg.payload().data() + data_offset, data_len);
+        offset += len;
+    }
+    assert(offset == dg.len());
+
+    try
+    {
+        socket_->write(send_bufs_);
+    }
+    catch (const gu::Exception& e)
+    {
+        log_warn << "Error: " << e.what();
+        return e.get_errno();
+    }
+    return 0;
+}
+
+
+void gcomm::AsioUdpSocket::dispatch(const NetHeader& hdr, const Datagram& dg)
+{
+    if (net_.checksum_ != NetHeader::CS_NONE && check_cs(hdr, dg))
+    {
+        log_warn << "checksum failed, hdr: len=" << hdr.len()
+                 << " has_crc32="  << hdr.has_crc32()
+                 << " has_crc32c=" << hdr.has_crc32c()
+                 << " crc32=" << hdr.crc32();
+    }
+    else
+    {
+        net_.dispatch(id(), dg, ProtoUpMeta());
+    }
+}
+
+
+void gcomm::AsioUdpSocket::handle_fragment(const NetHeader& hdr,
+                                           const gu::byte_t* buf,
+                                           size_t len)
+{
+    if (len < frag_hdr_size)
+    {
+        log_warn << "short fragment of " << len;
+        return;
+    }
+
+    UUID     source;
+    uint32_t seq, offset;
+    size_t off(source.unserialize(buf, len, 0));
+    off = gu::unserialize4(buf, len, off, seq);
+    off = gu::unserialize4(buf, len, off, offset);
+    buf += off;
+    len -= off;
+
+    std::map<UUID, Reassembly>::iterator i(reassembly_.find(source));
+
+    if (0 == offset)
+    {
+        // Length comes from the network, don't reserve more than
+        // the largest message gcomm sends
+        if (hdr.len() > mtu())
+        {
+            log_warn << "fragmented message of " << hdr.len()
+                     << " bytes exceeds max message size " << mtu();
+            if (i != reassembly_.end()) reassembly_.erase(i);
+            return;
+        }
+
+        if (i == reassembly_.end())
+        {
+            if (reassembly_.size() >= max_reassembly)
+            {
+                // Sources which stop sending in the middle of message
+                // must not block new ones
+                std::map<UUID, Reassembly>::iterator oldest(
+                    reassembly_.begin());
+                for (std::map<UUID, Reassembly>::iterator j(oldest);
+                     j != reassembly_.end(); ++j)
+                {
+                    if (j->second.tstamp_ < oldest->second.tstamp_)
+                    {
+                        oldest = j;
+                    }
+                }
+                reassembly_.erase(oldest);
+            }
+            i = reassembly_.insert(std::make_pair(source, Reassembly())).first;
+        }
+        i->second.seq_ = seq;
+        i->second.hdr_ = hdr;
+        i->second.buf_ = gu::make_shared_buffer();
+        i->second.buf_->reserve(hdr.len());
+    }
+    else if (i == reassembly_.end() || i->second.seq_ != seq ||
+             i->second.buf_->size() != offset)
+    {
+        // Missing fragment, the message will be recovered by upper layer.
+        if (i != reassembly_.end()) reassembly_.erase(i);
+        return;
+    }
+
+    Reassembly& r(i->second);
+    r.tstamp_ = gu::datetime::Date::monotonic();
+
+    if (r.buf_->size() + len > r.hdr_.len())
+    {
+        log_warn << "fragment at " << offset << " of " << len
+                 << " bytes exceeds message length " << r.hdr_.len();
+        reassembly_.erase(i);
+        return;
+    }
+
+    r.buf_->insert(r.buf_->end(), buf, buf + len);
+
+    if (r.buf_->size() == r.hdr_.len())
+    {
+        NetHeader const msg_hdr(r.hdr_);
+        Datagram const  dg(r.buf_);
+        reassembly_.erase(i);
+        dispatch(msg_hdr, dg);
+    }
+}
+
+
+void gcomm::AsioUdpSocket::handle_datagram(const gu::byte_t* buf, size_t len)
+{
+    if (len < NetHeader::serial_size_)
+    {
+        log_warn << "short read of " << len;
+        return;
+    }
+
+    if (len > max_recv_dgram)
+    {
+        log_warn << "dropping truncated datagram, max size " << max_recv_dgram;
+        return;
+    }
+
+    NetHeader hdr;
+    try
+    {
+        unserialize(buf, NetHeader::serial_size_, 0, hdr);
+    }
+    catch (gu::Exception& e)
+    {
+        log_warn << "hdr unserialize failed: " << e.get_errno();
+        return;
+    }
+
+    if (hdr.is_fragment())
+    {
+        handle_fragment(hdr, buf + NetHeader::serial_size_,
+                        len - NetHeader::serial_size_);
+    }
+    else if (NetHeader::serial_size_ + hdr.len() != len)
+    {
+        log_warn << "len " << hdr.len()
+                 << " does not match to bytes transferred"
+                 << len;
+    }
+    else
+    {
+        dispatch(hdr, Datagram(
+                     gu::make_shared_buffer(buf + NetHeader::serial_size_,
+                                            buf + len)));
+    }
+}
+
 
 void gcomm::AsioUdpSocket::read_handler(gu::AsioDatagramSocket&,
                                         const gu::AsioErrorCode& ec,
@@ -92,56 +398,40 @@ void gcomm::AsioUdpSocket::read_handler(gu::AsioDatagramSocket&,
         return;
     }
 
-    if (bytes_transferred >= NetHeader::serial_size_)
     {
         Critical<AsioProtonet> crit(net_);
-        NetHeader hdr;
+
+        handle_datagram(&recv_ring_[0], bytes_transferred);
+
+        // Datagrams which arrived meanwhile are read in batches without
+        // going through the event loop.
         try
         {
-            unserialize(&recv_buf_[0], NetHeader::serial_size_, 0, hdr);
-        }
-        catch (gu::Exception& e)
-        {
-            log_warn << "hdr unserialize failed: " << e.get_errno();
-            return;
-        }
-        if (NetHeader::serial_size_ + hdr.len() != bytes_transferred)
-        {
-            log_warn << "len " << hdr.len()
-                     << " does not match to bytes transferred"
-                     << bytes_transferred;
-        }
-        else
-        {
-            Datagram dg(
-                gu::SharedBuffer(
-                    new gu::Buffer(&recv_buf_[0] + NetHeader::serial_size_,
-                                   &recv_buf_[0] + NetHeader::serial_size_
-                                   + hdr.len())));
-            if (net_.checksum_ == true && check_cs(hdr, dg))
+            for (size_t b(0); b < max_recv_batches; ++b)
             {
-                log_warn << "checksum failed, hdr: len=" << hdr.len()
-                         << " has_crc32="  << hdr.has_crc32()
-                         << " has_crc32c=" << hdr.has_crc32c()
-                         << " crc32=" << hdr.crc32();
-            }
-            else
-            {
-                net_.dispatch(id(), dg, ProtoUpMeta());
+                size_t const n(socket_->read(recv_bufs_, recv_lens_));
+                for (size_t i(0); i < n; ++i)
+                {
+                    handle_datagram(
+                        static_cast<const gu::byte_t*>(recv_bufs_[i].data()),
+                        recv_lens_[i]);
+                }
+                if (n < recv_bufs_.size()) break;
             }
         }
+        catch (const gu::Exception& e)
+        {
+            log_warn << "Error: " << e.what();
+        }
     }
-    else
-    {
-        log_warn << "short read of " << bytes_transferred;
-    }
+
     async_receive();
 }
 
 void gcomm::AsioUdpSocket::async_receive()
 {
     Critical<AsioProtonet> crit(net_);
-    socket_->async_read(gu::AsioMutableBuffer(&recv_buf_[0], recv_buf_.size()),
+    socket_->async_read(gu::AsioMutableBuffer(&recv_ring_[0], recv_slot_size),
                         shared_from_this());
 }
 
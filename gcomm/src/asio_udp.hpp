@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2010-2017 Codership Oy <info@codership.com>
+ * Copyright (C) 2010-2024 Codership Oy <info@codership.com>
  */
 
 #ifndef GCOMM_ASIO_UDP_HPP
@@ -7,7 +7,10 @@
 
 #include "socket.hpp"
 #include "asio_protonet.hpp"
+#include "gcomm/uuid.hpp"
+#include "gu_datetime.hpp"
 #include "gu_shared_ptr.hpp"
+#include <map>
 #include <vector>
 
 #include "gu_disable_non_virtual_dtor.hpp"
@@ -30,8 +33,8 @@ public:
     // Socket interface
     virtual void connect(const gu::URI& uri) GALERA_OVERRIDE;
     virtual void close() GALERA_OVERRIDE;
-    virtual void set_option(const std::string&, const std::string&) GALERA_OVERRIDE
-    { /* not implemented */ }
+    virtual void set_option(const std::string& key, const std::string& val)
+        GALERA_OVERRIDE;
     virtual int send(int segment, const Datagram& dg) GALERA_OVERRIDE;
     virtual void async_receive() GALERA_OVERRIDE;
     virtual size_t mtu() const GALERA_OVERRIDE;
@@ -45,10 +48,40 @@ private:
     virtual void read_handler(gu::AsioDatagramSocket&, const gu::AsioErrorCode&,
                               size_t) GALERA_OVERRIDE;
 
+    int send_fragments(const NetHeader& hdr, const Datagram& dg);
+    void handle_datagram(const gu::byte_t* buf, size_t len);
+    void handle_fragment(const NetHeader& hdr,
+                         const gu::byte_t* buf, size_t len);
+    void dispatch(const NetHeader& hdr, const Datagram& dg);
+
+    // Partially received fragmented message
+    struct Reassembly
+    {
+        Reassembly() : seq_(), hdr_(), buf_(), tstamp_() { }
+        uint32_t           seq_;
+        NetHeader          hdr_;
+        gu::SharedBuffer   buf_;
+        // Time of the last received fragment
+        gu::datetime::Date tstamp_;
+    };
+
     AsioProtonet&            net_;
     State                    state_;
     std::shared_ptr<gu::AsioDatagramSocket> socket_;
-    std::vector<gu::byte_t>  recv_buf_;
+    // Max size of datagram to send, larger messages are fragmented
+    size_t                   max_dgram_;
+    // Identifies fragments sent from this socket, UUID of local node
+    UUID                     source_;
+    uint32_t                 frag_seq_;
+    std::vector<gu::byte_t>  frag_hdrs_;
+    std::vector<std::array<gu::AsioConstBuffer, 2> > send_bufs_;
+    std::map<UUID, Reassembly> reassembly_;
+    // Receive ring, the first slot is used for asynchronous read,
+    // the rest is filled with datagrams which are ready when
+    // the asynchronous read completes
+    std::vector<gu::byte_t>  recv_ring_;
+    std::vector<gu::AsioMutableBuffer> recv_bufs_;
+    std::vector<size_t>      recv_lens_;
 };
 
 #include "gu_enable_non_virtual_dtor.hpp"
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2014 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 #include "gcomm/conf.hpp"
@@ -43,6 +43,8 @@ std::string const gcomm::Conf::GMCastMCastPort =
     GMCastPrefix + "mcast_port";
 std::string const gcomm::Conf::GMCastMCastTTL =
     GMCastPrefix + "mcast_ttl";
+std::string const gcomm::Conf::GMCastMCastMTU =
+    GMCastPrefix + "mcast_mtu";
 std::string const gcomm::Conf::GMCastTimeWait =
     GMCastPrefix + "time_wait";
 std::string const gcomm::Conf::GMCastPeerTimeout =
@@ -87,6 +89,8 @@ std::string const gcomm::Conf::EvsUserSendWindow =
     EvsPrefix + "user_send_window";
 std::string const gcomm::Conf::EvsUseAggregate =
     EvsPrefix + "use_aggregate";
+std::string const gcomm::Conf::EvsAdaptiveWindow =
+    EvsPrefix + "adaptive_window";
 std::string const gcomm::Conf::EvsCausalKeepalivePeriod =
     EvsPrefix + "causal_keepalive_period";
 std::string const gcomm::Conf::EvsMaxInstallTimeouts =
@@ -141,6 +145,7 @@ gcomm::Conf::register_params(gu::Config& cnf)
     GCOMM_CONF_ADD        (GMCastMCastAddr);
     GCOMM_CONF_ADD        (GMCastMCastPort);
     GCOMM_CONF_ADD        (GMCastMCastTTL);
+    GCOMM_CONF_ADD        (GMCastMCastMTU);
     GCOMM_CONF_ADD        (GMCastMCastAddr);
     GCOMM_CONF_ADD        (GMCastTimeWait);
     GCOMM_CONF_ADD        (GMCastPeerTimeout);
@@ -163,6 +168,7 @@ gcomm::Conf::register_params(gu::Config& cnf)
     GCOMM_CONF_ADD_DEFAULT(EvsSendWindow);
     GCOMM_CONF_ADD_DEFAULT(EvsUserSendWindow);
     GCOMM_CONF_ADD        (EvsUseAggregate);
+    GCOMM_CONF_ADD_DEFAULT(EvsAdaptiveWindow);
     GCOMM_CONF_ADD        (EvsCausalKeepalivePeriod);
     GCOMM_CONF_ADD_DEFAULT(EvsMaxInstallTimeouts);
     GCOMM_CONF_ADD_DEFAULT(EvsDelayMargin);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2012-2019 Codership Oy <info@codership.com>
+ * Copyright (C) 2012-2024 Codership Oy <info@codership.com>
  */
 
 #include "defaults.hpp"
@@ -37,6 +37,7 @@ namespace gcomm
     std::string const Defaults::EvsSendWindowMin        = "1";
     std::string const Defaults::EvsUserSendWindow       = "2";
     std::string const Defaults::EvsUserSendWindowMin    = "1";
+    std::string const Defaults::EvsAdaptiveWindow       = "false";
     std::string const Defaults::EvsMaxInstallTimeouts   = "3";
     std::string const Defaults::EvsDelayMargin          = "PT1S";
     std::string const Defaults::EvsDelayedKeepPeriod    = "PT30S";
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2019 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 #ifndef GCOMM_DEFAULTS_HPP
@@ -38,6 +38,7 @@ namespace gcomm
         static std::string const EvsSendWindowMin         ;
         static std::string const EvsUserSendWindow        ;
         static std::string const EvsUserSendWindowMin     ;
+        static std::string const EvsAdaptiveWindow        ;
         static std::string const EvsMaxInstallTimeouts    ;
         static std::string const EvsDelayMargin           ;
         static std::string const EvsDelayedKeepPeriod     ;
@@ -83,6 +84,8 @@ namespace gcomm
                                              gu::Config::Flag::type_integer;
         static const int GMCastMCastTTL    = gu::Config::Flag::read_only |
                                              gu::Config::Flag::type_integer;
+        static const int GMCastMCastMTU    = gu::Config::Flag::read_only |
+                                             gu::Config::Flag::type_integer;
         static const int GMCastTimeWait    = gu::Config::Flag::read_only |
                                              gu::Config::Flag::type_duration;
         static const int GMCastPeerTimeout = gu::Config::Flag::read_only |
@@ -112,6 +115,7 @@ namespace gcomm
         static const int EvsSendWindow        = gu::Config::Flag::type_integer;
         static const int EvsUserSendWindow    = gu::Config::Flag::type_integer;
         static const int EvsUseAggregate      = gu::Config::Flag::type_bool;
+        static const int EvsAdaptiveWindow    = gu::Config::Flag::type_bool;
         static const int EvsCausalKeepalivePeriod = gu::Config::Flag::type_duration;
         static const int EvsMaxInstallTimeouts = gu::Config::Flag::type_integer;
         static const int EvsDelayMargin       = gu::Config::Flag::type_duration;
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 
@@ -10,6 +10,7 @@
 #include "gu_buffer.hpp"
 #include <stdexcept>
 #include <numeric>
+#include <algorithm>
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -19,93 +20,184 @@
 //////////////////////////////////////////////////////////////////////////
 
 
-// Compare node index LUs
-class NodeIndexLUCmpOp
+/*
+ * Reductions over per node seqno arrays. Independent accumulators
+ * let the compiler vectorize the loops where the target has 64-bit
+ * integer min/max, and keep them branch free elsewhere.
+ */
+static inline gcomm::evs::seqno_t
+min_seqno(const std::vector<gcomm::evs::seqno_t>& v)
 {
-public:
-    bool operator()(const gcomm::evs::InputMapNodeIndex::value_type& a,
-                    const gcomm::evs::InputMapNodeIndex::value_type& b) const
+    assert(v.empty() == false);
+    const gcomm::evs::seqno_t* const a(&v[0]);
+    const size_t n(v.size());
+    gcomm::evs::seqno_t m0(a[0]), m1(a[0]), m2(a[0]), m3(a[0]);
+    size_t i(0);
+    for (; i + 4 <= n; i += 4)
     {
-
-        return (a.range().lu() < b.range().lu());
+        m0 = std::min(m0, a[i]);
+        m1 = std::min(m1, a[i + 1]);
+        m2 = std::min(m2, a[i + 2]);
+        m3 = std::min(m3, a[i + 3]);
     }
-};
+    for (; i < n; ++i) m0 = std::min(m0, a[i]);
+    return std::min(std::min(m0, m1), std::min(m2, m3));
+}
 
-class NodeIndexHSCmpOp
+static inline gcomm::evs::seqno_t
+max_seqno(const std::vector<gcomm::evs::seqno_t>& v)
 {
-public:
-    bool operator()(const gcomm::evs::InputMapNodeIndex::value_type& a,
-                    const gcomm::evs::InputMapNodeIndex::value_type& b) const
+    assert(v.empty() == false);
+    const gcomm::evs::seqno_t* const a(&v[0]);
+    const size_t n(v.size());
+    gcomm::evs::seqno_t m0(a[0]), m1(a[0]), m2(a[0]), m3(a[0]);
+    size_t i(0);
+    for (; i + 4 <= n; i += 4)
     {
-        return (a.range().hs() < b.range().hs());
+        m0 = std::max(m0, a[i]);
+        m1 = std::max(m1, a[i + 1]);
+        m2 = std::max(m2, a[i + 2]);
+        m3 = std::max(m3, a[i + 3]);
     }
-};
+    for (; i < n; ++i) m0 = std::max(m0, a[i]);
+    return std::max(std::max(m0, m1), std::max(m2, m3));
+}
 
 
-// Compare node index safe seqs
-class NodeIndexSafeSeqCmpOp
+//////////////////////////////////////////////////////////////////////////
+//
+// Ostream operators
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+std::ostream& gcomm::operator<<(std::ostream& os, const InputMapMsgKey& mk)
 {
-public:
-    bool operator()(const gcomm::evs::InputMapNodeIndex::value_type& a,
-                    const gcomm::evs::InputMapNodeIndex::value_type& b) const
-    {
-        return a.safe_seq() < b.safe_seq();
-    }
-};
+    return (os << "(" << mk.index() << "," << mk.seq() << ")");
+}
 
 
+std::ostream& gcomm::evs::operator<<(std::ostream& os, const InputMapMsg& m)
+{
+    return (os << m.msg());
+}
+
 
+std::ostream& gcomm::evs::operator<<(std::ostream& os, const InputMap& im)
+{
+    os << "evs::input_map: {"
+       << "aru_seq="        << im.aru_seq()   << ","
+       << "safe_seq="       << im.safe_seq()  << ","
+       << "node_index=";
+    for (size_t i(0); i < im.lu_.size(); ++i)
+    {
+        os << "node: {"
+           << "idx="      << i                << ","
+           << "range="    << im.range(i)      << ","
+           << "safe_seq=" << im.safe_seq(i)   << "} ";
+    }
+#ifndef NDEBUG
+    os << ","
+       << "msg_index="      << im.n_msgs_  << ","
+       << "recovery_index=" << im.n_recov_;
+#endif // !NDEBUG
+    return (os << "}");
+}
 
 
 //////////////////////////////////////////////////////////////////////////
 //
-// Ostream operators
+// InputMapMsgIndex
 //
 //////////////////////////////////////////////////////////////////////////
 
 
-std::ostream& gcomm::evs::operator<<(std::ostream& os, const InputMapNode& in)
+void gcomm::evs::InputMapMsgIndex::reserve(size_t const size)
 {
-    return (os << "node: {"
-            << "idx="      << in.index()    << ","
-            << "range="    << in.range()    << ","
-            << "safe_seq=" << in.safe_seq() << "}");
-}
+    size_t cap(std::max<size_t>(state_.size(), 16));
+    while (cap < size) cap <<= 1;
+    if (cap == state_.size()) return;
 
-std::ostream& gcomm::evs::operator<<(std::ostream& os, const InputMapNodeIndex& ni)
-{
-    copy(ni.begin(), ni.end(), std::ostream_iterator<const InputMapNode>(os, " "));
-    return os;
+    std::vector<unsigned char> new_state(cap, S_EMPTY);
+    std::vector<Storage>       new_msgs(cap);
+    const size_t mask(cap - 1);
+
+    for (seqno_t s(base_); s < base_ + seqno_t(size_); ++s)
+    {
+        const State st(state(s));
+        if (st == S_EMPTY) continue;
+        InputMapMsg* const m(ptr(s));
+        new (&new_msgs[size_t(s) & mask]) InputMapMsg(*m);
+        m->~InputMapMsg();
+        new_state[size_t(s) & mask] = st;
+    }
+
+    state_.swap(new_state);
+    msgs_.swap(new_msgs);
 }
 
-std::ostream& gcomm::operator<<(std::ostream& os, const InputMapMsgKey& mk)
+
+void gcomm::evs::InputMapMsgIndex::insert(seqno_t const     seq,
+                                          const UserMessage& msg,
+                                          const Datagram&    dg)
 {
-    return (os << "(" << mk.index() << "," << mk.seq() << ")");
+    assert(state(seq) == S_EMPTY);
+
+    if (size_ == 0)
+    {
+        base_ = seq;
+    }
+
+    const seqno_t lo(std::min(base_, seq));
+    const seqno_t hi(std::max(base_ + seqno_t(size_) - 1, seq));
+    gu_trace(reserve(hi - lo + 1));
+    base_ = lo;
+    size_ = hi - lo + 1;
+
+    new (ptr(seq)) InputMapMsg(msg, dg);
+    state_[pos(seq)] = S_MSG;
 }
 
 
-std::ostream& gcomm::evs::operator<<(std::ostream& os, const InputMapMsg& m)
+size_t gcomm::evs::InputMapMsgIndex::purge(seqno_t const seq)
 {
-    return (os << m.msg());
+    size_t ret(0);
+    const seqno_t last(std::min(seq, base_ + seqno_t(size_) - 1));
+
+    for (seqno_t s(base_); s <= last; ++s)
+    {
+        if (state(s) == S_RECOVERY)
+        {
+            ptr(s)->~InputMapMsg();
+            state_[pos(s)] = S_EMPTY;
+            ++ret;
+        }
+    }
+
+    while (size_ > 0 && base_ <= seq && state_[pos(base_)] == S_EMPTY)
+    {
+        ++base_;
+        --size_;
+    }
+
+    return ret;
 }
 
 
-std::ostream& gcomm::evs::operator<<(std::ostream& os, const InputMap& im)
+void gcomm::evs::InputMapMsgIndex::clear()
 {
-    return (os << "evs::input_map: {"
-            << "aru_seq="        << im.aru_seq()   << ","
-            << "safe_seq="       << im.safe_seq()  << ","
-            << "node_index="     << *im.node_index_
-#ifndef NDEBUG
-            << ","
-            << "msg_index="      << *im.msg_index_      << ","
-            << "recovery_index=" << *im.recovery_index_
-#endif // !NDEBUG
-            << "}");
+    for (seqno_t s(base_); s < base_ + seqno_t(size_); ++s)
+    {
+        if (state(s) != S_EMPTY)
+        {
+            ptr(s)->~InputMapMsg();
+            state_[pos(s)] = S_EMPTY;
+        }
+    }
+    size_ = 0;
 }
 
 
-
 //////////////////////////////////////////////////////////////////////////
 //
 // Constructors/destructors
@@ -116,18 +208,20 @@ std::ostream& gcomm::evs::operator<<(std::ostream& os, const InputMap& im)
 gcomm::evs::InputMap::InputMap() :
     safe_seq_       (-1),
     aru_seq_        (-1),
-    node_index_     (new InputMapNodeIndex()),
-    msg_index_      (new InputMapMsgIndex()),
-    recovery_index_ (new InputMapMsgIndex())
+    max_hs_         (-1),
+    begin_seq_      (0),
+    n_msgs_         (0),
+    n_recov_        (0),
+    lu_             (),
+    hs_             (),
+    safe_           (),
+    msg_index_      ()
 { }
 
 
 gcomm::evs::InputMap::~InputMap()
 {
     clear();
-    delete node_index_;
-    delete msg_index_;
-    delete recovery_index_;
 }
 
 
@@ -141,39 +235,24 @@ gcomm::evs::InputMap::~InputMap()
 
 void gcomm::evs::InputMap::reset(const size_t nodes)
 {
-    gcomm_assert(msg_index_->empty()                           == true &&
-                 recovery_index_->empty()                      == true);
-    node_index_->clear();
-
-    log_debug << " size " << node_index_->size();
-    gu_trace(node_index_->resize(nodes, InputMapNode()));
-    for (size_t i = 0; i < nodes; ++i)
-    {
-        node_index_->at(i).set_index(i);
-    }
-    log_debug << *node_index_ << " size " << node_index_->size();
+    gcomm_assert(n_msgs_ == 0 && n_recov_ == 0);
+
+    log_debug << " size " << lu_.size();
+    lu_.assign(nodes, 0);
+    hs_.assign(nodes, -1);
+    safe_.assign(nodes, -1);
+    msg_index_.clear();
+    gu_trace(msg_index_.resize(nodes));
+    max_hs_    = -1;
+    begin_seq_ = 0;
+    log_debug << *this << " size " << lu_.size();
 }
 
 
 gcomm::evs::seqno_t gcomm::evs::InputMap::min_hs() const
 {
-    seqno_t ret;
-    gcomm_assert(node_index_->empty() == false);
-    ret = min_element(node_index_->begin(),
-                      node_index_->end(),
-                      NodeIndexHSCmpOp())->range().hs();
-    return ret;
-}
-
-
-gcomm::evs::seqno_t gcomm::evs::InputMap::max_hs() const
-{
-    seqno_t ret;
-    gcomm_assert(node_index_->empty() == false);
-    ret = max_element(node_index_->begin(),
-                      node_index_->end(),
-                      NodeIndexHSCmpOp())->range().hs();
-    return ret;
+    gcomm_assert(hs_.empty() == false);
+    return min_seqno(hs_);
 }
 
 
@@ -188,17 +267,14 @@ void gcomm::evs::InputMap::set_safe_seq(const size_t uuid, const seqno_t seq)
 
     // Update node safe seq. Must (at least should) be updated
     // in monotonically increasing order if node works ok.
-    InputMapNode& node(node_index_->at(uuid));
-    gcomm_assert(seq >= node.safe_seq())
-        << "node.safe_seq=" << node.safe_seq()
+    seqno_t& node_safe_seq(safe_.at(uuid));
+    gcomm_assert(seq >= node_safe_seq)
+        << "node.safe_seq=" << node_safe_seq
         << " seq=" << seq;
-    node.set_safe_seq(seq);
+    node_safe_seq = seq;
 
     // Update global safe seq which must be monotonically increasing.
-    InputMapNodeIndex::const_iterator min =
-        min_element(node_index_->begin(), node_index_->end(),
-                    NodeIndexSafeSeqCmpOp());
-    const seqno_t minval = min->safe_seq();
+    const seqno_t minval(min_seqno(safe_));
     gcomm_assert(minval >= safe_seq_);
     safe_seq_ = minval;
 
@@ -211,21 +287,26 @@ void gcomm::evs::InputMap::set_safe_seq(const size_t uuid, const seqno_t seq)
 
 void gcomm::evs::InputMap::clear()
 {
-    if (msg_index_->empty() == false)
+    if (n_msgs_ > 0)
     {
-        log_warn << "discarding " << msg_index_->size() <<
+        log_warn << "discarding " << n_msgs_ <<
             " messages from message index";
     }
-    msg_index_->clear();
-    if (recovery_index_->empty() == false)
+    if (n_recov_ > 0)
     {
-        log_debug << "discarding " << recovery_index_->size()
+        log_debug << "discarding " << n_recov_
                   << " messages from recovery index";
     }
-    recovery_index_->clear();
-    node_index_->clear();
-    aru_seq_ = -1;
-    safe_seq_ = -1;
+    msg_index_.clear();
+    lu_.clear();
+    hs_.clear();
+    safe_.clear();
+    n_msgs_    = 0;
+    n_recov_   = 0;
+    max_hs_    = -1;
+    begin_seq_ = 0;
+    aru_seq_   = -1;
+    safe_seq_  = -1;
 }
 
 
@@ -234,8 +315,6 @@ gcomm::evs::InputMap::insert(const size_t uuid,
                              const UserMessage& msg,
                              const Datagram& rb)
 {
-    Range range;
-
     // Only insert messages with meaningful seqno
     gcomm_assert(msg.seq() > -1);
 
@@ -244,11 +323,11 @@ gcomm::evs::InputMap::insert(const size_t uuid,
     // messages.
     gcomm_assert(aru_seq_ < msg.seq())
         << "aru seq " << aru_seq_ << " msg seq " << msg.seq()
-        << " index size " << msg_index_->size();
+        << " index size " << n_msgs_;
 
-    gcomm_assert(uuid < node_index_->size());
-    InputMapNode& node((*node_index_)[uuid]);
-    range = node.range();
+    gcomm_assert(uuid < msg_index_.size());
+    InputMapMsgIndex& index(msg_index_[uuid]);
+    Range range(lu_[uuid], hs_[uuid]);
 
     // User should check LU before inserting. This check is left
     // also in optimized builds since violating it may cause duplicate
@@ -258,47 +337,37 @@ gcomm::evs::InputMap::insert(const size_t uuid,
         << msg.seq();
 
     // Check whether this message has already been seen
-    if (msg.seq() < node.range().lu() ||
-        (msg.seq() <= node.range().hs() &&
-         recovery_index_->find(InputMapMsgKey(node.index(), msg.seq())) !=
-         recovery_index_->end()))
+    if (msg.seq() < range.lu() ||
+        index.state(msg.seq()) == InputMapMsgIndex::S_RECOVERY)
     {
-        return node.range();
+        return range;
     }
 
     // Loop over message seqno range and insert messages when not
     // already found
     for (seqno_t s = msg.seq(); s <= msg.seq() + msg.seq_range(); ++s)
     {
-        InputMapMsgIndex::iterator msg_i;
-
-        if (range.hs() < s)
+        if (index.state(s) == InputMapMsgIndex::S_EMPTY)
         {
-            msg_i = msg_index_->end();
-        }
-        else
-        {
-            msg_i = msg_index_->find(InputMapMsgKey(node.index(), s));
-        }
+            if (s == msg.seq())
+            {
+                gu_trace(index.insert(s, msg, rb));
+            }
+            else
+            {
+                gu_trace(index.insert(s,
+                                      UserMessage(msg.version(),
+                                                  msg.source(),
+                                                  msg.source_view_id(),
+                                                  s,
+                                                  msg.aru_seq(),
+                                                  0,
+                                                  O_DROP),
+                                      Datagram()));
+            }
 
-        if (msg_i == msg_index_->end())
-        {
-            Datagram ins_dg(s == msg.seq() ?
-                                Datagram(rb)   :
-                                Datagram());
-            gu_trace((void)msg_index_->insert_unique(
-                         std::make_pair(
-                             InputMapMsgKey(node.index(), s),
-                             InputMapMsg(
-                                 (s == msg.seq() ?
-                                  msg :
-                                  UserMessage(msg.version(),
-                                              msg.source(),
-                                              msg.source_view_id(),
-                                              s,
-                                              msg.aru_seq(),
-                                              0,
-                                              O_DROP)), ins_dg))));
+            if (n_msgs_ == 0 || s < begin_seq_) begin_seq_ = s;
+            ++n_msgs_;
         }
 
         // Update highest seen
@@ -315,48 +384,90 @@ gcomm::evs::InputMap::insert(const size_t uuid,
             {
                 ++i;
             }
-            while (
-                i <= range.hs() &&
-                (msg_index_->find(InputMapMsgKey(node.index(), i))
-                 != msg_index_->end() ||
-                 recovery_index_->find(InputMapMsgKey(node.index(), i))
-                 != recovery_index_->end()));
+            while (i <= range.hs() &&
+                   index.state(i) != InputMapMsgIndex::S_EMPTY);
             range.set_lu(i);
         }
     }
 
-    node.set_range(range);
+    lu_[uuid] = range.lu();
+    hs_[uuid] = range.hs();
+    max_hs_   = std::max(max_hs_, range.hs());
     update_aru();
     return range;
 }
 
 
+gcomm::evs::InputMap::iterator gcomm::evs::InputMap::begin() const
+{
+    if (n_msgs_ == 0) return end();
+
+    iterator ret(this, begin_seq_, 0);
+    if (msg_index_[0].state(begin_seq_) != InputMapMsgIndex::S_MSG)
+    {
+        next(ret);
+    }
+    assert(ret != end());
+    begin_seq_ = ret.seq_;
+    return ret;
+}
+
+
+void gcomm::evs::InputMap::next(iterator& i) const
+{
+    const size_t n(msg_index_.size());
+    size_t idx(i.index_ + 1);
+
+    for (seqno_t seq(i.seq_); seq <= max_hs_; ++seq, idx = 0)
+    {
+        for (; idx < n; ++idx)
+        {
+            if (msg_index_[idx].state(seq) == InputMapMsgIndex::S_MSG)
+            {
+                i.seq_   = seq;
+                i.index_ = idx;
+                return;
+            }
+        }
+    }
+
+    i = end();
+}
+
+
 void gcomm::evs::InputMap::erase(iterator i)
 {
-    gu_trace(recovery_index_->insert_unique(*i));
-    gu_trace(msg_index_->erase(i));
+    InputMapMsgIndex& index(msg_index_[i.index_]);
+    gcomm_assert(index.state(i.seq_) == InputMapMsgIndex::S_MSG)
+        << "message " << key(i) << " not found";
+    index.set_state(i.seq_, InputMapMsgIndex::S_RECOVERY);
+    --n_msgs_;
+    ++n_recov_;
 }
 
 
 gcomm::evs::InputMap::iterator
 gcomm::evs::InputMap::find(const size_t uuid, const seqno_t seq) const
 {
-    iterator ret;
-    const InputMapNode& node(node_index_->at(uuid));
-    const InputMapMsgKey key(node.index(), seq);
-    gu_trace(ret = msg_index_->find(key));
-    return ret;
+    const InputMapMsgIndex& index(msg_index_.at(uuid));
+    if (index.state(seq) == InputMapMsgIndex::S_MSG)
+    {
+        return iterator(this, seq, uuid);
+    }
+    return end();
 }
 
 
 gcomm::evs::InputMap::iterator
 gcomm::evs::InputMap::recover(const size_t uuid, const seqno_t seq) const
 {
-    iterator ret;
-    const InputMapNode& node(node_index_->at(uuid));
-    const InputMapMsgKey key(node.index(), seq);
-    gu_trace(ret = recovery_index_->find_checked(key));
-    return ret;
+    const InputMapMsgIndex& index(msg_index_.at(uuid));
+    if (index.state(seq) != InputMapMsgIndex::S_RECOVERY)
+    {
+        gu_throw_fatal << "element " << InputMapMsgKey(uuid, seq)
+                       << " not found";
+    }
+    return iterator(this, seq, uuid);
 }
 
 static void append_gap_range_list(std::vector<gcomm::evs::Range>& range_list,
@@ -380,19 +491,12 @@ static void append_gap_range_list(std::vector<gcomm::evs::Range>& range_list,
 std::vector<gcomm::evs::Range>
 gcomm::evs::InputMap::gap_range_list(size_t index, const Range& range) const
 {
-    const InputMapNode& node(node_index_->at(index));
-    seqno_t max_lu(std::max(range.lu(), node.range().lu()));
+    const InputMapMsgIndex& msg_index(msg_index_.at(index));
+    seqno_t max_lu(std::max(range.lu(), lu_[index]));
     std::vector<Range> ret;
     for (seqno_t seq(range.lu()); seq <= range.hs(); ++seq)
     {
-        const InputMapMsgKey key(index, seq);
-        gcomm::evs::InputMap::const_iterator msg_i(msg_index_->find(key));
-        if (msg_i != msg_index_->end())
-        {
-            continue;
-        }
-        msg_i = recovery_index_->find(key);
-        if (msg_i != recovery_index_->end())
+        if (msg_index.state(seq) != InputMapMsgIndex::S_EMPTY)
         {
             continue;
         }
@@ -412,10 +516,7 @@ gcomm::evs::InputMap::gap_range_list(size_t index, const Range& range) const
 
 inline void gcomm::evs::InputMap::update_aru()
 {
-    InputMapNodeIndex::const_iterator min =
-        min_element(node_index_->begin(), node_index_->end(), NodeIndexLUCmpOp());
-
-    const seqno_t minval = min->range().lu();
+    const seqno_t minval(min_seqno(lu_));
     /* aru_seq must not decrease */
     gcomm_assert(minval - 1 >= aru_seq_);
     aru_seq_ = minval - 1;
@@ -424,8 +525,9 @@ inline void gcomm::evs::InputMap::update_aru()
 
 void gcomm::evs::InputMap::cleanup_recovery_index()
 {
-    gcomm_assert(node_index_->size() > 0);
-    InputMapMsgIndex::iterator i = recovery_index_->lower_bound(
-        InputMapMsgKey(0, safe_seq_ + 1));
-    recovery_index_->erase(recovery_index_->begin(), i);
+    gcomm_assert(msg_index_.size() > 0);
+    for (size_t i(0); i < msg_index_.size(); ++i)
+    {
+        n_recov_ -= msg_index_[i].purge(safe_seq_);
+    }
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -20,9 +20,10 @@
 #define EVS_INPUT_MAP2_HPP
 
 #include "evs_message2.hpp"
-#include "gcomm/map.hpp"
 #include "gcomm/datagram.hpp"
 
+#include <limits>
+#include <type_traits>
 #include <vector>
 
 
@@ -36,10 +37,6 @@ namespace gcomm
         class InputMapMsg;
         std::ostream& operator<<(std::ostream&, const InputMapMsg&);
         class InputMapMsgIndex;
-        class InputMapNode;
-        std::ostream& operator<<(std::ostream&, const InputMapNode&);
-        typedef std::vector<InputMapNode> InputMapNodeIndex;
-        std::ostream& operator<<(std::ostream&, const InputMapNodeIndex&);
         class InputMap;
         std::ostream& operator<<(std::ostream&, const InputMap&);
     }
@@ -92,54 +89,105 @@ private:
 };
 
 
-#if defined(GALERA_USE_BOOST_POOL_ALLOC)
+/*
+ * Messages of a single source node, addressed by seqno.
+ *
+ * Messages are kept in a ring buffer which covers the seqno window from
+ * the lowest seqno not yet purged up to the highest seen. Slot states are
+ * kept apart from the messages so that scanning for present messages
+ * touches only a byte per seqno.
+ */
+class gcomm::evs::InputMapMsgIndex
+{
+public:
 
-#include <boost/pool/pool_alloc.hpp>
+    enum State
+    {
+        S_EMPTY,    /*!< No message                                   */
+        S_MSG,      /*!< Message waiting for delivery                 */
+        S_RECOVERY  /*!< Delivered message kept for retransmission    */
+    };
+
+    InputMapMsgIndex() :
+        state_(),
+        msgs_ (),
+        base_ (0),
+        size_ (0)
+    { }
 
-class gcomm::evs::InputMapMsgIndex :
-    public Map<InputMapMsgKey, InputMapMsg,
-               std::map<InputMapMsgKey,
-                        InputMapMsg,
-                        std::less<InputMapMsgKey>,
-                        boost::fast_pool_allocator<
-                            std::pair<const InputMapMsgKey, InputMapMsg>,
-                            boost::default_user_allocator_new_delete,
-                            boost::details::pool::null_mutex
-                            >
-                        >
-               >
-{};
+    InputMapMsgIndex(InputMapMsgIndex&& other) :
+        state_(),
+        msgs_ (),
+        base_ (other.base_),
+        size_ (other.size_)
+    {
+        state_.swap(other.state_);
+        msgs_.swap(other.msgs_);
+        other.size_ = 0;
+    }
 
-#else /* GALERA_USE_BOOST_POOL_ALLOC */
+    ~InputMapMsgIndex() { clear(); }
 
-class gcomm::evs::InputMapMsgIndex :
-    public Map<InputMapMsgKey, InputMapMsg>
-{};
+    State state(const seqno_t seq) const
+    {
+        if (seq < base_ || seq >= base_ + seqno_t(size_)) return S_EMPTY;
+        return State(state_[pos(seq)]);
+    }
 
-#endif /* GALERA_USE_BOOST_POOL_ALLOC */
+    void set_state(const seqno_t seq, const State st)
+    {
+        assert(state(seq) != S_EMPTY && st != S_EMPTY);
+        state_[pos(seq)] = st;
+    }
 
-/* Internal node representation */
-class gcomm::evs::InputMapNode
-{
-public:
-    InputMapNode() : idx_(), range_(0, -1), safe_seq_(-1) { }
+    const InputMapMsg& msg(const seqno_t seq) const
+    {
+        assert(state(seq) != S_EMPTY);
+        return *reinterpret_cast<const InputMapMsg*>(&msgs_[pos(seq)]);
+    }
 
-    void   set_range     (const Range   r)       { range_     = r; }
-    void   set_safe_seq  (const seqno_t s)       { safe_seq_  = s; }
-    void   set_index     (const size_t  i)       { idx_       = i; }
+    /*!
+     * Store new message, the slot must be empty.
+     */
+    void insert(seqno_t seq, const UserMessage& msg, const Datagram& dg);
 
-    Range   range     ()               const { return range_;     }
-    seqno_t safe_seq  ()               const { return safe_seq_;  }
-    size_t  index     ()               const { return idx_;       }
+    /*!
+     * Drop recovery messages up to seq.
+     *
+     * @return Number of messages dropped
+     */
+    size_t purge(seqno_t seq);
+
+    /*!
+     * Drop all messages.
+     */
+    void clear();
 
 private:
-    size_t  idx_;
-    Range   range_;
-    seqno_t safe_seq_;
-};
 
+    InputMapMsgIndex(const InputMapMsgIndex&);
+    void operator=(const InputMapMsgIndex&);
 
+    typedef std::aligned_storage<sizeof(InputMapMsg),
+                                 alignof(InputMapMsg)>::type Storage;
 
+    size_t pos(const seqno_t seq) const
+    {
+        return (size_t(seq) & (state_.size() - 1));
+    }
+
+    InputMapMsg* ptr(const seqno_t seq)
+    {
+        return reinterpret_cast<InputMapMsg*>(&msgs_[pos(seq)]);
+    }
+
+    void reserve(size_t size);
+
+    std::vector<unsigned char> state_; /*!< Slot states, size power of 2 */
+    std::vector<Storage>       msgs_;  /*!< Slot messages               */
+    seqno_t                    base_;  /*!< Lowest seqno in window      */
+    size_t                     size_;  /*!< Window size                 */
+};
 
 
 /*!
@@ -150,9 +198,58 @@ class gcomm::evs::InputMap
 {
 public:
 
-    /* Iterators exposed to user */
-    typedef InputMapMsgIndex::iterator iterator;
-    typedef InputMapMsgIndex::const_iterator const_iterator;
+    /*!
+     * Iterator over messages waiting for delivery in (seqno, node index)
+     * order. Iterator stays valid until the message it points to is
+     * purged from the input map.
+     */
+    class iterator
+    {
+    public:
+        iterator() : im_(0), seq_(end_seq()), index_(0) { }
+
+        iterator& operator++() { im_->next(*this); return *this; }
+
+        bool operator==(const iterator& cmp) const
+        {
+            return (seq_ == cmp.seq_ && index_ == cmp.index_);
+        }
+
+        bool operator!=(const iterator& cmp) const
+        {
+            return !(*this == cmp);
+        }
+
+    private:
+
+        friend class InputMap;
+
+        iterator(const InputMap* im, const seqno_t seq, const size_t index)
+            :
+            im_   (im),
+            seq_  (seq),
+            index_(index)
+        { }
+
+        static seqno_t end_seq()
+        {
+            return std::numeric_limits<seqno_t>::max();
+        }
+
+        const InputMap* im_;
+        seqno_t         seq_;
+        size_t          index_;
+    };
+
+    static InputMapMsgKey key(const iterator& i)
+    {
+        return InputMapMsgKey(i.index_, i.seq_);
+    }
+
+    static const InputMapMsg& value(const iterator& i)
+    {
+        return i.im_->msg_index_[i.index_].msg(i.seq_);
+    }
 
     /*!
      * Default constructor.
@@ -200,7 +297,7 @@ public:
      */
     seqno_t safe_seq(const size_t uuid) const
     {
-        return node_index_->at(uuid).safe_seq();
+        return safe_.at(uuid);
     }
 
     /*!
@@ -214,26 +311,33 @@ public:
      */
     Range range   (const size_t uuid) const
     {
-        return node_index_->at(uuid).range();
+        return Range(lu_.at(uuid), hs_.at(uuid));
     }
 
     seqno_t min_hs() const;
 
-    seqno_t max_hs() const;
+    seqno_t max_hs() const
+    {
+        gcomm_assert(hs_.empty() == false);
+        return max_hs_;
+    }
 
     /*!
      * Get iterator to the beginning of the input map
      *
      * @return Iterator pointing to the first element
      */
-    iterator begin() const { return msg_index_->begin(); }
+    iterator begin() const;
 
     /*!
      * Get iterator next to the last element of the input map
      *
      * @return Iterator pointing past the last element
      */
-    iterator end  () const { return msg_index_->end(); }
+    iterator end  () const
+    {
+        return iterator(this, iterator::end_seq(), 0);
+    }
 
     /*!
      * Check if message pointed by iterator fulfills O_SAFE condition.
@@ -242,8 +346,7 @@ public:
      */
     bool is_safe  (iterator i) const
     {
-        const seqno_t seq(InputMapMsgIndex::key(i).seq());
-        return (seq <= safe_seq_);
+        return (i.seq_ <= safe_seq_);
     }
 
     /*!
@@ -253,8 +356,7 @@ public:
      */
     bool is_agreed(iterator i) const
     {
-        const seqno_t seq(InputMapMsgIndex::key(i).seq());
-        return (seq <= aru_seq_);
+        return (i.seq_ <= aru_seq_);
     }
 
     /*!
@@ -264,10 +366,7 @@ public:
      */
     bool is_fifo  (iterator i) const
     {
-        const seqno_t seq(InputMapMsgIndex::key(i).seq());
-        const InputMapNode& node((*node_index_)[
-                                     InputMapMsgIndex::key(i).index()]);
-        return (node.range().lu() > seq);
+        return (lu_[i.index_] > i.seq_);
     }
 
     /*!
@@ -348,6 +447,11 @@ private:
     InputMap(const InputMap&);
     void operator=(const InputMap&);
 
+    /*!
+     * Advance iterator to the next message waiting for delivery.
+     */
+    void next(iterator& i) const;
+
     /*!
      * Update aru_seq value to represent current state.
      */
@@ -358,11 +462,17 @@ private:
      */
     void cleanup_recovery_index();
 
-    seqno_t            safe_seq_;       /*!< Safe seqno               */
-    seqno_t            aru_seq_;        /*!< All received up to seqno */
-    InputMapNodeIndex* node_index_;     /*!< Index of nodes           */
-    InputMapMsgIndex*  msg_index_;      /*!< Index of messages        */
-    InputMapMsgIndex*  recovery_index_; /*!< Recovery index           */
+    seqno_t               safe_seq_;  /*!< Safe seqno                      */
+    seqno_t               aru_seq_;   /*!< All received up to seqno        */
+    seqno_t               max_hs_;    /*!< Highest seen seqno of all nodes */
+    mutable seqno_t       begin_seq_; /*!< No messages below this seqno    */
+    size_t                n_msgs_;    /*!< Messages waiting for delivery   */
+    size_t                n_recov_;   /*!< Messages kept for recovery      */
+    /* Per node state, kept in separate arrays for fast min/max */
+    std::vector<seqno_t>  lu_;        /*!< Lowest unseen seqno             */
+    std::vector<seqno_t>  hs_;        /*!< Highest seen seqno              */
+    std::vector<seqno_t>  safe_;      /*!< Safe seqno reported by node     */
+    std::vector<InputMapMsgIndex> msg_index_; /*!< Messages per node       */
 };
 
 #endif // EVS_INPUT_MAP2_HPP
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2023 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 #include "evs_proto.hpp"
@@ -168,9 +168,11 @@ gcomm::evs::Proto::Proto(gu::Config&    conf,
                                    Defaults::EvsUserSendWindow),
                     gu::from_string<seqno_t>(Defaults::EvsUserSendWindowMin),
                     send_window_ + 1)),
+    adaptive_window_(param<bool>(conf, uri, Conf::EvsAdaptiveWindow,
+                                 Defaults::EvsAdaptiveWindow)),
+    window_ctl_(send_window_),
     bytes_since_request_user_msg_feedback_(),
     output_(),
-    send_buf_(),
     max_output_size_(128),
     mtu_(mtu),
     use_aggregate_(param<bool>(conf, uri, Conf::EvsUseAggregate, "true")),
@@ -200,6 +202,7 @@ gcomm::evs::Proto::Proto(gu::Config&    conf,
     conf.set(Conf::EvsSendWindow, gu::to_string(send_window_));
     conf.set(Conf::EvsUserSendWindow, gu::to_string(user_send_window_));
     conf.set(Conf::EvsUseAggregate, gu::to_string(use_aggregate_));
+    conf.set(Conf::EvsAdaptiveWindow, gu::to_string(adaptive_window_));
     conf.set(Conf::EvsDebugLogMask, gu::to_string(debug_mask_, std::hex));
     conf.set(Conf::EvsInfoLogMask, gu::to_string(info_mask_, std::hex));
     conf.set(Conf::EvsMaxInstallTimeouts, gu::to_string(max_install_timeouts_));
@@ -215,6 +218,7 @@ gcomm::evs::Proto::Proto(gu::Config&    conf,
 
     NodeMap::value(self_i_).set_index(0);
     input_map_->reset(1);
+    window_ctl_.reset(1, 0);
     current_view_.add_member(my_uuid_, segment_);
     // we don't need to store previous views, do we ?
     if (rst_view) {
@@ -222,10 +226,6 @@ gcomm::evs::Proto::Proto(gu::Config&    conf,
         previous_views_.insert(
             std::make_pair(rst_view -> id(), gu::datetime::Date::monotonic()));
     }
-    if (mtu_ != std::numeric_limits<size_t>::max())
-    {
-        send_buf_.reserve(mtu_);
-    }
 }
 
 
@@ -257,6 +257,7 @@ gcomm::evs::Proto::set_param(const std::string& key, const std::string& val,
                                    gu::from_string<seqno_t>(val),
                                    user_send_window_,
                                    std::numeric_limits<seqno_t>::max());
+        window_ctl_.set_max_window(send_window_);
         conf_.set(Conf::EvsSendWindow, gu::to_string(send_window_));
         return true;
     }
@@ -270,6 +271,12 @@ gcomm::evs::Proto::set_param(const std::string& key, const std::string& val,
         conf_.set(Conf::EvsUserSendWindow, gu::to_string(user_send_window_));
         return true;
     }
+    else if (key == gcomm::Conf::EvsAdaptiveWindow)
+    {
+        adaptive_window_ = gu::from_string<bool>(val);
+        conf_.set(Conf::EvsAdaptiveWindow, gu::to_string(adaptive_window_));
+        return true;
+    }
     else if (key == gcomm::Conf::EvsMaxInstallTimeouts)
     {
         max_install_timeouts_ = check_range(
@@ -464,6 +471,25 @@ void gcomm::evs::Proto::handle_get_status(gu::Status& status) const
     }
     status.insert("evs_evict_list", evict_list_str);
 
+    status.insert("evs_send_window", gu::to_string(send_window()));
+    status.insert("evs_user_send_window", gu::to_string(user_send_window()));
+    if (adaptive_window_)
+    {
+        status.insert("evs_rtt", gu::to_string(window_ctl_.rtt()));
+        status.insert("evs_rtt_min", gu::to_string(window_ctl_.min_rtt()));
+        std::string node_rtt_str;
+        for (NodeMap::const_iterator i(known_.begin()); i != known_.end(); ++i)
+        {
+            const Node& node(NodeMap::value(i));
+            if (i == self_i_ || node.index() == Node::invalid_index) continue;
+            if (node_rtt_str.empty() == false) node_rtt_str += ",";
+            node_rtt_str += NodeMap::key(i).full_str()
+                + ":"
+                + gu::to_string(window_ctl_.rtt(node.index()));
+        }
+        status.insert("evs_node_rtt", node_rtt_str);
+    }
+
     if (info_mask_ & I_STATISTICS)
     {
         status.insert("evs_safe_hs", hs_safe_.to_string());
@@ -619,7 +645,7 @@ void gcomm::evs::Proto::handle_retrans_timer()
                 install_message_->set_flags(
                     install_message_->flags() | Message::F_RETRANS);
                 (void)serialize(*install_message_, buf);
-                Datagram dg(buf);
+                Datagram dg(std::move(buf));
                 // Must not be sent as delegate, newly joining node
                 // will filter them out in handle_msg().
                 gu_trace(send_down(dg, ProtoDownMeta()));
@@ -1556,6 +1582,11 @@ int gcomm::evs::Proto::send_user(Datagram& dg,
     gu_trace(pop_header(msg, dg));
     sent_msgs_[Message::EVS_T_USER]++;
 
+    if (adaptive_window_)
+    {
+        window_ctl_.sent(last_sent_, gu::datetime::Date::monotonic());
+    }
+
     if (delivering_ == false)
     {
         gu_trace(deliver());
@@ -1593,13 +1624,16 @@ int gcomm::evs::Proto::send_user(const seqno_t win)
 {
     gcomm_assert(output_.empty() == false);
     gcomm_assert(state() == S_OPERATIONAL);
-    gcomm_assert(win <= send_window_);
+    gcomm_assert(win <= send_window());
     int ret;
     size_t alen;
     if (use_aggregate_ == true && (alen = aggregate_len()) > 0)
     {
-        // Messages can be aggregated into single message
-        send_buf_.resize(alen);
+        // Messages can be aggregated into single message. It is assembled
+        // right in the buffer which will be sent and kept in the input map,
+        // so each queued message is copied only once.
+        gu::SharedBuffer buf(gu::make_shared_buffer(alen));
+        gu::byte_t* const ptr(&(*buf)[0]);
         size_t offset(0);
         size_t n(0);
 
@@ -1612,21 +1646,20 @@ int gcomm::evs::Proto::send_user(const seqno_t win)
             AggregateMessage am(0, dg.len(), dm.user_type());
             gcomm_assert(alen >= dg.len() + am.serial_size());
 
-            gu_trace(offset = am.serialize(&send_buf_[0],
-                                           send_buf_.size(), offset));
+            gu_trace(offset = am.serialize(ptr, buf->size(), offset));
             std::copy(dg.header() + dg.header_offset(),
                       dg.header() + dg.header_size(),
-                      &send_buf_[0] + offset);
+                      ptr + offset);
             offset += (dg.header_len());
             std::copy(dg.payload().begin(), dg.payload().end(),
-                      &send_buf_[0] + offset);
+                      ptr + offset);
             offset += dg.payload().size();
             alen -= dg.len() + am.serial_size();
             ++n;
             ++i;
         }
-        Datagram dg(gu::SharedBuffer(new gu::Buffer(send_buf_.begin(),
-                                                        send_buf_.end())));
+        assert(offset == buf->size());
+        Datagram dg(std::move(buf));
         if ((ret = send_user(dg, 0xff, ord, win, -1, n)) == 0)
         {
             while (n-- > 0)
@@ -1736,7 +1769,7 @@ void gcomm::evs::Proto::send_gap(EVS_CALLER_ARG,
     evs_log_debug(D_GAP_MSGS) << EVS_LOG_METHOD << gm;
     gu::Buffer buf;
     serialize(gm, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     int err = send_down(dg, ProtoDownMeta(range_uuid));
     if (err != 0)
     {
@@ -1903,7 +1936,7 @@ void gcomm::evs::Proto::send_join(bool handle)
 
     gu::Buffer buf;
     serialize(jm, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     int err = send_down(dg, ProtoDownMeta());
 
     if (err != 0)
@@ -1960,7 +1993,7 @@ void gcomm::evs::Proto::send_leave(bool handle)
 
     gu::Buffer buf;
     serialize(lm, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     int err = send_down(dg, ProtoDownMeta());
     if (err != 0)
     {
@@ -2046,7 +2079,7 @@ void gcomm::evs::Proto::send_install(EVS_CALLER_ARG)
 
     gu::Buffer buf;
     serialize(imsg, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     int err = send_down(dg, ProtoDownMeta());
     if (err != 0)
     {
@@ -2068,7 +2101,7 @@ void gcomm::evs::Proto::send_delayed_list()
     }
     gu::Buffer buf;
     serialize(elm, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     (void)send_down(dg, ProtoDownMeta());
     handle_delayed_list(elm, self_i_);
 }
@@ -2088,6 +2121,11 @@ void gcomm::evs::Proto::resend(const UUID& gap_source, const Range range)
         return;
     }
 
+    if (adaptive_window_)
+    {
+        window_ctl_.lost(gu::datetime::Date::monotonic());
+    }
+
     evs_log_debug(D_RETRANS) << " retrans requested by "
                              << gap_source
                              << " "
@@ -2118,9 +2156,9 @@ void gcomm::evs::Proto::resend(const UUID& gap_source, const Range range)
             }
         }
 
-        const UserMessage& msg(InputMapMsgIndex::value(msg_i).msg());
+        const UserMessage& msg(InputMap::value(msg_i).msg());
         gcomm_assert(msg.source() == uuid());
-        Datagram rb(InputMapMsgIndex::value(msg_i).rb());
+        Datagram rb(InputMap::value(msg_i).rb());
         assert(rb.offset() == 0);
 
         UserMessage um(msg.version(),
@@ -2203,10 +2241,10 @@ void gcomm::evs::Proto::recover(const UUID& gap_source,
             }
         }
 
-        const UserMessage& msg(InputMapMsgIndex::value(msg_i).msg());
+        const UserMessage& msg(InputMap::value(msg_i).msg());
         assert(msg.source() == range_uuid);
 
-        Datagram rb(InputMapMsgIndex::value(msg_i).rb());
+        Datagram rb(InputMap::value(msg_i).rb());
         assert(rb.offset() == 0);
         UserMessage um(msg.version(),
                        msg.source(),
@@ -2706,7 +2744,7 @@ int gcomm::evs::Proto::handle_down(Datagram& wb, const ProtoDownMeta& dm)
         err = send_user(wb,
                         dm.user_type(),
                         dm.order(),
-                        user_send_window_,
+                        user_send_window(),
                         -1);
 
         switch (err)
@@ -2971,6 +3009,8 @@ void gcomm::evs::Proto::shift_to(const State s, const bool send_j)
         }
 
         input_map_->reset(current_view_.members().size());
+        window_ctl_.reset(current_view_.members().size(),
+                          NodeMap::value(self_i_).index());
         last_sent_ = -1;
         state_ = S_OPERATIONAL;
         deliver_reg_view(*install_message_, previous_view_);
@@ -3103,15 +3143,14 @@ void gcomm::evs::Proto::deliver_finish(const InputMapMsg& msg)
                                     msg.rb().payload().size(),
                                     offset));
             Datagram dg(
-                gu::SharedBuffer(
-                    new gu::Buffer(
-                        msg.rb().payload().data()
-                        + offset
-                        + am.serial_size(),
-                        msg.rb().payload().data()
-                        + offset
-                        + am.serial_size()
-                        + am.len())));
+                gu::make_shared_buffer(
+                    msg.rb().payload().data()
+                    + offset
+                    + am.serial_size(),
+                    msg.rb().payload().data()
+                    + offset
+                    + am.serial_size()
+                    + am.len()));
             ProtoUpMeta um(msg.msg().source(),
                            msg.msg().source_view_id(),
                            0,
@@ -3148,10 +3187,10 @@ void gcomm::evs::Proto::deliver()
 
     // Read input map head until a message which cannot be
     // delivered is enountered.
-    InputMapMsgIndex::iterator i;
+    InputMap::iterator i;
     while ((i = input_map_->begin()) != input_map_->end())
     {
-        const InputMapMsg& msg(InputMapMsgIndex::value(i));
+        const InputMapMsg& msg(InputMap::value(i));
         if ((msg.msg().order() <= O_SAFE &&
              input_map_->is_safe(i) == true) ||
             (msg.msg().order() <= O_AGREED &&
@@ -3213,7 +3252,7 @@ void gcomm::evs::Proto::deliver_trans()
     {
         i_next = i;
         ++i_next;
-        const InputMapMsg& msg(InputMapMsgIndex::value(i));
+        const InputMapMsg& msg(InputMap::value(i));
         bool deliver = false;
         switch (msg.msg().order())
         {
@@ -3267,7 +3306,7 @@ void gcomm::evs::Proto::deliver_trans()
     {
         i_next = i;
         ++i_next;
-        const InputMapMsg& msg(InputMapMsgIndex::value(i));
+        const InputMapMsg& msg(InputMap::value(i));
         NodeMap::iterator ii;
         gu_trace(ii = known_.find_checked(msg.msg().source()));
 
@@ -3300,6 +3339,10 @@ gcomm::evs::seqno_t gcomm::evs::Proto::update_im_safe_seq(const size_t uuid,
     if (im_safe_seq  < seq)
     {
         input_map_->set_safe_seq(uuid, seq);
+        if (adaptive_window_)
+        {
+            window_ctl_.acked(uuid, seq, gu::datetime::Date::monotonic());
+        }
     }
     return im_safe_seq;
 }
@@ -3319,7 +3362,7 @@ void gcomm::evs::Proto::send_request_retrans_gap(const UUID& target,
                   Message::F_RETRANS);
     gu::Buffer buf;
     serialize(gm, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     int err = send_down(dg, ProtoDownMeta(target));
     if (err != 0)
     {
@@ -3778,7 +3821,7 @@ void gcomm::evs::Proto::handle_user(const UserMessage& msg,
         while (output_.empty() == false)
         {
             int err;
-            gu_trace(err = send_user(send_window_));
+            gu_trace(err = send_user(send_window()));
             if (err != 0)
             {
                 if (err == EAGAIN && n_sent == 0)
@@ -3968,7 +4011,7 @@ void gcomm::evs::Proto::handle_gap(const GapMessage& msg, NodeMap::iterator ii)
             while (output_.empty() == false)
             {
                 int err;
-                gu_trace(err = send_user(send_window_));
+                gu_trace(err = send_user(send_window()));
                 if (err != 0)
                     break;
             }
@@ -4048,7 +4091,7 @@ void gcomm::evs::Proto::retrans_leaves(const MessageNodeList& node_list)
 
                 gu::Buffer buf;
                 serialize(send_lm, buf);
-                Datagram dg(buf);
+                Datagram dg(std::move(buf));
                 gu_trace(send_delegate(dg, UUID::nil()));
             }
         }
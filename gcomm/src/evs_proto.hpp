@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2023 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 /*!
@@ -21,6 +21,7 @@
 #include "evs_seqno.hpp"
 #include "evs_node.hpp"
 #include "evs_consensus.hpp"
+#include "evs_send_window.hpp"
 #include "protocol_version.hpp"
 
 #include "gu_datetime.hpp"
@@ -152,6 +153,17 @@ public:
     // Return true if the message with seqno and given send window will
     // cause flow control.
     bool is_flow_control(const seqno_t seqno, const seqno_t win) const;
+    // Effective send windows, adjusted by window_ctl_ within configured
+    // limits if adaptive send window is enabled.
+    seqno_t send_window() const
+    {
+        return (adaptive_window_ ? window_ctl_.window() : send_window_);
+    }
+    seqno_t user_send_window() const
+    {
+        return (adaptive_window_ ?
+                window_ctl_.scale(user_send_window_) : user_send_window_);
+    }
     // Return true if sending the user message contained in dg
     // should make all nodes to respond to the message. This happens
     // if sending the datagram would cause some predefined (@todo name
@@ -510,6 +522,9 @@ private:
     seqno_t send_window_;
     // User send window size
     seqno_t user_send_window_;
+    // Adapt send windows to RTT and retransmissions
+    bool adaptive_window_;
+    SendWindow window_ctl_;
     // Bytes since the last user msg which will require feedback from
     // other nodes (i.e. sent without F_MSG_MORE)
     size_t bytes_since_request_user_msg_feedback_;
@@ -572,7 +587,6 @@ private:
         queue_type queue_;
     } output_;
 
-    std::vector<gu::byte_t> send_buf_;
     uint32_t max_output_size_;
     size_t mtu_;
     bool use_aggregate_;
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+#include "evs_send_window.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    // Max number of outstanding local messages timestamped for RTT
+    // sampling, older timestamps are dropped if exceeded
+    const size_t max_sent = 1024;
+    // Gain of RTT smoothing
+    const double rtt_gain = 1./8;
+    // Vegas thresholds: grow window if less than alpha messages are
+    // estimated to be queued in network, shrink if more than beta
+    const double alpha = 1;
+    const double beta  = 3;
+    // RTT variation which is considered scheduling noise rather than
+    // queueing, keeps the window from collapsing on LAN where RTT is
+    // comparable to jitter
+    const double rtt_noise = 0.001;
+    // Minimum RTT is re-established after this period in case route
+    // has changed
+    const gu::datetime::Period min_rtt_period(10 * gu::datetime::Sec);
+    // Multiplicative decrease on retransmission request
+    const double loss_factor = 0.75;
+}
+
+gcomm::evs::SendWindow::SendWindow(seqno_t const max_window)
+    :
+    max_window_    (max_window),
+    window_        (max_window),
+    nodes_         (),
+    self_          (0),
+    sent_          (),
+    srtt_          (0),
+    min_rtt_       (0),
+    min_rtt_tstamp_(gu::datetime::Date::zero()),
+    last_lost_     (gu::datetime::Date::zero())
+{
+    assert(max_window_ >= 1);
+}
+
+void gcomm::evs::SendWindow::reset(size_t const n_nodes, size_t const self)
+{
+    nodes_.assign(n_nodes, NodeRtt());
+    self_ = self;
+    sent_.clear();
+    srtt_ = 0;
+    min_rtt_ = 0;
+}
+
+void gcomm::evs::SendWindow::set_max_window(seqno_t const max_window)
+{
+    assert(max_window >= 1);
+    max_window_ = max_window;
+    window_ = std::min(window_, double(max_window_));
+}
+
+void gcomm::evs::SendWindow::sent(seqno_t const seq,
+                                  const gu::datetime::Date& now)
+{
+    assert(sent_.empty() || sent_.back().first < seq);
+    if (sent_.size() == max_sent) sent_.pop_front();
+    sent_.push_back(std::make_pair(seq, now));
+}
+
+void gcomm::evs::SendWindow::acked(size_t const idx, seqno_t const seq,
+                                   const gu::datetime::Date& now)
+{
+    if (idx == self_ || idx >= nodes_.size()) return;
+
+    NodeRtt& node(nodes_[idx]);
+    if (seq <= node.acked_) return;
+
+    // Latest local message acknowledged by this ack
+    SentList::const_iterator i(
+        std::upper_bound(sent_.begin(), sent_.end(),
+                         std::make_pair(seq, gu::datetime::Date::max())));
+    if (i != sent_.begin() && (--i)->first > node.acked_)
+    {
+        double const rtt(gu::datetime::to_double(now - i->second));
+        node.srtt_ = (node.srtt_ == 0 ? rtt :
+                      node.srtt_ + rtt_gain*(rtt - node.srtt_));
+    }
+    node.acked_ = seq;
+
+    // Messages acknowledged by all nodes give group RTT samples
+    seqno_t all_acked(seq);
+    for (size_t n(0); n < nodes_.size(); ++n)
+    {
+        if (n != self_) all_acked = std::min(all_acked, nodes_[n].acked_);
+    }
+
+    bool group_ack(false);
+    gu::datetime::Date oldest;
+    while (sent_.empty() == false && sent_.front().first <= all_acked)
+    {
+        oldest = sent_.front().second;
+        sent_.pop_front();
+        group_ack = true;
+    }
+
+    if (group_ack)
+    {
+        group_acked(gu::datetime::to_double(now - oldest), now);
+    }
+}
+
+void gcomm::evs::SendWindow::group_acked(double const rtt,
+                                         const gu::datetime::Date& now)
+{
+    srtt_ = (srtt_ == 0 ? rtt : srtt_ + rtt_gain*(rtt - srtt_));
+
+    if (min_rtt_ == 0 || rtt < min_rtt_ ||
+        min_rtt_tstamp_ + min_rtt_period < now)
+    {
+        min_rtt_ = rtt;
+        min_rtt_tstamp_ = now;
+    }
+
+    if (srtt_ <= 0) return;
+
+    // Estimated number of messages queued in network
+    double const queued(window_ *
+                        std::max(0., srtt_ - min_rtt_ - rtt_noise) / srtt_);
+    if (queued < alpha)
+    {
+        window_ = std::min(window_ + 1/window_, double(max_window_));
+    }
+    else if (queued > beta)
+    {
+        window_ = std::max(window_ - 1/window_, 1.);
+    }
+}
+
+void gcomm::evs::SendWindow::lost(const gu::datetime::Date& now)
+{
+    gu::datetime::Period const rtt(
+        static_cast<long long>(srtt_ * gu::datetime::Sec));
+    if (last_lost_ == gu::datetime::Date::zero() || last_lost_ + rtt < now)
+    {
+        window_ = std::max(window_ * loss_factor, 1.);
+        last_lost_ = now;
+    }
+}
+
+gcomm::evs::seqno_t
+gcomm::evs::SendWindow::scale(seqno_t const configured) const
+{
+    seqno_t const ret(configured * window() / max_window_);
+    return std::max(ret, seqno_t(1));
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+#ifndef GCOMM_EVS_SEND_WINDOW_HPP
+#define GCOMM_EVS_SEND_WINDOW_HPP
+
+#include "evs_seqno.hpp"
+
+#include "gu_datetime.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace gcomm
+{
+    namespace evs
+    {
+        class SendWindow;
+    }
+}
+
+/*!
+ * Adaptive EVS send window controller.
+ *
+ * Round trip time to a node is measured from sending a local user message
+ * until the node acknowledges it in aru_seq of its own messages. The time
+ * until all nodes have acknowledged a message is the group RTT, which is
+ * what eventually opens the window of flow control.
+ *
+ * The window is adjusted in the spirit of TCP Vegas: smoothed group RTT
+ * is compared against the minimum observed RTT, and the difference is
+ * translated into the number of messages queued in the network. The window
+ * grows by one message per RTT while the queue stays short and shrinks
+ * if it grows long. Retransmission requests for local messages cut the
+ * window by a quarter, at most once per RTT. The window is always within
+ * [1, max_window].
+ */
+class gcomm::evs::SendWindow
+{
+public:
+
+    SendWindow(seqno_t max_window);
+
+    /*!
+     * Reset RTT estimates and outstanding messages, new view was installed.
+     *
+     * @param n_nodes Number of nodes in the view
+     * @param self    Index of the local node
+     */
+    void reset(size_t n_nodes, size_t self);
+
+    /*!
+     * Set upper bound for the window. Current window is adjusted to
+     * the new bound if needed.
+     */
+    void set_max_window(seqno_t max_window);
+
+    /*!
+     * Local user message(s) up to seq were sent at now.
+     */
+    void sent(seqno_t seq, const gu::datetime::Date& now);
+
+    /*!
+     * Node with index idx has acknowledged messages up to seq.
+     */
+    void acked(size_t idx, seqno_t seq, const gu::datetime::Date& now);
+
+    /*!
+     * Some node requested retransmission of local messages.
+     */
+    void lost(const gu::datetime::Date& now);
+
+    /*!
+     * Current window.
+     */
+    seqno_t window() const { return seqno_t(window_); }
+
+    /*!
+     * Scale window configured for max_window to the current window.
+     */
+    seqno_t scale(seqno_t configured) const;
+
+    seqno_t max_window() const { return max_window_; }
+
+    /*!
+     * Smoothed group RTT in seconds, 0 if not known.
+     */
+    double rtt() const { return srtt_; }
+
+    /*!
+     * Minimum group RTT in seconds, 0 if not known.
+     */
+    double min_rtt() const { return min_rtt_; }
+
+    /*!
+     * Smoothed RTT to node with index idx in seconds, 0 if not known.
+     */
+    double rtt(size_t idx) const
+    {
+        return (idx < nodes_.size() ? nodes_[idx].srtt_ : 0);
+    }
+
+private:
+
+    struct NodeRtt
+    {
+        NodeRtt() : acked_(-1), srtt_(0) { }
+        seqno_t acked_;
+        double  srtt_;
+    };
+
+    typedef std::deque<std::pair<seqno_t, gu::datetime::Date> > SentList;
+
+    void group_acked(double rtt, const gu::datetime::Date& now);
+
+    seqno_t              max_window_;
+    double               window_;
+    std::vector<NodeRtt> nodes_;
+    size_t               self_;
+    SentList             sent_;
+    double               srtt_;
+    double               min_rtt_;
+    gu::datetime::Date   min_rtt_tstamp_;
+    gu::datetime::Date   last_lost_;
+};
+
+#endif // GCOMM_EVS_SEND_WINDOW_HPP
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2014 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 /*!
@@ -130,6 +130,18 @@ namespace gcomm
          */
         static std::string const GMCastMCastTTL;
 
+        /*!
+         * @brief GMCast multicast MTU ("gmcast.mcast_mtu")
+         *
+         * Maximum size of IP packets sent to multicast address. Messages
+         * which do not fit into single packet are split into fragments
+         * of this size instead of relying on IP fragmentation. By default
+         * it is set to 1500 which is Ethernet MTU. Allowed range is
+         * [576, 32768], larger datagrams would not fit into receive
+         * buffers.
+         */
+        static std::string const GMCastMCastMTU;
+
         static std::string const GMCastTimeWait;
         static std::string const GMCastPeerTimeout;
 
@@ -301,6 +313,18 @@ namespace gcomm
          */
         static std::string const EvsUseAggregate;
 
+        /*!
+         * @brief EVS adaptive send window ("evs.adaptive_window")
+         *
+         * If enabled, the effective send windows are adjusted at runtime
+         * according to round trip time and retransmission requests
+         * observed by EVS, within the limits set by Conf::EvsSendWindow
+         * and Conf::EvsUserSendWindow. This allows configuring large
+         * windows for low latency networks without overloading slow
+         * links. Disabled by default.
+         */
+        static std::string const EvsAdaptiveWindow;
+
         /*!
          * @brief Period to generate keepalives for causal messages
          *
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2010-2013 Codership Oy <info@codership.com>
+ * Copyright (C) 2010-2024 Codership Oy <info@codership.com>
  */
 
 #ifndef GCOMM_DATAGRAM_HPP
@@ -27,8 +27,12 @@ namespace gcomm
     //
     // Header structure is the following (MSB first)
     //
-    // | version(4) | reserved(2) | F_CRC(2) | len(24) |
-    // |                   CRC(32)                     |
+    // | version(4) | reserved(1) | F_FRAG(1) | F_CRC(2) | len(24) |
+    // |                          CRC(32)                          |
+    //
+    // F_FRAG is set in datagram socket fragments of a message which does
+    // not fit into single datagram. The len and CRC are of the whole
+    // message then.
     //
     class NetHeader
     {
@@ -71,6 +75,9 @@ namespace gcomm
         bool has_crc32()  const { return (len_ & F_CRC32);  }
         bool has_crc32c() const { return (len_ & F_CRC32C); }
 
+        void set_fragment() { len_ |= F_FRAG; }
+        bool is_fragment() const { return (len_ & F_FRAG); }
+
         uint32_t crc32()  const { return crc32_; }
 
         int version() const
@@ -98,6 +105,7 @@ namespace gcomm
 
         static const uint32_t F_CRC32  = 1 << 24; /* backward compatible */
         static const uint32_t F_CRC32C = 1 << 25;
+        static const uint32_t F_FRAG   = 1 << 26;
 
         uint32_t len_;
         uint32_t crc32_;
@@ -121,7 +129,8 @@ namespace gcomm
         {
         case 0:
             if ((hdr.len_ & NetHeader::flags_mask_) &
-                ~(NetHeader::F_CRC32 | NetHeader::F_CRC32C))
+                ~(NetHeader::F_CRC32 | NetHeader::F_CRC32C |
+                  NetHeader::F_FRAG))
             {
                 gu_throw_error(EPROTO)
                     << "invalid flags "
@@ -155,7 +164,7 @@ namespace gcomm
             :
             header_       (),
             header_offset_(header_size_),
-            payload_      (new gu::Buffer()),
+            payload_      (gu::make_shared_buffer()),
             offset_       (0)
         { }
         /*!
@@ -171,7 +180,22 @@ namespace gcomm
             :
             header_       (),
             header_offset_(header_size_),
-            payload_      (new gu::Buffer(buf)),
+            payload_      (gu::make_shared_buffer(buf)),
+            offset_       (offset)
+        {
+            assert(offset_ <= payload_->size());
+        }
+
+        /*!
+         * @brief Construct new datagram taking over byte buffer contents
+         *
+         * @throws std::bad_alloc
+         */
+        Datagram(gu::Buffer&& buf, size_t offset = 0)
+            :
+            header_       (),
+            header_offset_(header_size_),
+            payload_      (gu::make_shared_buffer(std::move(buf))),
             offset_       (offset)
         {
             assert(offset_ <= payload_->size());
@@ -231,7 +255,7 @@ namespace gcomm
         void normalize()
         {
             const gu::SharedBuffer old_payload(payload_);
-            payload_ = gu::SharedBuffer(new gu::Buffer);
+            payload_ = gu::make_shared_buffer();
             payload_->reserve(header_len() + old_payload->size() - offset_);
 
             if (header_len() > offset_)
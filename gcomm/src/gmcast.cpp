@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2019 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 #include "gmcast.hpp"
@@ -105,6 +105,10 @@ gcomm::GMCast::GMCast(Protonet& net, const gu::URI& uri,
                        Conf::GMCastMCastTTL,
                        param<int>(conf_, uri, Conf::GMCastMCastTTL, "1"),
                        1, 256)),
+    mcast_mtu_    (check_range(
+                       Conf::GMCastMCastMTU,
+                       param<int>(conf_, uri, Conf::GMCastMCastMTU, "1500"),
+                       576, 32768)),
     listener_     (),
     mcast_        (),
     pending_addrs_(),
@@ -224,13 +228,14 @@ gcomm::GMCast::GMCast(Protonet& net, const gu::URI& uri,
 
     log_info << self_string() << " listening at " << listen_addr_;
     log_info << self_string() << " multicast: " << mcast_addr_
-             << ", ttl: " << mcast_ttl_;
+             << ", ttl: " << mcast_ttl_ << ", mtu: " << mcast_mtu_;
 
     conf_.set(Conf::GMCastListenAddr, listen_addr_);
     conf_.set(Conf::GMCastMCastAddr, mcast_addr_);
     conf_.set(Conf::GMCastVersion, gu::to_string(version_));
     conf_.set(Conf::GMCastTimeWait, gu::to_string(time_wait_));
     conf_.set(Conf::GMCastMCastTTL, gu::to_string(mcast_ttl_));
+    conf_.set(Conf::GMCastMCastMTU, gu::to_string(mcast_mtu_));
     conf_.set(Conf::GMCastPeerTimeout, gu::to_string(peer_timeout_));
     conf_.set(Conf::GMCastSegment, gu::to_string<int>(segment_));
 }
@@ -341,6 +346,10 @@ void gcomm::GMCast::connect()
             + gu::URI(listen_addr_).get_host()+'&'
             + gcomm::Socket::OptNonBlocking + "=1&"
             + gcomm::Socket::OptMcastTTL    + '=' + gu::to_string(mcast_ttl_)
+            + '&'
+            + gcomm::Socket::OptMcastMTU    + '=' + gu::to_string(mcast_mtu_)
+            + '&'
+            + gcomm::Socket::OptSourceId    + '=' + uuid().full_str()
             );
 
         mcast_ = pnet().socket(mcast_uri);
@@ -613,6 +622,12 @@ void gcomm::GMCast::gmcast_forget(const UUID& uuid,
         }
     }
 
+    /* Discard partially received multicast messages from uuid */
+    if (mcast_)
+    {
+        mcast_->set_option(gcomm::Socket::OptForgetSource, uuid.full_str());
+    }
+
     /* Set all corresponding entries in address list to have retry cnt
      * greater than max retries and next reconnect time after some period */
     AddrList::iterator ai;
@@ -1949,6 +1964,7 @@ bool gcomm::GMCast::set_param(const std::string& key, const std::string& val,
                  key == Conf::GMCastMCastAddr   ||
                  key == Conf::GMCastMCastPort   ||
                  key == Conf::GMCastMCastTTL    ||
+                 key == Conf::GMCastMCastMTU    ||
                  key == Conf::GMCastTimeWait    ||
                  key == Conf::GMCastPeerTimeout ||
                  key == Conf::GMCastSegment)
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 /*
@@ -195,6 +195,7 @@ namespace gcomm
         std::string       mcast_addr_;
         std::string       bind_ip_;
         int               mcast_ttl_;
+        int               mcast_mtu_;
         std::shared_ptr<Acceptor> listener_;
         SocketPtr         mcast_;
         AddrList          pending_addrs_;
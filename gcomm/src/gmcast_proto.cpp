@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2019 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 #include "gmcast_proto.hpp"
@@ -86,7 +86,7 @@ void gcomm::gmcast::Proto::send_msg(const Message& msg,
 {
     gu::Buffer buf;
     gu_trace(serialize(msg, buf));
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     int ret = tp_->send(msg.segment_id(), dg);
 
     if (ret != 0)
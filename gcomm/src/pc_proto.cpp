@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 #include "pc_proto.hpp"
@@ -175,7 +175,7 @@ void gcomm::pc::Proto::send_state()
 
     gu::Buffer buf;
     serialize(pcs, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
 
     if (send_down(dg, ProtoDownMeta()))
     {
@@ -225,7 +225,7 @@ int gcomm::pc::Proto::send_install(bool bootstrap, int weight)
 
     gu::Buffer buf;
     serialize(pci, buf);
-    Datagram dg(buf);
+    Datagram dg(std::move(buf));
     int ret = send_down(dg, ProtoDownMeta());
     if (ret != 0)
     {
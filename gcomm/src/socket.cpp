@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2012 Codership Oy <info@codership.com>
+// Copyright (C) 2012-2024 Codership Oy <info@codership.com>
 //
 
 #include "socket.hpp"
@@ -11,3 +11,6 @@ const std::string gcomm::Socket::OptIfAddr      = SocketOptPrefix + "if_addr";
 const std::string gcomm::Socket::OptIfLoop      = SocketOptPrefix + "if_loop";
 const std::string gcomm::Socket::OptCRC32       = SocketOptPrefix + "crc32";
 const std::string gcomm::Socket::OptMcastTTL    = SocketOptPrefix + "mcast_ttl";
+const std::string gcomm::Socket::OptMcastMTU    = SocketOptPrefix + "mcast_mtu";
+const std::string gcomm::Socket::OptSourceId    = SocketOptPrefix + "source_id";
+const std::string gcomm::Socket::OptForgetSource = SocketOptPrefix + "forget_source";
@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2009-2019 Codership Oy <info@codership.com>
+// Copyright (C) 2009-2024 Codership Oy <info@codership.com>
 //
 
 //!
@@ -96,6 +96,11 @@ public:
     static const std::string OptIfLoop;      /*! socket.if_loop      */
     static const std::string OptCRC32;       /*! socket.crc32        */
     static const std::string OptMcastTTL;    /*! socket.mcast_ttl    */
+    static const std::string OptMcastMTU;    /*! socket.mcast_mtu    */
+    static const std::string OptSourceId;    /*! socket.source_id    */
+    /*! Set with set_option() to discard partially received messages
+     *  from given source, e.g. when node has left */
+    static const std::string OptForgetSource; /*! socket.forget_source */
 
     Socket(const gu::URI& uri)
         :
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2009-2023 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 /*!
@@ -12,6 +12,7 @@
 #include "evs_input_map2.hpp"
 #include "evs_message2.hpp"
 #include "evs_seqno.hpp"
+#include "evs_send_window.hpp"
 
 #include "check_gcomm.hpp"
 #include "check_templ.hpp"
@@ -21,6 +22,9 @@
 
 #include "gu_asio.hpp" // gu::ssl_register_params()
 
+#include <algorithm>
+#include <cmath>
+#include <map>
 #include <stdexcept>
 #include <vector>
 #include <set>
@@ -164,13 +168,13 @@ START_TEST(test_input_map_insert)
     {
         InputMap::iterator i = im.find(0, s);
         ck_assert(i != im.end());
-        ck_assert(InputMapMsgIndex::value(i).msg().source() == uuid1);
-        ck_assert(InputMapMsgIndex::value(i).msg().seq() == s);
+        ck_assert(InputMap::value(i).msg().source() == uuid1);
+        ck_assert(InputMap::value(i).msg().seq() == s);
 
         i = im.find(1, s);
         ck_assert(i != im.end());
-        ck_assert(InputMapMsgIndex::value(i).msg().source() == uuid2);
-        ck_assert(InputMapMsgIndex::value(i).msg().seq() == s);
+        ck_assert(InputMap::value(i).msg().source() == uuid2);
+        ck_assert(InputMap::value(i).msg().seq() == s);
     }
 
 }
@@ -378,7 +382,7 @@ START_TEST(test_input_map_random_insert)
     size_t n = 0;
     for (InputMap::iterator i = im.begin(); i != im.end(); ++i)
     {
-        const InputMapMsg& msg(InputMapMsgIndex::value(i));
+        const InputMapMsg& msg(InputMap::value(i));
         ck_assert(msg.msg() == msgs[n].second);
         ck_assert(im.is_safe(i) == false);
         ++n;
@@ -2328,7 +2332,7 @@ START_TEST(test_gap_rate_limit)
     f.evs2.set_param("evs.debug_log_mask", "0xffff", spcb);
     f.evs2.set_param("evs.info_log_mask", "0xff", spcb);
     char data[1] = { 0 };
-    gcomm::Datagram dg(gu::SharedBuffer(new gu::Buffer(data, data + 1)));
+    gcomm::Datagram dg(gu::make_shared_buffer(data, data + 1));
     // Generate four messages from node1. The first one is ignored,
     // the rest are handled by node2 for generating gap messages.
     f.evs1.handle_down(dg, ProtoDownMeta(O_SAFE));
@@ -2423,7 +2427,7 @@ START_TEST(test_gap_rate_limit_delayed)
     // auto evict is on.
     f.evs2.set_param("evs.auto_evict", "1", spcb);
     const char data[1] = { 0 };
-    gcomm::Datagram dg(gu::SharedBuffer(new gu::Buffer(data, data + 1)));
+    gcomm::Datagram dg(gu::make_shared_buffer(data, data + 1));
     // Generate four messages from node1. The first one is ignored,
     // the rest are handled by node2 for generating gap messages.
     f.evs1.handle_down(dg, ProtoDownMeta(O_SAFE));
@@ -2510,8 +2514,7 @@ START_TEST(test_out_queue_limit)
     TwoNodeFixture f;
 
     std::vector<char> data(1 << 15);
-    gcomm::Datagram dg(gu::SharedBuffer(
-                           new gu::Buffer(data.begin(), data.end())));
+    gcomm::Datagram dg(gu::make_shared_buffer(data.begin(), data.end()));
     // Default user send window is 2 and out queue limit is 1M,
     // so we can write 2 + 32 messages without blocking.
     for (size_t i(0); i < 34; ++i)
@@ -2520,7 +2523,7 @@ START_TEST(test_out_queue_limit)
     }
     // The next write should fill the out_queue and return EAGAIN
     const char small_data[1] = { 0 };
-    dg = gu::SharedBuffer(new gu::Buffer(small_data, small_data + 1));
+    dg = gu::make_shared_buffer(small_data, small_data + 1);
     ck_assert(f.evs1.handle_down(dg, ProtoDownMeta(O_SAFE)) == EAGAIN);
 
     gcomm::Datagram* tmp;
@@ -2603,6 +2606,147 @@ START_TEST(test_representative_incarnation_change)
 }
 END_TEST
 
+START_TEST(test_send_window)
+{
+    log_info << "START test_send_window";
+    SendWindow w(8);
+    w.reset(3, 0);
+    ck_assert(w.window() == 8);
+
+    gu::datetime::Date now(gu::datetime::Sec);
+    seqno_t seq(0);
+
+    // Steady 10ms RTT, node 1 acknowledges faster than node 2.
+    // Window should stay at maximum.
+    for (; seq < 100; ++seq)
+    {
+        w.sent(seq, now);
+        w.acked(1, seq, now + 5*MSec);
+        now = now + 10*MSec;
+        w.acked(2, seq, now);
+    }
+    ck_assert_msg(w.window() == 8, "window %lld", (long long)w.window());
+    ck_assert(std::fabs(w.rtt() - 0.01) < 1e-6);
+    ck_assert(std::fabs(w.min_rtt() - 0.01) < 1e-6);
+    ck_assert(std::fabs(w.rtt(1) - 0.005) < 1e-6);
+    ck_assert(std::fabs(w.rtt(2) - 0.01) < 1e-6);
+    ck_assert(w.rtt(0) == 0);
+    ck_assert(w.scale(4) == 4);
+
+    // RTT grows tenfold, messages are queued in network. Window should
+    // shrink until about three messages are estimated to be queued.
+    for (; seq < 150; ++seq)
+    {
+        w.sent(seq, now);
+        now = now + 100*MSec;
+        w.acked(1, seq, now);
+        w.acked(2, seq, now);
+    }
+    ck_assert_msg(w.window() == 3, "window %lld", (long long)w.window());
+    ck_assert(std::fabs(w.min_rtt() - 0.01) < 1e-6);
+
+    // Retransmission request cuts the window once per RTT
+    w.lost(now);
+    ck_assert_msg(w.window() == 2, "window %lld", (long long)w.window());
+    w.lost(now + 10*MSec);
+    ck_assert_msg(w.window() == 2, "window %lld", (long long)w.window());
+    ck_assert(w.scale(4) == 1);
+
+    // RTT back to normal, window should grow back to maximum
+    for (; seq < 250; ++seq)
+    {
+        w.sent(seq, now);
+        now = now + 10*MSec;
+        w.acked(1, seq, now);
+        w.acked(2, seq, now);
+    }
+    ck_assert_msg(w.window() == 8, "window %lld", (long long)w.window());
+
+    // Lowering the maximum applies immediately
+    w.set_max_window(4);
+    ck_assert(w.window() == 4);
+    ck_assert(w.scale(2) == 2);
+
+    // View change forgets RTT estimates but not the window
+    w.reset(2, 1);
+    ck_assert(w.rtt() == 0 && w.min_rtt() == 0 && w.rtt(0) == 0);
+    ck_assert(w.window() == 4);
+}
+END_TEST
+
+// Run lossy message exchange with adaptive send window enabled and
+// check that the window stays within configured limits and RTT
+// estimates are reported in status.
+START_TEST(test_adaptive_window)
+{
+    log_info << "START test_adaptive_window";
+    init_rand();
+
+    const size_t n_nodes(3);
+    PropagationMatrix prop;
+    vector<DummyNode*> dn;
+    Protolay::sync_param_cb_t sync_param_cb;
+
+    for (size_t i = 1; i <= n_nodes; ++i)
+    {
+        gu_trace(dn.push_back(create_dummy_node(i, 0)));
+    }
+
+    for (size_t i = 0; i < n_nodes; ++i)
+    {
+        gu_trace(join_node(&prop, dn[i], i == 0 ? true : false));
+        set_cvi(dn, 0, i, i + 1);
+        gu_trace(prop.propagate_until_cvi(false));
+    }
+
+    for (size_t i = 0; i < n_nodes; ++i)
+    {
+        Proto* evs(evs_from_dummy(dn[i]));
+        ck_assert(evs->set_param("evs.send_window", "16", sync_param_cb));
+        ck_assert(evs->set_param("evs.user_send_window", "8", sync_param_cb));
+        ck_assert(evs->set_param("evs.adaptive_window", "true",
+                                 sync_param_cb));
+    }
+
+    // PropagationMatrix runs on simulated clock, advance it to get
+    // non-zero RTT samples.
+    prop.set_loss(1, 2, 0.9);
+    for (size_t i(0); i < 100; ++i)
+    {
+        gu::datetime::SimClock::inc_time(MSec);
+        for (size_t j(0); j < n_nodes; ++j)
+        {
+            dn[j]->send();
+        }
+        gu_trace(prop.propagate_n(3));
+    }
+    prop.set_loss(1, 2, 1.);
+    gu_trace(prop.propagate_until_empty());
+    gu_trace(check_trace(dn));
+
+    for (size_t i = 0; i < n_nodes; ++i)
+    {
+        gu::Status status;
+        evs_from_dummy(dn[i])->handle_get_status(status);
+        std::map<std::string, std::string> vars(status.begin(), status.end());
+
+        seqno_t const send_window(
+            gu::from_string<seqno_t>(vars["evs_send_window"]));
+        seqno_t const user_send_window(
+            gu::from_string<seqno_t>(vars["evs_user_send_window"]));
+        ck_assert(send_window >= 1 && send_window <= 16);
+        ck_assert(user_send_window >= 1 && user_send_window <= 8);
+        ck_assert(user_send_window <= send_window);
+        ck_assert(gu::from_string<double>(vars["evs_rtt"]) > 0);
+        ck_assert(vars["evs_rtt_min"].empty() == false);
+        ck_assert(std::count(vars["evs_node_rtt"].begin(),
+                             vars["evs_node_rtt"].end(), ':') == 2);
+    }
+
+    for_each(dn.begin(), dn.end(), DeleteObject());
+}
+END_TEST
+
 Suite* evs2_suite()
 {
     Suite* s = suite_create("gcomm::evs");
@@ -2794,5 +2938,13 @@ Suite* evs2_suite()
     tcase_add_test(tc, test_representative_incarnation_change);
     suite_add_tcase(s, tc);
 
+    tc = tcase_create("test_send_window");
+    tcase_add_test(tc, test_send_window);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_adaptive_window");
+    tcase_add_test(tc, test_adaptive_window);
+    suite_add_tcase(s, tc);
+
     return s;
 }
@@ -1,5 +1,5 @@
 //
-// Copyright (C) 2019-2020 Codership Oy <info@codership.com>
+// Copyright (C) 2019-2024 Codership Oy <info@codership.com>
 //
 
 #include "check_gcomm.hpp"
@@ -10,7 +10,7 @@
 static gcomm::Datagram make_datagram(char header)
 {
     static const char data[1] = { 0 };
-    gcomm::Datagram ret(gu::SharedBuffer(new gu::Buffer(data, data + 1)));
+    gcomm::Datagram ret(gu::make_shared_buffer(data, data + 1));
     ret.set_header_offset(ret.header_offset() - 1);
     ret.header()[ret.header_offset()] = header;
     return ret;
@@ -1,14 +1,17 @@
 /*
- * Copyright (C) 2009-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 #include "gcomm/util.hpp"
 #include "gcomm/protonet.hpp"
 #include "gcomm/datagram.hpp"
 #include "gcomm/conf.hpp"
+#include "socket.hpp"
 
 #include "check_gcomm.hpp"
 
+#include "gu_asio.hpp"
+
 #include "gu_logger.hpp"
 
 #ifdef HAVE_ASIO_HPP
@@ -65,6 +68,278 @@ START_TEST(test_asio)
     pn.event_loop(gu::datetime::Sec);
 }
 END_TEST
+
+// Collects messages received from datagram socket
+class DatagramReceiver : public Toplay
+{
+public:
+    DatagramReceiver(gu::Config& conf, Protonet& pnet, const gu::URI& uri)
+        :
+        Toplay (conf),
+        pnet_  (pnet),
+        pstack_(),
+        socket_(pnet.socket(uri)),
+        msgs_  ()
+    {
+        pstack_.push_proto(this);
+        pnet_.insert(&pstack_);
+        socket_->connect(uri);
+    }
+
+    ~DatagramReceiver()
+    {
+        pnet_.erase(&pstack_);
+        pstack_.pop_proto(this);
+        socket_->close();
+    }
+
+    Socket& socket() { return *socket_; }
+
+    const vector<Buffer>& msgs() const { return msgs_; }
+
+    // Run event loop until n messages have been received, for at most
+    // two seconds
+    void wait(size_t const n)
+    {
+        for (int i(0); i < 200 && msgs_.size() < n; ++i)
+        {
+            pnet_.event_loop(10 * gu::datetime::MSec);
+        }
+    }
+
+    void handle_up(const void* id, const Datagram& dg, const ProtoUpMeta&)
+    {
+        if (id != socket_->id()) return;
+        msgs_.push_back(Buffer(gcomm::begin(dg),
+                               gcomm::begin(dg) + gcomm::available(dg)));
+    }
+
+private:
+    DatagramReceiver(const DatagramReceiver&);
+    void operator=(const DatagramReceiver&);
+
+    Protonet&      pnet_;
+    Protostack     pstack_;
+    SocketPtr      socket_;
+    vector<Buffer> msgs_;
+};
+
+static Buffer make_msg(size_t const len)
+{
+    Buffer ret(len);
+    for (size_t i(0); i < len; ++i)
+    {
+        ret[i] = static_cast<byte_t>((i * 7) & 0xff);
+    }
+    return ret;
+}
+
+// Unicast datagram socket sends to its own address, messages of
+// different sizes are sent with the largest allowed MTU.
+START_TEST(test_asio_udp_max_mtu)
+{
+    gu::Config conf;
+    gu::ssl_register_params(conf);
+    gcomm::Conf::register_params(conf);
+    std::unique_ptr<Protonet> pnet(Protonet::create(conf));
+
+    gu::URI const uri("udp://127.0.0.1:0?" + Socket::OptMcastMTU + "=32768");
+    DatagramReceiver recv(conf, *pnet, uri);
+
+    // Largest unfragmented, smallest fragmented and largest message
+    size_t const max_unfrag(32768 - 28 - NetHeader::serial_size_);
+    size_t const lens[] = { 1, max_unfrag, max_unfrag + 1, 1 << 15 };
+    for (size_t i(0); i < sizeof(lens)/sizeof(lens[0]); ++i)
+    {
+        Buffer const msg(make_msg(lens[i]));
+        ck_assert(recv.socket().send(0, Datagram(msg)) == 0);
+        recv.wait(i + 1);
+        ck_assert_int_eq(recv.msgs().size(), i + 1);
+        ck_assert_msg(recv.msgs()[i] == msg, "message %zu of %zu bytes "
+                      "differs", i, lens[i]);
+    }
+}
+END_TEST
+
+// Sends hand crafted fragments of message to given address
+class FragmentSender
+{
+public:
+    FragmentSender(const gu::URI& to)
+        :
+        io_service_(),
+        socket_    (io_service_.make_datagram_socket(gu::URI("udp://127.0.0.1:0"))),
+        addr_      (gu::make_address(to.get_host())),
+        port_      (gu::from_string<unsigned short>(to.get_port()))
+    {
+        socket_->connect(gu::URI("udp://127.0.0.1:0"));
+    }
+
+    // Sends len bytes of data as fragment at offset of message msg
+    // from source. Header length and checksum are computed over msg.
+    void send(const UUID& source, uint32_t const seq, const Buffer& msg,
+              size_t const offset, const byte_t* const data, size_t const len)
+    {
+        NetHeader hdr(msg.size(), 0);
+        hdr.set_crc32(crc32(NetHeader::CS_CRC32C, Datagram(msg)),
+                      NetHeader::CS_CRC32C);
+        hdr.set_fragment();
+        byte_t hbuf[prefix_size];
+        size_t off(serialize(hdr, hbuf, sizeof(hbuf), 0));
+        off = source.serialize(hbuf, sizeof(hbuf), off);
+        off = gu::serialize4(seq, hbuf, sizeof(hbuf), off);
+        off = gu::serialize4(uint32_t(offset), hbuf, sizeof(hbuf), off);
+        ck_assert_int_eq(off, prefix_size);
+
+        std::array<gu::AsioConstBuffer, 2> cbs;
+        cbs[0] = gu::AsioConstBuffer(hbuf, off);
+        cbs[1] = gu::AsioConstBuffer(data, len);
+        socket_->send_to(cbs, addr_, port_);
+    }
+
+    void send(const UUID& source, uint32_t const seq, const Buffer& msg,
+              size_t const offset, size_t const len)
+    {
+        send(source, seq, msg, offset, &msg[0] + offset, len);
+    }
+
+    // NetHeader, source UUID, seq and offset
+    static size_t const prefix_size = NetHeader::serial_size_ + 16 + 8;
+
+private:
+    gu::AsioIoService                        io_service_;
+    std::shared_ptr<gu::AsioDatagramSocket>  socket_;
+    gu::AsioIpAddress                        addr_;
+    unsigned short                           port_;
+};
+
+// Datagram which does not fit into receive buffer is dropped even if
+// the truncated part looks like a complete message.
+START_TEST(test_asio_udp_truncated)
+{
+    gu::Config conf;
+    gu::ssl_register_params(conf);
+    gcomm::Conf::register_params(conf);
+    std::unique_ptr<Protonet> pnet(Protonet::create(conf));
+
+    gu::URI const uri("udp://127.0.0.1:0");
+    DatagramReceiver recv(conf, *pnet, uri);
+    FragmentSender sender(recv.socket().local_addr());
+
+    // Single fragment message whose length matches to what would be left
+    // after truncating the datagram into 32K + NetHeader bytes
+    size_t const trunc_len((1 << 15) + NetHeader::serial_size_
+                           - FragmentSender::prefix_size);
+    Buffer const msg(make_msg(40000));
+    sender.send(UUID(1), 1, Buffer(msg.begin(), msg.begin() + trunc_len),
+                0, &msg[0], msg.size());
+
+    // Valid message sent after truncated one must be the only one received
+    Buffer const valid(make_msg(100));
+    ck_assert(recv.socket().send(0, Datagram(valid)) == 0);
+    recv.wait(1);
+    pnet->event_loop(10 * gu::datetime::MSec);
+    ck_assert_int_eq(recv.msgs().size(), 1);
+    ck_assert(recv.msgs()[0] == valid);
+}
+END_TEST
+
+// Sources which never complete their messages fill the reassembly table,
+// message from a new source must still get through.
+START_TEST(test_asio_udp_reassembly_full)
+{
+    gu::Config conf;
+    gu::ssl_register_params(conf);
+    gcomm::Conf::register_params(conf);
+    std::unique_ptr<Protonet> pnet(Protonet::create(conf));
+
+    gu::URI const uri("udp://127.0.0.1:0");
+    DatagramReceiver recv(conf, *pnet, uri);
+    FragmentSender sender(recv.socket().local_addr());
+
+    Buffer const msg(make_msg(200));
+    size_t const half(msg.size()/2);
+
+    // More incomplete messages than the table holds, sent in batches
+    // to stay within socket receive buffer
+    for (size_t i(0); i < 300; ++i)
+    {
+        sender.send(UUID(i + 1), 1, msg, 0, half);
+        if (i % 50 == 49) pnet->event_loop(10 * gu::datetime::MSec);
+    }
+    pnet->event_loop(10 * gu::datetime::MSec);
+    ck_assert_int_eq(recv.msgs().size(), 0);
+
+    UUID const source(1000);
+    sender.send(source, 1, msg, 0, half);
+    sender.send(source, 1, msg, half, msg.size() - half);
+    recv.wait(1);
+    ck_assert_int_eq(recv.msgs().size(), 1);
+    ck_assert(recv.msgs()[0] == msg);
+}
+END_TEST
+
+// Fragmented message longer than gcomm ever sends is not reassembled.
+START_TEST(test_asio_udp_oversized)
+{
+    gu::Config conf;
+    gu::ssl_register_params(conf);
+    gcomm::Conf::register_params(conf);
+    std::unique_ptr<Protonet> pnet(Protonet::create(conf));
+
+    gu::URI const uri("udp://127.0.0.1:0");
+    DatagramReceiver recv(conf, *pnet, uri);
+    FragmentSender sender(recv.socket().local_addr());
+
+    Buffer const msg(make_msg(recv.socket().mtu() + 1));
+    size_t const frag_len(1400);
+    for (size_t off(0); off < msg.size(); off += frag_len)
+    {
+        sender.send(UUID(1), 1, msg, off,
+                    std::min(frag_len, msg.size() - off));
+    }
+
+    Buffer const valid(make_msg(100));
+    ck_assert(recv.socket().send(0, Datagram(valid)) == 0);
+    recv.wait(1);
+    pnet->event_loop(10 * gu::datetime::MSec);
+    ck_assert_int_eq(recv.msgs().size(), 1);
+    ck_assert(recv.msgs()[0] == valid);
+}
+END_TEST
+
+// Partially received message is discarded when its source is forgotten.
+START_TEST(test_asio_udp_forget_source)
+{
+    gu::Config conf;
+    gu::ssl_register_params(conf);
+    gcomm::Conf::register_params(conf);
+    std::unique_ptr<Protonet> pnet(Protonet::create(conf));
+
+    gu::URI const uri("udp://127.0.0.1:0");
+    DatagramReceiver recv(conf, *pnet, uri);
+    FragmentSender sender(recv.socket().local_addr());
+
+    Buffer const msg(make_msg(200));
+    size_t const half(msg.size()/2);
+    UUID const source(1);
+
+    sender.send(source, 1, msg, 0, half);
+    pnet->event_loop(10 * gu::datetime::MSec);
+    recv.socket().set_option(Socket::OptForgetSource, source.full_str());
+    sender.send(source, 1, msg, half, msg.size() - half);
+    pnet->event_loop(10 * gu::datetime::MSec);
+    ck_assert_int_eq(recv.msgs().size(), 0);
+
+    // Next message from the same source is received normally
+    sender.send(source, 2, msg, 0, half);
+    sender.send(source, 2, msg, half, msg.size() - half);
+    recv.wait(1);
+    ck_assert_int_eq(recv.msgs().size(), 1);
+    ck_assert(recv.msgs()[0] == msg);
+}
+END_TEST
+
 #endif // HAVE_ASIO_HPP
 
 START_TEST(test_protonet)
@@ -91,6 +366,26 @@ Suite* util_nondet_suite()
     tc = tcase_create("test_asio");
     tcase_add_test(tc, test_asio);
     suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_asio_udp_max_mtu");
+    tcase_add_test(tc, test_asio_udp_max_mtu);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_asio_udp_truncated");
+    tcase_add_test(tc, test_asio_udp_truncated);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_asio_udp_reassembly_full");
+    tcase_add_test(tc, test_asio_udp_reassembly_full);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_asio_udp_oversized");
+    tcase_add_test(tc, test_asio_udp_oversized);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_asio_udp_forget_source");
+    tcase_add_test(tc, test_asio_udp_forget_source);
+    suite_add_tcase(s, tc);
 #endif // HAVE_ASIO_HPP
 
     tc = tcase_create("test_protonet");
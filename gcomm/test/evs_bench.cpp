@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * EVS user message throughput micro benchmark on top of the check_evs2
+ * loopback harness (DummyTransport + PropagationMatrix, no sockets).
+ *
+ * Every round each node queues a burst of small messages, which makes
+ * EVS hit its send window and aggregate the rest of the output queue,
+ * then messages are propagated until all nodes have delivered them.
+ *
+ * Usage: evs_bench [nodes [rounds [burst [aggregate]]]]
+ * (by default 3 nodes, 10000 rounds, bursts of 64 messages, aggregation on)
+ *
+ * Global operator new is replaced to count heap allocations made while
+ * messages are passed around.
+ */
+
+#include "check_trace.hpp"
+
+#include "evs_proto.hpp"
+#include "gcomm/conf.hpp"
+#include "gu_asio.hpp" // gu::ssl_register_params()
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include <iomanip>
+
+using namespace gcomm;
+
+static std::atomic<long long> heap_allocs(0);
+
+void* operator new(size_t const size)
+{
+    heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* const ret(::malloc(size ? size : 1));
+    if (!ret) throw std::bad_alloc();
+    return ret;
+}
+
+void operator delete(void* const ptr) noexcept
+{
+    ::free(ptr);
+}
+
+static DummyNode*
+create_node(gu::Config& conf, size_t const idx, bool const aggregate)
+{
+    std::string const uri("evs://?" + Conf::EvsViewForgetTimeout + "=PT1H&"
+                          + Conf::EvsSuspectTimeout + "=PT1H&"
+                          + Conf::EvsInactiveTimeout + "=PT1H&"
+                          + Conf::EvsKeepalivePeriod + "=PT10M&"
+                          + Conf::EvsJoinRetransPeriod + "=PT10M&"
+                          + Conf::EvsInfoLogMask + "=0x0&"
+                          + Conf::EvsUseAggregate + "="
+                          + (aggregate ? "true" : "false"));
+    UUID const uuid(static_cast<int32_t>(idx));
+    std::list<Protolay*> protos;
+    protos.push_back(new DummyTransport(uuid, false));
+    protos.push_back(new evs::Proto(conf, uuid, 0, uri));
+    return new DummyNode(conf, idx, uuid, protos);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t const n_nodes(argc > 1 ? atol(argv[1]) : 3);
+    size_t const rounds (argc > 2 ? atol(argv[2]) : 10000);
+    size_t const burst  (argc > 3 ? atol(argv[3]) : 64);
+    bool   const aggreg (argc > 4 ? atoi(argv[4]) != 0 : true);
+
+    if (n_nodes < 2 || rounds < 1 || burst < 1)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [nodes [rounds [burst [aggregate]]]]\n";
+        return 1;
+    }
+
+    gu_log_max_level = GU_LOG_ERROR;
+
+    gu::Config conf;
+    gu::ssl_register_params(conf);
+    Conf::register_params(conf);
+
+    PropagationMatrix prop;
+    std::vector<DummyNode*> dn;
+
+    for (size_t i(0); i < n_nodes; ++i)
+    {
+        dn.push_back(create_node(conf, i + 1, aggreg));
+        prop.insert_tp(dn[i]);
+        dn[i]->connect(i == 0);
+        for (size_t j(0); j <= i; ++j)
+        {
+            dn[j]->set_cvi(ViewId(V_REG, dn[0]->uuid(), i + 1));
+        }
+        prop.propagate_until_cvi(false);
+    }
+
+    long long const allocs_start(heap_allocs.load());
+    auto const start(std::chrono::steady_clock::now());
+
+    for (size_t r(0); r < rounds; ++r)
+    {
+        for (size_t i(0); i < n_nodes; ++i)
+        {
+            for (size_t m(0); m < burst; ++m) dn[i]->send();
+        }
+        prop.propagate_until_empty();
+    }
+
+    auto const stop(std::chrono::steady_clock::now());
+    long long const allocs(heap_allocs.load() - allocs_start);
+    double const sec(std::chrono::duration<double>(stop - start).count());
+    size_t const msgs(n_nodes * rounds * burst);
+
+    check_trace(dn);
+
+    std::cout << "Nodes: " << n_nodes << ", aggregate: " << aggreg
+              << ", messages: " << msgs
+              << ", time: " << std::fixed << std::setprecision(3) << sec
+              << " s, " << std::setprecision(0) << msgs / sec
+              << " msgs/s\nHeap allocations: " << allocs
+              << ", " << allocs / sec << " allocs/s, "
+              << std::setprecision(2) << double(allocs) / msgs
+              << " per message\n";
+
+    for (size_t i(0); i < n_nodes; ++i) delete dn[i];
+
+    return 0;
+}
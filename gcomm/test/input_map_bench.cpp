@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * Micro benchmark for evs::InputMap: messages from all nodes are inserted
+ * a window at a time, some of them out of order, gaps are looked up while
+ * the window is incomplete, then messages are delivered in agreed order
+ * and finally marked safe.
+ *
+ * Usage: input_map_bench [nodes [window [seqnos]]]
+ * (by default 3, 9 and 16 nodes, windows of 256 and 1M messages in total)
+ */
+
+#include "evs_input_map2.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+using namespace gcomm;
+using namespace gcomm::evs;
+
+static void
+one_run(size_t const n_nodes, seqno_t const window, size_t const total)
+{
+    std::vector<UUID> uuids;
+    for (size_t i(0); i < n_nodes; ++i)
+    {
+        uuids.push_back(UUID(static_cast<int32_t>(i + 1)));
+    }
+    ViewId const view(V_REG, uuids[0], 1);
+
+    seqno_t const seqnos(total / n_nodes);
+    size_t delivered(0);
+    size_t gaps(0);
+
+    InputMap im;
+    im.reset(n_nodes);
+
+    auto const start(std::chrono::steady_clock::now());
+
+    for (seqno_t base(0); base < seqnos; base += window)
+    {
+        seqno_t const last(std::min(base + window, seqnos) - 1);
+        std::vector<std::pair<size_t, seqno_t> > late;
+
+        for (seqno_t s(base); s <= last; ++s)
+        {
+            for (size_t i(0); i < n_nodes; ++i)
+            {
+                if ((s * n_nodes + i) % 17 == 0)
+                {
+                    late.push_back(std::make_pair(i, s));
+                    continue;
+                }
+                im.insert(i, UserMessage(0, uuids[i], view, s, s - 1));
+            }
+        }
+
+        for (size_t i(0); i < n_nodes; ++i)
+        {
+            gaps += im.gap_range_list(i, Range(im.aru_seq() + 1, last)).size();
+        }
+
+        for (size_t l(0); l < late.size(); ++l)
+        {
+            im.insert(late[l].first, UserMessage(0, uuids[late[l].first], view,
+                                                 late[l].second,
+                                                 late[l].second - 1));
+        }
+
+        InputMap::iterator i;
+        while ((i = im.begin()) != im.end() && im.is_agreed(i))
+        {
+            im.erase(i);
+            ++delivered;
+        }
+
+        for (size_t n(0); n < n_nodes; ++n)
+        {
+            im.set_safe_seq(n, im.aru_seq());
+        }
+    }
+
+    auto const stop(std::chrono::steady_clock::now());
+    double const sec(std::chrono::duration<double>(stop - start).count());
+
+    if (delivered != size_t(seqnos) * n_nodes || im.begin() != im.end())
+    {
+        std::cerr << "Delivered " << delivered << " of "
+                  << seqnos * n_nodes << '\n';
+        abort();
+    }
+
+    std::cout << n_nodes << '\t' << window << '\t' << delivered << '\t'
+              << gaps << '\t' << std::fixed << std::setprecision(3) << sec
+              << '\t' << std::setprecision(0) << delivered / sec << '\n';
+}
+
+int main(int argc, char* argv[])
+{
+    size_t  const nodes (argc > 1 ? atol(argv[1]) : 0);
+    seqno_t const window(argc > 2 ? atol(argv[2]) : 256);
+    size_t  const total (argc > 3 ? atol(argv[3]) : (1 << 20));
+
+    if (window < 1 || total < 1)
+    {
+        std::cerr << "Usage: " << argv[0] << " [nodes [window [seqnos]]]\n";
+        return 1;
+    }
+
+    gu_log_max_level = GU_LOG_ERROR;
+
+    std::cout << "Nodes:\tWindow:\tMsgs:\tGaps:\tTime:\tMsgs/s:\n";
+
+    if (nodes > 0)
+    {
+        one_run(nodes, window, total);
+    }
+    else
+    {
+        one_run(3, window, total);
+        one_run(9, window, total);
+        one_run(16, window, total);
+    }
+
+    return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2024 Codership Oy <info@codership.com>
+ */
+
+/**
+ * Data path benchmark comparing TCP fan-out with UDP multicast over
+ * loopback interface, sockets are driven by single gcomm Protonet.
+ *
+ * One sender delivers messages to nodes-1 receivers either by sending
+ * each message over nodes-1 TCP connections as GMCast does without
+ * multicast, or by sending it once to multicast group which all the
+ * receivers have joined. Messages are sent in windows of 32 messages or
+ * 64KB, next window is sent when all the receivers have got the previous
+ * one or no message has arrived for 100ms. Messages larger than MTU are fragmented by
+ * UDP socket.
+ *
+ * Usage: mcast_bench [nodes [messages [size [mtu]]]]
+ * (by default 3, 9 and 16 nodes, 20000 messages of 256 bytes, MTU 1500)
+ */
+
+#include "gcomm/protonet.hpp"
+#include "gcomm/conf.hpp"
+#include "socket.hpp"
+
+#include "gu_asio.hpp" // gu::ssl_register_params()
+#include "gu_crc32c.h" // gu_crc32c_configure()
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <unistd.h>
+
+using namespace gcomm;
+
+// Max number of messages and bytes sent in one window. Byte limit keeps
+// the window of fragmented messages within default socket receive buffer.
+static const size_t window(32);
+static const size_t window_bytes(64 << 10);
+
+class Sink : public Toplay
+{
+public:
+    Sink(gu::Config& conf, Protonet& pnet)
+        :
+        Toplay   (conf),
+        pnet_    (pnet),
+        pstack_  (),
+        counts_  (),
+        target_  (0),
+        pending_ (0),
+        received_(0)
+    {
+        pstack_.push_proto(this);
+        pnet_.insert(&pstack_);
+    }
+
+    ~Sink()
+    {
+        pnet_.erase(&pstack_);
+        pstack_.pop_proto(this);
+    }
+
+    void add_receiver(const void* id) { counts_[id] = 0; }
+
+    size_t n_receivers() const { return counts_.size(); }
+
+    // Run event loop until all receivers have got target messages or
+    // until nothing has been received for timeout.
+    void wait(size_t const target, const gu::datetime::Period& timeout)
+    {
+        target_ = target;
+        pending_ = 0;
+        for (Counts::const_iterator i(counts_.begin()); i != counts_.end();
+             ++i)
+        {
+            if (i->second < target_) ++pending_;
+        }
+        // Event loop may return early if it was interrupted before
+        gu::datetime::Date progress(gu::datetime::Date::monotonic());
+        while (pending_ > 0)
+        {
+            size_t const received(received_);
+            pnet_.event_loop(timeout);
+            gu::datetime::Date const now(gu::datetime::Date::monotonic());
+            if (received != received_)
+            {
+                progress = now;
+            }
+            else if (!(now < progress + timeout))
+            {
+                break;
+            }
+        }
+    }
+
+    size_t min_count() const
+    {
+        size_t ret(target_);
+        for (Counts::const_iterator i(counts_.begin()); i != counts_.end();
+             ++i)
+        {
+            ret = std::min(ret, i->second);
+        }
+        return ret;
+    }
+
+    size_t received() const { return received_; }
+
+    void handle_up(const void* id, const Datagram& dg, const ProtoUpMeta& um)
+    {
+        if (um.err_no() != 0)
+        {
+            std::cerr << "socket " << id << " failed: " << um.err_no() << '\n';
+            abort();
+        }
+
+        Counts::iterator i(counts_.find(id));
+        if (i == counts_.end() || dg.len() == 0) return;
+
+        ++received_;
+        if (++i->second == target_ && --pending_ == 0) pnet_.interrupt();
+    }
+
+private:
+    Sink(const Sink&);
+    void operator=(const Sink&);
+
+    typedef std::map<const void*, size_t> Counts;
+
+    Protonet& pnet_;
+    Protostack pstack_;
+    Counts     counts_;
+    size_t     target_;
+    size_t     pending_;
+    size_t     received_;
+};
+
+// Sends messages window at a time, returns sending time in seconds.
+static double
+send_loop(Sink& sink, const std::vector<SocketPtr>& out,
+          size_t const msgs, size_t const size)
+{
+    gu::Buffer const buf(size);
+    Datagram const dg(buf);
+    size_t const max_n(std::max(std::min(window, window_bytes/size),
+                                size_t(1)));
+
+    auto const start(std::chrono::steady_clock::now());
+
+    for (size_t sent(0); sent < msgs; )
+    {
+        size_t const n(std::min(max_n, msgs - sent));
+        for (size_t m(0); m < n; ++m)
+        {
+            for (size_t s(0); s < out.size(); ++s)
+            {
+                int const err(out[s]->send(0, dg));
+                if (err != 0 && err != EAGAIN && err != ENOBUFS)
+                {
+                    std::cerr << "send failed: " << err << '\n';
+                    abort();
+                }
+            }
+        }
+        sent += n;
+        sink.wait(sent, gu::datetime::Period(100 * gu::datetime::MSec));
+    }
+
+    auto const stop(std::chrono::steady_clock::now());
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+static void
+report(const char* const mode, size_t const n_nodes, size_t const msgs,
+       size_t const size, const Sink& sink, double const sec)
+{
+    size_t const expected(msgs * sink.n_receivers());
+    std::cout << mode << '\t' << n_nodes << '\t' << size << '\t' << msgs
+              << '\t' << sink.received() << '\t' << std::fixed
+              << std::setprecision(2)
+              << 100. * (expected - sink.received()) / expected << '\t'
+              << std::setprecision(3) << sec << '\t'
+              << std::setprecision(0) << msgs / sec << '\n';
+}
+
+static void
+tcp_run(gu::Config& conf, size_t const n_nodes, size_t const msgs,
+        size_t const size)
+{
+    std::unique_ptr<Protonet> pnet(Protonet::create(conf));
+
+    // Accepted connections are collected by the sender side
+    class Listener : public Toplay
+    {
+    public:
+        Listener(gu::Config& conf, Protonet& pnet, const gu::URI& uri)
+            :
+            Toplay(conf), pnet_(pnet), pstack_(),
+            acceptor_(pnet.acceptor(uri)), accepted_(), connected_()
+        {
+            pstack_.push_proto(this);
+            pnet_.insert(&pstack_);
+            acceptor_->listen(uri);
+        }
+        ~Listener()
+        {
+            pnet_.erase(&pstack_);
+            pstack_.pop_proto(this);
+            acceptor_->close();
+        }
+        std::string listen_addr() const { return acceptor_->listen_addr(); }
+        const std::vector<SocketPtr>& connected() const { return connected_; }
+        void handle_up(const void* id, const Datagram&, const ProtoUpMeta&)
+        {
+            if (id == acceptor_->id())
+            {
+                SocketPtr const socket(acceptor_->accept());
+                accepted_[socket->id()] = socket;
+                return;
+            }
+            std::map<const void*, SocketPtr>::iterator i(accepted_.find(id));
+            if (i != accepted_.end() &&
+                i->second->state() == Socket::S_CONNECTED)
+            {
+                connected_.push_back(i->second);
+                accepted_.erase(i);
+            }
+        }
+    private:
+        Listener(const Listener&);
+        void operator=(const Listener&);
+        Protonet&                        pnet_;
+        Protostack                       pstack_;
+        std::shared_ptr<Acceptor>        acceptor_;
+        std::map<const void*, SocketPtr> accepted_;
+        std::vector<SocketPtr>           connected_;
+    };
+
+    Listener listener(conf, *pnet, gu::URI("tcp://127.0.0.1:0"));
+    Sink sink(conf, *pnet);
+
+    gu::URI const uri(listener.listen_addr());
+    std::vector<SocketPtr> receivers;
+    for (size_t i(1); i < n_nodes; ++i)
+    {
+        receivers.push_back(pnet->socket(uri));
+        receivers.back()->connect(uri);
+        sink.add_receiver(receivers.back()->id());
+    }
+
+    while (listener.connected().size() < n_nodes - 1)
+    {
+        pnet->event_loop(gu::datetime::Period(10 * gu::datetime::MSec));
+    }
+
+    double const sec(send_loop(sink, listener.connected(), msgs, size));
+    report("tcp", n_nodes, msgs, size, sink, sec);
+
+    for (size_t i(0); i < receivers.size(); ++i) receivers[i]->close();
+}
+
+static void
+mcast_run(gu::Config& conf, size_t const n_nodes, size_t const msgs,
+          size_t const size, size_t const mtu)
+{
+    std::unique_ptr<Protonet> pnet(Protonet::create(conf));
+    Sink sink(conf, *pnet);
+
+    gu::URI const uri("udp://239.192.0.1:" + gu::to_string(20000 + getpid() % 20000)
+                      + '?' + Socket::OptIfAddr + "=127.0.0.1&"
+                      + Socket::OptIfLoop + "=1&"
+                      + Socket::OptMcastMTU + '=' + gu::to_string(mtu));
+
+    std::vector<SocketPtr> sockets;
+    for (size_t i(0); i < n_nodes; ++i)
+    {
+        sockets.push_back(pnet->socket(uri));
+        sockets.back()->connect(uri);
+        if (i > 0) sink.add_receiver(sockets.back()->id());
+    }
+
+    std::vector<SocketPtr> const out(1, sockets[0]);
+    double const sec(send_loop(sink, out, msgs, size));
+    report("mcast", n_nodes, msgs, size, sink, sec);
+
+    for (size_t i(0); i < sockets.size(); ++i) sockets[i]->close();
+}
+
+int main(int argc, char* argv[])
+{
+    size_t const nodes(argc > 1 ? atol(argv[1]) : 0);
+    size_t const msgs (argc > 2 ? atol(argv[2]) : 20000);
+    size_t const size (argc > 3 ? atol(argv[3]) : 256);
+    size_t const mtu  (argc > 4 ? atol(argv[4]) : 1500);
+
+    if ((nodes > 0 && nodes < 2) || msgs < 1 || size < 1 || mtu < 576)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " [nodes [messages [size [mtu]]]]\n";
+        return 1;
+    }
+
+    gu_log_max_level = GU_LOG_ERROR;
+    gu_crc32c_configure();
+
+    gu::Config conf;
+    gu::ssl_register_params(conf);
+    Conf::register_params(conf);
+
+    std::cout << "Mode:\tNodes:\tSize:\tMsgs:\tRecvd:\tLost%:\tTime:\tMsgs/s:\n";
+
+    size_t const runs[] = { 3, 9, 16 };
+    for (size_t r(0); r < sizeof(runs)/sizeof(runs[0]); ++r)
+    {
+        size_t const n(nodes > 0 ? nodes : runs[r]);
+        tcp_run(conf, n, msgs, size);
+        mcast_run(conf, n, msgs, size, mtu);
+        if (nodes > 0) break;
+    }
+
+    return 0;
+}
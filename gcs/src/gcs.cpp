@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2021 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -30,6 +30,8 @@
 #include <errno.h>
 #include <assert.h>
 
+#include <algorithm>
+
 const char* gcs_node_state_to_str (gcs_node_state_t state)
 {
     static const char* str[GCS_NODE_STATE_MAX + 1] =
@@ -140,6 +142,12 @@ struct gcs_conn
     gcs_fifo_lite_t* repl_q;
     gu_thread_t      send_thread;
 
+    /* Write sets waiting to be sent in one multi-action message */
+    gu_mutex_t           batch_lock;
+    struct gcs_repl_act* batch[GCS_CORE_BATCH_MAX];
+    int                  batch_len;
+    size_t               batch_bytes;
+
     /* A queue for threads waiting for received actions */
     gu_fifo_t*   recv_q;
     ssize_t      recv_q_size;
@@ -238,10 +246,14 @@ struct gcs_repl_act
     struct gcs_action*   action;
     gu_mutex_t           wait_mutex;
     gu_cond_t            wait_cond;
+    long                 err;  // set if action could not be sent
+    bool                 done; // protected by wait_mutex
     gcs_repl_act(const struct gu_buf* a_act_in, struct gcs_action* a_action)
       :
         act_in(a_act_in),
-        action(a_action)
+        action(a_action),
+        err(0),
+        done(false)
     { }
 };
 
@@ -359,6 +371,8 @@ gcs_create (gu_config_t* const conf, gcache_t* const gcache,
         GCS_CONN_DONOR : GCS_CONN_JOINED;
 
     gu_mutex_init(gu::get_mutex_key(gu::GU_MUTEX_KEY_GCS_FC), &conn->fc_lock);
+    gu_mutex_init(gu::get_mutex_key(gu::GU_MUTEX_KEY_GCS_BATCH),
+                  &conn->batch_lock);
     gu_mutex_init(gu::get_mutex_key(gu::GU_MUTEX_KEY_GCS_VOTE),
                   &conn->vote_lock_);
     gu_cond_init(gu::get_cond_key(gu::GU_COND_KEY_GCS_VOTE), &conn->vote_cond_);
@@ -1364,6 +1378,189 @@ _check_recv_queue_growth (gcs_conn_t* conn, ssize_t size)
     }
 }
 
+/*! Wakes up replicating thread whose action could not be sent */
+static void
+_repl_act_fail (struct gcs_repl_act* const act, long const err,
+                bool const locked)
+{
+    if (!locked) gu_mutex_lock (&act->wait_mutex);
+    act->err  = err;
+    act->done = true;
+    gu_cond_signal (&act->wait_cond);
+    if (!locked) gu_mutex_unlock (&act->wait_mutex);
+}
+
+/*! Moves batched write sets to acts array, @return their number */
+static int
+_batch_take (gcs_conn_t* const conn, struct gcs_repl_act** const acts)
+{
+    gu_mutex_lock (&conn->batch_lock);
+    int const ret(conn->batch_len);
+    std::copy (conn->batch, conn->batch + ret, acts);
+    conn->batch_len   = 0;
+    conn->batch_bytes = 0;
+    gu_mutex_unlock (&conn->batch_lock);
+
+    return ret;
+}
+
+/*! Adds write set to the batch, @return true if the batch is full */
+static bool
+_batch_add (gcs_conn_t* const conn, struct gcs_repl_act* const act)
+{
+    gu_mutex_lock (&conn->batch_lock);
+    assert (conn->batch_len < GCS_CORE_BATCH_MAX);
+    conn->batch[conn->batch_len++] = act;
+    conn->batch_bytes += act->action->size;
+    bool const ret(conn->batch_len   >= conn->params.batch_size ||
+                   conn->batch_bytes >= size_t(conn->params.batch_bytes));
+    gu_mutex_unlock (&conn->batch_lock);
+
+    return ret;
+}
+
+/*! @return true if write set is still in the batch */
+static bool
+_batch_pending (gcs_conn_t* const conn, const struct gcs_repl_act* const act)
+{
+    gu_mutex_lock (&conn->batch_lock);
+    bool const ret(std::find (conn->batch, conn->batch + conn->batch_len, act)
+                   != conn->batch + conn->batch_len);
+    gu_mutex_unlock (&conn->batch_lock);
+
+    return ret;
+}
+
+static inline bool
+_batchable (gcs_conn_t* const conn, const struct gcs_action* const act)
+{
+    return (conn->params.batch_size > 1                         &&
+            GCS_ACT_WRITESET == act->type                       &&
+            act->size < conn->params.batch_bytes                &&
+            gcs_core_proto_ver (conn->core) >= GCS_PROTO_BATCH);
+}
+
+/*!
+ * Sends batched write sets. Must be called from within send monitor.
+ * Threads of write sets that could not be sent are woken up with an error.
+ *
+ * @param self write set of the calling thread if it holds its wait_mutex
+ */
+static void
+_batch_flush (gcs_conn_t* const conn, const struct gcs_repl_act* const self)
+{
+    struct gcs_repl_act* acts[GCS_CORE_BATCH_MAX];
+    int const count(_batch_take (conn, acts));
+
+    if (0 == count) return;
+
+    ssize_t ret(-ENOTCONN);
+    int     queued(0);
+    int     sent(0);
+
+    if (GCS_CONN_OPEN >= conn->state) {
+        for (; queued < count; queued++) {
+            struct gcs_repl_act** const act_ptr((struct gcs_repl_act**)
+                                       gcs_fifo_lite_get_tail (conn->repl_q));
+            if (!act_ptr) break;
+            *act_ptr = acts[queued];
+            gcs_fifo_lite_push_tail (conn->repl_q);
+        }
+    }
+
+    if (queued == count) {
+        if (count > 1) {
+            struct gcs_core_act core_acts[GCS_CORE_BATCH_MAX];
+
+            for (int i = 0; i < count; i++) {
+                core_acts[i].act      = acts[i]->act_in;
+                core_acts[i].act_size = acts[i]->action->size;
+            }
+
+            while ((ret = gcs_core_send_batch (conn->core, core_acts, count))
+                   == -ERESTART) {}
+
+            if (ret >= 0) sent = count;
+        }
+
+        if (1 == count || -EPROTONOSUPPORT == ret) {
+            /* group protocol was downgraded since the batch was started */
+            for (; sent < count; sent++) {
+                while ((ret = gcs_core_send (conn->core, acts[sent]->act_in,
+                                             acts[sent]->action->size,
+                                             acts[sent]->action->type))
+                       == -ERESTART) {}
+                if (ret < 0) break;
+            }
+        }
+    }
+
+    if (gu_unlikely(sent < count)) {
+        gu_warn ("Send of %d batched write sets returned %zd (%s)",
+                 count - sent, ret, strerror(-ret));
+
+        /* remove unsent items from the queue, they will never be delivered */
+        for (int i = sent; i < queued; i++) {
+            if (!gcs_fifo_lite_remove (conn->repl_q)) {
+                gu_fatal ("Failed to remove unsent item from repl_q");
+                assert(0);
+                ret = -ENOTRECOVERABLE;
+            }
+        }
+
+        for (int i = sent; i < count; i++) {
+            _repl_act_fail (acts[i], ret < 0 ? ret : -ENOTCONN,
+                            acts[i] == self);
+        }
+    }
+}
+
+/*!
+ * Waits for delivery of the batched write set. If the batch is not sent
+ * within batch_latency, flushes it on behalf of the other threads.
+ * Called with repl_act->wait_mutex locked.
+ */
+static void
+_batch_wait (gcs_conn_t* const conn, struct gcs_repl_act* const repl_act)
+{
+    /* once the batch is sent there is nothing to wait for but delivery */
+    while (!repl_act->done && _batch_pending (conn, repl_act)) {
+        gu::datetime::Date const deadline(gu::datetime::Date::calendar() +
+            gu::datetime::Period(conn->params.batch_latency *
+                                 gu::datetime::USec));
+        struct timespec ts;
+        deadline._timespec(ts);
+
+        int err(0);
+        while (!repl_act->done && ETIMEDOUT != err) {
+            err = gu_cond_timedwait (&repl_act->wait_cond,
+                                     &repl_act->wait_mutex, &ts);
+        }
+
+        if (repl_act->done) break;
+
+        gu_mutex_unlock (&repl_act->wait_mutex);
+
+        gu_cond_t tmp_cond;
+        gu_cond_init (gu::get_cond_key(gu::GU_COND_KEY_GCS_SENDV), &tmp_cond);
+        long const ret(gcs_sm_enter (conn->sm, &tmp_cond, false, true));
+        if (0 == ret) {
+            _batch_flush (conn, NULL);
+            gcs_sm_leave (conn->sm);
+        }
+        gu_cond_destroy (&tmp_cond);
+
+        gu_mutex_lock (&repl_act->wait_mutex);
+
+        /* if the monitor is closed, _close() will release us */
+        if (ret && -EAGAIN != ret && -EINTR != ret) break;
+    }
+
+    while (!repl_act->done) {
+        gu_cond_wait (&repl_act->wait_cond, &repl_act->wait_mutex);
+    }
+}
+
 static long
 _close(gcs_conn_t* conn, bool join_recv_thread)
 {
@@ -1414,11 +1611,19 @@ _close(gcs_conn_t* conn, bool join_recv_thread)
              * they'll quit on their own,
              * they don't depend on the conn object after waking */
             gu_mutex_lock   (&act->wait_mutex);
+            act->done = true;
             gu_cond_signal  (&act->wait_cond);
             gu_mutex_unlock (&act->wait_mutex);
         }
         gcs_fifo_lite_close (conn->repl_q);
 
+        /* Write sets that were batched but never sent */
+        struct gcs_repl_act* batch[GCS_CORE_BATCH_MAX];
+        int const batch_len(_batch_take (conn, batch));
+        for (int i = 0; i < batch_len; i++) {
+            _repl_act_fail (batch[i], -ENOTCONN, false);
+        }
+
         /* wake all gcs_recv() threads () */
         // FIXME: this can block waiting for applicaiton threads to fetch all
         // items. In certain situations this can block forever. Ticket #113
@@ -1539,6 +1744,7 @@ static void *gcs_recv_thread (void *arg)
             repl_act->action->seqno_l = this_act_id;
 
             gu_mutex_lock   (&repl_act->wait_mutex);
+            repl_act->done = true;
             gu_cond_signal  (&repl_act->wait_cond);
             gu_mutex_unlock (&repl_act->wait_mutex);
         }
@@ -1780,6 +1986,7 @@ long gcs_destroy (gcs_conn_t *conn)
     gu_mutex_destroy(&conn->vote_lock_);
     /* This must not last for long */
     while (gu_mutex_destroy (&conn->fc_lock));
+    gu_mutex_destroy(&conn->batch_lock);
 
     _cleanup_params (conn);
 
@@ -1887,6 +2094,7 @@ long gcs_replv (gcs_conn_t*          const conn,      //!<in
             struct gcs_repl_act** act_ptr;
 
             const void* const orig_buf = act->buf;
+            bool batched = false;
 
             // some hack here to achieve one if() instead of two:
             // ret = -EAGAIN part is a workaround for #569
@@ -1895,6 +2103,9 @@ long gcs_replv (gcs_conn_t*          const conn,      //!<in
             if ((ret = -EAGAIN,
                  !fc_active(conn) || act->type != GCS_ACT_WRITESET) &&
                 (ret = -ENOTCONN, GCS_CONN_OPEN >= conn->state)     &&
+                !(batched = _batchable(conn, act))                  &&
+                /* batched write sets must be sent before this action */
+                (_batch_flush(conn, NULL), true)                    &&
                 (act_ptr = (struct gcs_repl_act**)gcs_fifo_lite_get_tail (conn->repl_q)))
             {
                 *act_ptr = &repl_act;
@@ -1920,6 +2131,16 @@ long gcs_replv (gcs_conn_t*          const conn,      //!<in
                     assert (ret == (ssize_t)act->size);
                 }
             }
+            else if (batched) {
+                /* send the batch right away if it is full or if nothing is
+                 * in flight, otherwise let it grow for up to batch_latency */
+                if (_batch_add (conn, &repl_act) ||
+                    gcs_fifo_lite_empty (conn->repl_q)) {
+                    _batch_flush (conn, &repl_act);
+                }
+
+                ret = act->size;
+            }
 
             gcs_sm_leave (conn->sm);
 
@@ -1927,7 +2148,23 @@ long gcs_replv (gcs_conn_t*          const conn,      //!<in
 
             /* now we can go waiting for action delivery */
             if (ret >= 0) {
-                gu_cond_wait (&repl_act.wait_cond, &repl_act.wait_mutex);
+                if (batched) {
+                    _batch_wait (conn, &repl_act);
+                }
+                else {
+                    while (!repl_act.done) {
+                        gu_cond_wait (&repl_act.wait_cond,
+                                      &repl_act.wait_mutex);
+                    }
+                }
+
+                if (repl_act.err) {
+                    /* batched action was never sent */
+                    assert (batched);
+                    assert (orig_buf == act->buf);
+                    ret = repl_act.err;
+                    goto out;
+                }
 #ifndef GCS_FOR_GARB
                 /* assert (act->buf != 0); */
                 if (act->buf == 0)
@@ -1966,9 +2203,7 @@ long gcs_replv (gcs_conn_t*          const conn,      //!<in
                 }
             }
         }
-#ifndef GCS_FOR_GARB
     out:
-#endif /* GCS_FOR_GARB */
         gu_mutex_unlock  (&repl_act.wait_mutex);
     }
     gu_mutex_destroy (&repl_act.wait_mutex);
@@ -2706,6 +2941,27 @@ bool gcs_register_params (gu_config_t* const conf)
     return (gcs_params_register (conf) || gcs_core_register (conf));
 }
 
+static long
+_set_batch_param (gcs_conn_t* conn, const char* value, const char* key,
+                  long min_val, long max_val, long* param)
+{
+    long long val;
+    const char* const endptr = gu_str2ll(value, &val);
+
+    if (*endptr == '\0' && val >= min_val && val <= max_val) {
+
+        gu_mutex_lock (&conn->batch_lock);
+        *param = val;
+        gu_config_set_int64 (conn->config, key, val);
+        gu_mutex_unlock (&conn->batch_lock);
+
+        return 0;
+    }
+    else {
+        return -EINVAL;
+    }
+}
+
 long gcs_param_set  (gcs_conn_t* conn, const char* key, const char *value)
 {
     if (!strcmp (key, GCS_PARAMS_FC_LIMIT)) {
@@ -2732,6 +2988,18 @@ long gcs_param_set  (gcs_conn_t* conn, const char* key, const char *value)
     else if (!strcmp (key, GCS_PARAMS_MAX_THROTTLE)) {
         return _set_max_throttle (conn, value);
     }
+    else if (!strcmp (key, GCS_PARAMS_BATCH_SIZE)) {
+        return _set_batch_param (conn, value, key, 1, GCS_CORE_BATCH_MAX,
+                                 &conn->params.batch_size);
+    }
+    else if (!strcmp (key, GCS_PARAMS_BATCH_BYTES)) {
+        return _set_batch_param (conn, value, key, 0, LONG_MAX,
+                                 &conn->params.batch_bytes);
+    }
+    else if (!strcmp (key, GCS_PARAMS_BATCH_LATENCY)) {
+        return _set_batch_param (conn, value, key, 0, 1000000,
+                                 &conn->params.batch_latency);
+    }
 #ifdef GCS_SM_DEBUG
     else if (!strcmp (key, GCS_PARAMS_SM_DUMP)) {
         gcs_sm_dump_state(conn->sm, stderr);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2013 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -22,10 +22,23 @@ bytes: 00 01                07 08       11 12       15 16       19 20
 PV - protocol version
 AT - action type
 
+  Since version 5 the last two reserved bytes carry the number of actions
+  packed in the message:
+
+bytes: 16 17 18 19 20
+      +--+--+--+--+--+---
+      |AT|rs|  AC |  data...
+      +--+--+--+--+--+---
+
+AC - action count, 1 for a regular action. If greater than 1, data starts
+     with a table of AC + 1 32-bit words: AC followed by the sizes of the
+     packed actions, then the actions themselves follow back to back.
+
 */
 
 static const size_t PROTO_PV_OFFSET       = 0;
 static const size_t PROTO_AT_OFFSET       = 16;
+static const size_t PROTO_AC_OFFSET       = 18;
 static const size_t PROTO_DATA_OFFSET     = 20;
 // static const size_t PROTO_ACT_ID_OFFSET   = 0;
 // static const size_t PROTO_ACT_SIZE_OFFSET = 8;
@@ -69,6 +82,15 @@ gcs_act_proto_write (gcs_act_frag_t* frag, void* buf, size_t buf_len)
     ((uint8_t *)buf)[PROTO_PV_OFFSET] = frag->proto_ver;
     ((uint8_t *)buf)[PROTO_AT_OFFSET] = frag->act_type;
 
+    if (frag->proto_ver >= GCS_PROTO_BATCH) {
+        assert (frag->act_count > 0 && frag->act_count <= 0xffff);
+        *(uint16_t*)((uint8_t*)buf + PROTO_AC_OFFSET) =
+            htogs((uint16_t)frag->act_count);
+    }
+    else {
+        assert (1 == frag->act_count);
+    }
+
     frag->frag     = (uint8_t*)buf + PROTO_DATA_OFFSET;
     frag->frag_len = buf_len - PROTO_DATA_OFFSET;
 
@@ -105,6 +127,22 @@ gcs_act_proto_read (gcs_act_frag_t* frag, const void* buf, size_t buf_len)
     frag->frag     = ((uint8_t*)buf) + PROTO_DATA_OFFSET;
     frag->frag_len = buf_len - PROTO_DATA_OFFSET;
 
+    if (frag->proto_ver >= GCS_PROTO_BATCH) {
+        frag->act_count =
+            gtohs(*(uint16_t*)((uint8_t*)buf + PROTO_AC_OFFSET));
+
+        if (gu_unlikely(0 == frag->act_count ||
+                        (frag->act_count > 1 &&
+                         GCS_ACT_WRITESET != frag->act_type))) {
+            gu_error ("Bad action count %d for action type %d",
+                      frag->act_count, frag->act_type);
+            return -EBADMSG;
+        }
+    }
+    else {
+        frag->act_count = 1;
+    }
+
     /* return 0 or -EMSGSIZE */
     return ((frag->act_size > GCS_MAX_ACT_SIZE) * -EMSGSIZE);
 }
@@ -120,3 +158,59 @@ gcs_act_proto_hdr_size (long version)
     return PROTO_DATA_OFFSET;
 }
 
+
+void
+gcs_act_proto_batch_write (void* buf, const size_t* sizes, int count)
+{
+    uint32_t* const table = (uint32_t*)buf;
+
+    assert (count > 1);
+
+    table[0] = htogl((uint32_t)count);
+
+    for (int i = 0; i < count; i++) {
+        table[i + 1] = htogl((uint32_t)sizes[i]);
+    }
+}
+
+long
+gcs_act_proto_batch_read (const void* buf, size_t buf_len, int count,
+                          size_t* sizes)
+{
+    size_t const hdr_size = gcs_act_proto_batch_hdr_size (count);
+
+    if (gu_unlikely(buf_len < hdr_size)) {
+        gu_error ("Multi-action message too short: %zu, expected at least %zu",
+                  buf_len, hdr_size);
+        return -EBADMSG;
+    }
+
+    const uint32_t* const table = (const uint32_t*)buf;
+
+    if (gu_unlikely(gtohl(table[0]) != (uint32_t)count)) {
+        gu_error ("Multi-action message count mismatch: %u, expected %d",
+                  gtohl(table[0]), count);
+        return -EBADMSG;
+    }
+
+    size_t total = hdr_size;
+
+    for (int i = 0; i < count; i++) {
+        sizes[i] = gtohl(table[i + 1]);
+
+        if (gu_unlikely(0 == sizes[i])) {
+            gu_error ("Empty action %d in multi-action message", i);
+            return -EBADMSG;
+        }
+
+        total += sizes[i];
+    }
+
+    if (gu_unlikely(total != buf_len)) {
+        gu_error ("Multi-action message size mismatch: %zu, expected %zu",
+                  total, buf_len);
+        return -EBADMSG;
+    }
+
+    return 0;
+}
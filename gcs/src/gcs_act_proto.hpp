@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2019 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -26,8 +26,12 @@ typedef uint8_t gcs_proto_t;
  *     (needs protocol version bump to keep it identical on all nodes)
  * 4 - fix for the error voting protocol
  *     (must keep it identical on all nodes)
+ * 5 - support for multi-action (batched) messages
  */
-#define GCS_PROTO_MAX 4
+#define GCS_PROTO_MAX 5
+
+/*! Minimal protocol version which can carry several actions in one message */
+#define GCS_PROTO_BATCH 5
 
 /*! Internal action fragment data representation */
 typedef struct gcs_act_frag
@@ -39,6 +43,7 @@ typedef struct gcs_act_frag
     unsigned long  frag_no;
     gcs_act_type_t act_type;
     int            proto_ver;
+    int            act_count; // number of actions packed in this one
 }
 gcs_act_frag_t;
 
@@ -71,6 +76,28 @@ gcs_act_proto_inc (void* buf)
 extern long
 gcs_act_proto_hdr_size (long version);
 
+/*! Returns the size of the action size table in front of the data of
+ *  multi-action message */
+static inline size_t
+gcs_act_proto_batch_hdr_size (int count)
+{
+    return sizeof(uint32_t) * (count + 1);
+}
+
+/*! Writes the action size table of multi-action message of count actions.
+ *  buf must have at least gcs_act_proto_batch_hdr_size(count) bytes */
+extern void
+gcs_act_proto_batch_write (void* buf, const size_t* sizes, int count);
+
+/*! Reads and validates the action size table of a complete multi-action
+ *  message of buf_len bytes. Action data starts at
+ *  gcs_act_proto_batch_hdr_size(count) offset.
+ *
+ * @return 0 on success, -EBADMSG if the table does not match the message */
+extern long
+gcs_act_proto_batch_read (const void* buf, size_t buf_len, int count,
+                          size_t* sizes);
+
 /*! Returns message protocol version */
 static inline int
 gcs_act_proto_ver (void* buf)
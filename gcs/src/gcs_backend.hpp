@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2014 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -54,12 +54,19 @@ long fn (gcs_backend_t*    backend)
 /*!
  * Send a message from the backend.
  *
+ * The message is given as a scatter/gather array of buffers, so that large
+ * action fragments can be passed as a header followed by slices of the
+ * original action buffers without gathering them in an intermediate buffer.
+ * Backend must not retain references to the buffers after return.
+ *
  * @param backend
  *        a pointer to the backend handle
- * @param buf
- *        a buffer to copy the message to
+ * @param bufs
+ *        array of buffers that make up the message
+ * @param bufs_num
+ *        number of buffers in the array
  * @param len
- *        length of the supplied buffer
+ *        total length of the message (sum of buffer sizes)
  * @param msg_type
  *        type of the message
  * @return
@@ -67,11 +74,12 @@ long fn (gcs_backend_t*    backend)
  *        OR
  *        amount of bytes sent
  */
-#define GCS_BACKEND_SEND_FN(fn)           \
-long fn (gcs_backend_t* const backend,    \
-         const void*    const buf,        \
-         size_t         const len,        \
-         gcs_msg_type_t const msg_type)
+#define GCS_BACKEND_SEND_FN(fn)                   \
+long fn (gcs_backend_t*       const backend,      \
+         const struct gu_buf* const bufs,         \
+         size_t               const bufs_num,     \
+         size_t               const len,          \
+         gcs_msg_type_t       const msg_type)
 
 /*!
  * Receive a message from the backend.
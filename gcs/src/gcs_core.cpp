@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  *
@@ -28,6 +28,11 @@
 #include <string.h> // for mempcpy
 #include <errno.h>
 
+#include <algorithm>
+#include <deque>
+#include <new>
+#include <vector>
+
 using namespace gcs::core;
 
 bool
@@ -79,6 +84,9 @@ struct gcs_core
     /* local action FIFO */
     gcs_fifo_lite_t* fifo;
 
+    /* write sets of the last multi-action message yet to be returned */
+    std::deque<struct gcs_act_rcvd>* batch_q;
+
     /* group context */
     gcs_group_t     group;
 
@@ -141,7 +149,9 @@ gcs_core_create (gu_config_t* const conf,
 
                 core->fifo = gcs_fifo_lite_create (CORE_FIFO_LEN,
                                                    sizeof (core_act_t));
-                if (core->fifo) {
+                core->batch_q =
+                    new (std::nothrow) std::deque<struct gcs_act_rcvd>;
+                if (core->fifo && core->batch_q) {
                     gu_mutex_init(
                         gu::get_mutex_key(gu::GU_MUTEX_KEY_GCS_CORE_SEND),
                         &core->send_lock);
@@ -162,6 +172,8 @@ gcs_core_create (gu_config_t* const conf,
                     return core; // success
                 }
 
+                delete core->batch_q;
+                if (core->fifo) gcs_fifo_lite_destroy (core->fifo);
                 gu_free (core->send_buf);
             }
 
@@ -254,10 +266,11 @@ core_error (core_state_t state)
  * actions.
  */
 static inline ssize_t
-core_msg_send (gcs_core_t*    core,
-               const void*    msg,
-               size_t         msg_len,
-               gcs_msg_type_t msg_type)
+core_msg_send (gcs_core_t*          core,
+               const struct gu_buf* bufs,
+               size_t               bufs_num,
+               size_t               msg_len,
+               gcs_msg_type_t       msg_type)
 {
     ssize_t ret;
 
@@ -267,7 +280,8 @@ core_msg_send (gcs_core_t*    core,
                       (CORE_EXCHANGE == core->state && GCS_MSG_STATE_MSG ==
                        msg_type))) {
 
-            ret = core->backend.send (&core->backend, msg, msg_len, msg_type);
+            ret = core->backend.send (&core->backend, bufs, bufs_num, msg_len,
+                                      msg_type);
 
             if (ret > 0 && ret != (ssize_t)msg_len &&
                 GCS_MSG_ACTION != msg_type) {
@@ -298,13 +312,15 @@ core_msg_send (gcs_core_t*    core,
  * by core_msg_send()
  */
 static inline ssize_t
-core_msg_send_retry (gcs_core_t*    core,
-                     const void*    buf,
-                     size_t         buf_len,
-                     gcs_msg_type_t type)
+core_msg_send_retry (gcs_core_t*          core,
+                     const struct gu_buf* bufs,
+                     size_t               bufs_num,
+                     size_t               msg_len,
+                     gcs_msg_type_t       type)
 {
     ssize_t ret;
-    while ((ret = core_msg_send (core, buf, buf_len, type)) == -EAGAIN) {
+    while ((ret = core_msg_send (core, bufs, bufs_num, msg_len, type))
+           == -EAGAIN) {
         /* wait for primary configuration - sleep 0.01 sec */
         gu_debug ("Backend requested wait");
         usleep (10000);
@@ -313,75 +329,87 @@ core_msg_send_retry (gcs_core_t*    core,
     return ret;
 }
 
-ssize_t
-gcs_core_send (gcs_core_t*          const conn,
-               const struct gu_buf* const action,
-               size_t                     act_size,
-               gcs_act_type_t       const act_type)
+/*! Same as above for a message in a single contiguous buffer */
+static inline ssize_t
+core_msg_send_retry (gcs_core_t*    core,
+                     const void*    buf,
+                     size_t         buf_len,
+                     gcs_msg_type_t type)
 {
-    ssize_t        ret  = 0;
-    ssize_t        sent = 0;
-    gcs_act_frag_t frg;
-    ssize_t        send_size;
-    const unsigned char proto_ver = conn->proto_ver;
-    const ssize_t  hdr_size       = gcs_act_proto_hdr_size (proto_ver);
-
-    core_act_t*    local_act;
-
-    assert (action != NULL);
-    assert (act_size > 0);
-    /* actions passing this way will be put in cache */
-    assert (gcs_act_in_cache(act_type));
-
-    /*
-     * Action header will be replicated with every message.
-     * It may seem like an extra overhead, but it is tiny
-     * so far and simplifies A LOT.
-     */
-
-    /* Initialize action constants */
-    frg.act_size  = act_size;
-    frg.act_type  = act_type;
-    frg.act_id    = conn->send_act_no; /* incremented for every new action */
-    frg.frag_no   = 0;
-    frg.proto_ver = proto_ver;
+    struct gu_buf const msg = { buf, static_cast<ssize_t>(buf_len) };
+    return core_msg_send_retry (core, &msg, 1, buf_len, type);
+}
 
-    if ((ret = gcs_act_proto_write (&frg, conn->send_buf, conn->send_buf_len)))
-        return ret;
+/* Records local action in the FIFO to be matched with it on delivery */
+static inline ssize_t
+core_fifo_push (gcs_core_t* const conn, const void* const action,
+                size_t const action_size)
+{
+    core_act_t* local_act;
 
     if ((local_act = (core_act_t*)gcs_fifo_lite_get_tail (conn->fifo))) {
-        *local_act = (core_act_t){ conn->send_act_no, action, act_size };
+        *local_act = (core_act_t){ conn->send_act_no, action, action_size };
         gcs_fifo_lite_push_tail (conn->fifo);
+        return 0;
     }
     else {
-        ret = core_error (conn->state);
-        gu_error ("Failed to access core FIFO: %d (%s)", ret, strerror (-ret));
+        ssize_t const ret = core_error (conn->state);
+        gu_error ("Failed to access core FIFO: %zd (%s)", ret, strerror(-ret));
         return ret;
     }
+}
+
+/*!
+ * Sends action fragments. Action header must be already written to send_buf
+ * and fifo_len local action records pushed to FIFO.
+ */
+static ssize_t
+core_send_frags (gcs_core_t*          const conn,
+                 gcs_act_frag_t&            frg,
+                 ssize_t              const hdr_size,
+                 const struct gu_buf* const action,
+                 size_t                     act_size,
+                 int                  const fifo_len)
+{
+    ssize_t        ret  = 0;
+    ssize_t        sent = 0;
+    ssize_t        send_size;
 
     int            idx  = 0;
     const uint8_t* ptr  = (const uint8_t*)action[idx].ptr;
     size_t         left = action[idx].size;
 
+    /* Fragment is sent as the header from send_buf followed by slices of
+     * action buffers, so action payload is not copied here. */
+    std::vector<struct gu_buf> frag_bufs;
+    frag_bufs.reserve(8);
+
     do {
         const size_t chunk_size =
             act_size < frg.frag_len ? act_size : frg.frag_len;
 
-        /* Here is the only time we have to cast frg.frag */
-        char* dst = (char*)frg.frag;
-        size_t to_copy = chunk_size;
+        frag_bufs.clear();
+        struct gu_buf const hdr = { conn->send_buf, hdr_size };
+        frag_bufs.push_back(hdr);
 
-        while (to_copy > 0) {        // gather action bufs into one
-            if (to_copy <= left) {
-                memcpy (dst, ptr, to_copy);
-                ptr     += to_copy;
-                left    -= to_copy;
-                to_copy = 0;
+        size_t to_slice = chunk_size;
+
+        while (to_slice > 0) {       // slice action bufs into fragment
+            if (to_slice <= left) {
+                struct gu_buf const slice =
+                    { ptr, static_cast<ssize_t>(to_slice) };
+                frag_bufs.push_back(slice);
+                ptr     += to_slice;
+                left    -= to_slice;
+                to_slice = 0;
             }
             else {
-                memcpy (dst, ptr, left);
-                dst     += left;
-                to_copy -= left;
+                if (left > 0) {
+                    struct gu_buf const slice =
+                        { ptr, static_cast<ssize_t>(left) };
+                    frag_bufs.push_back(slice);
+                }
+                to_slice -= left;
                 idx++;
                 ptr  = (const uint8_t*)action[idx].ptr;
                 left = action[idx].size;
@@ -393,10 +421,10 @@ gcs_core_send (gcs_core_t*          const conn,
 #ifdef GCS_CORE_TESTING
         gu_lock_step_wait (&conn->ls); // pause after every fragment
         gu_info ("Sent %p of size %zu. Total sent: %zu, left: %zu",
-                 (char*)conn->send_buf + hdr_size, chunk_size, sent, act_size);
+                 frag_bufs[1].ptr, chunk_size, sent, act_size);
 #endif
-        ret = core_msg_send_retry (conn, conn->send_buf, send_size,
-                                   GCS_MSG_ACTION);
+        ret = core_msg_send_retry (conn, &frag_bufs[0], frag_bufs.size(),
+                                   send_size, GCS_MSG_ACTION);
         GU_DBUG_SYNC_WAIT("gcs_core_after_frag_send");
 #ifdef GCS_CORE_TESTING
 //        gu_lock_step_wait (&conn->ls); // pause after every fragment
@@ -413,9 +441,9 @@ gcs_core_send (gcs_core_t*          const conn,
             act_size -= ret;
 
             if (gu_unlikely((size_t)ret < chunk_size)) {
-                /* Could not send all that was copied: */
+                /* Could not send the whole fragment: */
 
-                /* 1. adjust frag_len, don't copy more than we could send */
+                /* 1. adjust frag_len, don't slice more than we could send */
                 frg.frag_len = ret;
 
                 /* 2. move ptr back to point at the first unsent byte */
@@ -451,7 +479,7 @@ gcs_core_send (gcs_core_t*          const conn,
              *
              * 1. Action will never be received completely by this node. Hence
              *    action must be removed from fifo on behalf of sending thr.: */
-            gcs_fifo_lite_remove (conn->fifo);
+            for (int i = 0; i < fifo_len; i++) gcs_fifo_lite_remove (conn->fifo);
             /* 2. Members will have to discard received fragments.
              * Two reasons could lead us here: new member(s) in configuration
              * change or broken connection (leave group). In both cases other
@@ -472,6 +500,112 @@ out:
     return ret;
 }
 
+ssize_t
+gcs_core_send (gcs_core_t*          const conn,
+               const struct gu_buf* const action,
+               size_t                     act_size,
+               gcs_act_type_t       const act_type)
+{
+    ssize_t        ret;
+    gcs_act_frag_t frg;
+    const unsigned char proto_ver = conn->proto_ver;
+    const ssize_t  hdr_size       = gcs_act_proto_hdr_size (proto_ver);
+
+    assert (action != NULL);
+    assert (act_size > 0);
+    /* actions passing this way will be put in cache */
+    assert (gcs_act_in_cache(act_type));
+
+    /*
+     * Action header will be replicated with every message.
+     * It may seem like an extra overhead, but it is tiny
+     * so far and simplifies A LOT.
+     */
+
+    /* Initialize action constants */
+    frg.act_size  = act_size;
+    frg.act_type  = act_type;
+    frg.act_id    = conn->send_act_no; /* incremented for every new action */
+    frg.frag_no   = 0;
+    frg.proto_ver = proto_ver;
+    frg.act_count = 1;
+
+    if ((ret = gcs_act_proto_write (&frg, conn->send_buf, conn->send_buf_len)))
+        return ret;
+
+    if ((ret = core_fifo_push (conn, action, act_size))) return ret;
+
+    return core_send_frags (conn, frg, hdr_size, action, act_size, 1);
+}
+
+ssize_t
+gcs_core_send_batch (gcs_core_t*                const conn,
+                     const struct gcs_core_act* const acts,
+                     int                        const count)
+{
+    ssize_t        ret;
+    gcs_act_frag_t frg;
+    int const      proto_ver = conn->proto_ver;
+
+    assert (acts != NULL);
+    assert (count > 1 && count <= GCS_CORE_BATCH_MAX);
+
+    if (gu_unlikely(proto_ver < GCS_PROTO_BATCH)) return -EPROTONOSUPPORT;
+
+    const ssize_t hdr_size = gcs_act_proto_hdr_size (proto_ver);
+
+    /* message payload: action size table followed by action buffers */
+    size_t   sizes[GCS_CORE_BATCH_MAX];
+    uint32_t table[GCS_CORE_BATCH_MAX + 1];
+    size_t   act_size = gcs_act_proto_batch_hdr_size (count);
+
+    std::vector<struct gu_buf> bufs;
+    bufs.reserve(count * 4 + 1);
+
+    struct gu_buf const table_buf =
+        { table, static_cast<ssize_t>(act_size) };
+    bufs.push_back(table_buf);
+
+    for (int i = 0; i < count; i++) {
+        assert (acts[i].act_size > 0);
+
+        sizes[i]  = acts[i].act_size;
+        act_size += sizes[i];
+
+        size_t left = sizes[i];
+        for (int b = 0; left > 0; b++) {
+            size_t const size =
+                std::min<size_t>(acts[i].act[b].size, left);
+            struct gu_buf const buf = { acts[i].act[b].ptr,
+                                        static_cast<ssize_t>(size) };
+            bufs.push_back(buf);
+            left -= size;
+        }
+    }
+
+    gcs_act_proto_batch_write (table, sizes, count);
+
+    frg.act_size  = act_size;
+    frg.act_type  = GCS_ACT_WRITESET;
+    frg.act_id    = conn->send_act_no;
+    frg.frag_no   = 0;
+    frg.proto_ver = proto_ver;
+    frg.act_count = count;
+
+    if ((ret = gcs_act_proto_write (&frg, conn->send_buf, conn->send_buf_len)))
+        return ret;
+
+    /* every write set gets its own FIFO record, all with the same id */
+    for (int i = 0; i < count; i++) {
+        if ((ret = core_fifo_push (conn, acts[i].act, acts[i].act_size))) {
+            while (i--) gcs_fifo_lite_remove (conn->fifo);
+            return ret;
+        }
+    }
+
+    return core_send_frags (conn, frg, hdr_size, &bufs[0], act_size, count);
+}
+
 /* A helper for gcs_core_recv().
  * Deals with fetching complete message from backend
  * and reallocates recv buf if needed */
@@ -519,6 +653,127 @@ core_msg_recv (gcs_backend_t* backend, gcs_recv_msg_t* recv_msg,
     return ret;
 }
 
+/*!
+ * Helper for core_handle_act_msg(). Splits complete multi-action message
+ * into separate write sets with consecutive ids. The first write set is
+ * returned in act, the rest are queued to be returned by the following
+ * gcs_core_recv() calls.
+ *
+ * @return size of the first write set or negative error code.
+ */
+static ssize_t
+core_handle_batch (gcs_core_t*           const core,
+                   const gcs_act_frag_t&       frg,
+                   struct gcs_act_rcvd*  const act,
+                   bool                  const my_msg)
+{
+    int const    count    = frg.act_count;
+    size_t const hdr_size = gcs_act_proto_batch_hdr_size (count);
+    std::vector<size_t>      sizes(count);
+    std::vector<core_act_t>  locals;
+
+    assert (count > 1);
+    assert (GCS_ACT_WRITESET == act->act.type);
+
+#ifndef GCS_FOR_GARB
+    const uint8_t* const plain = static_cast<const uint8_t*>
+        (gcs_gcache_get_ro_plaintext (core->cache, act->act.buf));
+
+    if (gu_unlikely(gcs_act_proto_batch_read (plain, act->act.buf_len, count,
+                                              &sizes[0]))) {
+        gu_fatal ("Malformed multi-action message %lld from member %d",
+                  (long long)frg.act_id, act->sender_idx);
+        return -ENOTRECOVERABLE;
+    }
+
+    const uint8_t* data = plain + hdr_size;
+#else
+    /* action data is not stored, sizes serve only for accounting */
+    size_t const len     = act->act.buf_len;
+    size_t const payload = len > hdr_size ? len - hdr_size : 0;
+    for (int i = 0; i < count; i++) sizes[i] = payload / count;
+    sizes[count - 1] += payload % count;
+#endif /* GCS_FOR_GARB */
+
+    if (my_msg) {
+        /* local write sets, get them from FIFO, should be there already */
+        locals.reserve(count);
+
+        for (int i = 0; i < count; i++) {
+            core_act_t* const local_act =
+                (core_act_t*)gcs_fifo_lite_get_head (core->fifo);
+
+            if (gu_unlikely(NULL == local_act)) {
+                gu_fatal ("FIFO violation: queue empty when local action "
+                          "received");
+                return -ENOTRECOVERABLE;
+            }
+
+            locals.push_back(*local_act);
+            gcs_fifo_lite_pop_head (core->fifo);
+
+            /* sanity check */
+            if (gu_unlikely(locals[i].sent_act_id != frg.act_id)) {
+                gu_fatal ("FIFO violation: expected sent_act_id %lld "
+                          "found %lld", locals[i].sent_act_id, frg.act_id);
+                return -ENOTRECOVERABLE;
+            }
+#ifndef GCS_FOR_GARB
+            if (gu_unlikely(locals[i].action_size != sizes[i])) {
+                gu_fatal ("Send/recv action size mismatch: %zu/%zu",
+                          locals[i].action_size, sizes[i]);
+                return -ENOTRECOVERABLE;
+            }
+#else
+            sizes[i] = locals[i].action_size;
+#endif /* GCS_FOR_GARB */
+        }
+
+        assert (act->id < 0 || CORE_PRIMARY == core->state);
+
+        if (gu_unlikely(CORE_PRIMARY != core->state) && act->id < 0) {
+            act->id = core_error (core->state);
+        }
+    }
+
+    struct gcs_act_rcvd const batch(*act);
+
+    for (int i = 0; i < count; i++) {
+        struct gcs_act_rcvd item(batch);
+
+        item.act.buf_len = sizes[i];
+        /* error codes are shared by all write sets */
+        if (batch.id > 0) item.id = batch.id + i;
+        if (my_msg) item.local = (const struct gu_buf*)locals[i].action;
+
+#ifndef GCS_FOR_GARB
+        void* item_plain;
+        item.act.buf = gcs_gcache_malloc (core->cache, sizes[i], &item_plain);
+
+        if (gu_unlikely(NULL == item.act.buf)) {
+            gu_fatal ("Could not allocate %zu bytes for action %d of "
+                      "multi-action message", sizes[i], i);
+            return -ENOTRECOVERABLE;
+        }
+
+        memcpy (item_plain, data, sizes[i]);
+        data += sizes[i];
+        gcs_gcache_drop_plaintext (core->cache, item.act.buf);
+#endif /* GCS_FOR_GARB */
+
+        if (0 == i)
+            *act = item;
+        else
+            core->batch_q->push_back(item);
+    }
+
+#ifndef GCS_FOR_GARB
+    gcs_gcache_free (core->cache, batch.act.buf);
+#endif /* GCS_FOR_GARB */
+
+    return act->act.buf_len;
+}
+
 /*!
  * Helper for gcs_core_recv(). Handles GCS_MSG_ACTION.
  *
@@ -576,7 +831,11 @@ core_handle_act_msg (gcs_core_t*          core,
 #endif
             assert(act->sender_idx == msg->sender_idx);
 
-            if (gu_likely(!my_msg)) {
+            if (gu_unlikely(frg.act_count > 1)) {
+                /* multi-action message, split it into separate write sets */
+                ret = core_handle_batch (core, frg, act, my_msg);
+            }
+            else if (gu_likely(!my_msg)) {
                 /* foreign action, must be passed from gcs_group */
                 assert (GCS_ACT_WRITESET != act->act.type || act->id > 0);
             }
@@ -834,8 +1093,9 @@ core_handle_comp_msg (gcs_core_t*          const core,
                     uuid = core->state_uuid;
                 }
 #endif
+                struct gu_buf const msg = { &uuid, sizeof(uuid) };
                 ret = core->backend.send (&core->backend,
-                                          &uuid,
+                                          &msg, 1,
                                           sizeof(uuid),
                                           GCS_MSG_STATE_UUID);
                 if (ret < 0) {
@@ -1192,6 +1452,13 @@ ssize_t gcs_core_recv (gcs_core_t*          conn,
 
     *recv_act = zero_act;
 
+    if (gu_unlikely(!conn->batch_q->empty())) {
+        /* return the rest of the last multi-action message first */
+        *recv_act = conn->batch_q->front();
+        conn->batch_q->pop_front();
+        return recv_act->act.buf_len;
+    }
+
     /* receive messages from group and demultiplex them
      * until finally some complete action is ready */
     do
@@ -1348,6 +1615,13 @@ long gcs_core_destroy (gcs_core_t* core)
         gcs_fifo_lite_pop_head (core->fifo);
     }
     gcs_fifo_lite_destroy (core->fifo);
+
+    while (!core->batch_q->empty()) {
+        gcs_gcache_free (core->cache, core->batch_q->front().act.buf);
+        core->batch_q->pop_front();
+    }
+    delete core->batch_q;
+
     gcs_group_free (&core->group);
 
     /* free buffers */
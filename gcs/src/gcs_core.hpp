@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2019 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -109,6 +109,36 @@ gcs_core_send (gcs_core_t*          core,
                size_t               act_size,
                gcs_act_type_t       act_type);
 
+/*! Maximum number of actions in a multi-action message */
+#define GCS_CORE_BATCH_MAX 256
+
+/*! Write set to be packed into a multi-action message */
+struct gcs_core_act
+{
+    const struct gu_buf* act;
+    size_t               act_size;
+};
+
+/*
+ * gcs_core_send_batch() atomically sends count write sets to group in one
+ * multi-action message. Upon delivery the write sets get consecutive global
+ * seqnos and are returned by consecutive gcs_core_recv() calls in the order
+ * of acts array, each one as if it was sent by gcs_core_send().
+ *
+ * NOT THREAD SAFE! Access should be serialized with gcs_core_send().
+ *
+ * Return values:
+ * non-negative - amount of message bytes sent (sans headers)
+ * negative     - error code as in gcs_core_send() or
+ *                -EPROTONOSUPPORT - group protocol does not support
+ *                                   multi-action messages, write sets
+ *                                   should be sent one by one
+ */
+extern ssize_t
+gcs_core_send_batch (gcs_core_t*                core,
+                     const struct gcs_core_act* acts,
+                     int                        count);
+
 /*
  * gcs_core_recv() blocks until some action is received from group.
  *
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2014 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -34,17 +34,27 @@ typedef struct dummy_msg
 }
 dummy_msg_t;
 
+/*! Creates message of len bytes gathered from the beginning of bufs array */
 static inline dummy_msg_t*
-dummy_msg_create (gcs_msg_type_t const type,
-                  size_t         const len,
-                  long           const sender,
-                  const void*    const buf)
+dummy_msg_create (gcs_msg_type_t       const type,
+                  size_t               const len,
+                  long                 const sender,
+                  const struct gu_buf* const bufs,
+                  size_t               const bufs_num)
 {
     dummy_msg_t *msg = NULL;
 
     if ((msg = static_cast<dummy_msg_t*>(gu_malloc (sizeof(dummy_msg_t) + len))))
     {
-        memcpy (msg->buf, buf, len);
+        size_t copied = 0;
+        for (size_t i = 0; i < bufs_num && copied < len; ++i)
+        {
+            size_t const to_copy = (size_t)bufs[i].size < len - copied ?
+                                   (size_t)bufs[i].size : len - copied;
+            memcpy (msg->buf + copied, bufs[i].ptr, to_copy);
+            copied += to_copy;
+        }
+        assert (copied == len);
         msg->len        = len;
         msg->type       = type;
         msg->sender_idx = sender;
@@ -102,6 +112,43 @@ GCS_BACKEND_DESTROY_FN(dummy_destroy)
     return 0;
 }
 
+/*! Puts a message gathered from bufs array in the message queue */
+static long
+dummy_inject_bufs (gcs_backend_t*       const backend,
+                   const struct gu_buf* const bufs,
+                   size_t               const bufs_num,
+                   size_t               const len,
+                   gcs_msg_type_t       const type,
+                   long                 const sender_idx)
+{
+    long         ret;
+    size_t       send_size = len < backend->conn->max_send_size ?
+                             len : backend->conn->max_send_size;
+    dummy_msg_t* msg = dummy_msg_create (type, send_size, sender_idx,
+                                         bufs, bufs_num);
+
+    if (msg)
+    {
+        dummy_msg_t** ptr = static_cast<dummy_msg_t**>(
+            gu_fifo_get_tail (backend->conn->gc_q));
+
+        if (gu_likely(ptr != NULL)) {
+            *ptr = msg;
+            gu_fifo_push_tail (backend->conn->gc_q);
+            ret = send_size;
+        }
+        else {
+            dummy_msg_destroy (msg);
+            ret = -EBADFD; // closed
+        }
+    }
+    else {
+        ret = -ENOMEM;
+    }
+
+    return ret;
+}
+
 static
 GCS_BACKEND_SEND_FN(dummy_send)
 {
@@ -112,8 +159,8 @@ GCS_BACKEND_SEND_FN(dummy_send)
 
     if (gu_likely(DUMMY_PRIM == dummy->state))
     {
-        err = gcs_dummy_inject_msg (backend, buf, len, msg_type,
-                                    backend->conn->my_idx);
+        err = dummy_inject_bufs (backend, bufs, bufs_num, len, msg_type,
+                                 backend->conn->my_idx);
     }
     else {
         static long send_error[DUMMY_PRIM] =
@@ -326,31 +373,8 @@ gcs_dummy_inject_msg (gcs_backend_t* backend,
                       gcs_msg_type_t type,
                       long           sender_idx)
 {
-    long         ret;
-    size_t       send_size = buf_len < backend->conn->max_send_size ?
-                             buf_len : backend->conn->max_send_size;
-    dummy_msg_t* msg = dummy_msg_create (type, send_size, sender_idx, buf);
-
-    if (msg)
-    {
-        dummy_msg_t** ptr = static_cast<dummy_msg_t**>(
-            gu_fifo_get_tail (backend->conn->gc_q));
-
-        if (gu_likely(ptr != NULL)) {
-            *ptr = msg;
-            gu_fifo_push_tail (backend->conn->gc_q);
-            ret = send_size;
-        }
-        else {
-            dummy_msg_destroy (msg);
-            ret = -EBADFD; // closed
-        }
-    }
-    else {
-        ret = -ENOMEM;
-    }
-
-    return ret;
+    struct gu_buf const msg = { buf, static_cast<ssize_t>(buf_len) };
+    return dummy_inject_bufs (backend, &msg, 1, buf_len, type, sender_idx);
 }
 
 /*! Sets the new component view.
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2011 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  *
@@ -194,4 +194,10 @@ gcs_fifo_lite_not_full (const gcs_fifo_lite_t* const fifo)
     return (fifo->used < fifo->length);
 }
 
+static inline bool
+gcs_fifo_lite_empty (const gcs_fifo_lite_t* const fifo)
+{
+    return (0 == fifo->used);
+}
+
 #endif /* _GCS_FIFO_LITE_H_ */
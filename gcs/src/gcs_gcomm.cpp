@@ -1,13 +1,9 @@
 /*
- * Copyright (C) 2009-2019 Codership Oy <info@codership.com>
+ * Copyright (C) 2009-2024 Codership Oy <info@codership.com>
  */
 
 /*!
  * @file GComm GCS Backend implementation
- *
- * @todo Figure out if there is lock-free way to handle RecvBuf
- *       push/pop operations.
- *
  */
 
 
@@ -26,8 +22,10 @@
 #include <gu_logger.hpp>
 #include <gu_thread.hpp>
 
+#include <atomic>
 #include <deque>
 #include <future>
+#include <type_traits>
 
 using namespace std;
 using namespace gu;
@@ -76,6 +74,24 @@ typedef deque<RecvBufData>
 
 RecvBufQueue;
 
+/*
+ * Messages from gcomm thread to GCS receiving thread.
+ *
+ * There is only one producer at a time: all handle_up() calls are made
+ * under Protonet mutex. There is only one consumer: gcomm_recv() called from
+ * GCS receiving thread. So this is a bounded single-producer/single-consumer
+ * ring where each side caches the other side's index and rereads it only
+ * when the cached value runs out, so that a consumer which falls behind
+ * pops a whole batch of messages with a single shared cache line access.
+ *
+ * Mutex and condition are used only to sleep on an empty ring: consumer
+ * announces itself in waiting_ and the producer signals only then, i.e.
+ * only on empty->non-empty transitions.
+ *
+ * gcomm thread must never block on a slow consumer, so when the ring is full
+ * messages spill over to a mutex-protected overflow queue. Until it is
+ * drained all new messages go there too to preserve the order.
+ */
 class RecvBuf
 {
 private:
@@ -83,34 +99,103 @@ private:
     class Waiting
     {
     public:
-        Waiting (bool& w) : w_(w) { w_ = true;  }
-        ~Waiting()                { w_ = false; }
+        Waiting (std::atomic<bool>& w) : w_(w)
+        {
+            w_.store(true, std::memory_order_relaxed);
+            /* pairs with the fence in push_back() */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ~Waiting() { w_.store(false, std::memory_order_relaxed); }
     private:
-        bool& w_;
+        std::atomic<bool>& w_;
     };
 
 public:
 
+    static size_t const SIZE = 1024; // must be a power of 2
+
     RecvBuf() : mutex_(gu::get_mutex_key(gu::GU_MUTEX_KEY_GCS_GCOMM_RECV_BUF)),
                 cond_(gu::get_cond_key(gu::GU_COND_KEY_GCS_GCOMM_RECV_BUF)),
-                queue_(), waiting_(false) { }
+                overflow_(), overflow_size_(0), waiting_(false),
+                ring_(static_cast<Slot*>(::operator new(SIZE * sizeof(Slot)))),
+                pad0_(), tail_(0), head_cache_(0),
+                pad1_(), head_(0), tail_cache_(0), overflow_front_(false),
+                pad2_()
+    { }
+
+    ~RecvBuf()
+    {
+        size_t const tail(tail_.load(std::memory_order_acquire));
+        for (size_t i(head_.load(std::memory_order_relaxed)); i != tail; ++i)
+        {
+            slot(i).~RecvBufData();
+        }
+        ::operator delete(ring_);
+    }
 
     void push_back(const RecvBufData& p)
     {
-        Lock lock(mutex_);
+        size_t const tail(tail_.load(std::memory_order_relaxed));
+
+        if (gu_likely(overflow_size_.load(std::memory_order_acquire) == 0) &&
+            (tail - head_cache_ < SIZE ||
+             tail - (head_cache_ = head_.load(std::memory_order_acquire))
+             < SIZE))
+        {
+            new (ring_ + (tail & (SIZE - 1))) RecvBufData(p);
+            tail_.store(tail + 1, std::memory_order_release);
 
-        queue_.push_back(p);
+            /* pairs with the fence in Waiting() */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (gu_likely(waiting_.load(std::memory_order_relaxed) == false))
+                return;
 
-        if (waiting_ == true) { cond_.signal(); }
+            Lock lock(mutex_);
+            cond_.signal();
+        }
+        else
+        {
+            Lock lock(mutex_);
+
+            if (overflow_.empty())
+            {
+                log_debug << "gcomm recv buffer full, spilling over";
+            }
+
+            overflow_.push_back(p);
+            overflow_size_.store(overflow_.size(), std::memory_order_release);
+
+            if (waiting_.load(std::memory_order_relaxed)) { cond_.signal(); }
+        }
     }
 
     const RecvBufData& front(const Date& timeout)
     {
-        Lock lock(mutex_);
-
-        while (queue_.empty())
+        while (true)
         {
+            size_t const head(head_.load(std::memory_order_relaxed));
+
+            if (gu_likely(head != tail_cache_ ||
+                          head != (tail_cache_ =
+                                   tail_.load(std::memory_order_acquire))))
+            {
+                overflow_front_ = false;
+                return slot(head);
+            }
+
+            Lock lock(mutex_);
+
+            if (overflow_size_.load(std::memory_order_relaxed) > 0)
+            {
+                /* deque::push_back() does not invalidate references */
+                overflow_front_ = true;
+                return overflow_.front();
+            }
+
             Waiting w(waiting_);
+
+            if (head != tail_.load(std::memory_order_acquire)) continue;
+
             if (gu_likely (timeout == GU_TIME_ETERNITY))
             {
                 lock.wait(cond_);
@@ -120,24 +205,58 @@ public:
                 lock.wait(cond_, timeout);
             }
         }
-        assert (false == waiting_);
-
-        return queue_.front();
     }
 
     void pop_front()
     {
-        Lock lock(mutex_);
-        assert(queue_.empty() == false);
-        queue_.pop_front();
+        if (gu_likely(overflow_front_ == false))
+        {
+            size_t const head(head_.load(std::memory_order_relaxed));
+            assert(head != tail_cache_);
+            slot(head).~RecvBufData();
+            head_.store(head + 1, std::memory_order_release);
+        }
+        else
+        {
+            Lock lock(mutex_);
+            assert(overflow_.empty() == false);
+            overflow_.pop_front();
+            overflow_size_.store(overflow_.size(), std::memory_order_release);
+            overflow_front_ = false;
+        }
     }
 
 private:
 
-    Mutex mutex_;
-    Cond cond_;
-    RecvBufQueue queue_;
-    bool waiting_;
+    RecvBuf(const RecvBuf&);
+    RecvBuf& operator=(const RecvBuf&);
+
+    struct Slot
+    {
+        std::aligned_storage<sizeof(RecvBufData),
+                                      alignof(RecvBufData)>::type buf_;
+    };
+
+    RecvBufData& slot(size_t const i)
+    {
+        return *reinterpret_cast<RecvBufData*>(ring_ + (i & (SIZE - 1)));
+    }
+
+    Mutex               mutex_;
+    Cond                cond_;
+    RecvBufQueue        overflow_;
+    std::atomic<size_t> overflow_size_;
+    std::atomic<bool>   waiting_;
+    Slot* const         ring_;
+    // keep producer and consumer indices on separate cache lines
+    char                pad0_[64];
+    std::atomic<size_t> tail_;
+    size_t              head_cache_;     // producer's copy of head_
+    char                pad1_[64];
+    std::atomic<size_t> head_;
+    size_t              tail_cache_;     // consumer's copy of tail_
+    bool                overflow_front_; // front() returned overflow item
+    char                pad2_[64];
 };
 
 class GCommConn : public Toplay
@@ -515,10 +634,18 @@ static GCS_BACKEND_SEND_FN(gcomm_send)
 
     GCommConn& conn(*ref.get());
 
-    Datagram dg(
-        SharedBuffer(
-            new Buffer(reinterpret_cast<const byte_t*>(buf),
-                       reinterpret_cast<const byte_t*>(buf) + len)));
+    // Datagram must own its payload as it may be retained for
+    // retransmission, so message buffers are gathered here, once.
+    SharedBuffer payload(make_shared_buffer());
+    payload->reserve(len);
+    for (size_t i(0); i < bufs_num; ++i)
+    {
+        const byte_t* const ptr(static_cast<const byte_t*>(bufs[i].ptr));
+        payload->insert(payload->end(), ptr, ptr + bufs[i].size);
+    }
+    assert(payload->size() == len);
+
+    Datagram dg(payload);
 
     int err;
     // Set thread scheduling params if gcomm thread runs with
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -223,8 +223,11 @@ gcs_group_handle_act_msg (gcs_group_t*          const group,
                       commonly_supported_version)) {
             /* Common situation -
              * increment and assign act_id only for totally ordered actions
-             * and only in PRIM (skip messages while in state exchange) */
-            rcvd->id = ++group->act_id_;
+             * and only in PRIM (skip messages while in state exchange).
+             * Multi-action message reserves a range of consecutive ids
+             * starting with the assigned one. */
+            rcvd->id = group->act_id_ + 1;
+            group->act_id_ += frg->act_count;
         }
         else if (GCS_ACT_WRITESET  == rcvd->act.type) {
             /* Rare situations */
@@ -1,11 +1,12 @@
 /*
- * Copyright (C) 2010-2017 Codership Oy <info@codership.com>
+ * Copyright (C) 2010-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
 
 #include "gcs_params.hpp"
-#include "gcs_fc.hpp" // gcs_fc_hard_limit_fix
+#include "gcs_fc.hpp"   // gcs_fc_hard_limit_fix
+#include "gcs_core.hpp" // GCS_CORE_BATCH_MAX
 
 #include "gu_inttypes.hpp"
 #include "gu_config.hpp" // gu::Config::Flag
@@ -22,6 +23,9 @@ const char* const GCS_PARAMS_MAX_PKT_SIZE      = "gcs.max_packet_size";
 const char* const GCS_PARAMS_RECV_Q_HARD_LIMIT = "gcs.recv_q_hard_limit";
 const char* const GCS_PARAMS_RECV_Q_SOFT_LIMIT = "gcs.recv_q_soft_limit";
 const char* const GCS_PARAMS_MAX_THROTTLE      = "gcs.max_throttle";
+const char* const GCS_PARAMS_BATCH_SIZE        = "gcs.batch_size";
+const char* const GCS_PARAMS_BATCH_BYTES       = "gcs.batch_bytes";
+const char* const GCS_PARAMS_BATCH_LATENCY     = "gcs.batch_latency";
 #ifdef GCS_SM_DEBUG
 const char* const GCS_PARAMS_SM_DUMP           = "gcs.sm_dump";
 #endif /* GCS_SM_DEBUG */
@@ -36,6 +40,9 @@ static const char* const GCS_PARAMS_MAX_PKT_SIZE_DEFAULT      = "64500";
 static ssize_t const GCS_PARAMS_RECV_Q_HARD_LIMIT_DEFAULT     = SSIZE_MAX;
 static const char* const GCS_PARAMS_RECV_Q_SOFT_LIMIT_DEFAULT = "0.25";
 static const char* const GCS_PARAMS_MAX_THROTTLE_DEFAULT      = "0.25";
+static const char* const GCS_PARAMS_BATCH_SIZE_DEFAULT        = "1";
+static const char* const GCS_PARAMS_BATCH_BYTES_DEFAULT       = "32768";
+static const char* const GCS_PARAMS_BATCH_LATENCY_DEFAULT     = "100";
 
 bool
 gcs_params_register(gu_config_t* conf)
@@ -78,6 +85,15 @@ gcs_params_register(gu_config_t* conf)
     ret |= gu_config_add (conf, GCS_PARAMS_MAX_THROTTLE,
                           GCS_PARAMS_MAX_THROTTLE_DEFAULT,
                           gu::Config::Flag::type_double);
+    ret |= gu_config_add (conf, GCS_PARAMS_BATCH_SIZE,
+                          GCS_PARAMS_BATCH_SIZE_DEFAULT,
+                          gu::Config::Flag::type_integer);
+    ret |= gu_config_add (conf, GCS_PARAMS_BATCH_BYTES,
+                          GCS_PARAMS_BATCH_BYTES_DEFAULT,
+                          gu::Config::Flag::type_integer);
+    ret |= gu_config_add (conf, GCS_PARAMS_BATCH_LATENCY,
+                          GCS_PARAMS_BATCH_LATENCY_DEFAULT,
+                          gu::Config::Flag::type_integer);
 #ifdef GCS_SM_DEBUG
     ret |= gu_config_add (conf, GCS_PARAMS_SM_DUMP, "0", 0);
 #endif /* GCS_SM_DEBUG */
@@ -221,6 +237,17 @@ gcs_params_init (struct gcs_params* params, gu_config_t* config)
     if ((ret = params_init_long (config, GCS_PARAMS_MAX_PKT_SIZE, 0,LONG_MAX,
                                  &params->max_packet_size))) return ret;
 
+    if ((ret = params_init_long (config, GCS_PARAMS_BATCH_SIZE,
+                                 1, GCS_CORE_BATCH_MAX,
+                                 &params->batch_size))) return ret;
+
+    if ((ret = params_init_long (config, GCS_PARAMS_BATCH_BYTES, 0, LONG_MAX,
+                                 &params->batch_bytes))) return ret;
+
+    if ((ret = params_init_long (config, GCS_PARAMS_BATCH_LATENCY,
+                                 0, 1000000,
+                                 &params->batch_latency))) return ret;
+
     if ((ret = params_init_double (config, GCS_PARAMS_FC_FACTOR, 0.0, 1.0,
                                    &params->fc_resume_factor))) return ret;
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2010-2014 Codership Oy <info@codership.com>
+ * Copyright (C) 2010-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -17,6 +17,9 @@ struct gcs_params
     long    fc_base_limit;
     long    max_packet_size;
     long    fc_debug;
+    long    batch_size;
+    long    batch_bytes;
+    long    batch_latency;
     bool    fc_single_primary;
     bool    sync_donor;
 };
@@ -30,6 +33,9 @@ extern const char* const GCS_PARAMS_MAX_PKT_SIZE;
 extern const char* const GCS_PARAMS_RECV_Q_HARD_LIMIT;
 extern const char* const GCS_PARAMS_RECV_Q_SOFT_LIMIT;
 extern const char* const GCS_PARAMS_MAX_THROTTLE;
+extern const char* const GCS_PARAMS_BATCH_SIZE;
+extern const char* const GCS_PARAMS_BATCH_BYTES;
+extern const char* const GCS_PARAMS_BATCH_LATENCY;
 #ifdef GCS_SM_DEBUG
 extern const char* const GCS_PARAMS_SM_DUMP;
 #endif /* GCS_SM_DEBUG */
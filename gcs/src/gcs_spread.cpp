@@ -246,14 +246,23 @@ GCS_BACKEND_SEND_FN(spread_send)
 
     if (SPREAD_TRANSITIONAL == spread->config) return -EAGAIN;
 
+    if (bufs_num > MAX_CLIENT_SCATTER_ELEMENTS) return -EMSGSIZE;
+
+    scatter msg;
+    msg.num_elements = bufs_num;
+    for (size_t i = 0; i < bufs_num; i++)
+    {
+        msg.elements[i].buf = (char*)bufs[i].ptr;
+        msg.elements[i].len = bufs[i].size;
+    }
+
     /* can it be that not all of the message is sent? */
-    ret = SP_multicast (spread->mbox,         // mailbox
-			SAFE_MESS,            // service type
-			spread->channel,      // destination group
-			(short)msg_type,      // message from application
-			len,                  // message length
-			(const char*)buf      // message buffer
-			);
+    ret = SP_scat_multicast (spread->mbox,    // mailbox
+			     SAFE_MESS,       // service type
+			     spread->channel, // destination group
+			     (short)msg_type, // message from application
+			     &msg             // message buffers
+			     );
 
     if (ret != len)
     {
@@ -271,7 +280,7 @@ GCS_BACKEND_SEND_FN(spread_send)
     }
 
 #ifdef GCS_DEBUG_SPREAD
-//    gu_debug ("spread_send: message sent: %p, len: %d\n", buf, ret);
+//    gu_debug ("spread_send: message sent: %p, len: %d\n", bufs[0].ptr, ret);
 #endif
     return ret;
 }
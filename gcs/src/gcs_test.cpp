@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2021 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -19,6 +19,7 @@
 
 #include <GCache.hpp>
 #include <galerautils.h>
+#include <gu_asio.hpp> // gu::ssl_register_params()
 
 #include "gcs.hpp"
 #include "gcs_test.hpp"
@@ -67,12 +68,16 @@ gcs_test_thread_t;
 
 #define MAX_MSG_LEN (1 << 16)
 
+long msg_len = 0;
+
 static long gcs_test_thread_create (gcs_test_thread_t *t, long id, long n_tries)
 {
+    long const buf_len = msg_len > MAX_MSG_LEN ? msg_len : MAX_MSG_LEN;
+
     t->id           = id;
-    t->msg          = calloc (MAX_MSG_LEN, sizeof(char));
+    t->msg          = calloc (buf_len, sizeof(char));
     t->act.buf      = t->msg;
-    t->act.size     = MAX_MSG_LEN;
+    t->act.size     = buf_len;
     t->act.seqno_g  = GCS_SEQNO_ILL;
     t->act.seqno_l  = GCS_SEQNO_ILL;
     t->act.type     = GCS_ACT_WRITESET;
@@ -242,7 +247,6 @@ gu_to_t    *to  = NULL;
 long msg_sent  = 0;
 long msg_recvd = 0;
 long msg_repld = 0;
-long msg_len   = 0;
 
 size_t size_sent  = 0;
 size_t size_repld = 0;
@@ -437,7 +441,8 @@ gcs_test_handle_configuration (gcs_conn_t* gcs, gcs_test_thread_t* thread)
     static gcs_seqno_t conf_id = 0;
     gcs_act_cchange const conf(thread->act.buf, thread->act.size);
     int const my_idx(thread->act.seqno_g);
-    gcs_node_state my_state(conf.memb[my_idx].state_);
+    gcs_node_state my_state(my_idx >= 0 ? conf.memb[my_idx].state_ :
+                            GCS_NODE_STATE_NON_PRIM); // self-leave
     gu_uuid_t ist_uuid = {{0, }};
     gcs_seqno_t ist_seqno = GCS_SEQNO_ILL;
 
@@ -634,6 +639,8 @@ typedef struct gcs_test_conf
     long n_repl;
     long n_send;
     long n_recv;
+    long msg_len;
+    long batch;
     const char* backend;
 }
 gcs_test_conf_t;
@@ -649,10 +656,20 @@ static long gcs_test_conf (gcs_test_conf_t *conf, long argc, char *argv[])
     conf->n_repl  = 10;
     conf->n_send  = 0;
     conf->n_recv  = 1;
+    conf->msg_len = 1300;
+    conf->batch   = 1;
     conf->backend = DEFAULT_BACKEND;
 
     switch (argc)
     {
+    case 8:
+        conf->batch = strtol (argv[7], &endptr, 10);
+        if ('\0' != *endptr || conf->batch <= 0) goto error;
+        // fall through
+    case 7:
+        conf->msg_len = strtol (argv[6], &endptr, 10);
+        if ('\0' != *endptr || conf->msg_len <= 0) goto error;
+        // fall through
     case 6:
         conf->n_recv = strtol (argv[5], &endptr, 10);
         if ('\0' != *endptr) goto error;
@@ -677,15 +694,17 @@ static long gcs_test_conf (gcs_test_conf_t *conf, long argc, char *argv[])
     }
 
     printf ("Config: n_tries = %ld, n_repl = %ld, n_send = %ld, n_recv = %ld, "
-            "backend = %s\n",
+            "msg_len = %ld, batch = %ld, backend = %s\n",
             conf->n_tries, conf->n_repl, conf->n_send, conf->n_recv,
-            conf->backend);
+            conf->msg_len, conf->batch, conf->backend);
 
     return 0;
 error:
     printf ("Usage: %s [backend] [tries:%ld] [repl threads:%ld] "
-            "[send threads: %ld] [recv threads: %ld]\n",
-            argv[0], conf->n_tries, conf->n_repl, conf->n_send, conf->n_recv);
+            "[send threads: %ld] [recv threads: %ld] [max msg len: %ld] "
+            "[repl batch: %ld]\n",
+            argv[0], conf->n_tries, conf->n_repl, conf->n_send, conf->n_recv,
+            conf->msg_len, conf->batch);
     exit (EXIT_SUCCESS);
 }
 
@@ -729,7 +748,9 @@ int main (int argc, char *argv[])
     gu_config_set_string(gconf, "gcache.size", "0");
     gu_config_set_string(gconf, "gcache.page_size", "1M");
 
+    gu::ssl_register_params(*reinterpret_cast<gu::Config*>(gconf));
     gcs_register_params(gconf);
+    gu_config_set_int64(gconf, "gcs.batch_size", conf.batch);
 
     if (!(cache = gcache_create (gconf, ""))) goto out;
     if (!(gcs = gcs_create (gconf, cache, NULL, NULL, NULL, 0, 0))) goto out;
@@ -739,8 +760,8 @@ int main (int argc, char *argv[])
     if ((err  = gcs_open   (gcs, channel, conf.backend, bstrap))) goto out;
     printf ("Connected\n");
 
-    msg_len = 1300;
-    if (msg_len > MAX_MSG_LEN) msg_len = MAX_MSG_LEN;
+    msg_len = conf.msg_len;
+    if (!throughput && msg_len > MAX_MSG_LEN) msg_len = MAX_MSG_LEN;
     gcs_conf_set_pkt_size (gcs, 7570); // to test fragmentation
 
     if ((err = gcs_test_thread_pool_create
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2021 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -498,7 +498,8 @@ core_test_cleanup ()
     ck_assert(!core_test_check_conf(act.out, act.size, false, -1, 0));
 
     // check that backend is closed too
-    ret = Backend->send (Backend, tmp, sizeof(tmp), GCS_MSG_ACTION);
+    struct gu_buf const tmp_buf = { tmp, sizeof(tmp) };
+    ret = Backend->send (Backend, &tmp_buf, 1, sizeof(tmp), GCS_MSG_ACTION);
     ck_assert(ret == -EBADFD);
 
     ret = gcs_core_destroy (Core);
@@ -829,6 +830,57 @@ START_TEST (gcs_core_test_own_v1E)
 }
 END_TEST
 
+START_TEST (gcs_core_test_batch)
+{
+    gu::Config config;
+    core_test_init (&config, false, true, GCS_PROTO_BATCH);
+    gcs_core_send_lock_step (Core, false);
+
+    struct gcs_core_act const acts[] = {
+        { act1, sizeof(act1_str) },
+        { act2, sizeof(act2_str) },
+        { act3, sizeof(act3_str) }
+    };
+    const char* const strs[] = { act1_str, act2_str, act3_str };
+    int const count(sizeof(acts)/sizeof(acts[0]));
+
+    size_t total(gcs_act_proto_batch_hdr_size(count));
+    for (int i = 0; i < count; i++) total += acts[i].act_size;
+
+    ssize_t const ret(gcs_core_send_batch (Core, acts, count));
+    ck_assert_msg(ret == ssize_t(total), "Expected %zu, got %zd (%s)",
+                  total, ret, strerror(-ret));
+
+    // write sets must come out separately, in order, with consecutive seqnos
+    for (int i = 0; i < count; i++) {
+        action_t act;
+        act.in = acts[i].act;
+        ck_assert(!CORE_RECV_ACT (&act, strs[i], acts[i].act_size,
+                                  GCS_ACT_WRITESET));
+        ck_assert(act.local == acts[i].act);
+    }
+
+    gcs_core_send_lock_step (Core, true);
+    core_test_cleanup ();
+}
+END_TEST
+
+START_TEST (gcs_core_test_batch_proto)
+{
+    gu::Config config;
+    core_test_init (&config, false, true, GCS_PROTO_BATCH - 1);
+
+    struct gcs_core_act const acts[] = {
+        { act1, sizeof(act1_str) },
+        { act2, sizeof(act2_str) }
+    };
+
+    ck_assert(-EPROTONOSUPPORT == gcs_core_send_batch (Core, acts, 2));
+
+    core_test_cleanup ();
+}
+END_TEST
+
 #ifdef GCS_ALLOW_GH74
 /*
  * Disabled test because it is too slow and timeouts on crowded
@@ -868,6 +920,7 @@ START_TEST (gcs_core_test_gh74)
     frg.act_id = 1;
     frg.act_size = act_size;
     frg.act_type = GCS_ACT_STATE_REQ;
+    frg.act_count = 1;
     char msg_buf[1024];
     ck_assert(!gcs_act_proto_write(&frg, msg_buf, sizeof(msg_buf)));
     memcpy(const_cast<void*>(frg.frag), act_ptr, act_size);
@@ -1092,6 +1145,8 @@ Suite *gcs_core_suite(void)
       tcase_add_test  (tcase, gcs_core_test_own_v0);
       tcase_add_test  (tcase, gcs_core_test_own_v1);
       tcase_add_test  (tcase, gcs_core_test_own_v1E);
+      tcase_add_test  (tcase, gcs_core_test_batch);
+      tcase_add_test  (tcase, gcs_core_test_batch_proto);
 #ifdef GCS_ALLOW_GH74
       tcase_add_test  (tcase, gcs_core_test_gh74);
 #endif /* GCS_ALLOW_GH74 */
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -108,6 +108,7 @@ START_TEST (gcs_group_configuration)
     frg1.frag_no   = 0;
     frg1.act_type  = GCS_ACT_WRITESET;
     frg1.proto_ver = 0;
+    frg1.act_count = 1;
 
     // normal fragments
     frg2 = frg3 = frg1;
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2008-2020 Codership Oy <info@codership.com>
+ * Copyright (C) 2008-2024 Codership Oy <info@codership.com>
  *
  * $Id$
  */
@@ -40,6 +40,7 @@ START_TEST (gcs_proto_test)
     frg_send.frag_no   = 0;
     frg_send.act_type  = (gcs_act_type_t)0;
     frg_send.proto_ver = 0;
+    frg_send.act_count = 1;
 
     // set up action header
     ret = gcs_act_proto_write (&frg_send, buf, buf_len);
@@ -101,6 +102,57 @@ START_TEST (gcs_proto_test)
 }
 END_TEST
 
+START_TEST (gcs_proto_batch_test)
+{
+    uint32_t       buf[16]; // size table must be aligned
+    gcs_act_frag_t frg_send, frg_recv;
+    long           ret;
+
+    frg_send.act_id    = getpid();
+    frg_send.act_size  = 30;
+    frg_send.frag      = NULL;
+    frg_send.frag_len  = 0;
+    frg_send.frag_no   = 0;
+    frg_send.act_type  = GCS_ACT_WRITESET;
+    frg_send.proto_ver = GCS_PROTO_BATCH;
+    frg_send.act_count = 3;
+
+    ret = gcs_act_proto_write (&frg_send, buf, sizeof(buf));
+    ck_assert_msg(0 == ret, "error code: %ld", ret);
+
+    ret = gcs_act_proto_read (&frg_recv, buf, sizeof(buf));
+    ck_assert_msg(0 == ret, "error code: %ld", ret);
+    ck_assert(!frgcmp(&frg_send, &frg_recv));
+    ck_assert_int_eq(frg_recv.act_count, 3);
+
+    // only write sets can be batched
+    frg_send.act_type = GCS_ACT_STATE_REQ;
+    ret = gcs_act_proto_write (&frg_send, buf, sizeof(buf));
+    ck_assert_msg(0 == ret, "error code: %ld", ret);
+    ret = gcs_act_proto_read (&frg_recv, buf, sizeof(buf));
+    ck_assert_int_eq(ret, -EBADMSG);
+
+    // action size table
+    size_t const sizes_send[3] = { 5, 1, 12 };
+    size_t       sizes_recv[3] = { 0, };
+    size_t const hdr_size(gcs_act_proto_batch_hdr_size(3));
+    size_t const msg_size(hdr_size + 5 + 1 + 12);
+
+    ck_assert(hdr_size <= sizeof(buf));
+    gcs_act_proto_batch_write (buf, sizes_send, 3);
+
+    ret = gcs_act_proto_batch_read (buf, msg_size, 3, sizes_recv);
+    ck_assert_msg(0 == ret, "error code: %ld", ret);
+    ck_assert(!memcmp(sizes_send, sizes_recv, sizeof(sizes_send)));
+
+    // size mismatch and wrong count must be detected
+    ret = gcs_act_proto_batch_read (buf, msg_size + 1, 3, sizes_recv);
+    ck_assert_int_eq(ret, -EBADMSG);
+    ret = gcs_act_proto_batch_read (buf, msg_size, 2, sizes_recv);
+    ck_assert_int_eq(ret, -EBADMSG);
+}
+END_TEST
+
 Suite *gcs_proto_suite(void)
 {
   Suite *suite = suite_create("GCS core protocol");
@@ -108,6 +160,7 @@ Suite *gcs_proto_suite(void)
 
   suite_add_tcase (suite, tcase);
   tcase_add_test  (tcase, gcs_proto_test);
+  tcase_add_test  (tcase, gcs_proto_batch_test);
   return suite;
 }
 